@@ -56,9 +56,17 @@
 
 
 
+#include <atomic>
 #include <TimeLib.h>            // https://github.com/PaulStoffregen/Time
 #include <TelnetStream.h>       // https://github.com/jandrassy/TelnetStream/commit/1294a9ee5cc9b1f7e51005091e351d60c8cddecf
 #include "safeTimers.h"
+#include "taskScheduler.h"
+#include "fixedDecimal.h"
+#include "jsonTokenizer.h"
+#include "scratchArena.h"
+#include "MQTTqueue.h"
+#include "httpJobs.h"
+#include "telegramGenerator.h"
 
 #ifdef USE_SYSLOGGER
   #include "ESP_SysLogger.h"      // https://github.com/mrWheel/ESP_SysLogger
@@ -85,14 +93,83 @@
 
 #define _DEFAULT_HOSTNAME  "DSMR-API"  
 
+#define SM_UTC_OFFSET      1            // hours: the meter runs on CET, +1 in summer (S/W flag)
+
 #define SETTINGS_FILE      "/DSMRsettings.ini"
+#define SETTINGS_BIN_FILE  "/DSMRsettings.bin"
+#define SETTINGS_MAGIC     0x53455431   // "SET1"
+#define SETTINGS_VERSION   3            // +1 for every change in settingsRecord!
+#define SETTINGS_QUIET_SEC 5            // commit changed settings after this quiet time
 
 #define LED_ON            LOW
 #define LED_OFF          HIGH
 #define FLASH_BUTTON        0
 #define MAXCOLORNAME       15
 #define JSON_BUFF_MAX     255
+
+//-- power quality (see powerQuality) --
+#define PQ_VOLT_LOW       207.0   // V  (230 -10%)
+#define PQ_VOLT_HIGH      253.0   // V  (230 +10%)
+#define PQ_VOLT_HYST        2.0   // V
+#define PQ_CURRENT_MAX     25.0   // A  per phase
+#define PQ_IMBALANCE_MAX   16.0   // A  between the highest and lowest phase current
+#define PQ_CURRENT_HYST     1.0   // A
+#define PQ_EVENT_SLOTS       16
+
+enum    { PQ_EV_UNDERVOLT, PQ_EV_OVERVOLT, PQ_EV_OVERCURRENT, PQ_EV_IMBALANCE, PQ_EV_TYPES };
+enum    { PQ_VOLTAGE, PQ_CURRENT, PQ_POWER, PQ_QUANTITIES };
+enum    { PQ_HOUR, PQ_DAY, PQ_PERIODS };
+
+//-- telegram pipeline: time budget per stage (see processTelegram) --
+#define TELEGRAM_BUDGET_MS   800    // one telegram, all stages (1 Hz in continuous mode)
+#define STAGE_PARSE_MS       150
+#define STAGE_PROCESS_MS      50
+#define STAGE_FILES_MS       300    // only on a new hour
+#define STAGE_MQTT_MS        150
+#define STAGE_INFLUX_MS      150
+#define STAGE_MAX_DEFER        5    // then it runs anyway
+#define SM_RX_BUFF_SIZE     1536    // a whole telegram fits while loop() is busy (continuous mode)
+
+enum    { STAGE_PARSE, STAGE_PROCESS, STAGE_FILES, STAGE_MQTT, STAGE_INFLUX, STAGES };
+
+//-- output sinks: interval and aggregation of the power fields (see sinkPolicy) --
+#define SINK_FIELDS           16    // kW, V and A fields that are aggregated
+#define SINK_MAX_INTERVAL   3600    // sec
+#define SINK_MAX_SAMPLES    3600    // in one window (the sums must fit in 32 bits)
+
+enum    { SINK_MQTT, SINK_INFLUX, SINK_OLED, SINKS };
+enum    { AGG_LAST, AGG_MEAN, AGG_MIN, AGG_MAX, AGGS };
+
+#define BOOT_STAGES           10    // boot timeline (see bootMark())
+
+//-- memory pressure: shed load below these, reboot only as a last resort --
+#define MEM_HEAP_LOW        12000   // free heap (bytes)
+#define MEM_BLOCK_LOW        6000   // largest free block (bytes)
+#define MEM_HEAP_CRITICAL    7000
+#define MEM_BLOCK_CRITICAL   3000
+#define MEM_HYSTERESIS       2000   // to get back to a better level
+#define MEM_HEAP_REBOOT      4000   // below this for MEM_REBOOT_AFTER: reboot
+#define MEM_REBOOT_AFTER      120   // seconds
+#define MEM_MQTT_BUFF_MIN     256   // MQTT buffer size at MEM_CRITICAL
+
+enum    { MEM_OK, MEM_LOW, MEM_CRITICAL };
 #define MQTT_BUFF_MAX     200
+#define MQTT_STATE_BUFF_MAX  1536   // one JSON document with all fields
+#define MQTT_STATE_STR_MAX    100   // max. length of a String value in the state document
+#define MQTT_MAX_FIELDS        60   // (at least) the number of fields in MyData
+#define MQTT_TOPIC_POOL_MAX  2048   // all "<topTopic>/<field>" topics
+#define MQTT_DNS_TTL         3600   // seconds a resolved broker address is used
+#define MQTT_DNS_TIMEOUT     1000   // ms to wait for the (asynchronous) lookup
+#define MQTT_TCP_TIMEOUT     1500   // ms to wait for the (non-blocking) TCP connection
+#define MQTT_SOCKET_TIMEOUT     2   // seconds to wait for CONNACK
+#define MQTT_BACKOFF_MIN     5000   // ms, doubles after every failed attempt ..
+#define MQTT_BACKOFF_MAX   600000   // .. up to 10 minutes
+#define MQTT_DISCOVERY_BURST    3   // auto discovery messages per loop()
+#define MQTT_DISCOVERY_BUFF_MAX 512   // one auto discovery payload
+#define MQTT_HA_HASH_FILE "/mqttha.hash"
+#define MQTT_HA_STATUS_TOPIC "homeassistant/status"   // HA birth/will message
+
+enum    { MQTT_MODE_TOPICS, MQTT_MODE_STATE, MQTT_MODE_BOTH };
 
 //-------------------------.........1....1....2....2....3....3....4....4....5....5....6....6....7....7
 //-------------------------1...5....0....5....0....5....0....5....0....5....0....5....0....5....0....5
@@ -111,6 +188,23 @@
 
 enum    { PERIOD_UNKNOWN, HOURS, DAYS, MONTHS, YEARS };
 
+//-- one column (file) per M-Bus channel next to every RING file (see histColumns) --
+//-------------------------.........1....1....2
+//-------------------------1...5....0....5....0
+#define COL_FORMAT        "%-8.8s;%10s;\n"
+#define COL_RECLEN        21
+#define COL_FILE_FORMAT   "/RING%s-%s.csv"    // period, channel
+#define COL_FILE_LEN      32
+
+enum    { COL_WATER, COL_THERMAL, COL_SLAVE, HIST_COLUMNS };
+
+//-- FSexplorer --
+#define FS_NAME_LEN       32      // SPIFFS names are max. 31 chars (with the '/')
+#define FS_SORT_WINDOW     8      // nextFile(): names sorted per walk of the directory
+#define UPLOAD_BUF_SIZE   2048    // uploads are written in whole SPIFFS pages (256 bytes)
+#define UPLOAD_TMP_FILE   "/upload.tmp"   // renamed to the real name when the upload is complete
+#define LIST_BUF_SIZE     512     // the file listing is sent in parts of this size
+
 //prototype esp helper
 void esp_reboot();
 uint32_t esp_get_free_block();
@@ -119,6 +213,10 @@ uint32_t esp_get_free_block();
 #include "espHelper.h"
 #include "oledStuff.h"
 #include "networkStuff.h"
+#include <lwip/dns.h>           // dns_gethostbyname() does not block (WiFi.hostByName() does)
+#if defined(ESP8266)
+  #include <include/ClientContext.h>  // to hand a (non-blocking) connected tcp_pcb to a WiFiClient
+#endif
 
 /**
  * Define the DSMRdata we're interested in, as well as the DSMRdatastructure to
@@ -200,6 +298,114 @@ static dataStruct hourData;   // 0 + 1-24
 static dataStruct dayData;    // 1 - 7 (0=header, 1=sunday)
 static dataStruct monthData;  // 0 + year1 1 t/m 12 + year2 1 t/m 12
 
+typedef struct {
+    uint16_t  topic;        // offset in mqttTopicPool
+    uint16_t  maxSilence;   // seconds, 0 = only publish on change
+    uint32_t  deadband;     // in 1/1000 of the unit of the field
+    uint32_t  lastSent;     // seconds since boot +1, 0 = never sent
+    int64_t   lastValue;    // in 1/1000 of the unit (hash for Strings)
+} mqttField;                // publish-on-change state of one MyData field
+
+typedef struct {
+    const char *unit;       // unit of the MyData field
+    const char *haUnit;
+    const char *devClass;
+    const char *stateClass;
+} haDeviceClass;            // Home Assistant auto discovery
+
+typedef struct {
+    uint32_t  magic;
+    uint16_t  version;      // SETTINGS_VERSION
+    uint16_t  size;         // sizeof(settingsRecord)
+    uint32_t  crc;          // crc32 of the record with crc = 0
+    float     EDT1, EDT2, ERT1, ERT2, GDT;
+    float     ENBK, GNBK;
+    uint16_t  oledSleep;
+    uint8_t   oledType, oledFlip;
+    uint8_t   telegramInterval, smHasFaseInfo;
+    uint8_t   continuousRead;
+    uint8_t   mqttMode;
+    uint8_t   mqttAggregate, influxDBaggregate, oledAggregate;
+    uint16_t  influxDBinterval, oledInterval;
+    int32_t   mqttInterval, mqttBrokerPort;
+    uint16_t  influxDBport;
+    char      hostname[30];
+    char      indexPage[50];
+    char      mqttBroker[101], mqttUser[40], mqttPasswd[30], mqttTopTopic[21];
+    char      mindergasToken[21];
+    char      influxDBhostname[101], influxDBdatabasename[30];
+} settingsRecord;           // contents of SETTINGS_BIN_FILE
+
+typedef struct {
+    const char *name;       // channel in the file name and the API
+    const char *unit;
+} histColumn;               // one M-Bus channel with history (see histColumns)
+
+typedef struct {
+    uint16_t  slot;         // ring slot of the running period
+    bool      valid;        // start is known
+    bool      prevValid;
+    char      id[9];        // recid of the running period
+    char      prevId[9];
+    int32_t   start[5];     // edt1, edt2, ert1, ert2, gdt at the start of the running period (1/1000)
+    int32_t   prev[5];      // usage in the previous period (1/1000)
+} histSummary;              // per HOURS, DAYS and MONTHS (see histSummary)
+
+typedef struct {
+    uint32_t  n;
+    float     mean;
+    float     m2;           // sum of squared differences from the mean (Welford)
+    float     min, max;
+} pqStat;                   // running statistics of one quantity
+
+typedef struct {
+    uint32_t  seq;          // 1, 2, .. (0 = empty slot)
+    time_t    start;
+    time_t    end;          // 0 = still going on
+    uint8_t   type;         // PQ_EV_..
+    uint8_t   phase;        // 1 .. 3 (0 = all phases)
+    float     extreme;      // lowest/highest value during the event
+} pqEvent;                  // one power quality event
+
+typedef struct {
+    const char *name;
+    uint16_t  budgetMs;
+    bool      deferrable;   // may wait for the next telegram
+    uint8_t   deferRow;     // deferred this many times in a row
+    uint32_t  runs;
+    uint32_t  overruns;     // took longer than budgetMs
+    uint32_t  deferred;
+    uint32_t  lastUs, maxUs;
+    uint64_t  totalUs;
+} telegramStage;            // one stage of processing a telegram
+
+typedef struct {
+    const char *name;
+    uint32_t  atMs;         // millis() when the stage was done
+} bootStage;                // one stage of setup() (and the first telegram)
+
+typedef struct {
+    uint32_t  sum;          // 1/1000 of the unit
+    uint32_t  min, max;
+    uint16_t  n;            // samples since the sink last sent
+} sinkAccum;                // one power field of one sink
+
+typedef struct {
+    char      name[FS_NAME_LEN];  // without the leading '/'
+    uint32_t  size;
+} fsEntry;                  // one file in the SPIFFS root
+
+typedef struct {
+#if defined(ESP8266)
+    Dir       dir;
+#elif defined(ESP32)
+    File      root;
+#endif
+    fsEntry   entry;        // the file dirNext()/nextFile() got
+    fsEntry   window[FS_SORT_WINDOW];   // nextFile(): the next files by name
+    uint8_t   winLen, winPos;
+} dirWalker;                // see dirOpen()
+
 const char *weekDayName[]  { "Unknown", "Zondag", "Maandag", "Dinsdag", "Woensdag"
                             , "Donderdag", "Vrijdag", "Zaterdag", "Unknown" };
 const char *monthName[]    { "00", "Januari", "Februari", "Maart", "April", "Mei", "Juni", "Juli"
@@ -237,15 +443,19 @@ void delayms(unsigned long);
   uint32_t    nrReboots  = 0;
   uint32_t    loopCount = 0;
   uint32_t    telegramCount = 0, telegramErrors = 0;
-  bool        showRaw = false;
+  std::atomic<bool> showRaw {false};  // loop() reads the P1 port itself (see claimP1forRaw())
   int8_t      showRawCount = 0;
+  bool        p1Continuous = false;   // slimmeMeter is enabled in continuous mode
   char      cMsg[150], fChar[10];
 
 #ifdef USE_MQTT
   //  https://github.com/knolleary/pubsubclient
   #include <PubSubClient.h>           // MQTT client publish and subscribe functionality
+  #include "MQTTtcpClient.h"
   
-  static PubSubClient MQTTclient(wifiClient);
+  static MQTTtcpClient  mqttTcpClient(wifiClient);
+  static tcpConnector   mqttTcp;
+  static PubSubClient   MQTTclient(mqttTcpClient);
 #endif
 
 #ifdef USE_MINDERGAS
@@ -255,14 +465,45 @@ void delayms(unsigned long);
   static char      timeLastResponse[16]      = "";  
 #endif
 
+#if defined(ESP32) && !defined(HAS_NO_SLIMMEMETER)
+  #define USE_P1_TASK           // read and parse telegrams in a task on the other core
+#endif
+
+#ifdef USE_P1_TASK
+  #include "spscRing.h"
+  #define P1_TASK_STACK   8192
+  #define P1_TASK_PRIO    2     // below the WiFi/TCP tasks on that core
+  #define P1_RING_SLOTS   2
+
+  typedef struct {
+      MyData    data;
+      bool      parsed;
+      String    error;
+      uint32_t  parseUs;
+  } p1Telegram;                 // handed over from the P1 reader task to loop()
+
+  static spscRing<p1Telegram, P1_RING_SLOTS> p1Ring;
+  static TaskHandle_t       p1TaskHandle    = NULL;
+  static volatile bool      p1EnableRequest = false;  // loop() asks the reader for a telegram
+  static std::atomic<bool>  p1RawPaused {false};      // the reader saw showRaw and stopped reading
+  uint32_t                  p1Dropped       = 0;      // ring was full
+#endif
+
 #ifdef USE_INFLUXDB
   char      settingInfluxDBhostname[101] = "";
   uint16_t  settingInfluxDBport = 8086;
   char      settingInfluxDBdatabasename[30] = "";
+  uint16_t  settingInfluxDBinterval = 0;      // sec, 0 = every telegram
+  uint8_t   settingInfluxDBaggregate = AGG_LAST;
 #endif
 
 
 String    lastReset           = "";
+bootStage bootTimeline[BOOT_STAGES];
+uint8_t   bootStages          = 0;
+char      lastRebootReason[41] = "";  // as written by rebootWithReason() (before the last boot)
+char      rebootReason[41]     = "";  // written to DSMRstatus.csv by writeLastStatus()
+uint8_t   memLevel            = 0;    // MEM_OK, MEM_LOW or MEM_CRITICAL
 bool      spiffsNotPopulated  = false;
 bool      hasAlternativeIndex = false;
 bool      mqttIsConnected     = false;
@@ -275,10 +516,13 @@ float     settingEDT1, settingEDT2, settingERT1, settingERT2, settingGDT;
 float     settingENBK, settingGNBK;
 uint8_t   settingTelegramInterval;
 uint8_t   settingSmHasFaseInfo = 1;
+uint8_t   settingContinuousRead = 0;
 char      settingHostname[30];
 char      settingIndexPage[50];
 char      settingMQTTbroker[101], settingMQTTuser[40], settingMQTTpasswd[30], settingMQTTtopTopic[21];
 int32_t   settingMQTTinterval, settingMQTTbrokerPort;
+uint8_t   settingMQTTmode = MQTT_MODE_TOPICS;
+uint8_t   settingMQTTaggregate = AGG_LAST;
 String    pTimestamp;
 bool      isDST = false;
 
@@ -298,10 +542,15 @@ DECLARE_TIMER_SEC(updateDisplay,       5);
 DECLARE_TIMER_MIN(reconnectWiFi,      30);
 DECLARE_TIMER_MIN(synchrNTP,          10, SKIP_MISSED_TICKS);
 DECLARE_TIMER_SEC(nextTelegram,       10, CATCH_UP_MISSED_TICKS);
-DECLARE_TIMER_MIN(reconnectMQTTtimer,  2); // try reconnecting cyclus timer
+DECLARE_TIMER_MIN(reconnectMQTTtimer,  2); // next connect attempt (backoff set by mqttRetryLater())
 DECLARE_TIMER_SEC(publishMQTTtimer,   60, CATCH_UP_MISSED_TICKS); // interval time between MQTT messages  
+DECLARE_TIMER_MS(mqttQueueTimer,   250);  // drain rate of the MQTT store-and-forward queue
+DECLARE_TIMER_SEC(influxSpoolTimer,   2);  // replay rate of the InfluxDB spool
+DECLARE_TIMER_SEC(influxBatchTimer,   5);  // is the oldest line in the InfluxDB batch too old?
+DECLARE_TIMER_SEC(memoryTimer,        2);  // check the memory pressure
 DECLARE_TIMER_MIN(minderGasTimer,     1, CATCH_UP_MISSED_TICKS);  // once minute
 DECLARE_TIMER_SEC(antiWearTimer,      61);
+DECLARE_TIMER_SEC(settingsCommitTimer, SETTINGS_QUIET_SEC);  // restarted on every change
 
 /***************************************************************************
 *
@@ -17,7 +17,7 @@
 ***************************************************************************      
 *
 * DSMRlogger-Next instructions:
-* -   Install InfluxDBclient library    (https://github.com/tobiasschuerg/InfluxDB-Client-for-Arduino)
+* -   InfluxDB (v1) is written with the HTTPClient of the core, no extra library needed
 
 *
 ***************************************************************************      
@@ -88,6 +88,7 @@
 #define USE_MINDERGAS             // define if you want to update mindergas (configure through webinterface)
 //  #define USE_SYSLOGGER               // define if you want to use the sysLog library for debugging
 //  #define SHOW_PASSWRDS               // well .. show the PSK key and MQTT password, what else?
+//  #define LOG_COMPILE_LEVEL LOG_WARN  // leave out all DebugT()/DebugTln()/DebugTf() (LOG_INFO) and LOG_DEBUG calls
 //  #define USE_WEMOSLOLIN32            //define if it is a WEMOS LOLIN32 with OLED (requires different IO pins and I2Cadres)
 /******************** don't change anything below this comment **********************/
 
@@ -152,16 +153,16 @@ void openSysLog(bool empty)
     if (settingOledType > 0)
     {
       oled_Print_Msg(0, " <DSMRlogger-Next>", 0);
-      oled_Print_Msg(3, "Syslog OK!", 500);
+      oled_Print_Msg(3, "Syslog OK!", 0);
     }
   }
   else
   {
-    DebugTln("Error opening sysLog!");
+    LogTln(LOG_ERROR, "Error opening sysLog!");
     if (settingOledType > 0)
     {
       oled_Print_Msg(0, " <DSMRlogger-Next>", 0);
-      oled_Print_Msg(3, "Error Syslog", 1500);
+      oled_Print_Msg(3, "Error Syslog", 0);
     }
   }
 
@@ -183,6 +184,52 @@ void openSysLog(bool empty)
 } // openSysLog()
 #endif
 
+//===========================================================================================
+// the boot timeline: when (millis()) a stage of setup() was done
+//===========================================================================================
+void bootMark(const char *stage)
+{
+  if (bootStages >= BOOT_STAGES) return;
+  bootTimeline[bootStages].name = stage;
+  bootTimeline[bootStages].atMs = millis();
+  DebugTf("boot: [%s] done at [%u]ms\r\n", stage, bootTimeline[bootStages].atMs);
+  bootStages++;
+
+} // bootMark()
+
+
+//===========================================================================================
+void sendJsonBootInfo()
+{
+  char cName[30];
+
+  for (uint8_t b = 0; b < bootStages; b++)
+  {
+    snprintf(cName, sizeof(cName), "boot_%s", bootTimeline[b].name);
+    sendNestedJsonObj(cName, bootTimeline[b].atMs, "ms");
+  }
+
+} // sendJsonBootInfo()
+
+
+//===========================================================================================
+// the slimme meter has its own UART on an ESP32: it can start before
+// the network. On an ESP8266 the debug port is swapped to the meter,
+// so that waits until telnet is there to take over the debug output
+//===========================================================================================
+void startSlimmeMeter()
+{
+  DebugTln(F("Start slimmeMeter..."));
+  initSlimmermeter();
+  slimmeMeter.enable(true);
+#ifdef USE_P1_TASK
+  startP1ReaderTask();     // ESP32: read and parse telegrams on the other core
+#endif
+  bootMark("slimmemeter");
+
+} // startSlimmeMeter()
+
+
 //===========================================================================================
 void setup() 
 {
@@ -190,14 +237,7 @@ void setup()
   //================ Serial Debug ================================
 
   DEBUG_PORT.begin(115200, SERIAL_8N1);                   //DEBUG
-  Debugf("\n\nBooting [%s]", _FW_VERSION);
-  for(int i=10; i>0; i--)
-  {
-    delay(300);
-    Debugf(".");
-  }
-  Debugf("\r\n");
-  DebugFlush();  //flush out all serial data
+  Debugf("\n\nBooting [%s]\r\n", _FW_VERSION);
 
   //setup hardware buildin led and flash_button
   pinMode(LED_BUILTIN, OUTPUT);
@@ -212,7 +252,37 @@ void setup()
     randomSeed(esp_random());
   #endif
   strlcpy(settingHostname, _DEFAULT_HOSTNAME, sizeof(settingHostname));
-  
+  lastReset = getResetReason();
+  Debugf("Reset reason....[%s]\r\n", lastReset.c_str());  
+  bootMark("serial");
+
+//============= start SPIFFS ========================================
+//--- first: the settings (OLED type, hostname) are needed by everything after this
+  if (SPIFFS.begin()) 
+  {
+    DebugTln(F("SPIFFS Mount succesfull\r"));
+    SPIFFSmounted = true;
+  } else { 
+    LogTln(LOG_ERROR, F("SPIFFS Mount failed\r"));   // Serious problem with SPIFFS 
+    SPIFFSmounted = false;
+  }
+
+//------ read status file for last Timestamp --------------------
+  strncpy(actTimestamp, "040302010101X", sizeof(actTimestamp));
+  //==========================================================//
+  // writeLastStatus();  // only for firsttime initialization //
+  //==========================================================//
+  readLastStatus(); // place it in actTimestamp
+  // set the time to actTimestamp!
+  actT = epoch(actTimestamp, strlen(actTimestamp), true);
+  DebugTf("===> actTimestamp[%s]-> nrReboots[%u] - Errors[%u]\r\n\n", actTimestamp
+                                                                    , nrReboots++
+                                                                    , slotErrors);                                                                    
+  loadSettings(true);
+  initHistSummary();
+  bootMark("spiffs");
+
+//============= end SPIFFS ========================================
 
 //================ oLed =======================================
   if (settingOledType > 0)
@@ -222,31 +292,26 @@ void setup()
     oled_Print_Msg(0, "<DSMRlogger-Next>", 0);
     oled_Print_Msg(1, _SEMVER_FULL , 0);
     oled_Print_Msg(2, "The next DSMRlogger", 0);
-    oled_Print_Msg(3, " >> Enjoy logging! <<", 1000);
-    yield();
+    oled_Print_Msg(3, (SPIFFSmounted ? " >> Enjoy logging! <<" : "SPIFFS FAILED!"), 0);
   }
-  else  // don't blink if oled-screen attatched
+
+#ifdef USE_SYSLOGGER
+  openSysLog(false);
+  if (strlen(lastRebootReason) > 0)
   {
-    for(int i=8; i>0; i--) 
-    {
-      digitalWrite(LED_BUILTIN, !digitalRead(LED_BUILTIN));
-      Debug(".");
-      delay(500);
-    }
-    Debugln();
+    writeToSysLog("Last reboot reason [%s]", lastRebootReason);
   }
-  digitalWrite(LED_BUILTIN, LED_OFF);  // HIGH is OFF
-  lastReset = getResetReason();
-  Debugf("\n\nReset reason....[%s]\r\n", lastReset.c_str());  
+#endif
+
+#if defined(ESP32)
+  startSlimmeMeter();
+#endif
 
-  
 //=============start Networkstuff==================================
   if (settingOledType > 0)
   {
-    if (settingOledFlip)  oled_Init();  // only if true restart(init) oled screen
-    oled_Clear();                       // clear the screen 
     oled_Print_Msg(0, " <DSMRlogger-Next>", 0);
-    oled_Print_Msg(1, "Verbinden met WiFi", 500);
+    oled_Print_Msg(1, "Verbinden met WiFi", 0);
   }
   digitalWrite(LED_BUILTIN, LED_ON);
   startWiFi(settingHostname, 240);  // timeout 4 minuten
@@ -254,27 +319,19 @@ void setup()
   Debug (F("Connected to " )); Debugln (WiFi.SSID());
   Debug (F("IP address: " ));  Debugln (WiFi.localIP());
   Debug (F("IP gateway: " ));  Debugln (WiFi.gatewayIP());
+  digitalWrite(LED_BUILTIN, LED_OFF);
+  bootMark("wifi");
 
   if (settingOledType > 0)
   {
     oled_Print_Msg(0, " <DSMRlogger-Next>", 0);
     oled_Print_Msg(1, WiFi.SSID().c_str(), 0);
     snprintf(cMsg, sizeof(cMsg), "IP %s", WiFi.localIP().toString().c_str());
-    oled_Print_Msg(2, cMsg, 1500);
-  }
-  else
-  {
-    digitalWrite(LED_BUILTIN, LED_OFF);
-    for (int L=0; L < 10; L++) {
-      digitalWrite(LED_BUILTIN, !digitalRead(LED_BUILTIN));
-      delay(200);
-    }
+    oled_Print_Msg(2, cMsg, 0);
   }
-  digitalWrite(LED_BUILTIN, LED_OFF);
 
 //-----------------------------------------------------------------
 #ifdef USE_SYSLOGGER
-  openSysLog(false);
   snprintf(cMsg, sizeof(cMsg), "SSID:[%s],  IP:[%s], Gateway:[%s]", WiFi.SSID().c_str()
                                                                   , WiFi.localIP().toString().c_str()
                                                                   , WiFi.gatewayIP().toString().c_str());
@@ -283,67 +340,30 @@ void setup()
 //-----------------------------------------------------------------
 
   startMDNS(settingHostname);
-  if (settingOledType > 0)
-  {
-    oled_Print_Msg(3, "mDNS gestart", 1500);
-  }
-
-  Debugf("Starting Telnet");    
   startTelnet();
   if (settingOledType > 0)
   {
-    oled_Print_Msg(0, " <DSMRloggerAPI>", 0);
-    oled_Print_Msg(3, "telnet (poort 23)", 2500);
+    oled_Print_Msg(3, "telnet (poort 23)", 0);
   }
   Debugln("Debug open for business on port 23");
+  bootMark("network");
+
+#if defined(ESP8266)
+  startSlimmeMeter();
+#endif
   
 //=============end Networkstuff======================================
 
-//============= start SPIFFS ========================================
-  if (SPIFFS.begin()) 
-  {
-    DebugTln(F("SPIFFS Mount succesfull\r"));
-    SPIFFSmounted = true;
-    if (settingOledType > 0)
-    {
-      oled_Print_Msg(0, " <DSMRlogger-Next>", 0);
-      oled_Print_Msg(3, "SPIFFS mounted", 1500);
-    }    
-  } else { 
-    DebugTln(F("SPIFFS Mount failed\r"));   // Serious problem with SPIFFS 
-    SPIFFSmounted = false;
-    if (settingOledType > 0)
-    {
-      oled_Print_Msg(0, " <DSMRlogger-Next>", 0);
-      oled_Print_Msg(3, "SPIFFS FAILED!", 2000);
-    }
-  }
-
-//------ read status file for last Timestamp --------------------
-  strncpy(actTimestamp, "040302010101X", sizeof(actTimestamp));
-  //==========================================================//
-  // writeLastStatus();  // only for firsttime initialization //
-  //==========================================================//
-  readLastStatus(); // place it in actTimestamp
-  // set the time to actTimestamp!
-  actT = epoch(actTimestamp, strlen(actTimestamp), true);
-  DebugTf("===> actTimestamp[%s]-> nrReboots[%u] - Errors[%u]\r\n\n", actTimestamp
-                                                                    , nrReboots++
-                                                                    , slotErrors);                                                                    
-  readSettings(true);
-
-//============= end SPIFFS ========================================
-
 #if defined(USE_NTP_TIME)                                   //USE_NTP
 //================ startNTP =========================================
   if (settingOledType > 0)                                  //USE_NTP
   {                                                         //USE_NTP
-    oled_Print_Msg(3, "setup NTP server", 100);             //USE_NTP
+    oled_Print_Msg(3, "setup NTP server", 0);               //USE_NTP
   }                                                         //USE_NTP
                                                             //USE_NTP
   if (!startNTP())                                          //USE_NTP
   {                                                         //USE_NTP
-    DebugTln(F("ERROR!!! No NTP server reached!\r\n\r"));   //USE_NTP
+    LogTln(LOG_ERROR, F("ERROR!!! No NTP server reached!\r\n\r"));   //USE_NTP
     if (settingOledType > 0)                                //USE_NTP
     {                                                       //USE_NTP
       oled_Print_Msg(0, " <DSMRlogger-Next>", 0);              //USE_NTP
@@ -352,13 +372,13 @@ void setup()
       oled_Print_Msg(3, "Reboot DSMR-logger", 2000);        //USE_NTP
     }                                                       //USE_NTP
     delay(2000);                                            //USE_NTP
-    esp_reboot();                                          //USE_NTP
+    rebootWithReason("no response from NTP server");        //USE_NTP
     delay(3000);                                            //USE_NTP
   }                                                         //USE_NTP
   if (settingOledType > 0)                                  //USE_NTP
   {                                                         //USE_NTP
     oled_Print_Msg(0, " <DSMRlogger-Next>", 0);                //USE_NTP
-    oled_Print_Msg(3, "NTP gestart", 1500);                 //USE_NTP
+    oled_Print_Msg(3, "NTP gestart", 0);                    //USE_NTP
   }                                                         //USE_NTP
   prevNtpHour = hour();                                     //USE_NTP
                                                             //USE_NTP
@@ -434,7 +454,7 @@ void setup()
     snprintf(cMsg, sizeof(cMsg), "DT: %02d%02d%02d%02d0101W", thisYear
                                                             , thisMonth, thisDay, thisHour);
     oled_Print_Msg(0, " <DSMRlogger-Next>", 0);
-    oled_Print_Msg(3, cMsg, 1500);
+    oled_Print_Msg(3, cMsg, 0);
   }
 
 //================ Start MQTT  ======================================
@@ -444,7 +464,7 @@ void setup()
   if (settingOledType > 0)                                      //USE_MQTT
   {                                                             //USE_MQTT
     oled_Print_Msg(0, " <DSMRlogger-Next>", 0);                    //USE_MQTT
-    oled_Print_Msg(3, "MQTT server set!", 1500);                //USE_MQTT
+    oled_Print_Msg(3, "MQTT server set!", 0);                   //USE_MQTT
   }                                                             //USE_MQTT
 #endif                                                          //USE_MQTT
 
@@ -460,7 +480,7 @@ void setup()
       oled_Print_Msg(0, " <DSMRlogger-Next>", 0); 
       oled_Print_Msg(1, "OK, SPIFFS correct", 0);
       oled_Print_Msg(2, "Verder met normale", 0);
-      oled_Print_Msg(3, "Verwerking ;-)", 2500);
+      oled_Print_Msg(3, "Verwerking ;-)", 0);
     }
 
       
@@ -502,7 +522,7 @@ void setup()
       oled_Print_Msg(0, "!OEPS! niet alle", 0);
       oled_Print_Msg(1, "files op SPIFFS", 0);
       oled_Print_Msg(2, "gevonden! (fout!)", 0);
-      oled_Print_Msg(3, "Start FSexplorer", 2000);
+      oled_Print_Msg(3, "Start FSexplorer", 0);
     }
   }
   
@@ -523,11 +543,7 @@ void setup()
     oled_Print_Msg(3, "gestart (poort 80)", 0);             //HAS_OLED
   }                                                         //HAS_OLED
 
-  for (int i = 0; i< 10; i++) 
-  {
-    digitalWrite(LED_BUILTIN, !digitalRead(LED_BUILTIN));
-    delay(250);
-  }
+  bootMark("http");
 //================ End HTTP Server ================================
 
   //test(); monthTabel
@@ -553,24 +569,22 @@ void setup()
 //  Modbus_SolarEdge.client();
 //================ End SolarEdge_Modbus ===========================
 
-//================ Start Slimme Meter ===============================
+//================ Slimme Meter is already reading ===================
 
   if (settingOledType > 0)
   {
     oled_Print_Msg(0, "<DSMRlogger-Next>", 0);
     oled_Print_Msg(1, "Startup complete", 0);
     oled_Print_Msg(2, "Wait for first", 0);
-    oled_Print_Msg(3, "telegram .....", 500);
+    oled_Print_Msg(3, "telegram .....", 0);
+    oledBuffered = true;    // from now on oled_Update() does the writing
   }
 
-  DebugTln(F("Start slimmeMeter..."));
-  initSlimmermeter();
-  slimmeMeter.enable(true);
-
 //================ The final part of the Setup =====================
 
-  DebugTf("Startup complete! actTimestamp[%s]\r\n", actTimestamp);  
-  writeToSysLog("Startup complete! actTimestamp[%s]", actTimestamp);  
+  bootMark("setup");
+  DebugTf("Startup complete in [%u]ms! actTimestamp[%s]\r\n", millis(), actTimestamp);  
+  writeToSysLog("Startup complete in [%u]ms! actTimestamp[%s]", millis(), actTimestamp);  
 
 //================ Find out DST--------------- =====================
   isDST = isdsmrDST(String(actTimestamp).c_str());
@@ -583,6 +597,28 @@ void setup()
     DebugTln("Wintertime");
   }
 //================ End of Slimmer Meter ============================
+
+//================ Scheduled tasks (most important first) ==========
+  ADD_TASK(nextTelegram,      doTaskTelegram,     PRIO_TELEGRAM);
+  ADD_TASK(updateSeconds,     doUpdateSeconds,    PRIO_SYSTEM);
+  ADD_TASK(reconnectWiFi,     doReconnectWifi,    PRIO_SYSTEM);
+  ADD_TASK(memoryTimer,       handleMemory,       PRIO_SYSTEM);
+#if defined(USE_NTP_TIME)                                           //USE_NTP
+  ADD_TASK(synchrNTP,         doSynchrNTP,        PRIO_SYSTEM);     //USE_NTP
+#endif                                                              //USE_NTP
+  ADD_TASK(updateDisplay,     doUpdateDisplay,    PRIO_DISPLAY);
+#ifdef USE_MQTT
+  ADD_TASK(mqttQueueTimer,    handleMQTTqueue,    PRIO_UPLOAD);
+#endif
+#ifdef USE_INFLUXDB
+  ADD_TASK(influxSpoolTimer,  handleInfluxSpool,  PRIO_UPLOAD);
+  ADD_TASK(influxBatchTimer,  handleInfluxBatch,  PRIO_UPLOAD);
+#endif
+#ifdef USE_MINDERGAS
+  ADD_TASK(minderGasTimer,    handleMindergas,    PRIO_UPLOAD);
+#endif
+  ADD_TASK(settingsCommitTimer, commitSettings,   PRIO_LOW);
+
 } // setup()
 
 
@@ -667,7 +703,7 @@ void doReconnectWifi()
 void doTaskTelegram()
 {
   //Trigger next telegram (or just generate data in case of no slimmemeter)
-  if (Verbose1) DebugTln("doTaskTelegram");
+  if (Verbose1) LogTln(LOG_DEBUG, "doTaskTelegram");
   #if defined(HAS_NO_SLIMMEMETER)
     handleTestdata();  
   #else
@@ -680,13 +716,16 @@ void doTaskTelegram()
 //===[ Do System tasks ]=============================================================
 void doSystemTasks()
 {
+  //--- print (some of) what was logged
+  handleDebugLog();
+
   #ifndef HAS_NO_SLIMMEMETER
     //It's async serial device, so it can receive the next telegram, when done, trigger processing.
     //Do not use just slimmeMeter.loop(), it only "receives data", not process when done.
     handleSlimmemeter();  
   #endif
   #ifdef USE_MQTT
-    MQTTclient.loop();
+    handleMQTT();
   #endif
   httpServer.handleClient();
 #if defined(ESP8266)
@@ -696,65 +735,59 @@ void doSystemTasks()
   if (settingOledType > 0)
   {
     checkFlashButton();
+    oled_Update();
   }
 
   yield();
 
 } // doSystemTasks()
 
-  
-void loop () 
-{  
-  //--- do the tasks that has to be done 
-  //--- as often as possible
-  doSystemTasks();
-
-  loopCount++;
 
+//===[ Scheduled tasks ]=============================================================
+void doUpdateSeconds()
+{
   //--- update upTime counter
-  if DUE(updateSeconds)
-  {
-    upTimeSeconds++;
-  }
-    
-  //--- verwerk volgend telegram
-  if DUE(nextTelegram)
-  {
-    doTaskTelegram();
-    //doReadSolarEdge();
-  }
+  upTimeSeconds++;
 
-//--- if an OLED screen attached, display the status
+} // doUpdateSeconds()
+
+
+//===========================================================================================
+void doUpdateDisplay()
+{
+  //--- if an OLED screen attached, display the status
   if (settingOledType > 0)
   {
-    if DUE(updateDisplay)
-    {
-      displayStatus();
-    }
+    displayStatus();
   }
 
-  //--- if mindergas then check
-#ifdef USE_MINDERGAS
-  if DUE(minderGasTimer) 
-    handleMindergas();
-#endif
+} // doUpdateDisplay()
 
-  //--- if connection lost, try to reconnect to WiFi
-  if DUE(reconnectWiFi) 
-    doReconnectWifi();
 
-//--- if NTP set, see if it needs synchronizing
+//===========================================================================================
+void doSynchrNTP()
+{
 #if defined(USE_NTP_TIME)                                           //USE_NTP
-  if DUE(synchrNTP)                                                 //USE_NTP
-  {
-  //if (timeStatus() == timeNeedsSync || prevNtpHour != hour())     //USE_NTP
-  //{
-      //prevNtpHour = hour();                                         //USE_NTP
-      setSyncProvider(getNtpTime);                                  //USE_NTP
-      setSyncInterval(600);                                         //USE_NTP
-  //}
-  }
+  setSyncProvider(getNtpTime);                                      //USE_NTP
+  setSyncInterval(600);                                             //USE_NTP
 #endif                                                              //USE_NTP
+
+} // doSynchrNTP()
+
+  
+void loop () 
+{  
+  //--- do the tasks that has to be done 
+  //--- as often as possible
+  doSystemTasks();
+
+  loopCount++;
+
+  //--- outbound HTTP requests (mindergas.nl), a small step every loop
+  handleHttpJobs();
+
+  //--- the most important task that is due (see setup())
+  runScheduledTask();
   
   yield();
   
@@ -29,45 +29,478 @@
 
 /*---- start macro's ------------------------------------------------------------------*/
 
-#define Debug(...)      ({ Serial.print(__VA_ARGS__);         \
+// Debug(), Debugln() and Debugf() print directly (menu's, lists). They first
+// drain the log ring, so everything comes out in the right order.
+#define Debug(...)      ({ _logFlush();                       \
+                           Serial.print(__VA_ARGS__);         \
                            TelnetStream.print(__VA_ARGS__);   \
                         })                       
-#define Debugln(...)    ({ Serial.println(__VA_ARGS__);       \
+#define Debugln(...)    ({ _logFlush();                       \
+                           Serial.println(__VA_ARGS__);       \
                            TelnetStream.println(__VA_ARGS__); \
                         })                        
-#define Debugf(...)     ({ Serial.printf(__VA_ARGS__);        \
+#define Debugf(...)     ({ _logFlush();                       \
+                           Serial.printf(__VA_ARGS__);        \
                            TelnetStream.printf(__VA_ARGS__);  \
                         })
-#define DebugFlush()    ({ Serial.flush(); \
+#define DebugFlush()    ({ _logFlush();    \
+                           Serial.flush(); \
                            TelnetStream.flush(); \
                         })
 
-
-#define DebugT(...)     ({ _debugBOL(__FUNCTION__, __LINE__);     \
-                           Debug(__VA_ARGS__);                    \
-                        })
-#define DebugTln(...)   ({ _debugBOL(__FUNCTION__, __LINE__);     \
-                           Debugln(__VA_ARGS__);                  \
-                        })
-#define DebugTf(...)    ({ _debugBOL(__FUNCTION__, __LINE__);     \
-                           Debugf(__VA_ARGS__);                   \
+// DebugT(), DebugTln() and DebugTf() don't print anything themselves. They
+// store a record (time, heap, call site and the raw arguments) in logRing[].
+// The text is formatted when the record is drained to the sinks (see
+// handleDebugLog()) or pulled with /api/v1/dev/log.
+// Every call site has its own (static) logSite, so the format string must
+// be a literal. Levels can be set per module (source file) at runtime, calls
+// above LOG_COMPILE_LEVEL are not compiled in at all.
+// Failures go to LogTf(LOG_ERROR, ..), failures that are tried again later
+// to LOG_WARN and the Verbose output to LOG_DEBUG. DebugTxx() is LOG_INFO.
+#define _LogT(lvl, fmt, nl, ...) ({ if ((lvl) <= LOG_COMPILE_LEVEL)                                \
+                           {                                                                      \
+                             static const logSite _site = { __FILE__, __FUNCTION__, fmt           \
+                                                          , __LINE__, (lvl), (nl) };              \
+                             static int8_t        _mod  = -1;                                     \
+                             if (_logEnabled(_site, _mod)) _logWrite(&_site, _mod, ##__VA_ARGS__); \
+                           }                                                                      \
                         })
 
+#define DebugT(...)           _LogT(LOG_INFO, NULL, false, __VA_ARGS__)
+#define DebugTln(...)         _LogT(LOG_INFO, NULL, true,  __VA_ARGS__)
+#define DebugTf(fmt, ...)     _LogT(LOG_INFO, fmt,  false, ##__VA_ARGS__)
+#define LogTln(lvl, ...)      _LogT(lvl,      NULL, true,  __VA_ARGS__)
+#define LogTf(lvl, fmt, ...)  _LogT(lvl,      fmt,  false, ##__VA_ARGS__)
+
 /*---- einde macro's ------------------------------------------------------------------*/
 
 // needs #include <TelnetStream.h>       // Version 0.0.1 - https://github.com/jandrassy/TelnetStream
 
-char _bol[128];
-void _debugBOL(const char *fn, int line)
+enum { LOG_NONE, LOG_ERROR, LOG_WARN, LOG_INFO, LOG_DEBUG };
+enum { LOG_ARG_INT, LOG_ARG_UINT, LOG_ARG_I64, LOG_ARG_U64, LOG_ARG_DBL, LOG_ARG_CHR, LOG_ARG_STR };
+enum { LOG_TRUNC_ARGS = 0x01, LOG_TRUNC_STR = 0x02 };   // logRecord.truncated
+
+#ifndef LOG_COMPILE_LEVEL
+  #define LOG_COMPILE_LEVEL LOG_DEBUG   // LogTf(LOG_DEBUG, ..) etc. above this level are left out
+#endif
+#define LOG_SLOTS           32          // records in logRing[]
+#define LOG_ARGS_SIZE      104          // bytes for the arguments of one record
+#define LOG_STR_MAX         80          // chars kept of a string argument
+#define LOG_MODULES         32
+#define LOG_DRAIN_MAX       4           // records printed per handleDebugLog()
+#define LOG_SINK_SERIAL     0x01
+#define LOG_SINK_TELNET     0x02
+
+typedef struct {
+    const char *file;
+    const char *func;
+    const char *fmt;        // NULL: DebugT()/DebugTln(), print the arguments
+    uint16_t    line;
+    uint8_t     level;
+    bool        newLine;
+} logSite;                  // one (static) per DebugTxx() call
+
+typedef struct {
+    const logSite *site;
+    time_t    time;
+    uint32_t  heap;
+    uint32_t  block;
+    int8_t    module;
+    uint8_t   truncated;    // LOG_TRUNC_ARGS: arguments left out, LOG_TRUNC_STR: a string was cut
+    uint8_t   len;          // bytes used in args[]
+    uint8_t   args[LOG_ARGS_SIZE];  // [type][value] ..
+} logRecord;
+
+typedef struct {
+    const char *name;       // points into __FILE__
+    uint8_t     len;
+    uint8_t     level;
+} logModule;
+
+typedef struct {
+    uint8_t     type;
+    int64_t     i;
+    double      d;
+    const char *s;
+} logArg;
+
+static logRecord  logRing[LOG_SLOTS];
+static uint32_t   logHead         = 0;    // records written (ever)
+static uint32_t   logSinkTail     = 0;    // records drained to the sinks
+static uint32_t   logLost         = 0;    // overwritten before they were drained
+static uint32_t   logTruncated    = 0;    // records that did not fit completely
+static uint8_t    logSinks        = (LOG_SINK_SERIAL | LOG_SINK_TELNET);
+static uint8_t    logDefaultLevel = LOG_INFO;
+static logModule  logModules[LOG_MODULES];
+static uint8_t    logNrModules    = 0;
+static char       _logLine[256];
+
+
+//===========================================================================================
+// module = name of the source file without path and extension
+static int8_t _logModule(const char *file)
 {
-   
-  snprintf(_bol, sizeof(_bol), "[%02d:%02d:%02d][%7u|%6u] %-12.12s(%4d): ", \
-                hour(), minute(), second(), \
-                ESP.getFreeHeap(), esp_get_free_block(),\
-                fn, line);
-                 
-  DEBUG_PORT.print (_bol);
-  TelnetStream.print(_bol);
+  const char *name = strrchr(file, '/');
+  if (name == NULL) name = strrchr(file, '\\');
+  name = (name == NULL) ? file : name +1;
+  uint8_t len = strcspn(name, ".");
+
+  for (uint8_t m = 0; m < logNrModules; m++)
+  {
+    if (logModules[m].len == len && strncmp(logModules[m].name, name, len) == 0) return m;
+  }
+  if (logNrModules >= LOG_MODULES) return LOG_MODULES;  // uses logDefaultLevel
+  logModules[logNrModules].name  = name;
+  logModules[logNrModules].len   = len;
+  logModules[logNrModules].level = logDefaultLevel;
+  return logNrModules++;
+
+} // _logModule()
+
+
+//===========================================================================================
+static inline bool _logEnabled(const logSite &site, int8_t &mod)
+{
+  if (mod < 0) mod = _logModule(site.file);
+  if (mod < logNrModules) return (site.level <= logModules[mod].level);
+  return (site.level <= logDefaultLevel);
+
+} // _logEnabled()
+
+
+//===========================================================================================
+// set the level of a module ("all" for every module), false if never heard of it
+bool setLogLevel(const char *module, uint8_t level)
+{
+  if (level > LOG_DEBUG) level = LOG_DEBUG;
+  if (strcasecmp(module, "all") == 0)
+  {
+    logDefaultLevel = level;
+    for (uint8_t m = 0; m < logNrModules; m++) logModules[m].level = level;
+    return true;
+  }
+  for (uint8_t m = 0; m < logNrModules; m++)
+  {
+    if (strlen(module) == logModules[m].len && strncasecmp(logModules[m].name, module, logModules[m].len) == 0)
+    {
+      logModules[m].level = level;
+      return true;
+    }
+  }
+  return false;
+
+} // setLogLevel()
+
+
+//===========================================================================================
+static void _logPutRaw(logRecord &r, uint8_t type, const void *val, uint8_t len)
+{
+  if ((r.truncated & LOG_TRUNC_ARGS) || (r.len + 1 + len) > LOG_ARGS_SIZE)
+  {
+    r.truncated |= LOG_TRUNC_ARGS;  // no room: drop this and all next arguments
+    return;
+  }
+  r.args[r.len++] = type;
+  memcpy(&r.args[r.len], val, len);
+  r.len += len;
+
+} // _logPutRaw()
+
+//===========================================================================================
+static void _logPutStr(logRecord &r, const char *s, bool progmem)
+{
+  int16_t room = LOG_ARGS_SIZE - r.len - 2;   // type and '\0'
+  if ((r.truncated & LOG_TRUNC_ARGS) || room <= 0)
+  {
+    r.truncated |= LOG_TRUNC_ARGS;
+    return;
+  }
+  if (s == NULL) { s = "(null)"; progmem = false; }
+  if (room > LOG_STR_MAX) room = LOG_STR_MAX;
+  r.args[r.len++] = LOG_ARG_STR;
+  char *dst = (char*)&r.args[r.len];
+  if (progmem)  strncpy_P(dst, s, room);
+  else          strncpy(dst, s, room);
+  dst[room] = '\0';
+  //-- cut: the rest of the record is still right, but the text shows it --
+  if ((int16_t)strlen(dst) == room && (progmem ? pgm_read_byte(s + room) : s[room]) != '\0')
+  {
+    r.truncated |= LOG_TRUNC_STR;
+  }
+  r.len += strlen(dst) +1;
+
+} // _logPutStr()
+
+static inline void _logPut(logRecord &r, int32_t v, uint8_t type) { _logPutRaw(r, type, &v, sizeof(v)); }
+static inline void _logPut(logRecord &r, bool v)                { _logPut(r, (int32_t)v, LOG_ARG_INT); }
+static inline void _logPut(logRecord &r, char v)                { _logPut(r, (int32_t)v, LOG_ARG_CHR); }
+static inline void _logPut(logRecord &r, signed char v)         { _logPut(r, (int32_t)v, LOG_ARG_INT); }
+static inline void _logPut(logRecord &r, short v)               { _logPut(r, (int32_t)v, LOG_ARG_INT); }
+static inline void _logPut(logRecord &r, int v)                 { _logPut(r, (int32_t)v, LOG_ARG_INT); }
+static inline void _logPut(logRecord &r, long long v)           { _logPutRaw(r, LOG_ARG_I64, &v, sizeof(v)); }
+static inline void _logPut(logRecord &r, unsigned long long v)  { _logPutRaw(r, LOG_ARG_U64, &v, sizeof(v)); }
+//-- a long is 32 bits on the ESP, but not everywhere --
+static inline void _logPut(logRecord &r, long v)
+{
+  if (sizeof(v) > sizeof(int32_t)) _logPut(r, (long long)v);
+  else                             _logPut(r, (int32_t)v, LOG_ARG_INT);
 }
+static inline void _logPut(logRecord &r, unsigned char v)       { _logPut(r, (int32_t)v, LOG_ARG_UINT); }
+static inline void _logPut(logRecord &r, unsigned short v)      { _logPut(r, (int32_t)v, LOG_ARG_UINT); }
+static inline void _logPut(logRecord &r, unsigned int v)        { _logPut(r, (int32_t)v, LOG_ARG_UINT); }
+static inline void _logPut(logRecord &r, unsigned long v)
+{
+  if (sizeof(v) > sizeof(uint32_t)) _logPut(r, (unsigned long long)v);
+  else                              _logPut(r, (int32_t)v, LOG_ARG_UINT);
+}
+static inline void _logPut(logRecord &r, double v)              { _logPutRaw(r, LOG_ARG_DBL, &v, sizeof(v)); }
+static inline void _logPut(logRecord &r, float v)               { _logPut(r, (double)v); }
+static inline void _logPut(logRecord &r, const char *v)         { _logPutStr(r, v, false); }
+static inline void _logPut(logRecord &r, const __FlashStringHelper *v)  { _logPutStr(r, (PGM_P)v, true); }
+static inline void _logPut(logRecord &r, const String &v)       { _logPutStr(r, v.c_str(), false); }
+static inline void _logPut(logRecord &r, const void *v)         { _logPut(r, (int32_t)(uintptr_t)v, LOG_ARG_UINT); }
+
+static inline void _logPutArgs(logRecord &r) { }
+
+template <typename T, typename... Rest>
+static inline void _logPutArgs(logRecord &r, const T &first, const Rest&... rest)
+{
+  _logPut(r, first);
+  _logPutArgs(r, rest...);
+}
+
+void _logDrain(uint8_t maxRecs);
+
+//===========================================================================================
+// store a record, the arguments are kept as they are (strings are copied)
+template <typename... Args>
+static void _logWrite(const logSite *site, int8_t mod, const Args&... args)
+{
+  //-- first, now() may sync the time (and log something itself) --
+  time_t    t     = now();
+  uint32_t  heap  = ESP.getFreeHeap();
+  uint32_t  block = esp_get_free_block();
+
+  //-- full: print what has not been printed yet before it is overwritten --
+  if ((logHead - logSinkTail) >= LOG_SLOTS) _logDrain(1);
+
+  logRecord &r = logRing[logHead % LOG_SLOTS];
+  r.site      = site;
+  r.time      = t;
+  r.heap      = heap;
+  r.block     = block;
+  r.module    = mod;
+  r.truncated = 0;
+  r.len       = 0;
+  _logPutArgs(r, args...);
+  if (r.truncated) logTruncated++;
+  logHead++;
+
+} // _logWrite()
+
+
+//===========================================================================================
+static bool _logGetArg(const logRecord &r, uint8_t &pos, logArg &a)
+{
+  int32_t   i32;
+  uint32_t  u32;
+  int64_t   i64;
+  uint64_t  u64;
+
+  if (pos >= r.len) return false;
+  a.type = r.args[pos++];
+  a.s    = "";
+  switch(a.type)
+  {
+    case LOG_ARG_INT:
+    case LOG_ARG_CHR:   memcpy(&i32, &r.args[pos], sizeof(i32)); pos += sizeof(i32);
+                        a.i = i32;  a.d = i32;
+                        break;
+    case LOG_ARG_UINT:  memcpy(&u32, &r.args[pos], sizeof(u32)); pos += sizeof(u32);
+                        a.i = u32;  a.d = u32;
+                        break;
+    case LOG_ARG_I64:   memcpy(&i64, &r.args[pos], sizeof(i64)); pos += sizeof(i64);
+                        a.i = i64;  a.d = i64;
+                        break;
+    case LOG_ARG_U64:   memcpy(&u64, &r.args[pos], sizeof(u64)); pos += sizeof(u64);
+                        a.i = (int64_t)u64;  a.d = u64;
+                        break;
+    case LOG_ARG_DBL:   memcpy(&a.d, &r.args[pos], sizeof(a.d)); pos += sizeof(a.d);
+                        a.i = (int64_t)a.d;
+                        break;
+    case LOG_ARG_STR:   a.s = (const char*)&r.args[pos]; pos += strlen(a.s) +1;
+                        a.i = 0;    a.d = 0;
+                        break;
+    default:            pos = r.len;
+                        return false;
+  }
+  return true;
+
+} // _logGetArg()
+
+
+//===========================================================================================
+static void _logAppend(char *out, size_t size, size_t &o, const char *fmt, ...)
+{
+  va_list args;
+
+  if (o >= (size -1)) return;
+  va_start(args, fmt);
+  int n = vsnprintf(&out[o], (size - o), fmt, args);
+  va_end(args);
+  if (n > 0) o += n;
+  if (o >= size) o = (size -1);
+
+} // _logAppend()
+
+
+//===========================================================================================
+// build the text of a record (without the "[time][heap] function(line): " part)
+static size_t _logFormat(const logRecord &r, char *out, size_t size)
+{
+  const char *fmt = r.site->fmt;
+  uint8_t     pos = 0;
+  size_t      o   = 0;
+  uint8_t     s;
+  char        spec[24];
+  char        conv;
+  logArg      a;
+
+  out[0] = '\0';
+  if (fmt == NULL)    //-- DebugT()/DebugTln(): print the arguments --
+  {
+    while (_logGetArg(r, pos, a))
+    {
+      switch(a.type)
+      {
+        case LOG_ARG_STR:   _logAppend(out, size, o, "%s", a.s);                  break;
+        case LOG_ARG_CHR:   _logAppend(out, size, o, "%c", (int)a.i);             break;
+        case LOG_ARG_DBL:   _logAppend(out, size, o, "%.2f", a.d);                break;
+        case LOG_ARG_UINT:  _logAppend(out, size, o, "%lu", (unsigned long)a.i);  break;
+        case LOG_ARG_INT:   _logAppend(out, size, o, "%ld", (long)a.i);           break;
+        default:            _logAppend(out, size, o, "%.0f", a.d);                break;
+      }
+    }
+  }
+
+  while (fmt != NULL && *fmt && o < (size -1))
+  {
+    if (*fmt != '%')   { out[o++] = *fmt++; continue; }
+    if (fmt[1] == '%') { out[o++] = '%'; fmt += 2; continue; }
+
+    //-- "%[flags][width][.precision]", a '*' takes its value from the arguments --
+    s = 0;
+    spec[s++] = *fmt++;
+    while (*fmt && strchr("-+ #0123456789.*", *fmt) && s < (sizeof(spec) -16))
+    {
+      if (*fmt == '*')
+      {
+        s += snprintf(&spec[s], 12, "%d", (_logGetArg(r, pos, a) ? (int)a.i : 0));
+        fmt++;
+        continue;
+      }
+      spec[s++] = *fmt++;
+    }
+    while (*fmt && strchr("hlLqjzt", *fmt)) fmt++;  // the size is in the record
+    if ((conv = *fmt) == '\0') break;
+    fmt++;
+
+    if (!_logGetArg(r, pos, a))
+    {
+      _logAppend(out, size, o, "?");
+      continue;
+    }
+    bool is64 = (a.type == LOG_ARG_I64 || a.type == LOG_ARG_U64);
+    switch(conv)
+    {
+      case 'd':
+      case 'i':   if (a.type == LOG_ARG_STR)  { _logAppend(out, size, o, "%s", a.s); break; }
+                  if (is64 && (a.i < INT32_MIN || a.i > INT32_MAX)) { _logAppend(out, size, o, "%.0f", a.d); break; }
+                  spec[s++] = 'l'; spec[s++] = 'd'; spec[s] = '\0';
+                  _logAppend(out, size, o, spec, (long)a.i);
+                  break;
+      case 'u':
+      case 'o':
+      case 'x':
+      case 'X':   if (a.type == LOG_ARG_STR)  { _logAppend(out, size, o, "%s", a.s); break; }
+                  if (is64 && (uint64_t)a.i > UINT32_MAX) { _logAppend(out, size, o, "%.0f", a.d); break; }
+                  spec[s++] = 'l'; spec[s++] = conv; spec[s] = '\0';
+                  _logAppend(out, size, o, spec, (unsigned long)(uint32_t)a.i);
+                  break;
+      case 'c':   spec[s++] = 'c'; spec[s] = '\0';
+                  _logAppend(out, size, o, spec, (int)a.i);
+                  break;
+      case 's':   spec[s++] = 's'; spec[s] = '\0';
+                  _logAppend(out, size, o, spec, (a.type == LOG_ARG_STR ? a.s : "?"));
+                  break;
+      case 'p':   spec[s++] = 'p'; spec[s] = '\0';
+                  _logAppend(out, size, o, spec, (void*)(uintptr_t)a.i);
+                  break;
+      case 'f':
+      case 'F':
+      case 'e':
+      case 'E':
+      case 'g':
+      case 'G':   spec[s++] = conv; spec[s] = '\0';
+                  _logAppend(out, size, o, spec, a.d);
+                  break;
+      default:    _logAppend(out, size, o, "?");
+                  break;
+    }
+  }
+  out[o] = '\0';
+  if (r.truncated)    //-- the marker goes before the line ending (if the format has one) --
+  {
+    char   eol[4];
+    size_t e = o;
+    while (e > 0 && (o - e) < (sizeof(eol) -1) && (out[e -1] == '\r' || out[e -1] == '\n')) e--;
+    strlcpy(eol, &out[e], sizeof(eol));
+    out[o = e] = '\0';
+    _logAppend(out, size, o, " [truncated]%s", eol);
+  }
+  if (r.site->newLine) _logAppend(out, size, o, "\r\n");
+  return o;
+
+} // _logFormat()
+
+
+//===========================================================================================
+// print the oldest not yet printed records to the sinks
+void _logDrain(uint8_t maxRecs)
+{
+  if ((logHead - logSinkTail) > LOG_SLOTS)
+  {
+    logLost    += (logHead - logSinkTail) - LOG_SLOTS;
+    logSinkTail = logHead - LOG_SLOTS;
+  }
+  while (logSinkTail != logHead && maxRecs-- > 0)
+  {
+    const logRecord &r = logRing[logSinkTail % LOG_SLOTS];
+    logSinkTail++;
+    if (logSinks == 0) continue;
+
+    size_t o = snprintf(_logLine, sizeof(_logLine), "[%02d:%02d:%02d][%7u|%6u] %-12.12s(%4d): "
+                                        , hour(r.time), minute(r.time), second(r.time)
+                                        , r.heap, r.block
+                                        , r.site->func, r.site->line);
+    if (o >= sizeof(_logLine)) o = sizeof(_logLine) -1;
+    _logFormat(r, &_logLine[o], sizeof(_logLine) - o);
+
+    if (logSinks & LOG_SINK_SERIAL) DEBUG_PORT.print(_logLine);
+    if (logSinks & LOG_SINK_TELNET) TelnetStream.print(_logLine);
+  }
+
+} // _logDrain()
+
+#define _logFlush()     ({ if (logSinkTail != logHead) _logDrain(LOG_SLOTS); })
+
+
+//===========================================================================================
+// called from doSystemTasks()
+void handleDebugLog()
+{
+  if (logSinkTail != logHead) _logDrain(LOG_DRAIN_MAX);
+
+} // handleDebugLog()
 
-#endif // DEBUG_H 
+#endif // DEBUG_H
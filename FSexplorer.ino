@@ -52,6 +52,10 @@ void setupFSexplorer()    // Funktionsaufruf "spiffs();" muss im Setup eingebund
   {
     httpServer.send(200, "text/html", Helper); //Upload the FSexplorer.html
   }
+  //-- handleFileUpload() needs the size of the upload before it starts --
+  const char *uploadHeaders[] = { "Content-Length" };
+  httpServer.collectHeaders(uploadHeaders, 1);
+
   httpServer.on("/api/listfiles", APIlistFiles);
   httpServer.on("/SPIFFSformat", formatSpiffs);
   httpServer.on("/upload", HTTP_POST, []() {}, handleFileUpload);
@@ -59,10 +63,10 @@ void setupFSexplorer()    // Funktionsaufruf "spiffs();" muss im Setup eingebund
   httpServer.on("/update", updateFirmware);
   httpServer.onNotFound([]() 
   {
-    if (Verbose2) DebugTf("in 'onNotFound()'!! [%s] => \r\n", httpServer.uri().c_str());
+    if (Verbose2) LogTf(LOG_DEBUG, "in 'onNotFound()'!! [%s] => \r\n", httpServer.uri().c_str());
     if (httpServer.uri().indexOf("/api/") == 0) 
     {
-      if (Verbose1) DebugTf("next: processAPI(%s)\r\n", httpServer.uri().c_str());
+      if (Verbose1) LogTf(LOG_DEBUG, "next: processAPI(%s)\r\n", httpServer.uri().c_str());
       processAPI();
     }
     else
@@ -79,154 +83,73 @@ void setupFSexplorer()    // Funktionsaufruf "spiffs();" muss im Setup eingebund
 
 
 //=====================================================================================
-#if defined(ESP8266)
-
-void ESP8266_APIlistFiles()
+// [{"name":"..","size":".."}, .. ,{"usedBytes":"..","totalBytes":"..","freeBytes":"..","files":..}]
+// sent while walking the directory, in parts of LIST_BUF_SIZE
+//
+//   /api/listfiles?sort=none            in directory order (fastest)
+//   /api/listfiles?offset=20&count=10   only the 21st up to the 30th file
+//=====================================================================================
+void APIlistFiles()             // Senden aller Daten an den Client
 {   
-  FSInfo SPIFFSinfo;
-
-  typedef struct _fileMeta {
-    char    Name[30];     
-    int32_t Size;
-  } fileMeta;
-
-  _fileMeta dirMap[30];
-  int fileNr = 0;
-  
-  Dir dir = SPIFFS.openDir("/");         // List files on SPIFFS
-  while (dir.next())  
+  char      listBuff[LIST_BUF_SIZE];
+  uint16_t  listLen = 0;
+  dirWalker w;
+  bool      byName  = (httpServer.arg("sort") != "none");
+  uint16_t  offset  = httpServer.arg("offset").toInt();
+  uint16_t  count   = httpServer.hasArg("count") ? httpServer.arg("count").toInt() : 0xFFFF;
+  uint16_t  fileNr  = 0, nrFiles = 0;
+  uint32_t  usedBytes, totalBytes;
+
+  httpServer.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  httpServer.send(200, "application/json", "[");
+
+  if (dirOpen(w))
   {
-    dirMap[fileNr].Name[0] = '\0';
-    strncat(dirMap[fileNr].Name, dir.fileName().substring(1).c_str(), 29); // remove leading '/'
-    dirMap[fileNr].Size = dir.fileSize();
-    fileNr++;
-  }
-
-  // -- bubble sort dirMap op .Name--
-  for (int8_t y = 0; y < fileNr; y++) {
-    yield();
-    for (int8_t x = y + 1; x < fileNr; x++)  {
-      //DebugTf("y[%d], x[%d] => seq[y][%s] / seq[x][%s] ", y, x, dirMap[y].Name, dirMap[x].Name);
-      if (strcasecmp(dirMap[x].Name, dirMap[y].Name) <= 0)
+    while ((fileNr - offset) < count && nextFile(w, byName))
+    {
+      yield();
+      if (fileNr++ < offset) continue;
+      if ((sizeof(listBuff) - listLen) < (FS_NAME_LEN + 40))
       {
-        //Debug(" !switch!");
-        fileMeta temp = dirMap[y];
-        dirMap[y] = dirMap[x];
-        dirMap[x] = temp;
-      } /* end if */
-      //Debugln();
-    } /* end for */
-  } /* end for */
-
-  for (int8_t x = 0; x < fileNr; x++)  
-  {
-    DebugTln(dirMap[x].Name);
+        httpServer.sendContent(listBuff);
+        listLen = 0;
+      }
+      listLen += snprintf(&listBuff[listLen], sizeof(listBuff) - listLen, "%s{\"name\":\"%s\",\"size\":\"%s\"}"
+                                            , (fileNr > (offset +1) ? "," : "")
+                                            , w.entry.name, formatBytes(w.entry.size).c_str());
+    }
+    dirClose(w);
   }
-
-  String temp = "[";
-  for (int f=0; f < fileNr; f++)  
+  //-- the total (for paging) only needs one walk of the directory --
+  if (dirOpen(w))
   {
-    if (temp != "[") temp += ",";
-    temp += R"({"name":")" + String(dirMap[f].Name) + R"(","size":")" + formatBytes(dirMap[f].Size) + R"("})";
-  }
-  SPIFFS.info(SPIFFSinfo);
-  temp += R"(,{"usedBytes":")" + formatBytes(SPIFFSinfo.usedBytes * 1.05) + R"(",)" +       // Berechnet den verwendeten Speicherplatz + 5% Sicherheitsaufschlag
-          R"("totalBytes":")" + formatBytes(SPIFFSinfo.totalBytes) + R"(","freeBytes":")" + // Zeigt die Größe des Speichers
-          (SPIFFSinfo.totalBytes - (SPIFFSinfo.usedBytes * 1.05)) + R"("}])";               // Berechnet den freien Speicherplatz + 5% Sicherheitsaufschlag
-  httpServer.send(200, "application/json", temp);
-  
-}// ESP8266_APIlistFiles()
-
-#elif defined(ESP32)
-
-void ESP32_APIlistFiles()
-{   
-//  FSInfo SPIFFSinfo;
-
-  typedef struct _fileMeta {
-    char    Name[30];     
-    int32_t Size;
-  } fileMeta;
-
-  _fileMeta dirMap[30];
-  int fileNr = 0;
-  
-  File root = SPIFFS.open("/");         // List files on SPIFFS
-  if(!root){
-      DebugTln("- failed to open directory");
-      return;
-  }
-  if(!root.isDirectory()){
-      DebugTln(" - not a directory");
-      return;
-  }
-
-  File file = root.openNextFile();
-  while(file){
-    if(file.isDirectory()){
-        DebugT("  DIR : ");
-        DebugTln(file.name());
-        // directory is skipped
-    } else {
-      DebugT("  FILE: ");
-      Debug(file.name());
-      Debug("\tSIZE: ");
-      Debugln(file.size());
-      dirMap[fileNr].Name[0] = '\0';
-      strncat(dirMap[fileNr].Name, file.name(), 29); // first copy file.name() to dirMap
-      memmove(dirMap[fileNr].Name, dirMap[fileNr].Name+1, strlen(dirMap[fileNr].Name)); // remove leading '/'
-      dirMap[fileNr].Size = file.size();
+    while (dirNext(w))
+    {
+      if ((++nrFiles % 16) == 0)  yield();
     }
-    file = root.openNextFile();
-    fileNr++;
+    dirClose(w);
   }
 
-  // -- bubble sort dirMap op .Name--
-  for (int8_t y = 0; y < fileNr; y++) {
-    yield();
-    for (int8_t x = y + 1; x < fileNr; x++)  {
-      //DebugTf("y[%d], x[%d] => seq[y][%s] / seq[x][%s] ", y, x, dirMap[y].Name, dirMap[x].Name);
-      if (strcasecmp(dirMap[x].Name, dirMap[y].Name) <= 0)  
-      {
-        //Debug(" !switch!");
-        fileMeta temp = dirMap[y];
-        dirMap[y] = dirMap[x];
-        dirMap[x] = temp;
-      } /* end if */
-      //Debugln();
-    } /* end for */
-  } /* end for */
-
-  //Debugln(F("\r\n"));
-  for(int f=0; f<fileNr; f++)
-  {
-    Debugf("%-25s %6d bytes \r\n", dirMap[f].Name, dirMap[f].Size);
-    yield();
-  }
-  
-  String temp = "[";
-  for (int f=0; f < fileNr; f++)  
-  {
-    if (temp != "[") temp += ",";
-    temp += R"({"name":")" + String(dirMap[f].Name) + R"(","size":")" + formatBytes(dirMap[f].Size) + R"("})";
-  }
-  //SPIFFS.info(SPIFFSinfo);
-  temp += R"(,{"usedBytes":")" + formatBytes(SPIFFS.usedBytes() * 1.05) + R"(",)" +       // Berechnet den verwendeten Speicherplatz + 5% Sicherheitsaufschlag
-          R"("totalBytes":")" + formatBytes(SPIFFS.totalBytes()) + R"(","freeBytes":")" + // Zeigt die Größe des Speichers
-          (SPIFFS.totalBytes() - (SPIFFS.usedBytes() * 1.05)) + R"("}])";               // Berechnet den freien Speicherplatz + 5% Sicherheitsaufschlag
-  httpServer.send(200, "application/json", temp);
-  
-}// ESP32_APIlistFiles()
-#endif
-
-
-void APIlistFiles()             // Senden aller Daten an den Client
-{   
 #if defined(ESP8266)
-  ESP8266_APIlistFiles();
+  SPIFFS.info(SPIFFSinfo);
+  usedBytes  = SPIFFSinfo.usedBytes * 1.05;   // Berechnet den verwendeten Speicherplatz + 5% Sicherheitsaufschlag
+  totalBytes = SPIFFSinfo.totalBytes;
 #elif defined(ESP32)
-  ESP32_APIlistFiles();
+  usedBytes  = SPIFFS.usedBytes() * 1.05;
+  totalBytes = SPIFFS.totalBytes();
 #endif
+  if ((sizeof(listBuff) - listLen) < 120)
+  {
+    httpServer.sendContent(listBuff);
+    listLen = 0;
+  }
+  snprintf(&listBuff[listLen], sizeof(listBuff) - listLen
+                          , "%s{\"usedBytes\":\"%s\",\"totalBytes\":\"%s\",\"freeBytes\":\"%u\",\"files\":%u}]"
+                          , (fileNr > offset ? "," : "")
+                          , formatBytes(usedBytes).c_str(), formatBytes(totalBytes).c_str()
+                          , (usedBytes < totalBytes ? totalBytes - usedBytes : 0), nrFiles);
+  httpServer.sendContent(listBuff);
+  
 } // APIlistFiles()
 
 
@@ -247,11 +170,37 @@ bool handleFile(String&& path)
 } // handleFile()
 
 
+//=====================================================================================
+// the Content-Length of the (multipart) request is a bit more than the
+// size of the file, so this is on the safe side. A file that is replaced
+// stays until the upload is complete, so it does not give its space back
+//=====================================================================================
+bool uploadFits()
+{
+  uint32_t needed = httpServer.header("Content-Length").toInt();
+
+  if (needed == 0) return true;     // not known, find out while writing
+  return freeSpace(needed);
+
+} // uploadFits()
+
+
+//=====================================================================================
+// the chunks that come in are collected in uploadBuf and written in parts
+// of UPLOAD_BUF_SIZE (whole SPIFFS pages) to UPLOAD_TMP_FILE. Only a
+// complete upload replaces the file, a failed one leaves it as it was. An
+// upload that does not fit is refused before anything is written (the
+// web server still reads it)
 //=====================================================================================
 void handleFileUpload() 
 {
-  static File fsUploadFile;
+  static File     fsUploadFile;
+  static uint8_t *uploadBuf = NULL;
+  static uint16_t uploadLen;
+  static uint32_t uploadStart;
+  static bool     uploadFailed;
   HTTPUpload& upload = httpServer.upload();
+
   if (upload.status == UPLOAD_FILE_START) 
   {
     if (upload.filename.length() > 30) 
@@ -259,19 +208,78 @@ void handleFileUpload()
       upload.filename = upload.filename.substring(upload.filename.length() - 30, upload.filename.length());  // Dateinamen auf 30 Zeichen kürzen
     }
     Debugln("FileUpload Name: " + upload.filename);
-    fsUploadFile = SPIFFS.open("/" + httpServer.urlDecode(upload.filename), "w");
+    uploadStart  = millis();
+    uploadLen    = 0;
+    if (SPIFFS.exists(UPLOAD_TMP_FILE))  SPIFFS.remove(UPLOAD_TMP_FILE);   // left by a reboot
+    uploadFailed = !uploadFits();
+    if (uploadFailed) 
+    {
+      DebugTf("FileUpload [%s] does not fit on SPIFFS!\r\n", upload.filename.c_str());
+      return;
+    }
+    fsUploadFile = SPIFFS.open(UPLOAD_TMP_FILE, "w");
+    uploadBuf    = (uint8_t*)malloc(UPLOAD_BUF_SIZE);   // NULL: every chunk is written as it comes
   } 
   else if (upload.status == UPLOAD_FILE_WRITE) 
   {
-    Debugln("FileUpload Data: " + (String)upload.currentSize);
-    if (fsUploadFile)
-      fsUploadFile.write(upload.buf, upload.currentSize);
+    if (uploadFailed || !fsUploadFile) return;
+    if (Verbose2) LogTf(LOG_DEBUG, "FileUpload Data: [%u]\r\n", upload.currentSize);
+
+    const uint8_t *data = upload.buf;
+    size_t         left = upload.currentSize;
+    if (uploadBuf == NULL)
+    {
+      uploadFailed = (fsUploadFile.write(data, left) != left);
+      return;
+    }
+    while (left > 0 && !uploadFailed)
+    {
+      size_t part = (left < (size_t)(UPLOAD_BUF_SIZE - uploadLen)) ? left : (UPLOAD_BUF_SIZE - uploadLen);
+      memcpy(&uploadBuf[uploadLen], data, part);
+      uploadLen += part;
+      data      += part;
+      left      -= part;
+      if (uploadLen == UPLOAD_BUF_SIZE)
+      {
+        uploadFailed = (fsUploadFile.write(uploadBuf, uploadLen) != uploadLen);
+        uploadLen    = 0;
+      }
+    }
   } 
-  else if (upload.status == UPLOAD_FILE_END) 
+  else if (upload.status == UPLOAD_FILE_END || upload.status == UPLOAD_FILE_ABORTED) 
   {
+    String fileName = "/" + httpServer.urlDecode(upload.filename);
+
+    if (upload.status == UPLOAD_FILE_ABORTED) uploadFailed = true;
     if (fsUploadFile)
+    {
+      if (!uploadFailed && uploadLen > 0)
+        uploadFailed = (fsUploadFile.write(uploadBuf, uploadLen) != uploadLen);
       fsUploadFile.close();
-    Debugln("FileUpload Size: " + (String)upload.totalSize);
+      if (!uploadFailed)
+      {
+        if (SPIFFS.exists(fileName))  SPIFFS.remove(fileName);
+        uploadFailed = !SPIFFS.rename(UPLOAD_TMP_FILE, fileName);
+      }
+      if (uploadFailed) SPIFFS.remove(UPLOAD_TMP_FILE);   // no half files
+    }
+    else uploadFailed = true;
+    free(uploadBuf);
+    uploadBuf = NULL;
+
+    uint32_t ms = millis() - uploadStart;
+    if (uploadFailed)
+    {
+      LogTf(LOG_ERROR, "FileUpload [%s] FAILED after [%u] bytes\r\n", fileName.c_str(), upload.totalSize);
+      writeToSysLog("FileUpload [%s] FAILED after [%u] bytes", fileName.c_str(), upload.totalSize);
+      if (upload.status == UPLOAD_FILE_END)
+        httpServer.send(507, "text/plain", "Not enough space on SPIFFS\r\n");
+      return;
+    }
+    DebugTf("FileUpload Size: [%u] bytes in [%u]ms (%u bytes/sec)\r\n", upload.totalSize, ms
+                                        , (ms > 0 ? (uint32_t)((upload.totalSize * 1000ULL) / ms) : upload.totalSize));
+    //-- an (edited) settings file: use it --
+    if (fileName == SETTINGS_FILE) importSettings();
     httpServer.sendContent(Header);
   }
   
@@ -318,7 +326,7 @@ const String &contentType(String& filename)
 } // &contentType()
 
 //=====================================================================================
-bool freeSpace(uint16_t const& printsize) 
+bool freeSpace(uint32_t const& printsize) 
 {    
    #if defined(ESP8266)
     FSInfo SPIFFSinfo;
@@ -390,7 +398,7 @@ void doRedirect(String msg, int wait, const char* URL, bool reboot)
   if (reboot) 
   {
     delay(5000);
-    esp_reboot();
+    rebootWithReason(msg.c_str());
   }
   
 } // doRedirect()
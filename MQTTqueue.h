@@ -0,0 +1,72 @@
+/*
+***************************************************************************
+**  Filename  : MQTTqueue.h
+**  Version  : v2.3.0-rc5
+**
+**  Copyright (c) 2020 Robert van den Breemen
+**   Based on (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See bottom of file.
+***************************************************************************
+*/
+
+/*
+ * Layout of the MQTT store-and-forward queue (see MQTTqueue.ino):
+ *
+ *   mqttQueueHeader | mqttSnapshot[0] | mqttSnapshot[1] | ..
+ *
+ * The file grows one snapshot at a time until it holds MQTT_QUEUE_SLOTS
+ * of them, after that the snapshots are written in place. The header is
+ * only saved every MQTT_QUEUE_SAVE_EVERY snapshots (or when
+ * mqttQueueSaveTimer is due), so after a reboot at most that many
+ * snapshots are lost.
+ */
+
+#ifndef _MQTT_QUEUE_H
+#define _MQTT_QUEUE_H
+
+#define MQTT_QUEUE_FILE       "/MQTTqueue.bin"
+#define MQTT_QUEUE_SLOTS       720    // 2 hours of telegrams every 10 seconds
+#define MQTT_QUEUE_MAGIC      0x4D515131
+#define MQTT_QUEUE_SAVE_EVERY   10    // snapshots (queued or sent) between header writes
+
+typedef struct {
+    uint32_t  magic;
+    uint16_t  slots;
+    uint16_t  head;         // next slot to write
+    uint16_t  tail;         // oldest queued snapshot
+    uint16_t  count;
+} mqttQueueHeader;          // first bytes of MQTT_QUEUE_FILE
+
+typedef struct {
+    uint32_t  epoch;        // UTC
+    char      timestamp[14];
+    int32_t   edt1, edt2, ert1, ert2;   // all values in 1/1000 of the unit
+    int32_t   pd, pr, gdt;
+} mqttSnapshot;             // one telegram that could not be published
+
+#endif // _MQTT_QUEUE_H
+
+
+/***************************************************************************
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit
+* persons to whom the Software is furnished to do so, subject to the
+* following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT
+* OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+* THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+***************************************************************************/
@@ -0,0 +1,300 @@
+/*
+***************************************************************************
+**  Program  : MQTTqueue, part of DSMRlogger-Next
+**  Version  : v2.3.0-rc5
+**
+**  Copyright (c) 2020 Robert van den Breemen
+**   Based on (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See bottom of file.
+***************************************************************************
+**  Store-and-forward queue: while there is no connection with the broker
+**  a compact snapshot of every telegram that should have been published
+**  is written to a (bounded) ring file on SPIFFS. After the connection is
+**  restored the snapshots are published oldest first, with their original
+**  timestamp, to <topTopic>/history at a limited rate.
+**
+**  The file starts with a header (mqttQueueHeader) followed by (up to)
+**  MQTT_QUEUE_SLOTS records (mqttSnapshot), see MQTTqueue.h. When the
+**  queue is full the oldest snapshot is overwritten.
+*/
+
+#ifdef USE_MQTT
+
+  static mqttQueueHeader  mqttQueue;
+  static bool             mqttQueueOpen    = false;
+  static bool             mqttQueueChecked = false;
+  uint32_t                mqttQueueDropped = 0;
+  uint8_t                 mqttQueueUnsaved = 0;
+
+  DECLARE_TIMER_SEC(mqttQueueSaveTimer, 300);  // save a header that is behind at least this often
+
+#endif
+
+//===========================================================================================
+bool writeMQTTqueueHeader()
+{
+#ifdef USE_MQTT
+  File qFile = SPIFFS.open(MQTT_QUEUE_FILE, "r+");
+  if (!qFile)
+  {
+    LogTf(LOG_ERROR, "Error opening [%s]\r\n", MQTT_QUEUE_FILE);
+    return false;
+  }
+  qFile.seek(0, SeekSet);
+  qFile.write((const uint8_t*)&mqttQueue, sizeof(mqttQueue));
+  qFile.close();
+  mqttQueueUnsaved = 0;
+  RESTART_TIMER(mqttQueueSaveTimer);
+#endif
+  return true;
+
+} // writeMQTTqueueHeader()
+
+
+//===========================================================================================
+// don't wear out the flash: the header is saved every MQTT_QUEUE_SAVE_EVERY
+// snapshots, or when a change has waited for mqttQueueSaveTimer
+//===========================================================================================
+void saveMQTTqueueHeader(bool force)
+{
+#ifdef USE_MQTT
+  if (mqttQueueUnsaved == 0) return;
+  if (force || mqttQueueUnsaved >= MQTT_QUEUE_SAVE_EVERY || DUE(mqttQueueSaveTimer))
+  {
+    writeMQTTqueueHeader();
+  }
+#endif
+
+} // saveMQTTqueueHeader()
+
+
+//===========================================================================================
+bool openMQTTqueue()
+{
+#ifdef USE_MQTT
+  if (mqttQueueOpen) return true;
+
+  if (SPIFFS.exists(MQTT_QUEUE_FILE))
+  {
+    File qFile = SPIFFS.open(MQTT_QUEUE_FILE, "r");
+    uint32_t inFile = 0;
+    if (qFile)
+    {
+      qFile.read((uint8_t*)&mqttQueue, sizeof(mqttQueue));
+      if (qFile.size() > sizeof(mqttQueue))
+        inFile = (qFile.size() - sizeof(mqttQueue)) / sizeof(mqttSnapshot);
+      qFile.close();
+    }
+    //-- the file grows with the queue: every queued slot must be in it --
+    if (    mqttQueue.magic == MQTT_QUEUE_MAGIC
+         && mqttQueue.slots == MQTT_QUEUE_SLOTS
+         && mqttQueue.count <= MQTT_QUEUE_SLOTS
+         && mqttQueue.head  <= inFile
+         && (mqttQueue.count == 0 || (mqttQueue.tail < inFile && mqttQueue.count <= inFile)) )
+    {
+      DebugTf("[%s] holds [%d] snapshots\r\n", MQTT_QUEUE_FILE, mqttQueue.count);
+      mqttQueueOpen = true;
+      return true;
+    }
+    DebugTf("[%s] not valid -> create new queue\r\n", MQTT_QUEUE_FILE);
+    SPIFFS.remove(MQTT_QUEUE_FILE);
+  }
+
+  //-- only the header: the snapshots are added (appended) when they are queued --
+  memset(&mqttQueue, 0, sizeof(mqttQueue));
+  mqttQueue.magic = MQTT_QUEUE_MAGIC;
+  mqttQueue.slots = MQTT_QUEUE_SLOTS;
+
+  File qFile = SPIFFS.open(MQTT_QUEUE_FILE, "w");
+  if (!qFile)
+  {
+    LogTf(LOG_ERROR, "Error creating [%s]\r\n", MQTT_QUEUE_FILE);
+    return false;
+  }
+  if (qFile.write((const uint8_t*)&mqttQueue, sizeof(mqttQueue)) != sizeof(mqttQueue))
+  {
+    LogTf(LOG_ERROR, "Error: [%s] not created (SPIFFS full?)\r\n", MQTT_QUEUE_FILE);
+    qFile.close();
+    SPIFFS.remove(MQTT_QUEUE_FILE);
+    return false;
+  }
+  qFile.close();
+  DebugTf("created [%s] for [%d] slots\r\n", MQTT_QUEUE_FILE, MQTT_QUEUE_SLOTS);
+  mqttQueueOpen = true;
+#endif
+  return true;
+
+} // openMQTTqueue()
+
+
+//===========================================================================================
+// no broker connection: save what we should have published
+//===========================================================================================
+void queueMQTTsnapshot()
+{
+#ifdef USE_MQTT
+  mqttSnapshot snap;
+
+  if (!openMQTTqueue()) return;
+
+  memset(&snap, 0, sizeof(snap));
+  snap.epoch = utcEpoch(actTimestamp);
+  strlcpy(snap.timestamp, actTimestamp, sizeof(snap.timestamp));
+  snap.edt1  = DSMRdata.energy_delivered_tariff1.int_val();
+  snap.edt2  = DSMRdata.energy_delivered_tariff2.int_val();
+  snap.ert1  = DSMRdata.energy_returned_tariff1.int_val();
+  snap.ert2  = DSMRdata.energy_returned_tariff2.int_val();
+  snap.pd    = DSMRdata.power_delivered.int_val();
+  snap.pr    = DSMRdata.power_returned.int_val();
+#ifdef USE_PRE40_PROTOCOL
+  snap.gdt   = DSMRdata.gas_delivered2.int_val();
+#else
+  snap.gdt   = DSMRdata.gas_delivered.int_val();
+#endif
+
+  File qFile = SPIFFS.open(MQTT_QUEUE_FILE, "r+");
+  if (!qFile)
+  {
+    LogTf(LOG_ERROR, "Error opening [%s]\r\n", MQTT_QUEUE_FILE);
+    return;
+  }
+  //-- the first lap this is the end of the file (so the file grows) --
+  qFile.seek(sizeof(mqttQueue) + (mqttQueue.head * sizeof(snap)), SeekSet);
+  if (qFile.write((const uint8_t*)&snap, sizeof(snap)) != sizeof(snap))
+  {
+    LogTf(LOG_ERROR, "Error writing [%s] (SPIFFS full?)\r\n", MQTT_QUEUE_FILE);
+    qFile.close();
+    mqttQueueDropped++;
+    return;
+  }
+  qFile.close();
+
+  mqttQueue.head = (mqttQueue.head +1) % MQTT_QUEUE_SLOTS;
+  if (mqttQueue.count < MQTT_QUEUE_SLOTS)
+  {
+    mqttQueue.count++;
+  }
+  else  //-- full: the oldest one is gone --
+  {
+    mqttQueue.tail = (mqttQueue.tail +1) % MQTT_QUEUE_SLOTS;
+    mqttQueueDropped++;
+  }
+  mqttQueueUnsaved++;
+  saveMQTTqueueHeader(false);
+
+  if (Verbose1) LogTf(LOG_DEBUG, "queued [%s], [%d] in queue\r\n", snap.timestamp, mqttQueue.count);
+#endif
+
+} // queueMQTTsnapshot()
+
+
+//===========================================================================================
+// connected again: publish one queued snapshot (called when mqttQueueTimer is DUE)
+//===========================================================================================
+void handleMQTTqueue()
+{
+#ifdef USE_MQTT
+  mqttSnapshot  snap;
+  char          topic[50];
+  char          payload[300];
+
+  //-- after a reboot: pick up what was left in the queue (once) --
+  if (!mqttQueueOpen && !mqttQueueChecked)
+  {
+    mqttQueueChecked = true;
+    if (SPIFFS.exists(MQTT_QUEUE_FILE)) openMQTTqueue();
+  }
+  if (!mqttQueueOpen || mqttQueue.count == 0)  return;
+  if (memShed(MEM_CRITICAL))                   return;
+  if (!mqttIsConnected || !MQTTclient.connected())
+  {
+    saveMQTTqueueHeader(false);
+    return;
+  }
+
+  File qFile = SPIFFS.open(MQTT_QUEUE_FILE, "r");
+  if (!qFile)
+  {
+    LogTf(LOG_ERROR, "Error opening [%s]\r\n", MQTT_QUEUE_FILE);
+    return;
+  }
+  qFile.seek(sizeof(mqttQueue) + (mqttQueue.tail * sizeof(snap)), SeekSet);
+  qFile.read((uint8_t*)&snap, sizeof(snap));
+  qFile.close();
+
+  if (settingMQTTtopTopic[strlen(settingMQTTtopTopic)-1] == '/')
+        snprintf(topic, sizeof(topic), "%shistory",  settingMQTTtopTopic);
+  else  snprintf(topic, sizeof(topic), "%s/history", settingMQTTtopTopic);
+
+  snprintf(payload, sizeof(payload), "{\"timestamp\":\"%s\",\"epoch\":%lu"
+                                     ",\"energy_delivered_tariff1\":%d.%03d"
+                                     ",\"energy_delivered_tariff2\":%d.%03d"
+                                     ",\"energy_returned_tariff1\":%d.%03d"
+                                     ",\"energy_returned_tariff2\":%d.%03d"
+                                     ",\"power_delivered\":%d.%03d"
+                                     ",\"power_returned\":%d.%03d"
+                                     ",\"gas_delivered\":%d.%03d}"
+                                     , snap.timestamp, (unsigned long)snap.epoch
+                                     , (int)(snap.edt1 / 1000), (int)(snap.edt1 % 1000)
+                                     , (int)(snap.edt2 / 1000), (int)(snap.edt2 % 1000)
+                                     , (int)(snap.ert1 / 1000), (int)(snap.ert1 % 1000)
+                                     , (int)(snap.ert2 / 1000), (int)(snap.ert2 % 1000)
+                                     , (int)(snap.pd / 1000), (int)(snap.pd % 1000)
+                                     , (int)(snap.pr / 1000), (int)(snap.pr % 1000)
+                                     , (int)(snap.gdt / 1000), (int)(snap.gdt % 1000));
+
+  if (MQTTclient.getBufferSize() < (strlen(topic) + strlen(payload) + 7))
+  {
+    MQTTclient.setBufferSize(strlen(topic) + strlen(payload) + 7);
+  }
+  if (!MQTTclient.publish(topic, payload, false))
+  {
+    LogTf(LOG_WARN, "Error publish(%s) -> retry later\r\n", topic);
+    return;
+  }
+
+  mqttQueue.tail = (mqttQueue.tail +1) % MQTT_QUEUE_SLOTS;
+  mqttQueue.count--;
+  mqttQueueUnsaved++;
+  saveMQTTqueueHeader(mqttQueue.count == 0);
+
+  if (mqttQueue.count == 0) DebugTln("MQTT queue is empty");
+#endif
+
+} // handleMQTTqueue()
+
+
+//===========================================================================================
+uint16_t mqttQueueCount()
+{
+#ifdef USE_MQTT
+  if (mqttQueueOpen) return mqttQueue.count;
+#endif
+  return 0;
+
+} // mqttQueueCount()
+
+
+/***************************************************************************
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit
+* persons to whom the Software is furnished to do so, subject to the
+* following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT
+* OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+* THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+***************************************************************************/
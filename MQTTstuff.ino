@@ -23,50 +23,239 @@
 //  #include <PubSubClient.h>           // MQTT client publish and subscribe functionality
   
 //  static PubSubClient MQTTclient(wifiClient);
-  int8_t              reconnectAttempts = 0;
+  uint32_t            mqttDNSresolved = 0;  // millis() of the last lookup, 0 = none
+  uint32_t            mqttDNSstarted  = 0;  // millis() the lookup was started
+  uint32_t            mqttConnStarted = 0;  // millis() the TCP connect (or CONNECT) was started
+  volatile uint8_t    mqttDNSstate    = 0;  // MQTT_DNS_IDLE ..
+  volatile uint32_t   mqttDNSaddr     = 0;  // set by mqttDNSfound()
+  uint32_t            mqttBackoff = 0;      // ms, 0 = no failed attempts
+  int16_t             mqttHAnext = -1;      // next field for HA discovery, -1 = not started
+  uint32_t            mqttHAhash = 0;
+  bool                mqttHAfailed = false;
+  bool                mqttHAforce = false;  // HA (re)started: publish even if the hash matches
   char                lastMQTTtimestamp[15] = "-";
   char                mqttBuff[100] {0};
+  char                mqttStateBuff[MQTT_STATE_BUFF_MAX] {0};
+  uint16_t            mqttStateLen = 0;
+  uint8_t             mqttStateSkipped = 0;
 
+  //-- publish-on-change: one entry for every field in MyData --------
+  mqttField           mqttFields[MQTT_MAX_FIELDS];
+  char                mqttTopicPool[MQTT_TOPIC_POOL_MAX] {0};
+  uint16_t            mqttTopicPoolLen = 0;
+  uint8_t             mqttNrFields = 0;
+  uint8_t             mqttTopicPrefixLen = 0;
+  uint32_t            mqttMsgSent = 0, mqttMsgSaved = 0;
 
-  enum states_of_MQTT { MQTT_STATE_INIT, MQTT_STATE_TRY_TO_CONNECT, MQTT_STATE_IS_CONNECTED, MQTT_STATE_ERROR };
+
+  //-- non-blocking connect: one step per loop() -------------------
+  enum states_of_MQTT { MQTT_STATE_INIT, MQTT_STATE_RESOLVE, MQTT_STATE_TCP_CONNECT, MQTT_STATE_TCP_CONNECTING
+                      , MQTT_STATE_CONNACK, MQTT_STATE_DISCOVERY, MQTT_STATE_IS_CONNECTED, MQTT_STATE_WAIT_RETRY };
   enum states_of_MQTT stateMQTT = MQTT_STATE_INIT;
 
+  enum                { MQTT_DNS_IDLE, MQTT_DNS_BUSY, MQTT_DNS_FOUND, MQTT_DNS_FAILED };
+
   char                MQTTclientId[80] {0}; //hostname + mac 
 
 #endif
 
+//===========================================================================================
+// (re)start the state machine, the connection is made step by step from handleMQTT()
 //===========================================================================================
 void connectMQTT() 
 {
 #ifdef USE_MQTT
   
-  if (Verbose2) DebugTf("MQTTclient.connected(%d), mqttIsConnected[%d], stateMQTT [%d]\r\n"
+  if (Verbose2) LogTf(LOG_DEBUG, "MQTTclient.connected(%d), mqttIsConnected[%d], stateMQTT [%d]\r\n"
                                               , MQTTclient.connected()
                                               , mqttIsConnected, stateMQTT);
 
-  if (settingMQTTinterval == 0) {
+  if (MQTTclient.connected()) MQTTclient.disconnect();
+  tcpConnectAbort(mqttTcp);
+  mqttTcpClient.stop();
+  mqttHAnext      = -1;
+
+  mqttIsConnected = false;
+  mqttDNSresolved = 0;    // broker may have changed
+  mqttDNSstate    = MQTT_DNS_IDLE;
+  mqttBackoff     = 0;
+  stateMQTT       = MQTT_STATE_INIT;
+
+#endif
+} // connectMQTT()
+
+
+//===========================================================================================
+// called from doSystemTasks(), no step waits for the network
+//===========================================================================================
+void handleMQTT() 
+{
+#ifdef USE_MQTT
+  
+  if (settingMQTTinterval == 0 || strlen(settingMQTTbroker) == 0) 
+  {
+    if (stateMQTT != MQTT_STATE_INIT) connectMQTT();  // disconnect
     mqttIsConnected = false;
     return;
   }
 
-  if (!MQTTclient.connected() || stateMQTT != MQTT_STATE_IS_CONNECTED)
+  mqttIsConnected = connectMQTT_FSM();
+
+#endif
+} // handleMQTT()
+
+
+#ifdef USE_MQTT
+//===========================================================================================
+// called by lwIP (on the ESP32 from another task) with the answer of the lookup
+//===========================================================================================
+void mqttDNSfound(const char *name, const ip_addr_t *ipaddr, void *arg)
+{
+  if (ipaddr != NULL)
   {
-    mqttIsConnected = false;
-    stateMQTT = MQTT_STATE_INIT;
+    mqttDNSaddr  = ip4_addr_get_u32(ip_2_ip4(ipaddr));
+    mqttDNSstate = MQTT_DNS_FOUND;
   }
+  else mqttDNSstate = MQTT_DNS_FAILED;
 
-  mqttIsConnected = connectMQTT_FSM();
-  
-  if (Verbose1) DebugTf("connected()[%d], mqttIsConnected[%d], stateMQTT [%d]\r\n"
-                                              , MQTTclient.connected()
-                                              , mqttIsConnected, stateMQTT);
+} // mqttDNSfound()
+
+
+//===========================================================================================
+// use the cached address as long as it is valid, an IP address is never looked up.
+// The lookup does not block: it is started once and every next call checks if
+// the answer is there. Returns 1 if resolved, 0 while busy and -1 if it failed
+//===========================================================================================
+int8_t resolveMQTTbroker()
+{
+  ip_addr_t addr;
+
+  if (mqttDNSresolved > 0 && (millis() - mqttDNSresolved) < (MQTT_DNS_TTL * 1000UL)) 
+  {
+    return 1;
+  }
+
+  if (!MQTTbrokerIP.fromString(settingMQTTbroker))
+  {
+    switch(mqttDNSstate)
+    {
+      case MQTT_DNS_IDLE:
+            DebugTf("lookup [%s] ..\r\n", settingMQTTbroker);
+            mqttDNSstate = MQTT_DNS_BUSY;
+            switch(dns_gethostbyname(settingMQTTbroker, &addr, mqttDNSfound, NULL))
+            {
+              case ERR_OK:          mqttDNSaddr  = ip4_addr_get_u32(ip_2_ip4(&addr));   // cached by lwIP
+                                    mqttDNSstate = MQTT_DNS_FOUND;
+                                    break;
+              case ERR_INPROGRESS:  mqttDNSstarted = millis();
+                                    return 0;
+              default:              mqttDNSstate = MQTT_DNS_IDLE;
+                                    return -1;
+            }
+            break;
+
+      case MQTT_DNS_BUSY:
+            if ((millis() - mqttDNSstarted) < MQTT_DNS_TIMEOUT) return 0;
+            DebugTf("lookup [%s] timed out\r\n", settingMQTTbroker);
+            mqttDNSstate = MQTT_DNS_IDLE;
+            return -1;
+
+      case MQTT_DNS_FAILED:
+            mqttDNSstate = MQTT_DNS_IDLE;
+            return -1;
+    }
+    MQTTbrokerIP = IPAddress(mqttDNSaddr);
+    mqttDNSstate = MQTT_DNS_IDLE;
+  }
+  snprintf(MQTTbrokerIPchar, sizeof(MQTTbrokerIPchar), "%d.%d.%d.%d", MQTTbrokerIP[0]
+                                                                    , MQTTbrokerIP[1]
+                                                                    , MQTTbrokerIP[2]
+                                                                    , MQTTbrokerIP[3]);
+  if (!isValidIP(MQTTbrokerIP)) return -1;
+
+  DebugTf("[%s] => [%s]\r\n", settingMQTTbroker, MQTTbrokerIPchar);
+  mqttDNSresolved = millis() | 1;   // never 0
+  return 1;
+
+} // resolveMQTTbroker()
+
+
+//===========================================================================================
+// exponential backoff with +/- 25% jitter so not all loggers retry at the same moment
+//===========================================================================================
+void mqttRetryLater()
+{
+  uint32_t waitMs;
+
+  if (mqttBackoff == 0)   mqttBackoff = MQTT_BACKOFF_MIN;
+  else                    mqttBackoff = min(mqttBackoff * 2, (uint32_t)MQTT_BACKOFF_MAX);
+
+  waitMs = mqttBackoff - (mqttBackoff / 4) + random(mqttBackoff / 2);
+  DebugTf("MQTT: next attempt in [%d] seconds\r\n", (waitMs / 1000));
+  CHANGE_INTERVAL_MS(reconnectMQTTtimer, waitMs);
+
+  tcpConnectAbort(mqttTcp);
+  mqttTcpClient.stop();
+  mqttHAnext      = -1;
+  stateMQTT = MQTT_STATE_WAIT_RETRY;
+  DebugTln(F("Next State: MQTT_STATE_WAIT_RETRY"));
 
-  CHANGE_INTERVAL_MIN(reconnectMQTTtimer, 5);
+} // mqttRetryLater()
 
+
+//===========================================================================================
+// CONNECT (MQTT 3.1.1, clean session, no will) as PubSubClient::connect() builds it. It
+// is written without waiting for the CONNACK, PubSubClient's own CONNECT is then
+// swallowed by mqttTcpClient. Returns false if it could not be written
+//===========================================================================================
+bool mqttSendConnect()
+{
+  uint8_t   pkt[5 + 10 + sizeof(MQTTclientId) + sizeof(settingMQTTuser) + sizeof(settingMQTTpasswd) + 6];
+  uint8_t   body[sizeof(pkt)];
+  uint16_t  len = 0, hLen = 0;
+  uint16_t  remaining;
+  bool      withUser = (strlen(settingMQTTuser) > 0);
+
+  //-- variable header: protocol name, level, flags, keep alive --
+  const char *parts[3] = { MQTTclientId, settingMQTTuser, settingMQTTpasswd };
+  body[len++] = 0;  body[len++] = 4;
+  memcpy(&body[len], "MQTT", 4);  len += 4;
+  body[len++] = 4;                                      // 3.1.1
+  body[len++] = 0x02 | (withUser ? 0xC0 : 0x00);        // clean session (+ username, password)
+  body[len++] = (MQTT_KEEPALIVE >> 8);
+  body[len++] = (MQTT_KEEPALIVE & 0xFF);
+  //-- payload: client id (and username, password) --
+  for (uint8_t p = 0; p < (withUser ? 3 : 1); p++)
+  {
+    uint16_t l = strlen(parts[p]);
+    body[len++] = (l >> 8);
+    body[len++] = (l & 0xFF);
+    memcpy(&body[len], parts[p], l);
+    len += l;
+  }
+
+  //-- fixed header: type and the remaining length (7 bits per byte) --
+  pkt[hLen++] = MQTT_PKT_CONNECT;
+  remaining   = len;
+  do
+  {
+    uint8_t d   = remaining & 0x7F;
+    remaining >>= 7;
+    pkt[hLen++] = d | (remaining > 0 ? 0x80 : 0x00);
+  } while (remaining > 0);
+  memcpy(&pkt[hLen], body, len);
+
+  mqttTcpClient.connectSent = false;
+  if (mqttTcpClient.write(pkt, hLen + len) != (size_t)(hLen + len)) return false;
+  mqttTcpClient.connectSent = true;
+  return true;
+
+} // mqttSendConnect()
 #endif
-}
 
 
+//===========================================================================================
+// every call does (at most) one step and returns true if we can publish
 //===========================================================================================
 bool connectMQTT_FSM() 
 {
@@ -76,41 +265,77 @@ bool connectMQTT_FSM()
   {
     case MQTT_STATE_INIT:  
           DebugTln(F("MQTT State: MQTT Initializing"));
-          WiFi.hostByName(settingMQTTbroker, MQTTbrokerIP);  // lookup the MQTTbroker convert to IP
-          snprintf(MQTTbrokerIPchar, sizeof(MQTTbrokerIPchar), "%d.%d.%d.%d", MQTTbrokerIP[0]
-                                                                            , MQTTbrokerIP[1]
-                                                                            , MQTTbrokerIP[2]
-                                                                            , MQTTbrokerIP[3]);
-          if (!isValidIP(MQTTbrokerIP))  
-          {
-            DebugTf("ERROR: [%s] => is not a valid URL\r\n", settingMQTTbroker);
-            settingMQTTinterval = 0;
-            DebugTln(F("Next State: MQTT_STATE_ERROR"));
-            stateMQTT = MQTT_STATE_ERROR;
-            return false;
-          }
-          
-          //MQTTclient.disconnect();
-          //DebugTf("disconnect -> MQTT status, rc=%d \r\n", MQTTclient.state());
-          DebugTf("[%s] => setServer(%s, %d) \r\n", settingMQTTbroker, MQTTbrokerIPchar, settingMQTTbrokerPort);
-          MQTTclient.setServer(MQTTbrokerIPchar, settingMQTTbrokerPort);
-          DebugTf("setServer  -> MQTT status, rc=%d \r\n", MQTTclient.state());
           strlcpy(MQTTclientId, settingHostname, sizeof(MQTTclientId));
           strlcat(MQTTclientId, "-", sizeof(MQTTclientId));
           strlcat(MQTTclientId, WiFi.macAddress().c_str(), sizeof(MQTTclientId));
-          //MQTTclientId  = String(settingHostname) + "-" + WiFi.macAddress();
-          stateMQTT = MQTT_STATE_TRY_TO_CONNECT;
-          DebugTln(F("Next State: MQTT_STATE_TRY_TO_CONNECT"));
-          reconnectAttempts = 0;
-
-    case MQTT_STATE_TRY_TO_CONNECT:
-          DebugTln(F("MQTT State: MQTT try to connect"));
-          DebugTf("MQTT server is [%s], IP[%s]\r\n", settingMQTTbroker, MQTTbrokerIPchar);
-      
+          buildMQTTtopicTable();
+          MQTTclient.setSocketTimeout(MQTT_SOCKET_TIMEOUT);
+          stateMQTT = MQTT_STATE_RESOLVE;
+          DebugTln(F("Next State: MQTT_STATE_RESOLVE"));
+          break;
+
+    case MQTT_STATE_RESOLVE:
+          switch(resolveMQTTbroker())
+          {
+            case 0:   return false;   // still looking it up
+            case -1:  LogTf(LOG_ERROR, "ERROR: [%s] => is not a valid URL\r\n", settingMQTTbroker);
+                      mqttRetryLater();
+                      return false;
+          }
+          MQTTclient.setServer(MQTTbrokerIP, settingMQTTbrokerPort);
+          stateMQTT = MQTT_STATE_TCP_CONNECT;
+          break;
+
+    case MQTT_STATE_TCP_CONNECT:
+          DebugTf("MQTT server is [%s], IP[%s]:[%d]\r\n", settingMQTTbroker, MQTTbrokerIPchar
+                                                          , settingMQTTbrokerPort);
+          mqttTcpClient.stop();
+          mqttConnStarted = millis();
+          if (!tcpConnectStart(mqttTcp, (uint32_t)MQTTbrokerIP, settingMQTTbrokerPort))
+          {
+            LogTln(LOG_WARN, F("TCP connect failed"));
+            mqttRetryLater();
+            break;
+          }
+          stateMQTT = MQTT_STATE_TCP_CONNECTING;
+          break;
+
+    case MQTT_STATE_TCP_CONNECTING:
+          //--- polled, the connection is not waited for --
+          switch(tcpConnectPoll(mqttTcp, wifiClient))
+          {
+            case 0:   if ((millis() - mqttConnStarted) < MQTT_TCP_TIMEOUT) return false;
+                      DebugTln(F("TCP connect timed out"));
+                      tcpConnectAbort(mqttTcp);
+                      mqttDNSresolved = 0;    // look it up again next time
+                      mqttRetryLater();
+                      return false;
+            case -1:  LogTln(LOG_WARN, F("TCP connect failed"));
+                      mqttDNSresolved = 0;
+                      mqttRetryLater();
+                      return false;
+          }
           DebugTf("Attempting MQTT connection as [%s] .. \r\n", MQTTclientId);
-          reconnectAttempts++;
+          if (!mqttSendConnect())
+          {
+            LogTln(LOG_WARN, F("MQTT: could not send CONNECT"));
+            mqttRetryLater();
+            break;
+          }
+          mqttConnStarted = millis();
+          stateMQTT = MQTT_STATE_CONNACK;
+          break;
 
-          //--- If no username, then anonymous connection to broker, otherwise assume username/password.
+    case MQTT_STATE_CONNACK:
+          //--- CONNECT is sent, wait (at most MQTT_SOCKET_TIMEOUT seconds) for the 4 bytes
+          //--- of the CONNACK. Then PubSubClient::connect() reads it without waiting
+          if (wifiClient.available() < 4)
+          {
+            if (wifiClient.connected() && (millis() - mqttConnStarted) < (MQTT_SOCKET_TIMEOUT * 1000UL)) return false;
+            DebugTln(F("MQTT: no CONNACK"));
+            mqttRetryLater();
+            break;
+          }
           if (strlen(settingMQTTuser) == 0) 
           {
             DebugT(F("without a Username/Password "));
@@ -121,42 +346,72 @@ bool connectMQTT_FSM()
             DebugTf("with Username [%s] and password ", settingMQTTuser);
             MQTTclient.connect(MQTTclientId, settingMQTTuser, settingMQTTpasswd);
           }
-          //--- If connection was made succesful, move on to next state...
-          if (MQTTclient.connected())
+          mqttTcpClient.connectSent = false;
+          if (!MQTTclient.connected())
           {
-            reconnectAttempts = 0;  
-            Debugf(" .. connected -> MQTT status, rc=%d\r\n", MQTTclient.state());
-            MQTTclient.loop();
-            doAutoConfigure(); //HA Auto-Discovery 
-            stateMQTT = MQTT_STATE_IS_CONNECTED;
+            Debugf(" -> MQTT status, rc=%d \r\n", MQTTclient.state());
+            mqttRetryLater();
+            break;
+          }
+          Debugf(" .. connected -> MQTT status, rc=%d\r\n", MQTTclient.state());
+          mqttBackoff = 0;
+          resetMQTTfieldState();
+          MQTTclient.setCallback(mqttReceived);
+          MQTTclient.subscribe(MQTT_HA_STATUS_TOPIC);
+          stateMQTT = MQTT_STATE_DISCOVERY;
+          DebugTln(F("Next State: MQTT_STATE_DISCOVERY"));
+          return true;
+
+    case MQTT_STATE_DISCOVERY:
+          if (!MQTTclient.connected()) 
+          {
+            DebugTln(F("MQTT connection lost"));
+            mqttRetryLater();
+            break;
+          }
+          MQTTclient.loop();
+          if (memShed(MEM_LOW))   //-- postponed to the next connect --
+          {
+            DebugTln(F("low heap: skip HA discovery"));
+            mqttHAnext  = -1;
+            mqttHAforce = false;
+            stateMQTT   = MQTT_STATE_IS_CONNECTED;
             return true;
           }
-          Debugf(" -> MQTT status, rc=%d \r\n", MQTTclient.state());
-      
-          //--- After 3 attempts... go wait for a while.
-          if (reconnectAttempts >= 3)
+          if (doAutoConfigure())  //HA Auto-Discovery, a few messages at a time
           {
-            DebugTln(F("3 attempts have failed. Retry wait for next reconnect in 10 minutes\r"));
-            stateMQTT = MQTT_STATE_ERROR;  // if the re-connect did not work, then return to wait for reconnect
-            DebugTln(F("Next State: MQTT_STATE_ERROR"));
-          }   
-          break;
+            stateMQTT = MQTT_STATE_IS_CONNECTED;
+            DebugTln(F("Next State: MQTT_STATE_IS_CONNECTED"));
+          }
+          return true;
           
     case MQTT_STATE_IS_CONNECTED:
+          if (!MQTTclient.connected()) 
+          {
+            DebugTf("MQTT connection lost, rc=%d\r\n", MQTTclient.state());
+            mqttRetryLater();
+            break;
+          }
           MQTTclient.loop();
+          if (mqttHAforce)    //-- HA came online, it needs the discovery messages again --
+          {
+            stateMQTT = MQTT_STATE_DISCOVERY;
+            DebugTln(F("Next State: MQTT_STATE_DISCOVERY"));
+          }
           return true;
 
-    case MQTT_STATE_ERROR:
-          DebugTln(F("MQTT State: MQTT ERROR, wait for 10 minutes, before trying again"));
-          //--- next retry in 10 minutes.
-          CHANGE_INTERVAL_MIN(reconnectMQTTtimer, 10);
+    case MQTT_STATE_WAIT_RETRY:
+          if (DUE(reconnectMQTTtimer))
+          {
+            stateMQTT = MQTT_STATE_RESOLVE;
+            DebugTln(F("Next State: MQTT_STATE_RESOLVE"));
+          }
           break;
 
     default:
           DebugTln(F("MQTT State: default, this should NEVER happen!"));
           //--- do nothing, this state should not happen
           stateMQTT = MQTT_STATE_INIT;
-          CHANGE_INTERVAL_MIN(reconnectMQTTtimer, 10);
           DebugTln(F("Next State: MQTT_STATE_INIT"));
           break;
   }
@@ -167,45 +422,264 @@ bool connectMQTT_FSM()
 } // connectMQTT_FSM()
 
 
+#ifdef USE_MQTT
+//=======================================================================
+// values are compared in 1/1000 of their unit. For a String we use a 
+// hash, so every change gets published
+//=======================================================================
+int64_t mqttCompareValue(const String &sValue)
+{
+  uint32_t hash = 2166136261UL;   // FNV-1a
+  for (uint16_t c = 0; c < sValue.length(); c++)
+  {
+    hash = (hash ^ (uint8_t)sValue[c]) * 16777619UL;
+  }
+  return hash;
+
+} // mqttCompareValue(String)
+
+//---------------------------------------------------------------
+int64_t mqttCompareValue(int32_t iValue)
+{
+  return (int64_t)iValue * 1000;
+
+} // mqttCompareValue(int)
+
+//---------------------------------------------------------------
+int64_t mqttCompareValue(uint32_t uValue)
+{
+  return (int64_t)uValue * 1000;
+
+} // mqttCompareValue(uint)
+
+//---------------------------------------------------------------
+int64_t mqttCompareValue(float fValue)
+{
+  return llroundf(fValue * 1000.0);
+
+} // mqttCompareValue(float)
+
+//---------------------------------------------------------------
+int64_t mqttCompareValue(FixedValue &xValue)
+{
+  return xValue.int_val();
+
+} // mqttCompareValue(FixedValue)
+
+
+//=======================================================================
+// same format as String(value) (what was published before), except
+// FixedValue's: those are published exact (3 decimals)
+//=======================================================================
+void mqttFormatValue(char *cValue, size_t len, const String &sValue)
+{
+  strlcpy(cValue, sValue.c_str(), len);
+
+} // mqttFormatValue(*char, String)
+
+//---------------------------------------------------------------
+void mqttFormatValue(char *cValue, size_t len, int32_t iValue)
+{
+  snprintf(cValue, len, "%d", iValue);
+
+} // mqttFormatValue(*char, int)
+
+//---------------------------------------------------------------
+void mqttFormatValue(char *cValue, size_t len, uint32_t uValue)
+{
+  snprintf(cValue, len, "%u", uValue);
+
+} // mqttFormatValue(*char, uint)
+
+//---------------------------------------------------------------
+void mqttFormatValue(char *cValue, size_t len, float fValue)
+{
+  snprintf(cValue, len, "%.2f", fValue);
+
+} // mqttFormatValue(*char, float)
+
+//---------------------------------------------------------------
+void mqttFormatValue(char *cValue, size_t len, FixedValue &xValue)
+{
+  char cFixed[FIXED_MAX_CHARS];
+
+  fixedToChars(cFixed, (int32_t)xValue.int_val());
+  strlcpy(cValue, cFixed, len);
+
+} // mqttFormatValue(*char, FixedValue)
+
+
+//=======================================================================
+// default deadband (in 1/1000 of the unit) and max. silence (seconds)
+//=======================================================================
+void mqttFieldDefaults(mqttField &field, const char *cUnit)
+{
+  if      (!strcmp(cUnit, "V"))   { field.deadband = 1000; field.maxSilence =  300; } // 1 Volt
+  else if (!strcmp(cUnit, "A"))   { field.deadband = 1000; field.maxSilence =  300; } // 1 Amp.
+  else if (!strcmp(cUnit, "kW"))  { field.deadband =   10; field.maxSilence =  300; } // 10 Watt
+  else if (strlen(cUnit) > 0)     { field.deadband =    0; field.maxSilence =  300; } // kWh, m3 etc.
+  else                            { field.deadband =    0; field.maxSilence = 3600; } // id's, Strings
+
+} // mqttFieldDefaults()
+
+
+//=======================================================================
+struct buildMQTTtopics {
+
+    char cName[35];
+
+    template<typename Item>
+    void apply(Item &i) {
+      if (mqttNrFields >= MQTT_MAX_FIELDS) return;
+      
+      mqttField &field = mqttFields[mqttNrFields++];
+      strlcpy_P(cName, (PGM_P)Item::name, sizeof(cName));
+      #if defined( USE_PRE40_PROTOCOL )
+        //-- for dsmr30 ----------------------------------------------- 
+        if (strcmp(cName, "gas_delivered2") == 0) strlcpy(cName, "gas_delivered", sizeof(cName));
+      #endif
+      mqttFieldDefaults(field, Item::unit());
+      field.lastSent  = 0;
+      field.lastValue = 0;
+      
+      if ((mqttTopicPoolLen + mqttTopicPrefixLen + strlen(cName) +1) >= sizeof(mqttTopicPool))
+      {
+        DebugTf("no room in topic pool for [%s]\r\n", cName);
+        field.topic = sizeof(mqttTopicPool);  // --> build topic when needed
+        return;
+      }
+      field.topic = mqttTopicPoolLen;
+      memcpy(&mqttTopicPool[mqttTopicPoolLen], mqttTopicPool, mqttTopicPrefixLen);
+      strcpy(&mqttTopicPool[mqttTopicPoolLen + mqttTopicPrefixLen], cName);
+      mqttTopicPoolLen += mqttTopicPrefixLen + strlen(cName) +1;
+  }
+
+};  // struct buildMQTTtopics
+
+
+//===========================================================================================
+// /mqttpub.cfg: "<field name> , <deadband> , <max. silence in seconds>"
+//===========================================================================================
+void readMQTTpublishConfig()
+{
+  const char* cfgFilename = "/mqttpub.cfg";
+  char  cLine[80];
+  char  cName[35];
+  float fDeadband;
+  int   iSilence;
+
+  if (!SPIFFS.exists(cfgFilename)) return;
+  File fh = SPIFFS.open(cfgFilename, "r");
+  if (!fh) return;
+
+  while(fh.available()) 
+  {
+    int l = fh.readBytesUntil('\n', cLine, sizeof(cLine) -1);
+    cLine[l] = '\0';
+    if (strncmp(cLine, "//", 2) == 0) continue;
+    if (sscanf(cLine, " %34[^, ] , %f , %d", cName, &fDeadband, &iSilence) != 3)  continue;
+    
+    for (uint8_t f = 0; f < mqttNrFields; f++)
+    {
+      if (mqttFields[f].topic >= mqttTopicPoolLen) continue;
+      if (strcmp(&mqttTopicPool[mqttFields[f].topic + mqttTopicPrefixLen], cName) == 0)
+      {
+        mqttFields[f].deadband   = (uint32_t)lroundf(fabs(fDeadband) * 1000.0);
+        mqttFields[f].maxSilence = constrain(iSilence, 0, 65535);
+        if (Verbose1) LogTf(LOG_DEBUG, "[%s] deadband[%d], maxSilence[%d]\r\n", cName, mqttFields[f].deadband, mqttFields[f].maxSilence);
+        break;
+      }
+    }
+    yield();
+  }
+  fh.close();
+
+} // readMQTTpublishConfig()
+#endif
+
+
+//===========================================================================================
+// build the topic of every field once (and not for every telegram)
+//===========================================================================================
+void buildMQTTtopicTable()
+{
+#ifdef USE_MQTT
+  if (settingMQTTtopTopic[strlen(settingMQTTtopTopic)-1] == '/')
+        snprintf(mqttTopicPool, sizeof(mqttTopicPool), "%s",  settingMQTTtopTopic);
+  else  snprintf(mqttTopicPool, sizeof(mqttTopicPool), "%s/", settingMQTTtopTopic);
+  //-- the prefix itself is kept at the start of the pool ---
+  mqttTopicPrefixLen  = strlen(mqttTopicPool);
+  mqttTopicPoolLen    = mqttTopicPrefixLen +1;
+  mqttNrFields        = 0;
+
+  DSMRdata.applyEach(buildMQTTtopics());
+  readMQTTpublishConfig();
+  
+  DebugTf("[%d] topics, pool [%d/%d bytes]\r\n", mqttNrFields, mqttTopicPoolLen, sizeof(mqttTopicPool));
+#endif
+
+} // buildMQTTtopicTable()
+
+
+//===========================================================================================
+// after a (re)connect every field will be published again
+//===========================================================================================
+void resetMQTTfieldState()
+{
+#ifdef USE_MQTT
+  for (uint8_t f = 0; f < mqttNrFields; f++)  mqttFields[f].lastSent = 0;
+#endif
+
+} // resetMQTTfieldState()
+
+
 //=======================================================================
 struct buildJsonMQTT {
 #ifdef USE_MQTT
 
-    char topicId[100];
+    uint8_t  idx = 0;
+    uint32_t nowSec = (millis() / 1000) +1;
+    char     topicId[100];
+    char     cValue[MQTT_BUFF_MAX];
 
     template<typename Item>
     void apply(Item &i) {
+      if (idx >= mqttNrFields) return;
+      mqttField &field = mqttFields[idx++];
+      
       if (i.present()) 
       {
-        String Name = Item::name;
-        #if defined( USE_PRE40_PROTOCOL )
-          //-- for dsmr30 ----------------------------------------------- 
-          if (Name.indexOf("gas_delivered2") == 0) Name = "gas_delivered";
-        #endif
-        String Unit = Item::unit();
-
-        if (settingMQTTtopTopic[strlen(settingMQTTtopTopic)-1] == '/')
-              snprintf(topicId, sizeof(topicId), "%s",  settingMQTTtopTopic);
-        else  snprintf(topicId, sizeof(topicId), "%s/", settingMQTTtopTopic);
-        strlcat(topicId, Name.c_str(), sizeof(topicId));
-        if (Verbose2) DebugTf("topicId[%s]\r\n", topicId);
+        int64_t newValue = mqttCompareValue(i.val());
+        int64_t delta    = newValue - field.lastValue;
         
-        // if (Unit.length() > 0)
-        // {
-        //   createMQTTjsonMessage(mqttBuff, Name.c_str(), i.val(), Unit.c_str());
-        // }
-        // else
-        // {
-        // createMQTTjsonMessage(mqttBuff, Name.c_str(), i.val());
-        // }
-        // snprintf(mqttBuff, MQTT_BUFF_MAX, "%s" , cName, fValue);
-        //snprintf(cMsg, sizeof(cMsg), "%s", jsonString.c_str());
-        //DebugTf("topicId[%s] -> [%s]\r\n", topicId, mqttBuff);
+        if (field.lastSent != 0 && (delta == 0 || llabs(delta) < field.deadband))
+        {
+          if (field.maxSilence == 0 || (nowSec - field.lastSent) < field.maxSilence)
+          {
+            mqttMsgSaved++;
+            return;
+          }
+        }
+
+        const char *topic = &mqttTopicPool[field.topic];
+        if (field.topic >= mqttTopicPoolLen)
+        {
+          //-- did not fit in the pool -----
+          strlcpy(topicId, mqttTopicPool, sizeof(topicId));
+          strlcat_P(topicId, (PGM_P)Item::name, sizeof(topicId));
+          topic = topicId;
+        }
+        mqttFormatValue(cValue, sizeof(cValue), i.val());
+        if (Verbose2) LogTf(LOG_DEBUG, "topicId[%s] -> [%s]\r\n", topic, cValue);
          
-        if (!MQTTclient.publish(topicId, String(i.val()).c_str(), true))
+        if (!MQTTclient.publish(topic, cValue, true))
         {
-          DebugTf("Error publish(%s) [%s] [%d bytes]\r\n", topicId, String(i.val()).c_str(), (strlen(topicId) + strlen(String(i.val()).c_str())));
+          LogTf(LOG_ERROR, "Error publish(%s) [%s] [%d bytes]\r\n", topic, cValue, (strlen(topic) + strlen(cValue)));
+          return;
         }
+        field.lastValue = newValue;
+        field.lastSent  = nowSec;
+        mqttMsgSent++;
       }
   }
 #endif
@@ -213,22 +687,165 @@ struct buildJsonMQTT {
 };  // struct buildJsonMQTT
 
 
+#ifdef USE_MQTT
+//=======================================================================
+// append ["name":value] to the state document in mqttStateBuff. 
+// A field that does not fit is skipped (and counted)
+//=======================================================================
+void appendMQTTstate(const char *cName, const char *cValue, bool isString)
+{
+  char     jsonBuff[MQTT_STATE_STR_MAX + 50];
+  uint16_t p = 0;
+
+  p = snprintf(jsonBuff, sizeof(jsonBuff), "%s\"%s\":%s"
+                                          , (mqttStateLen > 1 ? "," : "")
+                                          , cName, (isString ? "\"" : ""));
+  for (uint16_t c = 0; (cValue[c] != '\0' && c < MQTT_STATE_STR_MAX && p < (sizeof(jsonBuff) -4)); c++)
+  {
+    if (cValue[c] < ' ') continue;  // skip control chars
+    if (cValue[c] == '"' || cValue[c] == '\\') jsonBuff[p++] = '\\';
+    jsonBuff[p++] = cValue[c];
+  }
+  if (isString) jsonBuff[p++] = '"';
+  jsonBuff[p] = '\0';
+
+  //-- keep room for the closing '}' -----
+  if ((mqttStateLen + p) >= (sizeof(mqttStateBuff) -2))
+  {
+    mqttStateSkipped++;
+    return;
+  }
+  memcpy(&mqttStateBuff[mqttStateLen], jsonBuff, p +1);
+  mqttStateLen += p;
+
+} // appendMQTTstate(*char, *char, bool)
+
+//---------------------------------------------------------------
+void appendMQTTstate(const char *cName, const String &sValue)
+{
+  appendMQTTstate(cName, sValue.c_str(), true);
+
+} // appendMQTTstate(*char, String)
+
+//---------------------------------------------------------------
+void appendMQTTstate(const char *cName, int32_t iValue)
+{
+  char cValue[12];
+
+  snprintf(cValue, sizeof(cValue), "%d", iValue);
+  appendMQTTstate(cName, cValue, false);
+
+} // appendMQTTstate(*char, int)
+
+//---------------------------------------------------------------
+void appendMQTTstate(const char *cName, uint32_t uValue)
+{
+  char cValue[12];
+
+  snprintf(cValue, sizeof(cValue), "%u", uValue);
+  appendMQTTstate(cName, cValue, false);
+
+} // appendMQTTstate(*char, uint)
+
+//---------------------------------------------------------------
+void appendMQTTstate(const char *cName, float fValue)
+{
+  char cValue[20];
+
+  snprintf(cValue, sizeof(cValue), "%.3f", fValue);
+  appendMQTTstate(cName, cValue, false);
+
+} // appendMQTTstate(*char, float)
+
+//---------------------------------------------------------------
+void appendMQTTstate(const char *cName, FixedValue &xValue)
+{
+  char cValue[FIXED_MAX_CHARS];
+
+  fixedToChars(cValue, (int32_t)xValue.int_val());
+  appendMQTTstate(cName, cValue, false);
+
+} // appendMQTTstate(*char, FixedValue)
+#endif
+
+
+//=======================================================================
+struct buildJsonMQTTstate {
+#ifdef USE_MQTT
+
+    char cName[35];
+
+    template<typename Item>
+    void apply(Item &i) {
+      if (i.present()) 
+      {
+        strlcpy_P(cName, (PGM_P)Item::name, sizeof(cName));
+        #if defined( USE_PRE40_PROTOCOL )
+          //-- for dsmr30 ----------------------------------------------- 
+          if (strcmp(cName, "gas_delivered2") == 0) strlcpy(cName, "gas_delivered", sizeof(cName));
+        #endif
+        appendMQTTstate(cName, i.val());
+      }
+  }
+#endif
+
+};  // struct buildJsonMQTTstate
+
+
 //===========================================================================================
-void sendMQTTData() 
+// publish all fields of this telegram as one JSON document to <topTopic>/state
+// so Home Assistant can pick out the values with a value_template (value_json)
+//===========================================================================================
+void sendMQTTstate() 
 {
 #ifdef USE_MQTT
-  String dateTime, topicId, json;
+  char     topic[50];
+  uint16_t needed;
 
-  if (settingMQTTinterval == 0) return;   // 0 == turned off
+  if (settingMQTTtopTopic[strlen(settingMQTTtopTopic)-1] == '/')
+        snprintf(topic, sizeof(topic), "%sstate",  settingMQTTtopTopic);
+  else  snprintf(topic, sizeof(topic), "%s/state", settingMQTTtopTopic);
 
-  if (ESP.getFreeHeap() < 7000) // to prevent firmware from crashing!
+  mqttStateBuff[0]  = '{';
+  mqttStateBuff[1]  = '\0';
+  mqttStateLen      = 1;
+  mqttStateSkipped  = 0;
+  DSMRdata.applyEach(buildJsonMQTTstate());
+  mqttStateBuff[mqttStateLen++] = '}';
+  mqttStateBuff[mqttStateLen]   = '\0';
+
+  if (mqttStateSkipped > 0)
   {
-    DebugTf("==> Bailout due to low heap (%d bytes)\r\n",   ESP.getFreeHeap() );
-    writeToSysLog("==> Bailout low heap (%d bytes)", ESP.getFreeHeap() );
-    esp_reboot(); //due to low memory, let's restart.
-    return;
+    DebugTf("state document full, skipped [%d] fields\r\n", mqttStateSkipped);
   }
 
+  //-- fixed header (max. 5) + topic length (2) + topic + payload -----
+  needed = 7 + strlen(topic) + mqttStateLen;
+  if (MQTTclient.getBufferSize() < needed) 
+  {
+    if (!MQTTclient.setBufferSize(needed))
+    {
+      LogTf(LOG_ERROR, "Error: could not resize MQTT buffer to [%d] bytes\r\n", needed);
+      return;
+    }
+  }
+  if (Verbose1) LogTf(LOG_DEBUG, "topic[%s] -> [%d bytes]\r\n", topic, mqttStateLen);
+
+  if (!MQTTclient.publish(topic, (const uint8_t*)mqttStateBuff, mqttStateLen, true))
+  {
+    LogTf(LOG_ERROR, "Error publish(%s) [%d bytes]\r\n", topic, needed);
+  }
+#endif
+
+} // sendMQTTstate()
+
+
+//===========================================================================================
+void sendMQTTData() 
+{
+#ifdef USE_MQTT
+  if (settingMQTTinterval == 0) return;   // 0 == turned off
+
   //Only send data when there is a new telegram
   static uint32_t lastTelegram = 0;
   if (telegramCount != lastTelegram)
@@ -237,40 +854,34 @@ void sendMQTTData()
       lastTelegram = telegramCount;
   } else return;
 
-  if (!MQTTclient.connected() || ! mqttIsConnected)
+  //-- low heap: keep it in the (flash) queue until there is room again --
+  if (memShed(MEM_CRITICAL))
   {
-    DebugTf("MQTTclient.connected(%d), mqttIsConnected[%d], stateMQTT [%d]\r\n"
-                                              , MQTTclient.connected()
-                                              , mqttIsConnected, stateMQTT);
+    DebugTf("==> low heap (%d bytes): queue MQTT data\r\n", ESP.getFreeHeap());
+    queueMQTTsnapshot();
+    return;
   }
-  if (!MQTTclient.connected())  
+
+  //-- (re)connecting is done by handleMQTT() --
+  if (!MQTTclient.connected() || !mqttIsConnected)
   {
-    if ( DUE( reconnectMQTTtimer) || mqttIsConnected)
-    {
-      mqttIsConnected = false;
-      connectMQTT();
-    }
-    else
-    {
-      DebugTf("trying to reconnect in less than %d minutes\r\n", (TIME_LEFT_MIN(reconnectMQTTtimer) +1) );
-    }
-    if ( !mqttIsConnected ) 
-    {
-      DebugTln("no connection with a MQTT broker ..");
-      return;
-    }
+    DebugTf("no connection with a MQTT broker (stateMQTT [%d]) ..\r\n", stateMQTT);
+    queueMQTTsnapshot();
+    return;
   }
 
   DebugTf("Sending data to MQTT server [%s]:[%d]\r\n", settingMQTTbroker, settingMQTTbrokerPort);
   
-  DSMRdata.applyEach(buildJsonMQTT());
+  if (mqttNrFields == 0) buildMQTTtopicTable();
+  if (settingMQTTmode != MQTT_MODE_STATE)  DSMRdata.applyEach(buildJsonMQTT());
+  if (settingMQTTmode != MQTT_MODE_TOPICS) sendMQTTstate();
 
 #endif
 
 } // sendMQTTData()
 
 //===========================================================================================
-void sendMQTTData(const String item, const String json)
+void sendMQTTData(const String &item, const String &json)
 {
   sendMQTTData(item.c_str(), json.c_str());
 } 
@@ -293,76 +904,252 @@ void sendMQTTData(const char* item, const char *json)
   snprintf(topic, sizeof(topic), "%s/", settingMQTTtopTopic);
   strlcat(topic, item, sizeof(topic));
   DebugTf("Sending MQTT: TopicId [%s] Message [%s]\r\n", topic, json);
-  if (!MQTTclient.publish(topic, json, true)) DebugTln("MQTT publish failed.");
+  if (!MQTTclient.publish(topic, json, true)) LogTln(LOG_ERROR, "MQTT publish failed.");
   delay(0);
 } // sendMQTTData()
 
 //===========================================================================================
-void sendMQTT(const char* topic, const char *json, const int8_t len) 
+void sendMQTT(const char* topic, const char *json, const uint16_t len) 
 {
   if (!MQTTclient.connected() || !isValidIP(MQTTbrokerIP)) return;
   // DebugTf("Sending data to MQTT server [%s]:[%d] ", settingMQTTbroker.c_str(), settingMQTTbrokerPort);  
   DebugTf("Sending MQTT: TopicId [%s] Message [%s]\r\n", topic, json);
   if (MQTTclient.getBufferSize() < len) MQTTclient.setBufferSize(len); //resize buffer when needed
-  if (!MQTTclient.publish(topic, json, true)) DebugTln("MQTT publish failed."); 
+  if (!MQTTclient.publish(topic, json, true)) LogTln(LOG_ERROR, "MQTT publish failed."); 
   delay(0);
 } // sendMQTTData()
 
+#ifdef USE_MQTT
+//===========================================================================================
+// FNV-1a over a '\0' terminated string, continues with 'hash'
 //===========================================================================================
-bool splitString(String sIn, char del, String& cKey, String& cVal)
+uint32_t mqttHash(uint32_t hash, const char *text)
 {
-  sIn.trim();                                 //trim spaces
-  cKey=""; cVal="";
-  if (sIn.indexOf("//")==0) return false;     //comment, skip split
-  if (sIn.length()<=3) return false;          //not enough buffer, skip split
-  int pos = sIn.indexOf(del);                 //determine split point
-  if ((pos==0) || (pos==(sIn.length()-1))) return false; // no key or no value
-  cKey = sIn.substring(0,pos); cKey.trim();   //before, and trim spaces
-  cVal = sIn.substring(pos+1); cVal.trim();   //after,and trim spaces
-  return true;
-}
+  while (*text)
+  {
+    hash = (hash ^ (uint8_t)*text++) * 16777619UL;
+  }
+  return hash;
+
+} // mqttHash()
+
 
 //===========================================================================================
-/*  
-* The maximum message size, including header, is 128 bytes by default. 
-* This is configurable via MQTT_MAX_PACKET_SIZE in PubSubClient.h.
-* Als de json string te lang wordt zal de string niet naar de MQTT server
-* worden gestuurd. 
-* Check de langste auto discovery string die verzonden gaat worden, 
-* indien meer dan MQTT_MAX_PACKET_SIZE !!!
-* 
-* Advies (3 november 2020): Stel het voor de zekerheid op 400 bytes in. 
-*
-*/
-void doAutoConfigure()
+// Home Assistant device class and state class by unit of the field
+//===========================================================================================
+static constexpr haDeviceClass haDeviceClasses[] = {
+    //  unit    HA unit       device_class  state_class
+      { "kWh",  "kWh",        "energy",     "total_increasing" }
+    , { "kW",   "kW",         "power",      "measurement"      }
+    , { "V",    "V",          "voltage",    "measurement"      }
+    , { "A",    "A",          "current",    "measurement"      }
+    , { "m3",   "m\\u00b3",   "gas",        "total_increasing" }
+    , { "GJ",   "GJ",         "energy",     "total_increasing" }
+};
+
+const haDeviceClass *findDeviceClass(const char *cUnit)
 {
+  for (uint8_t c = 0; c < (sizeof(haDeviceClasses) / sizeof(haDeviceClasses[0])); c++)
+  {
+    if (strcmp(haDeviceClasses[c].unit, cUnit) == 0) return &haDeviceClasses[c];
+  }
+  return NULL;
+
+} // findDeviceClass()
+
+
+//===========================================================================================
+// Home Assistant publishes "online" to MQTT_HA_STATUS_TOPIC every time it starts.
+// It may have lost the retained discovery messages (a new broker, or one without
+// persistence) so they are published again, whatever the hash says
+//===========================================================================================
+void mqttReceived(char *topic, byte *payload, unsigned int length)
+{
+  if (strcmp(topic, MQTT_HA_STATUS_TOPIC) != 0)   return;
+  if (length != 6 || strncmp((char*)payload, "online", 6) != 0) return;
+
+  DebugTln(F("Home Assistant is online -> publish discovery"));
+  mqttHAforce = true;
+
+} // mqttReceived()
+
+
+//===========================================================================================
+// the hash covers everything that ends up in a discovery message. The broker's
+// address is in it too: a new broker behind the same name needs them again
+//===========================================================================================
+struct hashHAconfig {
+
+    char      cName[35];
+
+    template<typename Item>
+    void apply(Item &i) {
+      if (!i.present()) return;
+      strlcpy_P(cName, (PGM_P)Item::name, sizeof(cName));
+      mqttHAhash = mqttHash(mqttHAhash, cName);
+      mqttHAhash = mqttHash(mqttHAhash, Item::unit());
+    }
+
+};  // struct hashHAconfig
+
+uint32_t calcHAconfigHash()
+{
+  char cMode[4];
+
+  snprintf(cMode, sizeof(cMode), "%d", settingMQTTmode);
+  mqttHAhash = 2166136261UL;
+  mqttHAhash = mqttHash(mqttHAhash, _VERSION);
+  mqttHAhash = mqttHash(mqttHAhash, settingMQTTbroker);
+  mqttHAhash = mqttHash(mqttHAhash, MQTTbrokerIPchar);
+  mqttHAhash = mqttHash(mqttHAhash, settingHostname);
+  mqttHAhash = mqttHash(mqttHAhash, settingMQTTtopTopic);
+  mqttHAhash = mqttHash(mqttHAhash, cMode);
+  DSMRdata.applyEach(hashHAconfig());
+  return mqttHAhash;
+
+} // calcHAconfigHash()
+
+
+//===========================================================================================
+uint32_t readHAconfigHash()
+{
+  char cHash[12] = "";
+
+  File fh = SPIFFS.open(MQTT_HA_HASH_FILE, "r");
+  if (!fh) return 0;
+  int l = fh.readBytes(cHash, sizeof(cHash) -1);
+  cHash[l] = '\0';
+  fh.close();
+  return strtoul(cHash, NULL, 16);
+
+} // readHAconfigHash()
+
 
-  const char* cfgFilename = "/mqttha.cfg";
-  String sTopic="";
-  String sMsg="";
-  File fh; //filehandle
-  //Let's open the MQTT autoconfig file
-  SPIFFS.begin();
-  if (SPIFFS.exists(cfgFilename))
+//===========================================================================================
+void writeHAconfigHash(uint32_t hash)
+{
+  File fh = SPIFFS.open(MQTT_HA_HASH_FILE, "w");
+  if (!fh)
   {
-    fh = SPIFFS.open(cfgFilename, "r");
-    if (fh) {
-      //Lets go read the config and send it out to MQTT line by line
-      while(fh.available()) 
-      {  //read file line by line, split and send to MQTT (topic, msg)
-          delay(0);
-          String sLine = fh.readStringUntil('\n');
-          // DebugTf("sline[%s]\r\n", sLine.c_str());
-          if (splitString( sLine, ',', sTopic, sMsg))
-          {
-            DebugTf("sTopic[%s], sMsg[%s]\r\n", sTopic.c_str(), sMsg.c_str());
-            sendMQTT(sTopic.c_str(), sMsg.c_str(), (sTopic.length() + sMsg.length()+2));
-          } else DebugTf("Either comment or invalid config line: [%s]\r\n", sLine.c_str());
-      } // while available()
-      fh.close();  
-    } 
-  } 
-}
+    LogTf(LOG_ERROR, "Error writing [%s]\r\n", MQTT_HA_HASH_FILE);
+    return;
+  }
+  fh.printf("%08x", hash);
+  fh.close();
+
+} // writeHAconfigHash()
+
+
+//===========================================================================================
+// one discovery message for every field in the window
+// [mqttHAnext .. mqttHAnext + MQTT_DISCOVERY_BURST>
+//===========================================================================================
+struct buildHAdiscovery {
+
+    uint8_t   idx;
+    char      cName[35];
+    char      cTopic[100];
+    char      cStateTopic[60];
+    char      cTemplate[50];
+    char      cPayload[MQTT_DISCOVERY_BUFF_MAX];
+
+    template<typename Item>
+    void apply(Item &i) {
+      uint8_t f = idx++;
+      if (f < mqttHAnext || f >= (mqttHAnext + MQTT_DISCOVERY_BURST)) return;
+      if (!i.present()) return;
+
+      strlcpy_P(cName, (PGM_P)Item::name, sizeof(cName));
+      #if defined( USE_PRE40_PROTOCOL )
+        //-- for dsmr30 ----------------------------------------------- 
+        if (strcmp(cName, "gas_delivered2") == 0) strlcpy(cName, "gas_delivered", sizeof(cName));
+      #endif
+
+      if (settingMQTTmode == MQTT_MODE_STATE)
+      {
+        snprintf(cStateTopic, sizeof(cStateTopic), "%sstate", mqttTopicPool);
+        snprintf(cTemplate,   sizeof(cTemplate),   "{{ value_json.%s }}", cName);
+      }
+      else
+      {
+        snprintf(cStateTopic, sizeof(cStateTopic), "%s%s", mqttTopicPool, cName);
+        strlcpy(cTemplate, "{{ value }}", sizeof(cTemplate));
+      }
+
+      snprintf(cTopic, sizeof(cTopic), "homeassistant/sensor/%s/%s/config", settingHostname, cName);
+      int len = snprintf(cPayload, sizeof(cPayload), "{\"name\":\"%s\",\"unique_id\":\"%s-%s\""
+                                                     ",\"state_topic\":\"%s\",\"value_template\":\"%s\""
+                                                    , cName, settingHostname, cName
+                                                    , cStateTopic, cTemplate);
+      const haDeviceClass *dc = findDeviceClass(Item::unit());
+      if (dc != NULL)
+      {
+        len += snprintf(&cPayload[len], sizeof(cPayload) - len
+                                       , ",\"unit_of_measurement\":\"%s\",\"device_class\":\"%s\""
+                                         ",\"state_class\":\"%s\""
+                                       , dc->haUnit, dc->devClass, dc->stateClass);
+      }
+      else if (strlen(Item::unit()) > 0)
+      {
+        len += snprintf(&cPayload[len], sizeof(cPayload) - len
+                                       , ",\"unit_of_measurement\":\"%s\"", Item::unit());
+      }
+      len += snprintf(&cPayload[len], sizeof(cPayload) - len
+                                     , ",\"device\":{\"identifiers\":[\"%s\"],\"name\":\"%s\""
+                                       ",\"model\":\"DSMRlogger-Next\",\"sw_version\":\"%s\"}}"
+                                     , settingHostname, settingHostname, _VERSION);
+      if (len >= (int)sizeof(cPayload))
+      {
+        DebugTf("discovery message for [%s] too long\r\n", cName);
+        return;
+      }
+
+      if (Verbose1) LogTf(LOG_DEBUG, "Sending MQTT: TopicId [%s] Message [%s]\r\n", cTopic, cPayload);
+      if (!MQTTclient.publish(cTopic, cPayload, true)) mqttHAfailed = true;
+    }
+
+};  // struct buildHAdiscovery
+#endif
+
+
+//===========================================================================================
+// Home Assistant auto discovery. Returns true when done. Only MQTT_DISCOVERY_BURST 
+// fields are done per call (from connectMQTT_FSM()) and only if the config changed
+// since the last time it was published.
+//===========================================================================================
+bool doAutoConfigure()
+{
+#ifdef USE_MQTT
+  if (mqttHAnext < 0)
+  {
+    //-- we need a telegram to know what fields this meter has --
+    if (telegramCount == 0) return false;
+    if (calcHAconfigHash() == readHAconfigHash() && !mqttHAforce)
+    {
+      DebugTln(F("HA discovery is up-to-date"));
+      return true;
+    }
+    DebugTf("HA discovery changed [%08x] -> publish\r\n", mqttHAhash);
+    if (MQTTclient.getBufferSize() < (MQTT_DISCOVERY_BUFF_MAX + 100))
+    {
+      MQTTclient.setBufferSize(MQTT_DISCOVERY_BUFF_MAX + 100);  // topic + payload
+    }
+    mqttHAfailed  = false;
+    mqttHAforce   = false;
+    mqttHAnext    = 0;
+  }
+
+  DSMRdata.applyEach(buildHAdiscovery());
+  mqttHAnext += MQTT_DISCOVERY_BURST;
+  if (mqttHAnext < mqttNrFields) return false;
+
+  if (!mqttHAfailed)  writeHAconfigHash(mqttHAhash);
+  else                DebugTln(F("HA discovery: not all messages were sent"));
+  mqttHAnext = -1;
+#endif
+  return true;
+
+} // doAutoConfigure()
 
 
 /***************************************************************************
@@ -0,0 +1,91 @@
+/*
+***************************************************************************
+**  Filename  : MQTTtcpClient.h
+**  Version  : v2.3.0-rc5
+**
+**  Copyright (c) 2020 Robert van den Breemen
+**   Based on (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See bottom of file.
+***************************************************************************
+*/
+
+/*
+ * The Client that PubSubClient talks through. It passes everything on
+ * to the WiFiClient, except the CONNECT that PubSubClient::connect()
+ * sends when connectMQTT_FSM() has already sent it (connectSent).
+ *
+ * PubSubClient::connect() sends CONNECT and then waits (up to its
+ * socket timeout) for the CONNACK. connectMQTT_FSM() opens the TCP
+ * connection (tcpConnector) and sends CONNECT itself, and only when the
+ * CONNACK is in the receive buffer it calls PubSubClient::connect(). Its
+ * CONNECT is swallowed here and it reads the CONNACK right away, so no
+ * step waits for the broker.
+ */
+
+#ifndef _MQTT_TCP_CLIENT_H
+#define _MQTT_TCP_CLIENT_H
+
+#define MQTT_PKT_CONNECT    0x10      // packet type of CONNECT (in the high nibble)
+
+class MQTTtcpClient : public Client {
+  public:
+    MQTTtcpClient(WiFiClient &c) : client(c) { }
+
+    bool      connectSent = false;
+
+    int       connect(IPAddress ip, uint16_t port)    { return client.connect(ip, port); }
+    int       connect(const char *host, uint16_t port){ return client.connect(host, port); }
+    size_t    write(uint8_t b)                        { return write(&b, 1); }
+    size_t    write(const uint8_t *buf, size_t size)
+    {
+      if (connectSent && size > 0 && (buf[0] & 0xF0) == MQTT_PKT_CONNECT)
+      {
+        connectSent = false;
+        return size;
+      }
+      return client.write(buf, size);
+    }
+    int       available()                             { return client.available(); }
+    int       read()                                  { return client.read(); }
+    int       read(uint8_t *buf, size_t size)         { return client.read(buf, size); }
+    int       peek()                                  { return client.peek(); }
+#if defined(ESP8266)
+    bool      flush(unsigned int maxWaitMs = 0)       { return client.flush(maxWaitMs); }
+    bool      stop(unsigned int maxWaitMs = 0)        { connectSent = false; return client.stop(maxWaitMs); }
+#else
+    void      flush()                                 { client.flush(); }
+    void      stop()                                  { connectSent = false; client.stop(); }
+#endif
+    uint8_t   connected()                             { return client.connected(); }
+    operator  bool()                                  { return (bool)client; }
+
+  private:
+    WiFiClient &client;
+};
+
+#endif // _MQTT_TCP_CLIENT_H
+
+
+/***************************************************************************
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit
+* persons to whom the Software is furnished to do so, subject to the
+* following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT
+* OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+* THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+***************************************************************************/
@@ -26,18 +26,16 @@ void handleMindergas()
 
 enum states_of_MG { MG_INIT, MG_WAIT_FOR_FIRST_TELEGRAM, MG_WAIT_FOR_NEXT_DAY
                            , MG_WRITE_TO_FILE, MG_DO_COUNTDOWN
-                           , MG_SEND_MINDERGAS, MG_NO_AUTHTOKEN, MG_ERROR };
+                           , MG_SEND_MINDERGAS, MG_WAIT_FOR_RESPONSE
+                           , MG_NO_AUTHTOKEN, MG_ERROR };
                            
 enum  states_of_MG stateMindergas   = MG_INIT;
-bool  sendMindergasPostFile();
 void  writePostToFile();
 
 int8_t    MG_Day                    = -1;
 bool      validToken                = false;
 bool      handleMindergasSemaphore  = false;
 int8_t    MGminuten                 = 0;
-int8_t    retryCounter = 0;
-bool      bDoneResponse             = false;
 
 //=======================================================================
 //force mindergas update, by skipping states
@@ -189,45 +187,27 @@ void processMindergas_FSM()
           strlcpy(txtResponseMindergas, "SEND_MINDERGAS", sizeof(txtResponseMindergas));
 
           //--- if POST response for Mindergas exists, then send it... btw it should exist by now :)
+          //--- it is send (and retried) by the httpJobs queue, mindergasJobDone() handles the response
           if ((validToken) && SPIFFS.exists(MG_FILENAME)) 
           {
-            if (!sendMindergasPostFile())
+            if (queueHttpJob(HTTP_JOB_MINDERGAS))
             {
-              Debugln();
-              retryCounter++;
-              if (retryCounter < 3)
-              {
-                //--- start countdown -- again
-                MGminuten = random(1,10);
-                DebugTf("Try[%d] MinderGas update in [%d] minute(s)\r\n", retryCounter, MGminuten);
-                writeToSysLog("Try[%d] MinderGas update in [%d] minute(s)", retryCounter, MGminuten);
-                //--- Lets'do the countdown
-                strlcpy(txtResponseMindergas, "DO_COUNTDOWN", sizeof(txtResponseMindergas));
-                stateMindergas = MG_DO_COUNTDOWN;
-                break;
-              }
+              writeToSysLog("Send to Mindergas.nl...");
+              stateMindergas = MG_WAIT_FOR_RESPONSE;
+              CHANGE_INTERVAL_MIN(minderGasTimer, 5);
+              break;
             }
-            Debugln();
-            //--- delete POST file from SPIFFS
-            if (SPIFFS.remove(MG_FILENAME)) 
-            {
-              DebugTln(F("POST Mindergas file succesfully deleted!"));
-              writeToSysLog("Deleted Mindergas.post !");
-            } 
-            else 
-            {
-              //--- help, this should just not happen, but if it does, it 
-              //--- will not influence behaviour in a negative way
-              DebugTln(F("Failed to delete POST Mindergas file"));
-              writeToSysLog("Failed to delete Mindergas.post");
-            } 
-//          bDoneResponse = true; 
           }   
           CHANGE_INTERVAL_MIN(minderGasTimer, 30);
           break; 
       
+    case MG_WAIT_FOR_RESPONSE:
+          if (Verbose2) LogTln(LOG_DEBUG, F("Mindergas State: MG_WAIT_FOR_RESPONSE"));
+          CHANGE_INTERVAL_MIN(minderGasTimer, 5);
+          break; 
+      
     case MG_NO_AUTHTOKEN:
-          if (Verbose2) DebugTln(F("Mindergas State: MG_NO_AUTHTOKEN"));
+          if (Verbose2) LogTln(LOG_DEBUG, F("Mindergas State: MG_NO_AUTHTOKEN"));
           if (validToken)
           {
             stateMindergas = MG_INIT;   
@@ -257,123 +237,77 @@ void processMindergas_FSM()
 
 
 //=======================================================================
-boolean sendMindergasPostFile()
+// called by the httpJobs queue. httpCode < 0: mindergas.nl did not answer
+// (after all retries)
+void mindergasJobDone(int16_t httpCode)
 {
-  WiFiClient  MGclient;   
-  const char *MGhost = "www.mindergas.nl";
-  File        minderGasFile;
-  boolean     bMgClientReply = false;
+  snprintf(timeLastResponse, sizeof(timeLastResponse), "@%02d|%02d:%02d >> ", day(), hour(), minute());
+  intStatuscodeMindergas = (httpCode > 0 ? httpCode : 0);
+  writeToSysLog("Mindergas response: [%d]", httpCode);
+  DebugTf("[%s] Mindergas response: [%d]\r\n", timeLastResponse, httpCode);
+
+  switch (httpCode) {
+    case 201:  
+        validToken = true;
+        //--- report error back to see in settings page
+        strlcpy(txtResponseMindergas, "Created entry", sizeof(txtResponseMindergas));
+        Debugln(F("Succes, the gas delivered has been added to your mindergas.nl account"));
+        writeToSysLog("Succes, the gas delivered has been added to your mindergas.nl account");
+        DebugTln(F("Next State: MG_WAIT_FOR_NEXT_DAY"));
+        stateMindergas = MG_WAIT_FOR_NEXT_DAY;               
+        break;
+  
+    case 401:
+        validToken = false;
+        strlcpy(settingMindergasToken, "Invalid token", sizeof(settingMindergasToken)); 
+        strlcpy(txtResponseMindergas, "Unauthorized, token invalid!", sizeof(txtResponseMindergas)); // report error back to see in settings page
+        Debugln(F("Invalid Mindergas Authenication Token"));
+        writeToSysLog("Invalid Mindergas Authenication Token");
+        stateMindergas = MG_NO_AUTHTOKEN;
+        break;
   
-  bDoneResponse = false; 
+    case 422:
+        validToken = true;
+        //--- report error back to see in settings page
+        strlcpy(txtResponseMindergas, "Unprocessed entity", sizeof(txtResponseMindergas));
+        Debugln(F("Unprocessed entity, goto website mindergas for more information")); 
+        writeToSysLog("Unprocessed entity, goto website mindergas for more information");
+        stateMindergas = MG_WAIT_FOR_NEXT_DAY; 
+        break;
+  
+    case -1:
+        //--- report error back to see in settings page
+        strlcpy(txtResponseMindergas, "No response (gave up)", sizeof(txtResponseMindergas));
+        DebugTln(F("No response from mindergas.nl, giving up for today"));
+        writeToSysLog("No response from mindergas.nl, giving up for today");
+        stateMindergas = MG_WAIT_FOR_NEXT_DAY;           
+        break;
 
-  //--- create a string with the date and the meter value
-  DebugTln(F("Reading POST from file:"));
-  minderGasFile = SPIFFS.open(MG_FILENAME, "r");
-  String sBuffer;
-  sBuffer = "";
-  while(minderGasFile.available()) 
-  { 
-    char ltr = minderGasFile.read();
-    sBuffer += ltr;
-  }
-  minderGasFile.close();
-  Debugln(sBuffer);
+    default:
+        validToken = true;
+        //--- report error back to see in settings page
+        strlcpy(txtResponseMindergas, "Unknown response code", sizeof(txtResponseMindergas));
+        Debugln(F("Unknown responsecode, goto mindergas for information"));
+        stateMindergas = MG_WAIT_FOR_NEXT_DAY;           
+        break;
+  } // end switch-case             
 
-  //--- try to connect to minderGas
-  DebugTf("Connecting to %s ...\r\n", MGhost);
-  //--- connect over http with mindergas
-  if (MGclient.connect(MGhost, 80)) 
+  //--- delete POST file from SPIFFS
+  if (SPIFFS.remove(MG_FILENAME)) 
   {
-    //--- then post to mindergas...
-    DebugTln(F("Send to Mindergas.nl..."));
-    writeToSysLog("Send to Mindergas.nl...");
-    MGclient.println(sBuffer);
-    //--- read response from mindergas.nl
-    snprintf(timeLastResponse, sizeof(timeLastResponse), "@%02d|%02d:%02d >> ", day(), hour(), minute());
-    DebugTf("[%s] Mindergas response: ", timeLastResponse);
-
-    MGclient.setTimeout(1000);
-
-    while (!bDoneResponse && (MGclient.connected() || MGclient.available())) 
-    {
-      Debug(".");
-      if (MGclient.available()) 
-      {
-        Debug(".");
-        //--- skip to find HTTP/1.1
-        //--- then parse response code
-        if (MGclient.find("HTTP/1.1"))
-        {
-          intStatuscodeMindergas = MGclient.parseInt(); // parse status code
-          //Debugln();
-          writeToSysLog("Mindergas response: [%d]", intStatuscodeMindergas);
-          Debugf("Statuscode: [%d]\r\n", intStatuscodeMindergas);
-          switch (intStatuscodeMindergas) {
-            case 201:  
-                validToken = true;
-                bMgClientReply = true;
-                //--- report error back to see in settings page
-                strlcpy(txtResponseMindergas, "Created entry", sizeof(txtResponseMindergas));
-                Debugln(F("Succes, the gas delivered has been added to your mindergas.nl account"));
-                writeToSysLog("Succes, the gas delivered has been added to your mindergas.nl account");
-                DebugTln(F("Next State: MG_WAIT_FOR_NEXT_DAY"));
-                stateMindergas = MG_WAIT_FOR_NEXT_DAY;               
-                break;
-          
-            case 401:
-                validToken = false;
-                bMgClientReply = true;
-                strlcpy(settingMindergasToken, "Invalid token", sizeof(settingMindergasToken)); 
-                strlcpy(txtResponseMindergas, "Unauthorized, token invalid!", sizeof(txtResponseMindergas)); // report error back to see in settings page
-                Debugln(F("Invalid Mindergas Authenication Token"));
-                writeToSysLog("Invalid Mindergas Authenication Token");
-                stateMindergas = MG_NO_AUTHTOKEN;
-                break;
-          
-            case 422:
-                validToken = true;
-                bMgClientReply = true;
-                //--- report error back to see in settings page
-                strlcpy(txtResponseMindergas, "Unprocessed entity", sizeof(txtResponseMindergas));
-                Debugln(F("Unprocessed entity, goto website mindergas for more information")); 
-                writeToSysLog("Unprocessed entity, goto website mindergas for more information");
-                stateMindergas = MG_WAIT_FOR_NEXT_DAY; 
-                break;
-          
-            default:
-                validToken = true;
-                bMgClientReply = true;
-                //--- report error back to see in settings page
-                strlcpy(txtResponseMindergas, "Unknown response code", sizeof(txtResponseMindergas));
-                Debugln(F("Unknown responsecode, goto mindergas for information"));
-                stateMindergas = MG_WAIT_FOR_NEXT_DAY;           
-                break;
-          } // end switch-case             
-        }  // end-if find HTTP/1.1
-    
-        //--- close HTTP connection
-        MGclient.stop();
-        DebugTln(F("Disconnected from mindergas.nl"));
-        writeToSysLog("Disconnected from mindergas.nl");
-        bDoneResponse = true; 
-    
-      } // end-if client.available() 
-      else 
-      {
-        //--- wait for connections, just keep trying...
-        delay(100); 
-      } // end-else
-    
-    } // while ..
-
-  } //   connect to mindergas.nl
-  else
+    DebugTln(F("POST Mindergas file succesfully deleted!"));
+    writeToSysLog("Deleted Mindergas.post !");
+  } 
+  else 
   {
-    DebugTln(".. not connected (ERROR!)");
-  }
-  return bMgClientReply;
-  
-} // sendMindergasPostFile()
+    //--- help, this should just not happen, but if it does, it 
+    //--- will not influence behaviour in a negative way
+    LogTln(LOG_ERROR, F("Failed to delete POST Mindergas file"));
+    writeToSysLog("Failed to delete Mindergas.post");
+  } 
+  CHANGE_INTERVAL_MIN(minderGasTimer, 30);
+
+} // mindergasJobDone()
 
 
 
@@ -387,7 +321,7 @@ void writePostToFile()
   if (!minderGasFile) 
   {
     //--- cannot create file, thus error
-    DebugTf("open(%s, 'w') FAILED!!! --> Bailout\r\n", MG_FILENAME);
+    LogTf(LOG_ERROR, "open(%s, 'w') FAILED!!! --> Bailout\r\n", MG_FILENAME);
     //--- now in failure mode
     //DebugTln(F("Next State: MG_ERROR"));
     strlcpy(txtResponseMindergas, "ERROR CREATE FILE", sizeof(txtResponseMindergas));
@@ -401,11 +335,13 @@ void writePostToFile()
   //--- we want to upload the gas usage of yesterday so rewind the clock for 1 day
   time_t t = now() - SECS_PER_DAY;  
   char dataString[80];
-  snprintf(dataString, sizeof(dataString),"{ \"date\": \"%04d-%02d-%02d\", \"reading\": \"%.3f\" }"
+  char gasReading[FIXED_MAX_CHARS];
+  fixedToChars(gasReading, (int32_t)DSMRdata.gas_delivered.int_val());
+  snprintf(dataString, sizeof(dataString),"{ \"date\": \"%04d-%02d-%02d\", \"reading\": \"%s\" }"
                                                           , year(t)
                                                           , month(t)
                                                           , day(t)
-                                                          , DSMRdata.gas_delivered.val());
+                                                          , gasReading);
   //--- write the POST to a file...
   minderGasFile.println(F("POST /api/gas_meter_readings HTTP/1.1"));
   minderGasFile.print(F("AUTH-TOKEN:")); minderGasFile.println(settingMindergasToken);
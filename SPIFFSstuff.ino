@@ -16,8 +16,7 @@ int16_t bytesWritten;
 //====================================================================
 void readLastStatus()
 {
-  char buffer[50] = "";
-  char dummy[50] = "";
+  char buffer[100] = "";
   char spiffsTimestamp[20] = "";
 
   File _file = SPIFFS.open("/DSMRstatus.csv", "r");
@@ -30,8 +29,9 @@ void readLastStatus()
     int l = _file.readBytesUntil('\n', buffer, sizeof(buffer));
     buffer[l] = 0;
     DebugTf("read lastUpdate[%s]\r\n", buffer);
-    sscanf(buffer, "%[^;]; %u; %u; %[^;]", spiffsTimestamp, &nrReboots, &slotErrors, dummy);
-    DebugTf("values timestamp[%s], nrReboots[%u], slotErrors[%u], dummy[%s]\r\n", spiffsTimestamp, nrReboots, slotErrors, dummy);
+    sscanf(buffer, "%19[^;]; %u; %u; %40[^;]", spiffsTimestamp, &nrReboots, &slotErrors, lastRebootReason);
+    if (strcmp(lastRebootReason, "meta data") == 0) lastRebootReason[0] = '\0';  // old layout
+    DebugTf("values timestamp[%s], nrReboots[%u], slotErrors[%u], rebootReason[%s]\r\n", spiffsTimestamp, nrReboots, slotErrors, lastRebootReason);
     yield();
   }
   _file.close();
@@ -46,15 +46,8 @@ void readLastStatus()
 //====================================================================
 void writeLastStatus()
 {
-  if (ESP.getFreeHeap() < 7000) // to prevent firmware from crashing!
-  {
-    DebugTf("Bailout due to low heap (%d bytes)\r\n", ESP.getFreeHeap());
-    writeToSysLog("Bailout low heap (%d bytes)", ESP.getFreeHeap());
-    esp_reboot(); //due to low memory, let's restart.
-    return;
-  }
-
-  char buffer[50] = "";
+  //-- no low heap bailout: this is also what rebootWithReason() needs --
+  char buffer[100] = "";
   DebugTf("writeLastStatus() => %s; %u; %u;\r\n", actTimestamp, nrReboots, slotErrors);
   writeToSysLog("writeLastStatus() => %s; %u; %u;", actTimestamp, nrReboots, slotErrors);
   File _file = SPIFFS.open("/DSMRstatus.csv", "w");
@@ -62,31 +55,59 @@ void writeLastStatus()
   {
     DebugTln("write(): No /DSMRstatus.csv found ..");
   }
-  snprintf(buffer, sizeof(buffer), "%-13.13s; %010u; %010u; %s;\n", actTimestamp, nrReboots, slotErrors, "meta data");
+  snprintf(buffer, sizeof(buffer), "%-13.13s; %010u; %010u; %s;\n", actTimestamp, nrReboots, slotErrors, rebootReason);
   _file.print(buffer);
   _file.flush();
   _file.close();
 
 } // writeLastStatus()
 
+//===========================================================================================
+//===========================================================================================
+// one record in the DATA_FORMAT layout from values in 1/1000 (no float rounding)
+void buildDataRecord(char *record, const char *key, const int32_t v[5])
+{
+  uint8_t p;
+
+  p = snprintf(record, DATA_RECLEN, "%-8.8s;", key);
+  for (uint8_t i = 0; i < 5; i++)
+  {
+    p += fixedToChars(&record[p], v[i], 3, 10);
+    record[p++] = ';';
+  }
+  record[p++] = '\n';
+  record[p]   = '\0';
+
+} // buildDataRecord()
+
+//===========================================================================================
+// the values (in 1/1000) of a record, false if it is not a valid record
+bool parseDataRecord(const char *record, char *recID, int32_t v[5])
+{
+  const char *p = strchr(record, ';');
+
+  if (p == NULL) return false;
+  if (recID != NULL) strlcpy(recID, record, ((p - record) < 9 ? (p - record) +1 : 9));
+  for (uint8_t i = 0; i < 5; i++)
+  {
+    p = charsToFixed(p +1, v[i]);
+    if (p == NULL || *p != ';') return false;
+  }
+  return true;
+
+} // parseDataRecord()
+
 //===========================================================================================
 bool buildDataRecordFromSM(char *recIn)
 {
-  static float GG = 1;
-  char record[DATA_RECLEN + 1] = "";
-  char key[10] = "";
+  char    record[DATA_RECLEN + 1] = "";
+  char    key[10] = "";
+  int32_t readings[5];
 
-  uint16_t recSlot = timestampToHourSlot(actTimestamp, strlen(actTimestamp));
   strlcpy(key, actTimestamp + 0, 9);
+  readingsFromSM(readings);
+  buildDataRecord(record, key, readings);
 
-  snprintf(record, sizeof(record), (char *)DATA_FORMAT, key, (float)DSMRdata.energy_delivered_tariff1, (float)DSMRdata.energy_delivered_tariff2, (float)DSMRdata.energy_returned_tariff1, (float)DSMRdata.energy_returned_tariff2
-#ifdef USE_PRE40_PROTOCOL
-           ,
-           (float)DSMRdata.gas_delivered2);
-#else
-           ,
-           (float)DSMRdata.gas_delivered);
-#endif
   // DATA + \n + \0
   fillRecord(record, DATA_RECLEN);
 
@@ -95,49 +116,39 @@ bool buildDataRecordFromSM(char *recIn)
 } // buildDataRecordFromSM()
 
 //===========================================================================================
-uint16_t buildDataRecordFromJson(char *recIn, String jsonIn)
+// parse one {"recid":"YYMM","edt1":..,"edt2":..,"ert1":..,"ert2":..,"gdt":..} object. 
+// 'jt' must be positioned just after the opening '{'. Returns the slot or
+// _NO_MONTH_SLOTS_ if the record is not valid
+uint16_t buildDataRecordFromJson(char *recIn, jsonTokenizer &jt)
 {
-  //static float GG = 1;
-  char record[DATA_RECLEN + 1] = "";
-  String wOut[10];
-  String wPair[5];
-  char uKey[15] = "";
-  float uEDT1 = 0.0;
-  float uEDT2 = 0.0;
-  float uERT1 = 0.0;
-  float uERT2 = 0.0;
-  float uGDT = 0.0;
-  uint16_t recSlot;
+  char      record[DATA_RECLEN + 1] = "";
+  jsonToken tok;
+  char      uKey[15] = "";
+  int32_t   uValue[5] = { 0, 0, 0, 0, 0 };
+  uint16_t  recSlot;
 
-  DebugTln(jsonIn);
-
-  jsonIn.replace("{", "");
-  jsonIn.replace("}", "");
-  jsonIn.replace("\"", "");
-  int8_t wp = splitString(jsonIn.c_str(), ',', wOut, 9);
-  for (int f = 0; f < wp; f++)
+  while (jsonNext(jt, tok) == JSON_TOK_KEY)
   {
-    splitString(wOut[f].c_str(), ':', wPair, 4);
+    jsonToken key = tok;
+    if (jsonNext(jt, tok) <= JSON_TOK_END) return _NO_MONTH_SLOTS_;
     if (Verbose2)
-      DebugTf("[%d] -> [%s]\r\n", f, wOut[f].c_str());
-    if (wPair[0].indexOf("recid") == 0)
-      strlcpy(uKey, wPair[1].c_str(), 10);
-    if (wPair[0].indexOf("edt1") == 0)
-      uEDT1 = wPair[1].toFloat();
-    if (wPair[0].indexOf("edt2") == 0)
-      uEDT2 = wPair[1].toFloat();
-    if (wPair[0].indexOf("ert1") == 0)
-      uERT1 = wPair[1].toFloat();
-    if (wPair[0].indexOf("ert2") == 0)
-      uERT2 = wPair[1].toFloat();
-    if (wPair[0].indexOf("gdt") == 0)
-      uGDT = wPair[1].toFloat();
-  }
-  strlcat(uKey, "0101X", 15);
+      LogTf(LOG_DEBUG, "[%.*s] -> [%.*s]\r\n", key.len, key.start, tok.len, tok.start);
+    if      (jsonTokenIs(key, "recid")) jsonTokenCopy(tok, uKey, 10);
+    else if (jsonTokenIs(key, "edt1"))  uValue[0] = jsonTokenToFixed(tok);
+    else if (jsonTokenIs(key, "edt2"))  uValue[1] = jsonTokenToFixed(tok);
+    else if (jsonTokenIs(key, "ert1"))  uValue[2] = jsonTokenToFixed(tok);
+    else if (jsonTokenIs(key, "ert2"))  uValue[3] = jsonTokenToFixed(tok);
+    else if (jsonTokenIs(key, "gdt"))   uValue[4] = jsonTokenToFixed(tok);
+    if (!jsonSkip(jt, tok))             return _NO_MONTH_SLOTS_;
+  }
+  if (tok.type != JSON_TOK_OBJ_END || !isNumericp(uKey, 4))  return _NO_MONTH_SLOTS_;
+  
+  uKey[4] = '\0';  // only YYMM is used (DDHHmmss is always 01010101)
+  strlcat(uKey, "01010101X", 15);
   recSlot = timestampToMonthSlot(uKey, strlen(uKey));
 
   DebugTf("MONTHS: Write [%s] to slot[%02d] in %s\r\n", uKey, recSlot, MONTHS_FILE);
-  snprintf(record, sizeof(record), (char *)DATA_FORMAT, uKey, (float)uEDT1, (float)uEDT2, (float)uERT1, (float)uERT2, (float)uGDT);
+  buildDataRecord(record, uKey, uValue);
 
   // DATA + \n + \0
   fillRecord(record, DATA_RECLEN);
@@ -148,6 +159,74 @@ uint16_t buildDataRecordFromJson(char *recIn, String jsonIn)
 
 } // buildDataRecordFromJson()
 
+//===========================================================================================
+// write one month record object, or an array of month record objects, to 
+// MONTHS_FILE. The file is opened (and committed to flash) only once for 
+// the whole batch. Returns the number of records written, -1 if json 
+// is not valid or -2 if MONTHS_FILE could not be opened. 'rejected' is 
+// the number of records that were not valid or not (completely) written
+int16_t writeMonthRecordsFromJson(const char *json, size_t len, uint16_t &rejected)
+{
+  char          record[DATA_RECLEN + 1] = "";
+  jsonTokenizer jt;
+  jsonToken     tok;
+  uint16_t      recSlot;
+  int16_t       nrRecs = 0;
+
+  rejected = 0;
+  if (!jsonIsValid(json, len))
+  {
+    DebugTf("invalid json [%s]\r\n", json);
+    return -1;
+  }
+  
+  if (!SPIFFS.exists(MONTHS_FILE))
+  {
+    createFile(MONTHS_FILE, _NO_MONTH_SLOTS_);
+  }
+  File dataFile = SPIFFS.open(MONTHS_FILE, "r+"); // read and write ..
+  if (!dataFile)
+  {
+    LogTf(LOG_ERROR, "Error opening [%s]\r\n", MONTHS_FILE);
+    writeToSysLog("Error opening [%s]", MONTHS_FILE);
+    return -2;
+  }
+
+  jsonBegin(jt, json, len);
+  while (jsonNext(jt, tok) > JSON_TOK_END)
+  {
+    if (tok.type != JSON_TOK_OBJ_START || tok.depth > 1)  continue;
+    
+    recSlot = buildDataRecordFromJson(record, jt);
+    if (recSlot >= _NO_MONTH_SLOTS_)
+    {
+      DebugTln("record not valid -> skipped");
+      slotErrors++;
+      rejected++;
+      continue;
+    }
+    // slot goes from 0 to _NO_OF_SLOTS_
+    // we need to add 1 to slot to skip header record!
+    dataFile.seek(((recSlot + 1) * DATA_RECLEN), SeekSet);
+    int32_t bytesWritten = dataFile.print(record);
+    if (bytesWritten != DATA_RECLEN)
+    {
+      LogTf(LOG_ERROR, "ERROR! slot[%02d]: written [%d] bytes but should have been [%d]\r\n", recSlot, bytesWritten, DATA_RECLEN);
+      writeToSysLog("ERROR! slot[%02d]: written [%d] bytes but should have been [%d]", recSlot, bytesWritten, DATA_RECLEN);
+      rejected++;
+      yield();
+      continue;
+    }
+    nrRecs++;
+    yield();
+  }
+  dataFile.close();
+  
+  DebugTf("wrote [%d] records to [%s]\r\n", nrRecs, MONTHS_FILE);
+  return nrRecs;
+
+} // writeMonthRecordsFromJson()
+
 //===========================================================================================
 void writeDataToFile(const char *fileName, const char *record, uint16_t slot, int8_t fileType)
 {
@@ -179,7 +258,7 @@ void writeDataToFile(const char *fileName, const char *record, uint16_t slot, in
   File dataFile = SPIFFS.open(fileName, "r+"); // read and write ..
   if (!dataFile)
   {
-    DebugTf("Error opening [%s]\r\n", fileName);
+    LogTf(LOG_ERROR, "Error opening [%s]\r\n", fileName);
     return;
   }
   // slot goes from 0 to _NO_OF_SLOTS_
@@ -189,7 +268,7 @@ void writeDataToFile(const char *fileName, const char *record, uint16_t slot, in
   int32_t bytesWritten = dataFile.print(record);
   if (bytesWritten != DATA_RECLEN)
   {
-    DebugTf("ERROR! slot[%02d]: written [%d] bytes but should have been [%d]\r\n", slot, bytesWritten, DATA_RECLEN);
+    LogTf(LOG_ERROR, "ERROR! slot[%02d]: written [%d] bytes but should have been [%d]\r\n", slot, bytesWritten, DATA_RECLEN);
     writeToSysLog("ERROR! slot[%02d]: written [%d] bytes but should have been [%d]", slot, bytesWritten, DATA_RECLEN);
   }
   dataFile.close();
@@ -201,28 +280,36 @@ void writeDataToFiles()
 {
   char record[DATA_RECLEN + 1] = "";
   uint16_t recSlot;
+  int32_t readings[5];
 
   buildDataRecordFromSM(record);
+  readingsFromSM(readings);
   DebugTf(">%s\r\n", record); // record ends in a \n
 
   // update HOURS
   recSlot = timestampToHourSlot(actTimestamp, strlen(actTimestamp));
   if (Verbose1)
-    DebugTf("HOURS:  Write to slot[%02d] in %s\r\n", recSlot, HOURS_FILE);
+    LogTf(LOG_DEBUG, "HOURS:  Write to slot[%02d] in %s\r\n", recSlot, HOURS_FILE);
   writeDataToFile(HOURS_FILE, record, recSlot, HOURS);
+  updateHistSummary(HOURS, recSlot, readings);
+  writeHistColumns(HOURS, recSlot);
   writeToSysLog("HOURS: actTimestamp[%s], recSlot[%d]", actTimestamp, recSlot);
 
   // update DAYS
   recSlot = timestampToDaySlot(actTimestamp, strlen(actTimestamp));
   if (Verbose1)
-    DebugTf("DAYS:   Write to slot[%02d] in %s\r\n", recSlot, DAYS_FILE);
+    LogTf(LOG_DEBUG, "DAYS:   Write to slot[%02d] in %s\r\n", recSlot, DAYS_FILE);
   writeDataToFile(DAYS_FILE, record, recSlot, DAYS);
+  updateHistSummary(DAYS, recSlot, readings);
+  writeHistColumns(DAYS, recSlot);
 
   // update MONTHS
   recSlot = timestampToMonthSlot(actTimestamp, strlen(actTimestamp));
   if (Verbose1)
-    DebugTf("MONTHS: Write to slot[%02d] in %s\r\n", recSlot, MONTHS_FILE);
+    LogTf(LOG_DEBUG, "MONTHS: Write to slot[%02d] in %s\r\n", recSlot, MONTHS_FILE);
   writeDataToFile(MONTHS_FILE, record, recSlot, MONTHS);
+  updateHistSummary(MONTHS, recSlot, readings);
+  writeHistColumns(MONTHS, recSlot);
 
 } // writeDataToFiles(fileType, dataStruct newDat, int8_t slotNr)
 
@@ -232,7 +319,7 @@ void readOneSlot(int8_t fileType, const char *fileName, uint8_t recNr, uint8_t r
   uint16_t slot, maxSlots = 0, offset;
   char buffer[DATA_RECLEN + 2] = "";
   char recID[10] = "";
-  float EDT1, EDT2, ERT1, ERT2, GDT;
+  int32_t values[5];
 
   switch (fileType)
   {
@@ -256,7 +343,7 @@ void readOneSlot(int8_t fileType, const char *fileName, uint8_t recNr, uint8_t r
   File dataFile = SPIFFS.open(fileName, "r+"); // read and write ..
   if (!dataFile)
   {
-    DebugTf("Error opening [%s]\r\n", fileName);
+    LogTf(LOG_ERROR, "Error opening [%s]\r\n", fileName);
     return;
   }
 
@@ -280,8 +367,10 @@ void readOneSlot(int8_t fileType, const char *fileName, uint8_t recNr, uint8_t r
     {
       if (doJson)
       {
-        sscanf(buffer, "%[^;];%f;%f;%f;%f;%f", recID, &EDT1, &EDT2, &ERT1, &ERT2, &GDT);
-        sendNestedJsonObj(recNr++, recID, slot, EDT1, EDT2, ERT1, ERT2, GDT);
+        if (parseDataRecord(buffer, recID, values))
+        {
+          sendNestedJsonObj(recNr++, recID, slot, values);
+        }
       }
       else
       {
@@ -293,6 +382,26 @@ void readOneSlot(int8_t fileType, const char *fileName, uint8_t recNr, uint8_t r
 
 } // readOneSlot()
 
+//===========================================================================================
+// the values of one slot, false if it has no valid record
+bool readSlotValues(int8_t fileType, const char *fileName, uint16_t slot, char *recID, int32_t v[5])
+{
+  char buffer[DATA_RECLEN + 2] = "";
+
+  File dataFile = SPIFFS.open(fileName, "r");
+  if (!dataFile) return false;
+
+  // we need to add 1 to slot to skip header record!
+  dataFile.seek(((slot + 1) * DATA_RECLEN), SeekSet);
+  int l = dataFile.readBytesUntil('\n', buffer, sizeof(buffer) -1);
+  buffer[l] = 0;
+  dataFile.close();
+
+  if (l < (DATA_RECLEN - 1) || !isNumericp(buffer, 8)) return false;
+  return parseDataRecord(buffer, recID, v);
+
+} // readSlotValues()
+
 //===========================================================================================
 void readSlotFromTimestamp(int8_t fileType, const char *fileName, const char *timeStamp, bool doJson, const char *rName)
 {
@@ -367,7 +476,7 @@ bool createFile(const char *fileName, uint16_t noSlots)
   bytesWritten = dataFile.print(cMsg);
   if (bytesWritten != DATA_RECLEN)
   {
-    DebugTf("ERROR!! slotNr[%d]: written [%d] bytes but should have been [%d] for Header\r\n", 0, bytesWritten, DATA_RECLEN);
+    LogTf(LOG_ERROR, "ERROR!! slotNr[%d]: written [%d] bytes but should have been [%d] for Header\r\n", 0, bytesWritten, DATA_RECLEN);
   }
   DebugTln(F(".. that went well! Now add next record ..\r"));
   // -- as this file is empty, write one data record ------------
@@ -383,7 +492,7 @@ bool createFile(const char *fileName, uint16_t noSlots)
     bytesWritten = dataFile.print(cMsg);
     if (bytesWritten != DATA_RECLEN)
     {
-      DebugTf("ERROR!! recNo[%d]: written [%d] bytes but should have been [%d] \r\n", r, bytesWritten, DATA_RECLEN);
+      LogTf(LOG_ERROR, "ERROR!! recNo[%d]: written [%d] bytes but should have been [%d] \r\n", r, bytesWritten, DATA_RECLEN);
     }
   } // for ..
 
@@ -409,7 +518,7 @@ void fillRecord(char *record, int8_t len)
     s++;
   }
   if (Verbose1)
-    DebugTf("Length of record is [%d] bytes\r\n", s);
+    LogTf(LOG_DEBUG, "Length of record is [%d] bytes\r\n", s);
   for (l = s; l < (len - 2); l++)
   {
     record[l] = ' ';
@@ -423,7 +532,7 @@ void fillRecord(char *record, int8_t len)
     l++;
   }
   if (Verbose1)
-    DebugTf("Length of record is now [%d] bytes\r\n", l);
+    LogTf(LOG_DEBUG, "Length of record is now [%d] bytes\r\n", l);
 
 } // fillRecord()
 
@@ -438,11 +547,11 @@ uint16_t timestampToHourSlot(const char *TS, int8_t len)
   uint8_t recSlot = (nrHours % _NO_HOUR_SLOTS_);
 
   if (Verbose1)
-    DebugTf("===>>>>>  HOUR[%02d] => recSlot[%02d]\r\n", hour(t1), recSlot);
+    LogTf(LOG_DEBUG, "===>>>>>  HOUR[%02d] => recSlot[%02d]\r\n", hour(t1), recSlot);
 
   if (recSlot < 0 || recSlot >= _NO_HOUR_SLOTS_)
   {
-    DebugTf("HOUR: Some serious error! Slot is [%d]\r\n", recSlot);
+    LogTf(LOG_ERROR, "HOUR: Some serious error! Slot is [%d]\r\n", recSlot);
     recSlot = _NO_HOUR_SLOTS_;
     slotErrors++;
   }
@@ -459,11 +568,11 @@ uint16_t timestampToDaySlot(const char *TS, int8_t len)
   uint16_t recSlot = (nrDays % _NO_DAY_SLOTS_);
 
   if (Verbose1)
-    DebugTf("===>>>>>   DAY[%02d] => recSlot[%02d]\r\n", day(t1), recSlot);
+    LogTf(LOG_DEBUG, "===>>>>>   DAY[%02d] => recSlot[%02d]\r\n", day(t1), recSlot);
 
   if (recSlot < 0 || recSlot >= _NO_DAY_SLOTS_)
   {
-    DebugTf("DAY: Some serious error! Slot is [%d]\r\n", recSlot);
+    LogTf(LOG_ERROR, "DAY: Some serious error! Slot is [%d]\r\n", recSlot);
     recSlot = _NO_DAY_SLOTS_;
     slotErrors++;
   }
@@ -480,11 +589,11 @@ uint16_t timestampToMonthSlot(const char *TS, int8_t len)
   uint16_t recSlot = (nrMonths % _NO_MONTH_SLOTS_);      // eg: 24285 % _NO_MONTH_SLOT_
 
   if (Verbose1)
-    DebugTf("===>>>>> MONTH[%02d] => recSlot[%02d]\r\n", month(t1), recSlot);
+    LogTf(LOG_DEBUG, "===>>>>> MONTH[%02d] => recSlot[%02d]\r\n", month(t1), recSlot);
 
   if (recSlot < 0 || recSlot >= _NO_MONTH_SLOTS_)
   {
-    DebugTf("MONTH: Some serious error! Slot is [%d]\r\n", recSlot);
+    LogTf(LOG_ERROR, "MONTH: Some serious error! Slot is [%d]\r\n", recSlot);
     recSlot = _NO_MONTH_SLOTS_;
     slotErrors++;
   }
@@ -507,156 +616,172 @@ int32_t freeSpace()
 } // freeSpace()
 
 //===========================================================================================
-#if defined(ESP8266)
-
-void ESP8266_listFiles()
+// walk the SPIFFS root the same way on the ESP8266 and the ESP32:
+//
+//   dirWalker w;
+//   if (dirOpen(w))
+//   {
+//     while (nextFile(w, true))  { .. w.entry.name, w.entry.size .. }
+//     dirClose(w);
+//   }
+//===========================================================================================
+bool dirOpen(dirWalker &w)
 {
-  typedef struct _fileMeta
+  w.entry.name[0] = '\0';
+  w.entry.size    = 0;
+  w.winLen        = 0;
+  w.winPos        = 0;
+#if defined(ESP8266)
+  w.dir = SPIFFS.openDir("/");
+#elif defined(ESP32)
+  w.root = SPIFFS.open("/");
+  if (!w.root || !w.root.isDirectory())
   {
-    char Name[20];
-    int32_t Size;
-  } fileMeta;
+    LogTln(LOG_ERROR, "- failed to open directory");
+    return false;
+  }
+#endif
+  return true;
 
-  _fileMeta dirMap[30];
-  int fileNr = 0;
+} // dirOpen()
 
-  Dir dir = SPIFFS.openDir("/"); // List files on SPIFFS
-  while (dir.next())
-  {
-    dirMap[fileNr].Name[0] = '\0';
-    strncat(dirMap[fileNr].Name, dir.fileName().substring(1).c_str(), 19); // remove leading '/'
-    dirMap[fileNr].Size = dir.fileSize();
-    fileNr++;
-  }
 
-  // -- bubble sort dirMap op .Name--
-  for (int8_t y = 0; y < fileNr; y++)
-  {
-    yield();
-    for (int8_t x = y + 1; x < fileNr; x++)
-    {
-      //DebugTf("y[%d], x[%d] => seq[x][%s] ", y, x, dirMap[x].Name);
-      if (strcasecmp(dirMap[x].Name, dirMap[y].Name) <= 0)
-      {
-        fileMeta temp = dirMap[y];
-        dirMap[y] = dirMap[x];
-        dirMap[x] = temp;
-      } /* end if */
-      //Debugln();
-    } /* end for */
-  }   /* end for */
+//===========================================================================================
+// the next file in directory order (directories are skipped)
+//===========================================================================================
+bool dirNext(dirWalker &w)
+{
+#if defined(ESP8266)
+  if (!w.dir.next()) return false;
+  String      fName = w.dir.fileName();
+  const char *name  = fName.c_str();
+  w.entry.size      = w.dir.fileSize();
+#elif defined(ESP32)
+  File file = w.root.openNextFile();
+  while (file && file.isDirectory())  file = w.root.openNextFile();
+  if (!file) return false;
+  const char *name  = file.name();
+  w.entry.size      = file.size();
+#endif
+  if (name[0] == '/') name++;
+  strlcpy(w.entry.name, name, sizeof(w.entry.name));
+  return true;
 
-  DebugTln(F("\r\n"));
-  for (int f = 0; f < fileNr; f++)
-  {
-    Debugf("%-25s %6d bytes \r\n", dirMap[f].Name, dirMap[f].Size);
-    yield();
-  }
+} // dirNext()
 
-  SPIFFS.info(SPIFFSinfo);
 
-  Debugln(F("\r"));
-  if (freeSpace() < (10 * SPIFFSinfo.blockSize))
-    Debugf("Available SPIFFS space [%6d]kB (LOW ON SPACE!!!)\r\n", (freeSpace() / 1024));
-  else
-    Debugf("Available SPIFFS space [%6d]kB\r\n", (freeSpace() / 1024));
-  Debugf("           SPIFFS Size [%6d]kB\r\n", (SPIFFSinfo.totalBytes / 1024));
-  Debugf("     SPIFFS block Size [%6d]bytes\r\n", SPIFFSinfo.blockSize);
-  Debugf("      SPIFFS page Size [%6d]bytes\r\n", SPIFFSinfo.pageSize);
-  Debugf(" SPIFFS max.Open Files [%6d]\r\n\r\n", SPIFFSinfo.maxOpenFiles);
+//===========================================================================================
+void dirClose(dirWalker &w)
+{
+#if defined(ESP32)
+  w.root.close();
+#endif
 
-} // ESP8266_listFiles()
+} // dirClose()
 
-#elif defined(ESP32)
 
-void ESP32_listFiles()
+//===========================================================================================
+// sorted like it always was: case insensitive (same letters: case sensitive)
+//===========================================================================================
+static int fileNameCmp(const char *a, const char *b)
 {
-  typedef struct _fileMeta
-  {
-    char Name[20];
-    int32_t Size;
-  } fileMeta;
+  int c = strcasecmp(a, b);
+  return (c != 0) ? c : strcmp(a, b);
 
-  _fileMeta dirMap[30];
-  int fileNr = 0;
+} // fileNameCmp()
 
-  File root = SPIFFS.open("/"); // List files on SPIFFS
-  if (!root)
-  {
-    DebugTln("- failed to open directory");
-    return;
-  }
-  if (!root.isDirectory())
-  {
-    DebugTln(" - not a directory");
-    return;
-  }
 
-  File file = root.openNextFile();
-  while (file)
-  {
-    if (file.isDirectory())
+//===========================================================================================
+// the FS_SORT_WINDOW files that come (by name) after "last" in w.window,
+// sorted. One walk of the directory (w is opened again)
+//===========================================================================================
+static void fillSortWindow(dirWalker &w)
+{
+  char      last[FS_NAME_LEN];
+  uint16_t  n = 0;
+  int8_t    i;
+
+  strlcpy(last, w.entry.name, sizeof(last));
+  dirClose(w);
+  if (!dirOpen(w)) return;
+  while (dirNext(w))
+  {
+    if ((++n % 16) == 0)  yield();
+    if (last[0] != '\0' && fileNameCmp(w.entry.name, last) <= 0) continue;
+    if (w.winLen == FS_SORT_WINDOW)
     {
-      DebugT("  DIR : ");
-      Debugln(file.name());
-      // directory is skipped
+      if (fileNameCmp(w.entry.name, w.window[FS_SORT_WINDOW -1].name) >= 0) continue;
+      w.winLen--;                   // the last one makes room
     }
-    else
+    for (i = w.winLen; i > 0 && fileNameCmp(w.entry.name, w.window[i -1].name) < 0; i--)
     {
-      DebugT("  FILE: ");
-      Debug(file.name());
-      Debug("\tSIZE: ");
-      Debugln(file.size());
-      dirMap[fileNr].Name[0] = '\0';
-      strncat(dirMap[fileNr].Name, file.name(), 29);                                      // first copy file.name() to dirMap
-      memmove(dirMap[fileNr].Name, dirMap[fileNr].Name + 1, strlen(dirMap[fileNr].Name)); // remove leading '/'
-      dirMap[fileNr].Size = file.size();
+      w.window[i] = w.window[i -1];
     }
-    file = root.openNextFile();
-    fileNr++;
+    w.window[i] = w.entry;
+    w.winLen++;
   }
 
-  // -- bubble sort dirMap op .Name--
-  for (int8_t y = 0; y < fileNr; y++)
+} // fillSortWindow()
+
+
+//===========================================================================================
+// the next file of the listing. Sorted by name, the directory is walked
+// once for every FS_SORT_WINDOW files (looking for the first names after
+// the last one), so no list of all files is kept and there is no maximum
+// number of files
+//===========================================================================================
+bool nextFile(dirWalker &w, bool byName)
+{
+  if (!byName) return dirNext(w);
+
+  if (w.winPos >= w.winLen)
   {
-    yield();
-    for (int8_t x = y + 1; x < fileNr; x++)
-    {
-      //DebugTf("y[%d], x[%d] => seq[x][%s] ", y, x, dirMap[x].Name);
-      if (strcasecmp(dirMap[x].Name, dirMap[y].Name) <= 0)
-      {
-        fileMeta temp = dirMap[y];
-        dirMap[y] = dirMap[x];
-        dirMap[x] = temp;
-      } /* end if */
-      //Debugln();
-    } /* end for */
-  }   /* end for */
+    //-- the last window was not full: there are no more files --
+    if (w.winLen > 0 && w.winLen < FS_SORT_WINDOW) return false;
+    fillSortWindow(w);
+    if (w.winLen == 0) return false;
+  }
+  w.entry = w.window[w.winPos++];
+  return true;
+
+} // nextFile()
+
+
+//===========================================================================================
+void listFiles() // Senden aller Daten an den Client
+{
+  dirWalker w;
+  uint16_t  nrFiles = 0;
+
+  if (!dirOpen(w)) return;
 
   DebugTln(F("\r\n"));
-  for (int f = 0; f < fileNr; f++)
+  while (nextFile(w, true))
   {
-    Debugf("%-25s %6d bytes \r\n", dirMap[f].Name, dirMap[f].Size);
+    Debugf("%-25s %6u bytes \r\n", w.entry.name, w.entry.size);
+    nrFiles++;
     yield();
   }
+  dirClose(w);
 
   Debugln(F("\r"));
+  Debugf("       Number of files [%6u]\r\n", nrFiles);
+#if defined(ESP8266)
+  SPIFFS.info(SPIFFSinfo);
+
+  if (freeSpace() < (10 * SPIFFSinfo.blockSize))
+    Debugf("Available SPIFFS space [%6d]kB (LOW ON SPACE!!!)\r\n", (freeSpace() / 1024));
+  else
+    Debugf("Available SPIFFS space [%6d]kB\r\n", (freeSpace() / 1024));
+  Debugf("           SPIFFS Size [%6d]kB\r\n", (SPIFFSinfo.totalBytes / 1024));
+  Debugf("     SPIFFS block Size [%6d]bytes\r\n", SPIFFSinfo.blockSize);
+  Debugf("      SPIFFS page Size [%6d]bytes\r\n", SPIFFSinfo.pageSize);
+  Debugf(" SPIFFS max.Open Files [%6d]\r\n\r\n", SPIFFSinfo.maxOpenFiles);
+#elif defined(ESP32)
   Debugf("Available SPIFFS space [%6d]kB\r\n", (freeSpace() / 1024));
   Debugf("           SPIFFS Size [%6d]kB\r\n", (SPIFFS.totalBytes() / 1024));
-  //  Debugf("     SPIFFS block Size [%6d]bytes\r\n", SPIFFS.blockSize());
-  //  Debugf("      SPIFFS page Size [%6d]bytes\r\n", SPIFFS.pageSize());
-  //  Debugf(" SPIFFS max.Open Files [%6d]\r\n\r\n", SPIFFS.maxOpenFiles());
-
-} // ESP32_listFiles()
 #endif
 
-void listFiles() // Senden aller Daten an den Client
-{
-#if defined(ESP8266)
-  ESP8266_listFiles();
-#elif defined(ESP32)
-  ESP32_listFiles();
-#endif
 } // listFiles()
 
 //===========================================================================================
@@ -718,9 +843,9 @@ bool DSMRfileExist(const char *fileName, bool doDisplay)
   DebugTf("check if [%s] exists .. ", fName);
   if (settingOledType > 0)
   {
-    oled_Print_Msg(1, "Bestaat:", 10);
-    oled_Print_Msg(2, fName, 10);
-    oled_Print_Msg(3, "op SPIFFS?", 250);
+    oled_Print_Msg(1, "Bestaat:", 0);
+    oled_Print_Msg(2, fName, 0);
+    oled_Print_Msg(3, "op SPIFFS?", 0);
   }
 
   if (!SPIFFS.exists(fName))
@@ -730,7 +855,7 @@ bool DSMRfileExist(const char *fileName, bool doDisplay)
       Debugln(F("NO! Error!!"));
       if (settingOledType > 0)
       {
-        oled_Print_Msg(3, "Nee! FOUT!", 6000);
+        oled_Print_Msg(3, "Nee! FOUT!", 0);
       }
       writeToSysLog("Error! File [%s] not found!", fName);
       return false;
@@ -740,7 +865,7 @@ bool DSMRfileExist(const char *fileName, bool doDisplay)
       Debugln(F("NO! "));
       if (settingOledType > 0)
       {
-        oled_Print_Msg(3, "Nee! ", 6000);
+        oled_Print_Msg(3, "Nee! ", 0);
       }
       writeToSysLog("File [%s] not found!", fName);
       return false;
@@ -751,7 +876,7 @@ bool DSMRfileExist(const char *fileName, bool doDisplay)
     Debugln(F("Yes! OK!"));
     if (settingOledType > 0)
     {
-      oled_Print_Msg(3, "JA! (OK!)", 250);
+      oled_Print_Msg(3, "JA! (OK!)", 0);
     }
   }
   return true;
@@ -2003,8 +2003,12 @@ http://DSMR-API.local/api/v1/dev/settings</pre>", false);
           ,[ "sm_has_fase_info",          "SM Has Fase Info (0=No, 1=Yes)" ]
           ,[ "oled_type",                 "OLED type (0=None, 1=SDD1306, 2=SH1106)" ]
           ,[ "oled_flip_screen",          "Flip OLED scherm (0=No, 1=Yes)" ]
+          ,[ "oled_interval",             "OLED Vermogen Interval (Sec., 0=elk telegram)" ]
+          ,[ "oled_aggregate",            "OLED Vermogen (0=laatste, 1=gemiddeld, 2=min, 3=max)" ]
           ,[ "tlgrm_interval",            "Telegram Lees Interval (Sec.)" ]
           ,[ "telegraminterval",          "Telegram Lees Interval (Sec.)" ]
+          ,[ "continuous_read",           "Elk Telegram Lezen (0=No, 1=Yes)" ]
+          ,[ "continuousread",            "Elk Telegram Lezen (0=No, 1=Yes)" ]
           ,[ "index_page",                "Te Gebruiken index.html Pagina" ]
           ,[ "oled_screen_time",          "Oled Screen Time (Min., 0=infinite)" ]
           ,[ "mqttbroker",                "MQTT Broker IP/URL" ]
@@ -2019,6 +2023,9 @@ http://DSMR-API.local/api/v1/dev/settings</pre>", false);
           ,[ "mqtt_toptopic",             "MQTT Top Topic" ]
           ,[ "mqttinterval",              "Verzend MQTT Berichten (Sec.)" ]
           ,[ "mqtt_interval",             "Verzend MQTT Berichten (Sec.)" ]
+          ,[ "mqtt_mode",                 "MQTT (0=per topic, 1=JSON state, 2=beide)" ]
+          ,[ "mqtt_aggregate",            "MQTT Vermogen (0=laatste, 1=gemiddeld, 2=min, 3=max)" ]
+          ,[ "mqttaggregate",             "MQTT Vermogen" ]
           ,[ "mqttbroker_connected",      "MQTT broker connected" ]
           ,[ "mindergas_token",           "Mindergas Token" ]
           ,[ "mindergas_response",        "Mindergas Terugkoppeling" ]
@@ -2026,6 +2033,8 @@ http://DSMR-API.local/api/v1/dev/settings</pre>", false);
           ,[ "influxdb_hostname",         "InfluxDB hostname"]
           ,[ "influxdb_port",             "InfluxDB port (default: 8086)"]
           ,[ "influxdb_databasename",     "InfluxDB database name"]
+          ,[ "influxdb_interval",         "InfluxDB Interval (Sec., 0=elk telegram)"]
+          ,[ "influxdb_aggregate",        "InfluxDB Vermogen (0=laatste, 1=gemiddeld, 2=min, 3=max)"]
 
           ,[ "telegramcount",             "Telegrammen verwerkt" ]
           ,[ "telegramerrors",            "Telegrammen met fouten" ]          
@@ -0,0 +1,137 @@
+/*
+***************************************************************************
+**  Filename  : fixedDecimal.h
+**  Version  : v2.3.0-rc5
+**
+**  Copyright (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See bottom of file.
+***************************************************************************
+*/
+
+/*
+ * Values in 1/1000 of their unit (what the parser gives in a FixedValue,
+ * see int_val()). A float only has ~7 significant digits, so a meter
+ * reading like 12345.678 kWh does not survive a (float) cast. These
+ * values stay integers all the way to the text that leaves the logger.
+ *
+ *   char buff[FIXED_MAX_CHARS];
+ *   fixedToChars(buff, 12345678);          // "12345.678"
+ *   fixedToChars(buff, 12345678, 2);       // "12345.68"
+ *   fixedToChars(buff, 12345678, 3, 10);   // " 12345.678"
+ *
+ *   int32_t milli;
+ *   charsToFixed(" 12345.678;", milli);    // 12345678, returns ptr to ';'
+ *
+ * Fewer than three decimals round half away from zero. charsToFixed()
+ * rounds on the fourth decimal and ignores the ones after that. A value
+ * that does not fit (more than 2147483.647) is rejected, not wrapped.
+ */
+
+#ifndef _FIXED_DECIMAL_H
+#define _FIXED_DECIMAL_H
+
+#define FIXED_MAX_CHARS   16    // "-2147483.648" (and some padding) + '\0'
+#define FIXED_MAX_DIGITS  10    // charsToFixed(): more digits before the '.' is not a number
+
+
+//===========================================================================================
+// returns the number of chars (without the '\0'). buff must hold
+// FIXED_MAX_CHARS (or width +1 if that is more)
+//===========================================================================================
+static inline uint8_t fixedToChars(char *buff, int32_t milli, uint8_t decimals = 3, uint8_t width = 0)
+{
+  static const uint16_t div[] = { 1000, 100, 10, 1 };
+  char      tmp[FIXED_MAX_CHARS];
+  uint8_t   t = sizeof(tmp), len = 0;
+  bool      isNeg = (milli < 0);
+  uint32_t  mag   = isNeg ? (uint32_t)(-(milli +1)) +1 : (uint32_t)milli;
+
+  if (decimals > 3) decimals = 3;
+  mag = (mag + (div[decimals] / 2)) / div[decimals];
+  if (mag == 0) isNeg = false;    // no "-0.000"
+
+  for (uint8_t d = 0; d < decimals; d++)
+  {
+    tmp[--t] = '0' + (mag % 10);
+    mag     /= 10;
+  }
+  if (decimals > 0) tmp[--t] = '.';
+  do
+  {
+    tmp[--t] = '0' + (mag % 10);
+    mag     /= 10;
+  } while (mag > 0);
+  if (isNeg) tmp[--t] = '-';
+
+  for (uint8_t n = (sizeof(tmp) - t); n < width; n++)  buff[len++] = ' ';
+  memcpy(&buff[len], &tmp[t], sizeof(tmp) - t);
+  len += (sizeof(tmp) - t);
+  buff[len] = '\0';
+  return len;
+
+} // fixedToChars()
+
+
+//===========================================================================================
+// "[ ][-]digits[.digits]" to 1/1000. Returns a pointer just after the
+// number, NULL if there is no number or if it does not fit in an int32_t
+// (more than FIXED_MAX_DIGITS digits before the '.', or > 2147483.647)
+//===========================================================================================
+static inline const char *charsToFixed(const char *s, int32_t &milli)
+{
+  uint64_t  mag    = 0;
+  uint8_t   digits = 0, decimals = 0, intDigits = 0;
+  bool      isNeg  = false;
+
+  while (*s == ' ') s++;
+  if (*s == '-' || *s == '+') isNeg = (*s++ == '-');
+
+  for ( ; *s >= '0' && *s <= '9'; s++, digits++)
+  {
+    if (mag > 0 || *s != '0') intDigits++;    // leading zero's do not count
+    if (intDigits > FIXED_MAX_DIGITS) return NULL;
+    mag = (mag * 10) + (*s - '0');
+  }
+  if (*s == '.')
+  {
+    for (s++; *s >= '0' && *s <= '9'; s++, digits++)
+    {
+      if (decimals < 3)       { mag = (mag * 10) + (*s - '0'); decimals++; }
+      else if (decimals == 3) { if (*s >= '5') mag++; decimals++; }
+    }
+  }
+  if (digits == 0) return NULL;
+  for ( ; decimals < 3; decimals++)  mag *= 10;
+  if (mag > (isNeg ? (uint64_t)INT32_MAX +1 : (uint64_t)INT32_MAX)) return NULL;
+
+  milli = isNeg ? (int32_t)(0 - (uint32_t)mag) : (int32_t)mag;
+  return s;
+
+} // charsToFixed()
+
+#endif // _FIXED_DECIMAL_H
+
+
+/***************************************************************************
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit
+* persons to whom the Software is furnished to do so, subject to the
+* following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT
+* OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+* THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+***************************************************************************/
@@ -10,125 +10,623 @@
 **  TERMS OF USE: MIT License. See bottom of file.                                                            
 ***************************************************************************      
 *      Created by Robert van den Breemen (26 june 2020)
-*/  
+*
+*      One line protocol point per telegram (all fields with a unit) is 
+*      added to influxBuff. The buffer is POST'ed (InfluxDB v1 /write) when 
+*      it holds INFLUX_BATCH_TELEGRAMS lines or (checked by influxBatchTimer,
+*      so also when the telegrams stop) the oldest line is INFLUX_BATCH_SEC
+*      seconds old, over a kept-alive HTTP connection.
+*      The server is only checked (/ping) after a failed POST.
+*      When the server can't be reached full buffers are appended to spool
+*      segments on flash (lines keep their own timestamp). These are sent
+*      again, oldest first, one segment every time influxSpoolTimer is DUE.
+*      The first INFLUX_SPOOL_FULL_SEGS segments hold every telegram, after
+*      that only one every INFLUX_SPOOL_THIN_SEC seconds is kept as a whole
+*      line: with lines of about 700 bytes the spool then holds more than a
+*      day. Of the other telegrams the meter readings (as readingsFromSM())
+*      are kept in a 24 byte record in INFLUX_THIN_FILE. After the segments
+*      these are sent as short lines, with their own timestamp.
+*/
 #ifdef USE_INFLUXDB
-// InfluxDB  server url. Don't use localhost, always server name or ip address.
-// For InfluxDB 2 e.g. http://192.168.1.48:9999 (Use: InfluxDB UI -> Load Data -> Client Libraries), 
-// For InfluxDB 1 e.g. http://192.168.1.48:8086
-#define INFLUXDB_URL "http://192.168.88.254:8086"
-//#define INFLUXDB_URL "http://127.0.0.1:8086"
-// InfluxDB 2 server or cloud API authentication token (Use: InfluxDB UI -> Load Data -> Tokens -> <select token>)
-//#define INFLUXDB_TOKEN "toked-id"
-// InfluxDB 2 organization id (Use: InfluxDB UI -> Settings -> Profile -> <name under tile> )
-//#define INFLUXDB_ORG "org"
-// InfluxDB 2 bucket name (Use: InfluxDB UI -> Load Data -> Buckets)
-//#define INFLUXDB_BUCKET "bucket"
-// InfluxDB v1 database name 
-#define INFLUXDB_DB_NAME "dsmr-api"
-#include <InfluxDbClient.h>
-
-// InfluxDB client instance
-//InfluxDBClient client(INFLUXDB_URL, INFLUXDB_ORG, INFLUXDB_BUCKET, INFLUXDB_TOKEN);
-// InfluxDB client instance for InfluxDB 1
-InfluxDBClient client(INFLUXDB_URL, INFLUXDB_DB_NAME);
-
-// Set timezone string according to https://www.gnu.org/software/libc/manual/html_node/TZ-Variable.html
-// Examples:
-//  Pacific Time:   "PST8PDT"
-//  Eastern:        "EST5EDT"
-//  Japanesse:      "JST-9"
-//  Central Europe: "CET-1CEST,M3.5.0,M10.5.0/3"
-#define TZ_INFO "CET-1CEST,M3.5.0,M10.5.0/3"
-#define WRITE_PRECISION WritePrecision::S
-#define MAX_BATCH_SIZE 16
-#define WRITE_BUFFER_SIZE 32
+
+#define INFLUX_MEASUREMENT      "dsmr"
+#define INFLUX_BUFF_MAX         4096    // a few telegrams
+#define INFLUX_LINE_MAX         1280    // room needed for one telegram
+#define INFLUX_BATCH_TELEGRAMS     4
+#define INFLUX_BATCH_SEC          60
+#define INFLUX_HTTP_TIMEOUT     2000    // ms
+#define INFLUX_RETRY_SEC          30    // wait after a failure
+#define INFLUX_SPOOL_INDEX      "/influx.idx"
+#define INFLUX_SPOOL_SEG_MAX   32768    // bytes in one spool segment (= one replay POST)
+#define INFLUX_SPOOL_SEGMENTS     10    // max. 320KB on flash
+#define INFLUX_SPOOL_FULL_SEGS     2    // segments with every telegram (~15 minutes)
+#define INFLUX_SPOOL_THIN_SEC    300    // then one telegram per 5 minutes
+#define INFLUX_THIN_FILE        "/influx-thin.bin"
+#define INFLUX_THIN_MAX         8640    // records, a day of telegrams (every 10s) in 207KB
+#define INFLUX_THIN_LINE         256    // room for one short line
+
+typedef struct {
+    uint32_t  epoch;
+    int32_t   v[5];       // as readingsFromSM()
+} influxThinRec;          // the meter readings of a thinned telegram
+
+static const char *influxThinNames[5] = { "energy_delivered_tariff1", "energy_delivered_tariff2"
+                                        , "energy_returned_tariff1",  "energy_returned_tariff2"
+#ifdef USE_PRE40_PROTOCOL
+                                        , "gas_delivered2" };
+#else
+                                        , "gas_delivered" };
+#endif
+
+  static HTTPClient   influxHttp;
+  static WiFiClient   influxWiFiClient;
+  static char         influxUrl[160] = "";
+  static char         influxBuff[INFLUX_BUFF_MAX];
+  static uint16_t     influxBuffLen   = 0;
+  static uint16_t     influxLineStart = 0;
+  static bool         influxOverflow  = false;
+  static uint8_t      influxLines     = 0;
+  static uint32_t     influxFirstLine = 0;      // millis() of the oldest line in influxBuff
+  static bool         influxBegun     = false;  // kept-alive connection
+  static bool         influxHealthy   = true;
+  static uint32_t     influxLastFail  = 0;
+  uint32_t            influxPosts = 0, influxErrors = 0, influxDropped = 0;
+  //-- backfill spool on flash --
+  static bool         influxSpoolRead  = false;
+  static bool         influxSpoolEmpty = true;
+  static uint32_t     influxSpoolTail  = 0, influxSpoolHead = 0;
+  static time_t       influxThinNext   = 0;      // epoch of the next telegram kept when thinning
+  static bool         influxThinEmpty  = true;
+  static uint32_t     influxThinSent   = 0;      // records of INFLUX_THIN_FILE that are posted
+  uint32_t            influxSpooled    = 0, influxThinned = 0;
 
 time_t thisEpoch;
 
+//===========================================================================================
 void initInfluxDB()
 {
-  if ( sizeof(settingInfluxDBhostname) < 8 )  return; 
-
- // Set InfluxDB 1 authentication params
-  // Only needed when query's are done?
-  //client.setConnectionParamsV1(INFLUXDB_URL, INFLUXDB_DB_NAME, INFLUXDB_USER, INFLUXDB_PASSWORD);   
-  snprintf(cMsg, sizeof(cMsg), "http://%s:%d", settingInfluxDBhostname , settingInfluxDBport);
-  DebugTf("InfluxDB Connection Setup: [%s] - database: [%s]\r\n", cMsg , settingInfluxDBdatabasename);
-  client.setConnectionParamsV1(cMsg, settingInfluxDBdatabasename);
-  Debugln("InfluxDB client setConnectionsParamsV1 done!");
-  // Connect to influxdb server connection
-
-  if (client.validateConnection()) {
-    DebugT("Connected to InfluxDB: ");
-    Debugln(client.getServerUrl());
-  } else {
-    DebugT("InfluxDB connection failed: ");
-    Debugln(client.getLastErrorMessage());
-  }
-    
-  //Enable messages batching and retry buffer
-  //deprecated writeoptions: 
-  client.setWriteOptions(WRITE_PRECISION, MAX_BATCH_SIZE, WRITE_BUFFER_SIZE);
-  
-  // client.setWriteOptions(WriteOptions().writePrecision(WRITE_PRECISION));
-  // client.setWriteOptions(WriteOptions().batchSize(MAX_BATCH_SIZE));
-  // client.setWriteOptions(WriteOptions().bufferSize(WRITE_BUFFER_SIZE));
-
-  //setup the HTTPoptions to reuse HTTP
-  //client.setHTTPOptions(HTTPOptions().connectionReuse(true));
-
-}
-struct writeInfluxDataPoints {
-  template<typename Item>
-  void apply(Item &i) {
-    
-    if (i.present()) 
+  influxHttp.end();
+  influxBegun   = false;
+  influxHealthy = true;
+  influxUrl[0]  = '\0';
+
+  if (strlen(settingInfluxDBhostname) < 4)  return; 
+
+  snprintf(influxUrl, sizeof(influxUrl), "http://%s:%d/write?db=%s&precision=s"
+                                       , settingInfluxDBhostname, settingInfluxDBport
+                                       , settingInfluxDBdatabasename);
+  DebugTf("InfluxDB Connection Setup: [%s]\r\n", influxUrl);
+
+} // initInfluxDB()
+
+
+//===========================================================================================
+void appendInfluxBuff(const char *cFormat, ...)
+{
+  va_list args;
+  int     len;
+
+  if (influxOverflow) return;
+  va_start(args, cFormat);
+  len = vsnprintf(&influxBuff[influxBuffLen], sizeof(influxBuff) - influxBuffLen, cFormat, args);
+  va_end(args);
+  if (len < 0 || (influxBuffLen + len) >= sizeof(influxBuff))
+  {
+    influxOverflow = true;
+    return;
+  }
+  influxBuffLen += len;
+
+} // appendInfluxBuff()
+
+
+//===========================================================================================
+// one field: "<sep><name>=<value>"
+//===========================================================================================
+void appendInfluxField(const char *cName, const String &sValue)
+{
+  appendInfluxBuff("%c%s=\"", (influxBuffLen > influxLineStart ? ',' : ' '), cName);
+  for (uint16_t c = 0; c < sValue.length(); c++)
+  {
+    if (sValue[c] == '"' || sValue[c] == '\\') appendInfluxBuff("\\");
+    appendInfluxBuff("%c", sValue[c]);
+  }
+  appendInfluxBuff("\"");
+
+} // appendInfluxField(String)
+
+//---------------------------------------------------------------
+void appendInfluxField(const char *cName, int32_t iValue)
+{
+  appendInfluxBuff("%c%s=%di", (influxBuffLen > influxLineStart ? ',' : ' '), cName, iValue);
+
+} // appendInfluxField(int)
+
+//---------------------------------------------------------------
+void appendInfluxField(const char *cName, uint32_t uValue)
+{
+  appendInfluxBuff("%c%s=%ui", (influxBuffLen > influxLineStart ? ',' : ' '), cName, uValue);
+
+} // appendInfluxField(uint)
+
+//---------------------------------------------------------------
+void appendInfluxField(const char *cName, float fValue)
+{
+  appendInfluxBuff("%c%s=%.3f", (influxBuffLen > influxLineStart ? ',' : ' '), cName, fValue);
+
+} // appendInfluxField(float)
+
+//---------------------------------------------------------------
+void appendInfluxField(const char *cName, FixedValue &xValue)
+{
+  char cValue[FIXED_MAX_CHARS];
+
+  fixedToChars(cValue, (int32_t)xValue.int_val());
+  appendInfluxBuff("%c%s=%s", (influxBuffLen > influxLineStart ? ',' : ' '), cName, cValue);
+
+} // appendInfluxField(FixedValue)
+
+
+//===========================================================================================
+struct buildInfluxLine {
+
+    char cName[35];
+
+    template<typename Item>
+    void apply(Item &i) {
+      //-- only measurements (fields with a unit) --
+      if (!i.present() || strlen(Item::unit()) == 0) return;
+
+      strlcpy_P(cName, (PGM_P)Item::name, sizeof(cName));
+      appendInfluxField(cName, i.val());
+    }
+
+};  // struct buildInfluxLine
+
+
+//===========================================================================================
+// GET /ping, only done after a failure
+//===========================================================================================
+bool influxIsHealthy()
+{
+  HTTPClient  http;
+  char        pingUrl[130];
+  int         httpCode;
+
+  snprintf(pingUrl, sizeof(pingUrl), "http://%s:%d/ping", settingInfluxDBhostname, settingInfluxDBport);
+  http.setTimeout(INFLUX_HTTP_TIMEOUT);
+  http.begin(influxWiFiClient, pingUrl);
+  httpCode = http.GET();
+  http.end();
+  DebugTf("InfluxDB ping -> [%d]\r\n", httpCode);
+  return (httpCode == 204 || httpCode == 200);
+
+} // influxIsHealthy()
+
+
+//===========================================================================================
+// after a failure the server is checked first (not more than once per INFLUX_RETRY_SEC)
+//===========================================================================================
+bool influxReady()
+{
+  if (strlen(influxUrl) == 0) return false;
+
+  if (!influxHealthy)
+  {
+    if ((millis() - influxLastFail) < (INFLUX_RETRY_SEC * 1000UL)) return false;
+    influxLastFail = millis();
+    if (!influxIsHealthy()) return false;
+    influxHealthy = true;
+  }
+
+  if (!influxBegun)
+  {
+    influxHttp.setReuse(true);
+    influxHttp.setTimeout(INFLUX_HTTP_TIMEOUT);
+    influxBegun = influxHttp.begin(influxWiFiClient, influxUrl);
+  }
+  return influxBegun;
+
+} // influxReady()
+
+
+//===========================================================================================
+bool influxPostOk(int httpCode)
+{
+  if (httpCode == 204 || httpCode == 200)
+  {
+    influxPosts++;
+    return true;
+  }
+
+  LogTf(LOG_WARN, "InfluxDB write failed [%d] %s\r\n", httpCode, influxHttp.errorToString(httpCode).c_str());
+  influxHttp.end();
+  influxBegun     = false;
+  influxHealthy   = false;
+  influxLastFail  = millis();
+  influxErrors++;
+  return false;
+
+} // influxPostOk()
+
+
+//===========================================================================================
+bool postInfluxBuff()
+{
+  uint32_t  timeThis = millis();
+
+  if (influxBuffLen == 0) return true;
+  if (memShed(MEM_LOW))   return false;   // no HTTP now, spooled when full
+  if (!influxReady())     return false;
+
+  if (!influxPostOk(influxHttp.POST((uint8_t *)influxBuff, influxBuffLen))) return false;
+
+  DebugTf("InfluxDB: [%d] telegrams, [%d] bytes in [%d] ms\r\n", influxLines, influxBuffLen
+                                                                  , (int)(millis()-timeThis));
+  influxBuffLen = 0;
+  influxLines   = 0;
+  return true;
+
+} // postInfluxBuff()
+
+
+//===========================================================================================
+// The spool: segment files "/influx-NNN.lp" (oldest = influxSpoolTail, being
+// written = influxSpoolHead). Tail and head are kept in INFLUX_SPOOL_INDEX.
+//===========================================================================================
+void influxSpoolName(char *fName, size_t len, uint32_t segment)
+{
+  snprintf(fName, len, "/influx-%03u.lp", (unsigned int)(segment % 1000));
+
+} // influxSpoolName()
+
+
+//===========================================================================================
+void readInfluxSpoolIndex()
+{
+  char cIdx[24] = "";
+
+  influxSpoolRead  = true;
+  influxSpoolEmpty = true;
+  influxSpoolTail  = influxSpoolHead = 0;
+  File fh = SPIFFS.open(INFLUX_SPOOL_INDEX, "r");
+  if (!fh) return;
+  int l = fh.readBytes(cIdx, sizeof(cIdx) -1);
+  cIdx[l] = '\0';
+  fh.close();
+  if (sscanf(cIdx, "%u %u", &influxSpoolTail, &influxSpoolHead) != 2 || influxSpoolHead < influxSpoolTail)
+  {
+    influxSpoolTail = influxSpoolHead = 0;
+  }
+  char fName[20];
+  influxSpoolName(fName, sizeof(fName), influxSpoolHead);
+  influxSpoolEmpty = (influxSpoolTail == influxSpoolHead && !SPIFFS.exists(fName));
+  influxThinEmpty  = !SPIFFS.exists(INFLUX_THIN_FILE);
+  influxThinSent   = 0;         // (again) from the start, InfluxDB overwrites what it has
+  DebugTf("InfluxDB spool: segments [%u .. %u]\r\n", influxSpoolTail, influxSpoolHead);
+
+} // readInfluxSpoolIndex()
+
+
+//===========================================================================================
+void writeInfluxSpoolIndex()
+{
+  File fh = SPIFFS.open(INFLUX_SPOOL_INDEX, "w");
+  if (!fh)
+  {
+    LogTf(LOG_ERROR, "Error writing [%s]\r\n", INFLUX_SPOOL_INDEX);
+    return;
+  }
+  fh.printf("%u %u\n", influxSpoolTail, influxSpoolHead);
+  fh.close();
+
+} // writeInfluxSpoolIndex()
+
+
+//===========================================================================================
+// InfluxDB can't be reached and influxBuff is full: move it to flash
+//===========================================================================================
+void spoolInfluxBuff()
+{
+  char  fName[20];
+
+  if (!influxSpoolRead) readInfluxSpoolIndex();
+
+  influxSpoolName(fName, sizeof(fName), influxSpoolHead);
+  File fh = SPIFFS.open(fName, "a");
+  if (fh && (fh.size() + influxBuffLen) > INFLUX_SPOOL_SEG_MAX)
+  {
+    //-- segment is full, start the next one --
+    fh.close();
+    influxSpoolHead++;
+    if ((influxSpoolHead - influxSpoolTail) >= INFLUX_SPOOL_SEGMENTS)
+    {
+      influxSpoolName(fName, sizeof(fName), influxSpoolTail++);
+      DebugTf("InfluxDB spool full, remove oldest segment [%s]\r\n", fName);
+      SPIFFS.remove(fName);
+      influxDropped += (INFLUX_SPOOL_SEG_MAX / INFLUX_LINE_MAX);  // (about)
+    }
+    influxSpoolName(fName, sizeof(fName), influxSpoolHead);
+    fh = SPIFFS.open(fName, "a");
+  }
+  if (!fh || fh.write((const uint8_t *)influxBuff, influxBuffLen) != influxBuffLen)
+  {
+    LogTf(LOG_ERROR, "InfluxDB spool: error writing [%s], [%d] telegrams dropped\r\n", fName, influxLines);
+    influxDropped += influxLines;
+  }
+  else
+  {
+    DebugTf("InfluxDB spool: [%d] telegrams -> [%s]\r\n", influxLines, fName);
+    influxSpooled   += influxLines;
+    influxSpoolEmpty = false;
+  }
+  if (fh) fh.close();
+  writeInfluxSpoolIndex();
+
+  influxBuffLen = 0;
+  influxLines   = 0;
+
+} // spoolInfluxBuff()
+
+
+//===========================================================================================
+// a thinned telegram: only its meter readings go to INFLUX_THIN_FILE
+//===========================================================================================
+void spoolInfluxThinned(time_t epoch)
+{
+  influxThinRec rec;
+
+  File fh = SPIFFS.open(INFLUX_THIN_FILE, "a");
+  if (!fh || fh.size() >= (INFLUX_THIN_MAX * sizeof(rec)))
+  {
+    if (fh) fh.close();
+    influxDropped++;
+    return;
+  }
+  rec.epoch = (uint32_t)epoch;
+  readingsFromSM(rec.v);
+  if (fh.write((const uint8_t *)&rec, sizeof(rec)) != sizeof(rec))
+  {
+    LogTf(LOG_ERROR, "InfluxDB spool: error writing [%s]\r\n", INFLUX_THIN_FILE);
+    influxDropped++;
+  }
+  else
+  {
+    influxThinned++;
+    influxThinEmpty = false;
+  }
+  fh.close();
+
+} // spoolInfluxThinned()
+
+
+//===========================================================================================
+// InfluxDB is down and the spool is past its full resolution segments: only keep
+// one telegram every INFLUX_SPOOL_THIN_SEC seconds as a whole line, of the others
+// only the meter readings (spoolInfluxThinned())
+//===========================================================================================
+bool influxSkipThinned(time_t epoch)
+{
+  if (influxHealthy) return false;
+  if (!influxSpoolRead) readInfluxSpoolIndex();
+  if (influxSpoolEmpty || (influxSpoolHead - influxSpoolTail) < INFLUX_SPOOL_FULL_SEGS)
+  {
+    influxThinNext = 0;
+    return false;
+  }
+  if (epoch >= influxThinNext)
+  {
+    influxThinNext = epoch + INFLUX_SPOOL_THIN_SEC;
+    return false;
+  }
+  spoolInfluxThinned(epoch);
+  return true;
+
+} // influxSkipThinned()
+
+
+//===========================================================================================
+// the records of INFLUX_THIN_FILE as line protocol for HTTPClient::sendRequest(), a
+// line at a time: "dsmr,host=.. energy_delivered_tariff1=..,.. <epoch>". A reading
+// that is 0 (not in the telegram) is left out, a record without readings is skipped
+//===========================================================================================
+class influxThinStream : public Stream {
+  public:
+    File      fh;
+    uint32_t  recs = 0;                   // records left to read
+    char      line[INFLUX_THIN_LINE];
+    uint16_t  len  = 0, pos = 0;
+
+    bool next()
     {
-      if (strlen(Item::unit()) != 0) 
+      influxThinRec rec;
+      char          cValue[FIXED_MAX_CHARS];
+
+      while (pos >= len)
       {
-        //when there is a unit, then it is a measurement
-        Point pointItem(Item::unit());
-        pointItem.setTime(thisEpoch);
-        pointItem.addTag("instance",Item::name);     
-        pointItem.addField("value", i.val());
-        if (Verbose1) {
-          DebugT("Writing to influxdb:");
-          Debugln(pointItem.toLineProtocol());          
-        }
-        if (!client.writePoint(pointItem)) {
-          DebugT("InfluxDB write failed: ");
-          Debugln(client.getLastErrorMessage());
+        if (recs == 0 || fh.read((uint8_t *)&rec, sizeof(rec)) != sizeof(rec)) return false;
+        recs--;
+        pos = 0;
+        len = snprintf(line, sizeof(line), "%s,host=%s", INFLUX_MEASUREMENT, settingHostname);
+        uint16_t fields = len;
+        for (uint8_t i = 0; i < 5; i++)
+        {
+          if (rec.v[i] == 0) continue;
+          fixedToChars(cValue, rec.v[i]);
+          len += snprintf(&line[len], sizeof(line) - len, "%c%s=%s", (len > fields ? ',' : ' ')
+                                                                   , influxThinNames[i], cValue);
         }
-      }//writing to influxdb      
+        if (len == fields) len = 0;
+        else len += snprintf(&line[len], sizeof(line) - len, " %lu\n", (unsigned long)rec.epoch);
+      }
+      return true;
+    }
+    int     available()           { return next() ? (len - pos) : 0; }
+    int     read()                { return next() ? line[pos++] : -1; }
+    int     peek()                { return next() ? line[pos] : -1; }
+    size_t  write(uint8_t c)      { return 0; }
+    void    flush()               { }
+
+};  // class influxThinStream
+
+
+//===========================================================================================
+// the spool segments are sent: post the next (up to) INFLUX_SPOOL_SEG_MAX bytes of
+// short lines from INFLUX_THIN_FILE
+//===========================================================================================
+void postInfluxThinned()
+{
+  influxThinStream  ts;
+  size_t            bytes = 0;
+  uint32_t          recs  = 0;
+  uint32_t          timeThis = millis();
+  uint32_t          start = influxThinSent * sizeof(influxThinRec);
+
+  ts.fh = SPIFFS.open(INFLUX_THIN_FILE, "r");
+  if (ts.fh && ts.fh.seek(start, SeekSet))
+  {
+    //-- first count the bytes (Content-Length), then send them --
+    ts.recs = (ts.fh.size() - start) / sizeof(influxThinRec);
+    while ((bytes + INFLUX_THIN_LINE) <= INFLUX_SPOOL_SEG_MAX && ts.next())
+    {
+      bytes += ts.len;
+      ts.pos = ts.len;
+    }
+    recs    = (ts.fh.position() - start) / sizeof(influxThinRec);
+    ts.recs = recs;
+    ts.len  = ts.pos = 0;
+    ts.fh.seek(start, SeekSet);
+  }
+  if (bytes > 0)
+  {
+    if (!influxPostOk(influxHttp.sendRequest("POST", &ts, bytes)))
+    {
+      ts.fh.close();
+      return;
+    }
+    DebugTf("InfluxDB spool: [%u] readings ([%d] bytes) sent in [%d] ms\r\n", recs, (int)bytes
+                                                                           , (int)(millis()-timeThis));
+    influxThinSent += recs;
+  }
+  if (ts.fh) ts.fh.close();
+  if (bytes == 0)
+  {
+    SPIFFS.remove(INFLUX_THIN_FILE);
+    influxThinEmpty = true;
+    influxThinSent  = 0;
+    DebugTln("InfluxDB spool of readings is empty");
+  }
+
+} // postInfluxThinned()
+
+
+//===========================================================================================
+// called from loop() when influxSpoolTimer is DUE: post the oldest segment (streamed
+// from flash, so one large batch without a RAM buffer). When the segments are all
+// sent, the readings of the thinned telegrams
+//===========================================================================================
+void handleInfluxSpool()
+{
+  char      fName[20];
+  uint32_t  timeThis = millis();
+
+  if (!influxSpoolRead)
+  {
+    if (strlen(influxUrl) == 0) return;
+    readInfluxSpoolIndex();
+  }
+  if (influxSpoolEmpty && influxThinEmpty) return;
+  if (memShed(MEM_LOW)) return;
+  if (!influxHealthy || !influxReady()) return;
+  if (influxSpoolEmpty)
+  {
+    postInfluxThinned();
+    return;
+  }
+
+  influxSpoolName(fName, sizeof(fName), influxSpoolTail);
+  File fh = SPIFFS.open(fName, "r");
+  if (fh && fh.size() > 0)
+  {
+    size_t segSize = fh.size();
+    if (!influxPostOk(influxHttp.sendRequest("POST", &fh, segSize)))
+    {
+      fh.close();
+      return;
     }
+    DebugTf("InfluxDB spool: [%s] ([%d] bytes) sent in [%d] ms\r\n", fName, (int)segSize
+                                                                     , (int)(millis()-timeThis));
+  }
+  if (fh) fh.close();
+  SPIFFS.remove(fName);
+
+  if (influxSpoolTail == influxSpoolHead)
+  {
+    influxSpoolHead++;          // this was the last one, next spool starts a new segment
+    influxSpoolEmpty = true;
+    DebugTln("InfluxDB spool is empty");
   }
-};
+  influxSpoolTail++;
+  writeInfluxSpoolIndex();
+
+} // handleInfluxSpool()
+
 
+//===========================================================================================
 void handleInfluxDB()
 {
   static uint32_t lastTelegram = 0;
-  if (!client.validateConnection()) {
-    DebugTln("InfluxDB connection problem!");
-    return; // only write if there is a valid connection to InfluxDB
-  }
-  if ((telegramCount - lastTelegram)> 0)
-  {
-    //New telegram received, let's forward that to influxDB
-    lastTelegram = telegramCount;
-    //Setup the timestamp for this telegram, so all points for this batch are the same.
-    // ThisEpoch needs to be the true epoch being the UTC epoch. As the clock is synced to NL timezone, it needs to be lowered by 7200 in summer, and 3600 in winter
-    thisEpoch = now()- (isDST ? 7200 : 3600);  
-    uint32_t timeThis = millis();
-    DSMRdata.applyEach(writeInfluxDataPoints());
-    // Check whether buffer in not empty
-    if (!client.isBufferEmpty()) {
-      // Write all remaining points to db
-      client.flushBuffer();
-    }
-    DebugTf("Influxdb write took [%d] ms\r\n", (int)(millis()-timeThis));
+
+  if (strlen(influxUrl) == 0) return;
+  if ((telegramCount - lastTelegram) == 0) return;
+
+  //New telegram received, let's forward that to influxDB
+  lastTelegram = telegramCount;
+  // ThisEpoch needs to be the true epoch being the UTC epoch (the clock runs on the meter's local time)
+  thisEpoch = utcEpoch(actTimestamp);
+  if (influxSkipThinned(thisEpoch)) return;
+
+  //-- no room for another line: try to send, else move them to the spool --
+  if ((sizeof(influxBuff) - influxBuffLen) < INFLUX_LINE_MAX && !postInfluxBuff())
+  {
+    spoolInfluxBuff();
   }
-  
-}
+
+  uint16_t lineBegin = influxBuffLen;
+  influxLineStart = influxBuffLen;
+  influxOverflow  = false;
+  appendInfluxBuff("%s,host=%s", INFLUX_MEASUREMENT, settingHostname);
+  influxLineStart = influxBuffLen;
+  DSMRdata.applyEach(buildInfluxLine());
+  if (influxBuffLen == influxLineStart)  influxOverflow = true;  // no fields
+  appendInfluxBuff(" %lu\n", (unsigned long)thisEpoch);
+  if (influxOverflow)
+  {
+    DebugTln("InfluxDB: line does not fit (or is empty)");
+    influxBuffLen = lineBegin;
+    return;
+  }
+  if (influxLines++ == 0)  influxFirstLine = millis();
+  if (Verbose1) LogTf(LOG_DEBUG, "InfluxDB line [%d] bytes\r\n", influxBuffLen - lineBegin);
+
+  if (influxLines >= INFLUX_BATCH_TELEGRAMS)  postInfluxBuff();
+
+} // handleInfluxDB()
+
+
+//===========================================================================================
+// called from loop() when influxBatchTimer is DUE: the age of a batch does not 
+// depend on the next telegram coming in
+//===========================================================================================
+void handleInfluxBatch()
+{
+  if (influxLines == 0) return;
+  if ((millis() - influxFirstLine) < (INFLUX_BATCH_SEC * 1000UL)) return;
+
+  postInfluxBuff();
+
+} // handleInfluxBatch()
+
 #endif
 
 /***************************************************************************
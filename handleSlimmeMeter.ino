@@ -12,6 +12,7 @@
 void initSlimmermeter()
 {
 #if defined( USE_REQUEST_PIN ) && !defined( HAS_NO_SLIMMEMETER )
+  SM_SERIAL.setRxBufferSize(SM_RX_BUFF_SIZE);
   #if defined(ESP8266) 
     #ifdef USE_PRE40_PROTOCOL                                                        
       SM_SERIAL.begin(9600, SERIAL_7E1);                                               
@@ -39,14 +40,35 @@ void initSlimmermeter()
 #endif // USE_REQUEST_PIN && !HAS_NO_SLIMMEMETER 
 }
 
+//==================================================================================
+// Raw mode: loop() reads the P1 port itself. With the reader task (ESP32) that is
+// only safe once the task has seen showRaw and stopped reading, it tells so with
+// p1RawPaused. Returns true when the port is ours, waits at most waitMs for it.
+//==================================================================================
+bool claimP1forRaw(uint32_t waitMs)
+{
+  showRaw = true;
+#ifdef USE_P1_TASK
+  uint32_t waitStart = millis();
+  while (!p1RawPaused)
+  {
+    if ((millis() - waitStart) >= waitMs) return false;
+    delay(5);
+  }
+#endif
+  return true;
+
+} // claimP1forRaw()
+
+
 #ifndef HAS_NO_SLIMMEMETER
 //==================================================================================
 void handleSlimmemeter()
 {
   //DebugTf("showRaw (%s)\r\n", showRaw ?"true":"false");
   if (showRaw) {
-    //-- process telegrams in raw in mode
-    processSlimmemeterRaw();
+    //-- process telegrams in raw in mode (as soon as the reader task let go of the port)
+    if (claimP1forRaw(0)) processSlimmemeterRaw();
   } 
   else
   {
@@ -59,14 +81,94 @@ void handleSlimmemeter()
 
 uint32_t timerTlg;
 
+//==================================================================================
 void tiggerNextTelegram()
 {
-    if (Verbose1|| Verbose2) DebugTln("Enable DTR, get that telegram...");
+    //-- continuous: DTR stays enabled, enabling it again would drop the telegram being read
+    if (settingContinuousRead && p1Continuous) return;
+    p1Continuous = settingContinuousRead;
+
+    if (Verbose1|| Verbose2) LogTln(LOG_DEBUG, "Enable DTR, get that telegram...");
     // //-- enable DTR to read a telegram from the Slimme Meter
-    slimmeMeter.enable(true); 
+#ifdef USE_P1_TASK
+    p1EnableRequest = true;       // slimmeMeter belongs to the P1 reader task
+#else
+    slimmeMeter.enable(!settingContinuousRead);   // once, or keep reading
+#endif
     timerTlg = millis();
 } // tiggerNextTelegram()
 
+#ifdef USE_P1_TASK
+//==================================================================================
+// ESP32: runs on the other core. Reads the P1 port, checks the CRC and parses
+// the telegram. The result goes to loop() through p1Ring.
+// No Debug output here, TelnetStream is not thread safe.
+//==================================================================================
+void p1ReaderTask(void *param)
+{
+  for(;;)
+  {
+    if (showRaw)  //-- loop() reads the port itself (processSlimmemeterRaw) --
+    {
+      p1RawPaused = true;
+      vTaskDelay(pdMS_TO_TICKS(100));
+      continue;
+    }
+    //-- clear the flag first, then look again: if loop() asked in between, one of 
+    //-- the two sees the other (both are seq_cst) and the port is never shared --
+    p1RawPaused = false;
+    if (showRaw) continue;
+    if (p1EnableRequest)
+    {
+      p1EnableRequest = false;
+      slimmeMeter.enable(!settingContinuousRead);
+    }
+    slimmeMeter.loop();
+    if (!slimmeMeter.available())
+    {
+      vTaskDelay(pdMS_TO_TICKS(5));
+      continue;
+    }
+
+    p1Telegram *p1 = p1Ring.reserve();
+    if (p1 == NULL)   //-- loop() did not pick up the previous ones (yet) --
+    {
+      p1Dropped++;
+      slimmeMeter.clear();
+      continue;
+    }
+    uint32_t start = micros();
+    p1->data    = {};
+    p1->error   = "";
+    p1->parsed  = slimmeMeter.parse(&p1->data, &p1->error);
+    p1->parseUs = micros() - start;
+    //--- set DTR to get a new telegram as soon as possible
+    if (!p1->parsed && !settingContinuousRead)  slimmeMeter.enable(true);
+    p1Ring.commit();
+  }
+
+} // p1ReaderTask()
+
+
+//==================================================================================
+void startP1ReaderTask()
+{
+  //-- loop() runs on ARDUINO_RUNNING_CORE, the reader gets the other one --
+  BaseType_t p1Core = (xPortGetCoreID() == 0) ? 1 : 0;
+
+  if (xTaskCreatePinnedToCore(p1ReaderTask, "P1reader", P1_TASK_STACK, NULL
+                                          , P1_TASK_PRIO, &p1TaskHandle, p1Core) != pdPASS)
+  {
+    LogTln(LOG_ERROR, F("Error: could not start P1 reader task!"));
+    writeToSysLog("Error: could not start P1 reader task!");
+    return;
+  }
+  DebugTf("P1 reader task started on core [%d]\r\n", p1Core);
+
+} // startP1ReaderTask()
+#endif
+
+
 //==================================================================================
 void processSlimmemeterRaw()
 {
@@ -75,6 +177,7 @@ void processSlimmemeterRaw()
   DebugTf("handleSlimmerMeter RawCount=[%4d]\r\n", showRawCount);
   showRawCount++;
   showRaw = (showRawCount <= 20);
+  p1Continuous = false;     // raw mode enables the port for one telegram
   if (!showRaw)
   {
     showRawCount  = 0;
@@ -132,10 +235,29 @@ void processSlimmemeterRaw()
 //==================================================================================
 void processSlimmemeter()
 {
+  String    DSMRerror;
+  bool      parsed;
+
+#ifdef USE_P1_TASK
+  //-- read and parsed by the P1 reader task --
+  p1Telegram *p1 = p1Ring.peek();
+  if (p1 != NULL) 
+  {
+    DSMRdata  = p1->data;
+    DSMRerror = p1->error;
+    parsed    = p1->parsed;
+    stageDone(STAGE_PARSE, p1->parseUs);
+    p1Ring.pop();
+#else
   slimmeMeter.loop();
   if (slimmeMeter.available()) 
   {
-    if (Verbose2) DebugTf("Telegram received [%d] ms after DTR enable.\r\n",  (timerTlg-millis()));
+    uint32_t start = micros();
+    DSMRdata = {};
+    parsed   = slimmeMeter.parse(&DSMRdata, &DSMRerror);
+    stageDone(STAGE_PARSE, micros() - start);
+#endif
+    if (Verbose2) LogTf(LOG_DEBUG, "Telegram received [%d] ms after DTR enable.\r\n",  (timerTlg-millis()));
     Debugln(F("\r\n[Time----][FreeHea| Frags| mBlck] Function----(line):\r"));
     DebugTf("telegramCount=[%d] telegramErrors=[%d]\r\n", telegramCount, telegramErrors);
     //  Voorbeeld: [21:00:11][   9880|     9|  8960] loop        ( 997): read telegram [28] => [140307210001S]
@@ -143,14 +265,12 @@ void processSlimmemeter()
     //     Voorbeeld: [21:00:11][   9880|  8960] loop        ( 997): read telegram [28] => [140307210001S]
     
     telegramCount++;    
-    DSMRdata = {};
-    String    DSMRerror;
-    if (slimmeMeter.parse(&DSMRdata, &DSMRerror))   // Parse succesful, print result
+    if (parsed)   // Parse succesful, print result
     {
       if (telegramCount > (UINT32_MAX - 10)) 
       {
         delay(1000);
-        esp_reboot();
+        rebootWithReason("telegramCount overflow");
         delay(1000);
       }
       digitalWrite(LED_BUILTIN, LED_OFF);
@@ -202,25 +322,27 @@ void processSlimmemeter()
     } 
     else                  // Parser error, print error
     {
-      DebugTln("Parse Telegram: Failed, try again!"); 
+      LogTln(LOG_WARN, "Parse Telegram: Failed, try again!"); 
       telegramErrors++;
       #ifdef USE_SYSLOGGER
         sysLog.writef("Parse error\r\n%s\r\n\r\n", DSMRerror.c_str());
       #endif
-      DebugTf("Parse error\r\n%s\r\n\r\n", DSMRerror.c_str());
+      LogTf(LOG_WARN, "Parse error\r\n%s\r\n\r\n", DSMRerror.c_str());
+#ifndef USE_P1_TASK
       //--- set DTR to get a new telegram as soon as possible
-      slimmeMeter.enable(true);
+      if (!settingContinuousRead)  slimmeMeter.enable(true);
       slimmeMeter.loop();
+#endif
     }
 
-    if ( (telegramCount > 25) && (telegramCount % (2100 / (settingTelegramInterval + 1)) == 0) )
+    if ( (telegramCount > 25) && (telegramCount % (2100 / ((settingContinuousRead ? 1 : settingTelegramInterval) + 1)) == 0) )
     {
       DebugTf("Processed [%d] telegrams ([%d] errors)\r\n", telegramCount, telegramErrors);
       writeToSysLog("Processed [%d] telegrams ([%d] errors)", telegramCount, telegramErrors);
     }
     
     DebugTf("telegramCount=[%d] telegramErrors=[%d]\r\n", telegramCount, telegramErrors);    
-  } // if (slimmeMeter.available()) 
+  } // if (telegram available) 
   
 } // processSlimmeMeter()
 
@@ -0,0 +1,291 @@
+/*
+***************************************************************************
+**  Program  : histColumns, part of DSMRlogger-Next
+**  Version  : v2.3.0-rc5
+**
+**  Copyright (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See bottom of file.
+***************************************************************************
+**  The RING files only have electricity and gas (DATA_FORMAT). The other
+**  M-Bus channels (water, thermal and slave) each get a column: a file
+**  per channel and period with the same slots as the RING file
+**
+**    /RINGhours-water.csv      "YYMMDDHH;  1234.567;\n"  (COL_RECLEN)
+**
+**  A column file is only made once the meter has a value for that
+**  channel, so a new channel does not change any existing file and a
+**  question for one channel only reads its own column.
+**
+**  /api/v1/hist/channels                   channels with a history (and
+**                                          their actual reading)
+**  /api/v1/hist/<channel>/<period>[/desc]  e.g. /api/v1/hist/water/days
+*/
+
+  const histColumn histColumns[HIST_COLUMNS] = {
+                            { "water",   "m3" }
+                          , { "thermal", "GJ" }
+                          , { "slave",   "m3" }
+                        };
+
+
+//===========================================================================================
+static const char *periodName(int8_t fileType)
+{
+  switch(fileType)
+  {
+    case HOURS:   return "hours";
+    case DAYS:    return "days";
+    case MONTHS:  return "months";
+  }
+  return "";
+
+} // periodName()
+
+
+//===========================================================================================
+static uint16_t periodSlots(int8_t fileType)
+{
+  switch(fileType)
+  {
+    case HOURS:   return _NO_HOUR_SLOTS_;
+    case DAYS:    return _NO_DAY_SLOTS_;
+    case MONTHS:  return _NO_MONTH_SLOTS_;
+  }
+  return 0;
+
+} // periodSlots()
+
+
+//===========================================================================================
+int8_t histColumnByName(const char *name)
+{
+  for (uint8_t c = 0; c < HIST_COLUMNS; c++)
+  {
+    if (strcasecmp(histColumns[c].name, name) == 0) return c;
+  }
+  return -1;
+
+} // histColumnByName()
+
+
+//===========================================================================================
+static void columnFileName(char *fileName, int8_t fileType, uint8_t col)
+{
+  snprintf(fileName, COL_FILE_LEN, COL_FILE_FORMAT, periodName(fileType), histColumns[col].name);
+
+} // columnFileName()
+
+
+//===========================================================================================
+// the reading (1/1000) of this channel, false if the meter has none
+//===========================================================================================
+static bool columnFromSM(uint8_t col, int32_t &v)
+{
+  switch(col)
+  {
+    case COL_WATER:   if (!DSMRdata.water_delivered_present)   return false;
+                      v = DSMRdata.water_delivered.int_val();
+                      return true;
+    case COL_THERMAL: if (!DSMRdata.thermal_delivered_present) return false;
+                      v = DSMRdata.thermal_delivered.int_val();
+                      return true;
+    case COL_SLAVE:   if (!DSMRdata.slave_delivered_present)   return false;
+                      v = DSMRdata.slave_delivered.int_val();
+                      return true;
+  }
+  return false;
+
+} // columnFromSM()
+
+
+//===========================================================================================
+static void buildColumnRecord(char *record, const char *key, int32_t v)
+{
+  char cValue[FIXED_MAX_CHARS];
+
+  fixedToChars(cValue, v, 3, 10);
+  snprintf(record, COL_RECLEN +1, COL_FORMAT, key, cValue);
+
+} // buildColumnRecord()
+
+
+//===========================================================================================
+// header and empty slots, like createFile() does for a RING file
+//===========================================================================================
+static bool createColumnFile(const char *fileName, uint8_t col, uint16_t noSlots)
+{
+  char record[COL_RECLEN +1];
+  char header[12];
+
+  DebugTf("fileName[%s], fileRecLen[%d]\r\n", fileName, COL_RECLEN);
+
+  File dataFile = SPIFFS.open(fileName, "w");
+  if (!dataFile)
+  {
+    LogTf(LOG_ERROR, "open(%s, 'w') FAILED!!!\r\n", fileName);
+    return false;
+  }
+  snprintf(header, sizeof(header), "%.10s", histColumns[col].name);
+  for (char *c = header; *c; c++) *c = toupper(*c);
+  snprintf(record, sizeof(record), COL_FORMAT, "YYMMDDHH", header);
+  dataFile.print(record);
+
+  buildColumnRecord(record, "00000000", 0);
+  for (uint16_t r = 1; r <= noSlots; r++)
+  {
+    if (dataFile.print(record) != COL_RECLEN)
+    {
+      LogTf(LOG_ERROR, "ERROR!! recNo[%d] in [%s] not written\r\n", r, fileName);
+      dataFile.close();
+      return false;
+    }
+  }
+  dataFile.close();
+  return true;
+
+} // createColumnFile()
+
+
+//===========================================================================================
+// called with every record that goes to a RING file (same slot)
+//===========================================================================================
+void writeHistColumns(int8_t fileType, uint16_t slot)
+{
+  char    fileName[COL_FILE_LEN];
+  char    record[COL_RECLEN +1];
+  char    key[10];
+  int32_t v;
+
+  strlcpy(key, actTimestamp, 9);
+  if (!isNumericp(key, 8)) return;
+
+  for (uint8_t c = 0; c < HIST_COLUMNS; c++)
+  {
+    if (!columnFromSM(c, v)) continue;
+
+    columnFileName(fileName, fileType, c);
+    if (!SPIFFS.exists(fileName) && !createColumnFile(fileName, c, periodSlots(fileType))) continue;
+
+    File dataFile = SPIFFS.open(fileName, "r+");
+    if (!dataFile)
+    {
+      LogTf(LOG_ERROR, "Error opening [%s]\r\n", fileName);
+      continue;
+    }
+    buildColumnRecord(record, key, v);
+    // we need to add 1 to slot to skip header record!
+    dataFile.seek(((slot + 1) * COL_RECLEN), SeekSet);
+    if (dataFile.print(record) != COL_RECLEN)
+    {
+      LogTf(LOG_ERROR, "ERROR! slot[%02d] in [%s] not written\r\n", slot, fileName);
+      writeToSysLog("ERROR! slot[%02d] in [%s] not written", slot, fileName);
+    }
+    dataFile.close();
+  }
+
+} // writeHistColumns()
+
+
+//===========================================================================================
+static bool readColumnSlot(File &dataFile, uint16_t slot, char *recID, int32_t &v)
+{
+  char buffer[COL_RECLEN +1];
+
+  dataFile.seek(((slot + 1) * COL_RECLEN), SeekSet);
+  if (dataFile.read((uint8_t*)buffer, COL_RECLEN) != COL_RECLEN) return false;
+  buffer[COL_RECLEN] = '\0';
+  if (!isNumericp(buffer, 8) || buffer[8] != ';') return false;
+
+  strlcpy(recID, buffer, 9);
+  return (charsToFixed(&buffer[9], v) != NULL);
+
+} // readColumnSlot()
+
+
+//===========================================================================================
+// same order as sendJsonHist(): from the actual slot back, or (desc)
+// from the oldest slot on. Only the column file is read
+//===========================================================================================
+void sendJsonHistColumn(int8_t fileType, uint8_t col, bool desc)
+{
+  char      fileName[COL_FILE_LEN];
+  char      recID[10];
+  uint16_t  startSlot = 0, nrSlots = periodSlots(fileType);
+  int32_t   v;
+
+  if (DUE(antiWearTimer))
+  {
+    writeDataToFiles();
+    writeLastStatus();
+  }
+
+  switch(fileType)
+  {
+    case HOURS:   startSlot = timestampToHourSlot(actTimestamp,  strlen(actTimestamp));  break;
+    case DAYS:    startSlot = timestampToDaySlot(actTimestamp,   strlen(actTimestamp));  break;
+    case MONTHS:  startSlot = timestampToMonthSlot(actTimestamp, strlen(actTimestamp));  break;
+  }
+  if (desc)
+        startSlot += nrSlots +1;  // past the actual slot
+  else  startSlot += nrSlots;     // the actual slot first
+
+  columnFileName(fileName, fileType, col);
+  File dataFile = SPIFFS.open(fileName, "r");
+
+  sendStartJsonObj(periodName(fileType));
+  for (uint16_t s = 0; dataFile && s < nrSlots; s++)
+  {
+    uint16_t slot = (desc ? (startSlot + s) : (startSlot - s)) % nrSlots;
+    if (!readColumnSlot(dataFile, slot, recID, v)) continue;
+    sendJsonColumnObj(s, recID, slot, histColumns[col].name, v, histColumns[col].unit);
+  }
+  sendEndJsonObj();
+  if (dataFile) dataFile.close();
+
+} // sendJsonHistColumn()
+
+
+//===========================================================================================
+void sendJsonHistChannels()
+{
+  char    fileName[COL_FILE_LEN];
+  char    cValue[FIXED_MAX_CHARS];
+  int32_t v;
+
+  sendStartJsonObj("channels");
+  for (uint8_t c = 0; c < HIST_COLUMNS; c++)
+  {
+    columnFileName(fileName, HOURS, c);
+    if (!SPIFFS.exists(fileName)) continue;
+    if (columnFromSM(c, v))  fixedToChars(cValue, v);
+    else                     cValue[0] = '\0';
+    sendNestedJsonObj(histColumns[c].name, cValue, histColumns[c].unit);
+  }
+  sendEndJsonObj();
+
+} // sendJsonHistChannels()
+
+
+/***************************************************************************
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit
+* persons to whom the Software is furnished to do so, subject to the
+* following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT
+* OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+* THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+***************************************************************************/
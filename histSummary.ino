@@ -0,0 +1,162 @@
+/*
+***************************************************************************
+**  Program  : histSummary, part of DSMRlogger-Next
+**  Version  : v2.3.0-rc5
+**
+**  Copyright (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See bottom of file.
+***************************************************************************
+**  Usage and costs of this and the previous hour, day and month, so a
+**  client does not need the complete RING files for that.
+**
+**  For every period only the meter readings at the start of the running
+**  period and the usage of the previous period are kept. They are
+**  updated when writeDataToFiles() goes to a new slot (the reading of
+**  that moment ends the previous period and starts the new one). At boot
+**  they come from the two slots before the actual slot. Readings and
+**  usage are kept in 1/1000 (kWh, m3) so nothing is lost to float rounding.
+**
+**  /api/v1/hist/summary
+*/
+
+  static histSummary histSum[3];    // HOURS, DAYS, MONTHS
+
+
+//===========================================================================================
+void readingsFromSM(int32_t v[5])
+{
+  v[0] = DSMRdata.energy_delivered_tariff1.int_val();
+  v[1] = DSMRdata.energy_delivered_tariff2.int_val();
+  v[2] = DSMRdata.energy_returned_tariff1.int_val();
+  v[3] = DSMRdata.energy_returned_tariff2.int_val();
+#ifdef USE_PRE40_PROTOCOL
+  v[4] = DSMRdata.gas_delivered2.int_val();
+#else
+  v[4] = DSMRdata.gas_delivered.int_val();
+#endif
+
+} // readingsFromSM()
+
+
+//===========================================================================================
+// the actual readings (v) are written to slot of fileType
+//===========================================================================================
+void updateHistSummary(int8_t fileType, uint16_t slot, const int32_t v[5])
+{
+  histSummary &h = histSum[fileType - HOURS];
+
+  if (h.valid && slot == h.slot) return;
+
+  if (h.valid)
+  {
+    for (uint8_t i = 0; i < 5; i++)  h.prev[i] = v[i] - h.start[i];
+    strlcpy(h.prevId, h.id, sizeof(h.prevId));
+    h.prevValid = true;
+  }
+  memcpy(h.start, v, sizeof(h.start));
+  strlcpy(h.id, actTimestamp, sizeof(h.id));
+  h.slot  = slot;
+  h.valid = true;
+
+} // updateHistSummary()
+
+
+//===========================================================================================
+// at boot (after readLastStatus()): the running period started with the
+// reading of the slot before the actual slot
+//===========================================================================================
+void initHistSummary()
+{
+  const char *fileName[3]  = { HOURS_FILE, DAYS_FILE, MONTHS_FILE };
+  uint16_t    maxSlots[3]  = { _NO_HOUR_SLOTS_, _NO_DAY_SLOTS_, _NO_MONTH_SLOTS_ };
+  uint16_t    slot[3];
+  int32_t     before[5];
+
+  slot[0] = timestampToHourSlot(actTimestamp,  strlen(actTimestamp));
+  slot[1] = timestampToDaySlot(actTimestamp,   strlen(actTimestamp));
+  slot[2] = timestampToMonthSlot(actTimestamp, strlen(actTimestamp));
+
+  for (uint8_t t = 0; t < 3; t++)
+  {
+    histSummary &h = histSum[t];
+
+    memset(&h, 0, sizeof(h));
+    h.slot  = slot[t];
+    strlcpy(h.id, actTimestamp, sizeof(h.id));
+    h.valid = readSlotValues(t + HOURS, fileName[t], (slot[t] + maxSlots[t] -1) % maxSlots[t], h.prevId, h.start);
+    if (!h.valid) continue;
+    if (readSlotValues(t + HOURS, fileName[t], (slot[t] + maxSlots[t] -2) % maxSlots[t], NULL, before))
+    {
+      for (uint8_t i = 0; i < 5; i++)  h.prev[i] = h.start[i] - before[i];
+      h.prevValid = true;
+    }
+  }
+
+} // initHistSummary()
+
+
+//===========================================================================================
+static void sendSummary(const char *period, const char *recId, bool running, const int32_t use[5], bool withNetwCosts)
+{
+  float costsE  = ((use[0] * settingEDT1) + (use[1] * settingEDT2)
+                -  (use[2] * settingERT1) - (use[3] * settingERT2)) / 1000.0;
+  float costsG  =  (use[4] * settingGDT) / 1000.0;
+  float costsNw = withNetwCosts ? (settingENBK + settingGNBK) : 0.0;
+
+  sendJsonSummaryObj(period, recId, running, use, costsE, costsG, costsNw);
+
+} // sendSummary()
+
+
+//===========================================================================================
+void sendJsonHistSummary()
+{
+  const char *period[3] = { "hours", "days", "months" };
+  int32_t     act[5], use[5];
+
+  readingsFromSM(act);
+
+  sendStartJsonObj("summary");
+  for (uint8_t t = 0; t < 3; t++)
+  {
+    histSummary &h = histSum[t];
+    bool         isMonth = (t + HOURS == MONTHS);
+
+    if (h.valid)
+    {
+      for (uint8_t i = 0; i < 5; i++)  use[i] = act[i] - h.start[i];
+      sendSummary(period[t], h.id, true, use, isMonth);
+    }
+    if (h.prevValid)
+    {
+      sendSummary(period[t], h.prevId, false, h.prev, isMonth);
+    }
+  }
+  sendEndJsonObj();
+
+} // sendJsonHistSummary()
+
+
+/***************************************************************************
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit
+* persons to whom the Software is furnished to do so, subject to the
+* following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT
+* OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+* THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+***************************************************************************/
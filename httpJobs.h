@@ -0,0 +1,82 @@
+/*
+***************************************************************************
+**  Filename  : httpJobs.h
+**  Version  : v2.3.0-rc5
+**
+**  Copyright (c) 2020 Robert van den Breemen
+**   Based on (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See bottom of file.
+***************************************************************************
+*/
+
+/*
+ * The outbound HTTP job queue (see httpJobs.ino). A job goes through
+ *
+ *   QUEUED -> CONNECT -> RESOLVE -> CONNECTING -> SEND -> RESPONSE
+ *
+ * one step per loop(). Looking up the host and waiting for the TCP
+ * connection are polled, so no step waits for the network. Together
+ * they may take HTTP_JOB_CONNECT_MS. The non-blocking connect (a
+ * tcpConnector) is also used for the MQTT broker.
+ */
+
+#ifndef _HTTP_JOBS_H
+#define _HTTP_JOBS_H
+
+#define HTTP_JOBS_FILE       "/httpjobs.dat"
+#define HTTP_JOB_MAX             4
+#define HTTP_JOB_CHUNK         256    // bytes of the request send per loop()
+#define HTTP_JOB_CONNECT_MS   3000    // lookup + connect
+#define HTTP_JOB_RESPONSE_MS 10000
+#define HTTP_JOB_TRIES           5
+#define HTTP_JOB_BACKOFF     60000    // ms, doubles after every failed attempt
+
+enum    { HTTP_JOB_NONE, HTTP_JOB_MINDERGAS };
+enum    { HTTP_JOB_QUEUED, HTTP_JOB_CONNECT, HTTP_JOB_RESOLVE, HTTP_JOB_CONNECTING
+        , HTTP_JOB_SEND, HTTP_JOB_RESPONSE };
+
+typedef struct {
+    uint8_t   kind;         // HTTP_JOB_NONE = free slot
+    uint8_t   state;
+    uint8_t   attempts;
+    uint32_t  nextTry;      // millis()
+} httpJob;                  // one outbound HTTP request (see httpJobs)
+
+typedef struct {
+    volatile int8_t state = 0;      // 0 busy, 1 connected, -1 failed
+#if defined(ESP8266)
+    struct tcp_pcb *pcb   = NULL;
+#elif defined(ESP32)
+    int       socket      = -1;
+#else
+    uint32_t  ip          = 0;
+    uint16_t  port        = 0;
+#endif
+} tcpConnector;             // a TCP connection that is opened without blocking (see tcpConnectStart())
+
+#endif // _HTTP_JOBS_H
+
+
+/***************************************************************************
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit
+* persons to whom the Software is furnished to do so, subject to the
+* following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT
+* OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+* THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+***************************************************************************/
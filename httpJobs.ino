@@ -0,0 +1,541 @@
+/*
+***************************************************************************
+**  Program  : httpJobs, part of DSMRlogger-Next
+**  Version  : v2.3.0-rc5
+**
+**  Copyright (c) 2020 Robert van den Breemen
+**   Based on (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See bottom of file.
+***************************************************************************
+**  Outbound HTTP job queue. A job is a complete HTTP request in a file on
+**  SPIFFS. handleHttpJobs() is called every loop() and does one small step
+**  per call: start or check the lookup of the host, start or check the
+**  connection, send HTTP_JOB_CHUNK bytes of the request (streamed from the
+**  file) or read what the server has answered so far. Nothing waits for
+**  the network: DNS is asked with dns_gethostbyname() (answer by callback)
+**  and the TCP connection is opened without blocking (a raw lwIP tcp_pcb
+**  on the ESP8266, a non-blocking socket on the ESP32).
+**  A failed job is tried again later (backoff), the queue itself is kept
+**  in HTTP_JOBS_FILE so it survives a reboot. When a job is done (or
+**  given up) the client is told by httpJobDone(), dispatched on the kind.
+*/
+
+  static httpJob      httpJobs[HTTP_JOB_MAX];
+  static bool         httpJobsRead    = false;
+  static int8_t       httpJobActive   = -1;     // only one job at a time
+  static WiFiClient   httpJobClient;
+  static File         httpJobFile;
+  static char         httpJobLine[40];          // (first) response line
+  static uint8_t      httpJobLineLen  = 0;
+  static uint32_t     httpJobDeadline = 0;
+  static uint32_t     httpJobStarted  = 0;      // millis() the lookup was started
+  static uint8_t      httpJobSeq      = 0;      // a late DNS answer is for an earlier attempt
+  static volatile int8_t    httpJobDNSstate = 0;  // 0 busy, 1 found, -1 failed
+  static volatile uint32_t  httpJobAddr     = 0;
+  static tcpConnector httpJobTcp;
+#if defined(ESP8266)
+  //-- WiFiClient(ClientContext*) is protected (used by WiFiServer) --
+  class tcpWiFiClient : public WiFiClient {
+    public:
+      tcpWiFiClient(ClientContext *ctx) : WiFiClient(ctx) { }
+  };
+#endif
+
+
+//===========================================================================================
+// host, port and request file of every kind of job
+//===========================================================================================
+bool httpJobTarget(uint8_t kind, const char **host, uint16_t *port, const char **fName)
+{
+  switch(kind)
+  {
+#ifdef USE_MINDERGAS
+    case HTTP_JOB_MINDERGAS:  *host = "www.mindergas.nl"; *port = 80; *fName = MG_FILENAME;
+                              return true;
+#endif
+    default:                  return false;
+  }
+
+} // httpJobTarget()
+
+
+//===========================================================================================
+// tell the client the job is done. After HTTP_JOB_TRIES failed attempts httpCode is the
+// last answer (5xx, 429) or < 0 if there was none
+//===========================================================================================
+void httpJobDone(uint8_t kind, int16_t httpCode)
+{
+  switch(kind)
+  {
+#ifdef USE_MINDERGAS
+    case HTTP_JOB_MINDERGAS:  mindergasJobDone(httpCode);
+                              break;
+#endif
+    default:                  DebugTf("httpJob kind [%d] done [%d]\r\n", kind, httpCode);
+                              break;
+  }
+
+} // httpJobDone()
+
+
+//===========================================================================================
+void writeHttpJobs()
+{
+  File fh = SPIFFS.open(HTTP_JOBS_FILE, "w");
+  if (!fh)
+  {
+    LogTf(LOG_ERROR, "Error writing [%s]\r\n", HTTP_JOBS_FILE);
+    return;
+  }
+  fh.write((const uint8_t*)httpJobs, sizeof(httpJobs));
+  fh.close();
+
+} // writeHttpJobs()
+
+
+//===========================================================================================
+void readHttpJobs()
+{
+  httpJobsRead = true;
+  memset(httpJobs, 0, sizeof(httpJobs));
+
+  File fh = SPIFFS.open(HTTP_JOBS_FILE, "r");
+  if (!fh) return;
+  if (fh.size() == sizeof(httpJobs))
+  {
+    fh.read((uint8_t*)httpJobs, sizeof(httpJobs));
+  }
+  fh.close();
+
+  //-- after a reboot everything starts again (the request is still in its file) --
+  for (uint8_t j = 0; j < HTTP_JOB_MAX; j++)
+  {
+    if (httpJobs[j].kind == HTTP_JOB_NONE) continue;
+    httpJobs[j].state   = HTTP_JOB_QUEUED;
+    httpJobs[j].nextTry = millis();
+    DebugTf("httpJob[%d] kind [%d] attempts [%d] is queued\r\n", j, httpJobs[j].kind, httpJobs[j].attempts);
+  }
+
+} // readHttpJobs()
+
+
+//===========================================================================================
+// add a job, the request must already be written to its file
+//===========================================================================================
+bool queueHttpJob(uint8_t kind)
+{
+  int8_t freeSlot = -1;
+
+  if (!httpJobsRead) readHttpJobs();
+
+  for (uint8_t j = 0; j < HTTP_JOB_MAX; j++)
+  {
+    if (httpJobs[j].kind == kind)           return true;  // already queued
+    if (httpJobs[j].kind == HTTP_JOB_NONE && freeSlot < 0)  freeSlot = j;
+  }
+  if (freeSlot < 0)
+  {
+    DebugTf("no room for httpJob kind [%d]\r\n", kind);
+    return false;
+  }
+  httpJobs[freeSlot].kind     = kind;
+  httpJobs[freeSlot].state    = HTTP_JOB_QUEUED;
+  httpJobs[freeSlot].attempts = 0;
+  httpJobs[freeSlot].nextTry  = millis();
+  writeHttpJobs();
+  return true;
+
+} // queueHttpJob()
+
+
+//===========================================================================================
+// called by lwIP with the address of the host
+//===========================================================================================
+void httpJobDNSfound(const char *name, const ip_addr_t *ipaddr, void *arg)
+{
+  if ((uint8_t)(uintptr_t)arg != httpJobSeq) return;
+  if (ipaddr != NULL)
+  {
+    httpJobAddr     = ip4_addr_get_u32(ip_2_ip4(ipaddr));
+    httpJobDNSstate = 1;
+  }
+  else httpJobDNSstate = -1;
+
+} // httpJobDNSfound()
+
+
+#if defined(ESP8266)
+//===========================================================================================
+// non-blocking connect, ESP8266: a raw tcp_pcb that is handed to a WiFiClient once
+// it is connected (like WiFiServer does with an accepted connection)
+//===========================================================================================
+err_t tcpConnectConnected(void *arg, struct tcp_pcb *pcb, err_t err)
+{
+  ((tcpConnector *)arg)->state = 1;
+  return ERR_OK;
+
+} // tcpConnectConnected()
+
+//---------------------------------------------------------------
+void tcpConnectError(void *arg, err_t err)
+{
+  ((tcpConnector *)arg)->pcb   = NULL;     // already freed by lwIP
+  ((tcpConnector *)arg)->state = -1;
+
+} // tcpConnectError()
+
+//---------------------------------------------------------------
+void tcpConnectAbort(tcpConnector &c)
+{
+  if (c.pcb == NULL) return;
+  tcp_arg(c.pcb, NULL);
+  tcp_err(c.pcb, NULL);
+  tcp_abort(c.pcb);
+  c.pcb = NULL;
+
+} // tcpConnectAbort()
+
+//---------------------------------------------------------------
+bool tcpConnectStart(tcpConnector &c, uint32_t ip, uint16_t port)
+{
+  ip_addr_t addr;
+
+  tcpConnectAbort(c);
+  ip_addr_set_ip4_u32(&addr, ip);
+  c.state = 0;
+  c.pcb   = tcp_new();
+  if (c.pcb == NULL) return false;
+  tcp_arg(c.pcb, &c);
+  tcp_err(c.pcb, tcpConnectError);
+  if (tcp_connect(c.pcb, &addr, port, tcpConnectConnected) != ERR_OK)
+  {
+    tcpConnectAbort(c);
+    return false;
+  }
+  return true;
+
+} // tcpConnectStart()
+
+//---------------------------------------------------------------
+// 1: connected (client can be used), 0: not yet, -1: failed
+int8_t tcpConnectPoll(tcpConnector &c, WiFiClient &client)
+{
+  if (c.state != 1 || c.pcb == NULL) return (c.state == 1 ? -1 : c.state);
+
+  tcp_err(c.pcb, NULL);               // from now on ClientContext handles it
+  client = tcpWiFiClient(new ClientContext(c.pcb, NULL, NULL));
+  c.pcb  = NULL;
+  return 1;
+
+} // tcpConnectPoll()
+
+#elif defined(ESP32)
+//===========================================================================================
+// non-blocking connect, ESP32: a non-blocking socket, checked with select() and then
+// given to a WiFiClient
+//===========================================================================================
+void tcpConnectAbort(tcpConnector &c)
+{
+  if (c.socket < 0) return;
+  lwip_close(c.socket);
+  c.socket = -1;
+
+} // tcpConnectAbort()
+
+//---------------------------------------------------------------
+bool tcpConnectStart(tcpConnector &c, uint32_t ip, uint16_t port)
+{
+  struct sockaddr_in addr;
+
+  tcpConnectAbort(c);
+  c.socket = lwip_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (c.socket < 0) return false;
+  fcntl(c.socket, F_SETFL, fcntl(c.socket, F_GETFL, 0) | O_NONBLOCK);
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family      = AF_INET;
+  addr.sin_addr.s_addr = ip;
+  addr.sin_port        = htons(port);
+  if (lwip_connect(c.socket, (struct sockaddr *)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS)
+  {
+    tcpConnectAbort(c);
+    return false;
+  }
+  return true;
+
+} // tcpConnectStart()
+
+//---------------------------------------------------------------
+// 1: connected (client can be used), 0: not yet, -1: failed
+int8_t tcpConnectPoll(tcpConnector &c, WiFiClient &client)
+{
+  fd_set          fdset;
+  struct timeval  tv = { 0, 0 };
+  int             sockErr = 0;
+  socklen_t       errLen  = sizeof(sockErr);
+
+  if (c.socket < 0) return -1;
+  FD_ZERO(&fdset);
+  FD_SET(c.socket, &fdset);
+  int res = select(c.socket +1, NULL, &fdset, NULL, &tv);
+  if (res == 0) return 0;
+  if (res < 0 || getsockopt(c.socket, SOL_SOCKET, SO_ERROR, &sockErr, &errLen) < 0 || sockErr != 0)
+  {
+    tcpConnectAbort(c);
+    return -1;
+  }
+  fcntl(c.socket, F_SETFL, fcntl(c.socket, F_GETFL, 0) & ~O_NONBLOCK);
+  client   = WiFiClient(c.socket);
+  c.socket = -1;
+  return 1;
+
+} // tcpConnectPoll()
+
+#else
+//===========================================================================================
+// other platforms (the host tests): WiFiClient.connect() on the first poll
+//===========================================================================================
+void   tcpConnectAbort(tcpConnector &c)                                 { c.ip = 0; }
+bool   tcpConnectStart(tcpConnector &c, uint32_t ip, uint16_t port)    { c.ip = ip; c.port = port; return true; }
+int8_t tcpConnectPoll(tcpConnector &c, WiFiClient &client)
+{
+  if (c.ip == 0) return -1;
+  bool ok = client.connect(IPAddress(c.ip), c.port);
+  c.ip = 0;
+  return (ok ? 1 : -1);
+
+} // tcpConnectPoll()
+#endif
+
+
+//===========================================================================================
+// an answer that is final: 2xx, or a 4xx the server will give again (not 429, too many
+// requests). A 5xx, 429 (or anything else) is tried again later, like no answer at all
+//===========================================================================================
+bool httpJobFinal(int16_t httpCode)
+{
+  if (httpCode >= 200 && httpCode < 300)  return true;
+  if (httpCode >= 400 && httpCode < 500)  return (httpCode != 429);
+  return false;
+
+} // httpJobFinal()
+
+
+//===========================================================================================
+// the active job is finished: close everything and either remove it or try later
+//===========================================================================================
+void endHttpJob(int16_t httpCode)
+{
+  httpJob &job = httpJobs[httpJobActive];
+  uint8_t  kind = job.kind;
+  uint32_t backoff;
+
+  tcpConnectAbort(httpJobTcp);
+  httpJobClient.stop();
+  if (httpJobFile) httpJobFile.close();
+  httpJobActive = -1;
+  httpJobSeq++;                   // ignore the DNS answer if it still comes
+
+  if (httpJobFinal(httpCode) || ++job.attempts >= HTTP_JOB_TRIES)
+  {
+    memset(&job, 0, sizeof(job));
+    writeHttpJobs();
+    httpJobDone(kind, (httpCode > 0 ? httpCode : -1));    // the last answer, if there was one
+    return;
+  }
+
+  //-- backoff: HTTP_JOB_BACKOFF, doubled every attempt, +/- 25% jitter --
+  backoff     = (uint32_t)HTTP_JOB_BACKOFF << (job.attempts -1);
+  backoff     = backoff - (backoff / 4) + random(backoff / 2);
+  job.state   = HTTP_JOB_QUEUED;
+  job.nextTry = millis() + backoff;
+  writeHttpJobs();
+  LogTf(LOG_WARN, "httpJob kind [%d] failed [%d], try[%d] in [%d] seconds\r\n", kind, httpCode, job.attempts, (backoff / 1000));
+  writeToSysLog("httpJob kind [%d] failed [%d], try[%d] in [%d] seconds", kind, httpCode, job.attempts, (backoff / 1000));
+
+} // endHttpJob()
+
+
+//===========================================================================================
+// called every loop(), one small step per call
+//===========================================================================================
+void handleHttpJobs()
+{
+  const char *host;
+  const char *fName;
+  uint16_t    port;
+  ip_addr_t   addr;
+  int8_t      tcpState;
+  uint8_t     buff[HTTP_JOB_CHUNK];
+
+  if (!httpJobsRead) readHttpJobs();
+
+  //-- nothing to do: find the next job that is due --
+  if (httpJobActive < 0)
+  {
+    if (memShed(MEM_CRITICAL)) return;
+    for (uint8_t j = 0; j < HTTP_JOB_MAX; j++)
+    {
+      if (httpJobs[j].kind == HTTP_JOB_NONE) continue;
+      if ((int32_t)(millis() - httpJobs[j].nextTry) < 0) continue;
+      httpJobActive = j;
+      httpJobs[j].state = HTTP_JOB_CONNECT;
+      break;
+    }
+    if (httpJobActive < 0) return;
+  }
+
+  httpJob &job = httpJobs[httpJobActive];
+  if (!httpJobTarget(job.kind, &host, &port, &fName))
+  {
+    DebugTf("unknown httpJob kind [%d] -> removed\r\n", job.kind);
+    memset(&job, 0, sizeof(job));
+    httpJobActive = -1;
+    writeHttpJobs();
+    return;
+  }
+
+  switch(job.state)
+  {
+    case HTTP_JOB_CONNECT:
+          httpJobFile = SPIFFS.open(fName, "r");
+          if (!httpJobFile)
+          {
+            DebugTf("httpJob: [%s] not found -> removed\r\n", fName);
+            job.attempts = HTTP_JOB_TRIES;
+            endHttpJob(-1);
+            break;
+          }
+          DebugTf("httpJob: lookup [%s] ..\r\n", host);
+          httpJobStarted  = millis();
+          httpJobDNSstate = 0;
+          switch(dns_gethostbyname(host, &addr, httpJobDNSfound, (void *)(uintptr_t)httpJobSeq))
+          {
+            case ERR_OK:          httpJobAddr     = ip4_addr_get_u32(ip_2_ip4(&addr));  // cached by lwIP
+                                  httpJobDNSstate = 1;
+                                  job.state       = HTTP_JOB_RESOLVE;
+                                  break;
+            case ERR_INPROGRESS:  job.state       = HTTP_JOB_RESOLVE;
+                                  break;
+            default:              LogTf(LOG_WARN, "httpJob: lookup [%s] failed\r\n", host);
+                                  endHttpJob(-1);
+                                  break;
+          }
+          break;
+
+    case HTTP_JOB_RESOLVE:
+          if (httpJobDNSstate == 0)
+          {
+            if ((millis() - httpJobStarted) < HTTP_JOB_CONNECT_MS) break;
+            DebugTf("httpJob: lookup [%s] timed out\r\n", host);
+            endHttpJob(-1);
+            break;
+          }
+          if (httpJobDNSstate < 0)
+          {
+            LogTf(LOG_WARN, "httpJob: [%s] not found (ERROR!)\r\n", host);
+            endHttpJob(-1);
+            break;
+          }
+          DebugTf("httpJob: connect to [%s]:[%d] ..\r\n", host, port);
+          if (!tcpConnectStart(httpJobTcp, httpJobAddr, port))
+          {
+            LogTln(LOG_WARN, F("httpJob: not connected (ERROR!)"));
+            endHttpJob(-1);
+            break;
+          }
+          job.state = HTTP_JOB_CONNECTING;
+          break;
+
+    case HTTP_JOB_CONNECTING:
+          tcpState = tcpConnectPoll(httpJobTcp, httpJobClient);
+          if (tcpState > 0)
+          {
+            job.state = HTTP_JOB_SEND;
+            break;
+          }
+          if (tcpState == 0 && (millis() - httpJobStarted) < HTTP_JOB_CONNECT_MS) break;
+          LogTln(LOG_WARN, F("httpJob: not connected (ERROR!)"));
+          endHttpJob(-1);
+          break;
+
+    case HTTP_JOB_SEND:
+          if (!httpJobClient.connected())
+          {
+            DebugTln(F("httpJob: connection lost while sending"));
+            endHttpJob(-1);
+            break;
+          }
+          if (httpJobFile.available())
+          {
+            size_t len = httpJobFile.read(buff, sizeof(buff));
+            if (httpJobClient.write(buff, len) != len)
+            {
+              LogTln(LOG_WARN, F("httpJob: write error"));
+              endHttpJob(-1);
+            }
+            break;
+          }
+          httpJobFile.close();
+          httpJobLineLen  = 0;
+          httpJobDeadline = millis() + HTTP_JOB_RESPONSE_MS;
+          job.state       = HTTP_JOB_RESPONSE;
+          break;
+
+    case HTTP_JOB_RESPONSE:
+          //-- only the status line ("HTTP/1.1 201 Created") is needed --
+          while (httpJobClient.available())
+          {
+            char c = httpJobClient.read();
+            if (c != '\n')
+            {
+              if (c != '\r' && httpJobLineLen < (sizeof(httpJobLine) -1)) httpJobLine[httpJobLineLen++] = c;
+              continue;
+            }
+            httpJobLine[httpJobLineLen] = '\0';
+            httpJobLineLen = 0;
+            if (strncmp(httpJobLine, "HTTP/1.", 7) == 0 && strlen(httpJobLine) > 9)
+            {
+              DebugTf("httpJob: response [%s]\r\n", httpJobLine);
+              endHttpJob(atoi(&httpJobLine[9]));
+              return;
+            }
+          }
+          if (!httpJobClient.connected() || (int32_t)(millis() - httpJobDeadline) > 0)
+          {
+            DebugTln(F("httpJob: no (complete) response"));
+            endHttpJob(-1);
+          }
+          break;
+
+    default:
+          job.state = HTTP_JOB_CONNECT;
+          break;
+  }
+
+} // handleHttpJobs()
+
+
+/***************************************************************************
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit
+* persons to whom the Software is furnished to do so, subject to the
+* following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT
+* OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+* THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+***************************************************************************/
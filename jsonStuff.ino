@@ -35,20 +35,98 @@ void sendEndJsonObj()
 } // sendEndJsonObj()
 
 //=======================================================================
-void sendNestedJsonObj(uint8_t recNr, const char *recID, uint8_t slot, float EDT1, float EDT2, float ERT1, float ERT2, float GDT)
+void sendNestedJsonObj(uint8_t recNr, const char *recID, uint8_t slot, const int32_t v[5])
 {
   char jsonBuff[200] = "";
-  
+  char cValue[5][FIXED_MAX_CHARS];
+
+  for (uint8_t i = 0; i < 5; i++)  fixedToChars(cValue[i], v[i]);
   snprintf(jsonBuff, sizeof(jsonBuff), "%s{\"recnr\": %d, \"recid\": \"%s\", \"slot\": %d,"
-                          "\"edt1\": %.3f, \"edt2\": %.3f,"
-                          "\"ert1\": %.3f, \"ert2\": %.3f,"
-                          "\"gdt\": %.3f}"
-                                      , objSprtr, recNr, recID, slot, EDT1, EDT2, ERT1, ERT2, GDT);
+                          "\"edt1\": %s, \"edt2\": %s,"
+                          "\"ert1\": %s, \"ert2\": %s,"
+                          "\"gdt\": %s}"
+                                      , objSprtr, recNr, recID, slot
+                                      , cValue[0], cValue[1], cValue[2], cValue[3], cValue[4]);
+
+  httpServer.sendContent(jsonBuff);
+  sprintf(objSprtr, ",\r\n");
+
+} // sendNestedJsonObj(int, *char, int, int[5])
+
+
+//=======================================================================
+void sendJsonColumnObj(uint8_t recNr, const char *recID, uint8_t slot, const char *cName, int32_t v, const char *cUnit)
+{
+  char jsonBuff[JSON_BUFF_MAX] = "";
+  char cValue[FIXED_MAX_CHARS];
+
+  fixedToChars(cValue, v);
+  snprintf(jsonBuff, sizeof(jsonBuff), "%s{\"recnr\": %d, \"recid\": \"%s\", \"slot\": %d, \"%s\": %s, \"unit\": \"%s\"}"
+                                      , objSprtr, recNr, recID, slot, cName, cValue, cUnit);
 
   httpServer.sendContent(jsonBuff);
   sprintf(objSprtr, ",\r\n");
 
-} // sendNestedJsonObj(int, *char, int, float, float, float, float, float)
+} // sendJsonColumnObj()
+
+
+//=======================================================================
+void sendJsonSummaryObj(const char *period, const char *recID, bool running, const int32_t use[5]
+                      , float costsE, float costsG, float costsNw)
+{
+  char jsonBuff[250] = "";
+  char pED[FIXED_MAX_CHARS], pER[FIXED_MAX_CHARS], pGD[FIXED_MAX_CHARS];
+
+  fixedToChars(pED, (use[0] + use[1]));
+  fixedToChars(pER, (use[2] + use[3]));
+  fixedToChars(pGD, use[4]);
+  snprintf(jsonBuff, sizeof(jsonBuff), "%s{\"period\": \"%s\", \"recid\": \"%s\", \"running\": %s,"
+                          "\"p_ed\": %s, \"p_er\": %s, \"p_gd\": %s,"
+                          "\"costs_e\": %.2f, \"costs_g\": %.2f, \"costs_nw\": %.2f, \"costs_tt\": %.2f}"
+                                      , objSprtr, period, recID, running ? "true" : "false"
+                                      , pED, pER, pGD
+                                      , costsE, costsG, costsNw, (costsE + costsG + costsNw));
+
+  httpServer.sendContent(jsonBuff);
+  sprintf(objSprtr, ",\r\n");
+
+} // sendJsonSummaryObj()
+
+
+//=======================================================================
+void sendJsonPqStatObj(const char *period, bool running, uint8_t phase, const char *quantity
+                     , const char *unit, const pqStat &st, float stddev)
+{
+  char jsonBuff[250] = "";
+  
+  snprintf(jsonBuff, sizeof(jsonBuff), "%s{\"period\": \"%s\", \"running\": %s, \"phase\": %d,"
+                          "\"quantity\": \"%s\", \"unit\": \"%s\", \"samples\": %u,"
+                          "\"min\": %.3f, \"max\": %.3f, \"mean\": %.3f, \"stddev\": %.3f}"
+                                      , objSprtr, period, running ? "true" : "false", phase
+                                      , quantity, unit, st.n, st.min, st.max, st.mean, stddev);
+
+  httpServer.sendContent(jsonBuff);
+  sprintf(objSprtr, ",\r\n");
+
+} // sendJsonPqStatObj()
+
+
+//=======================================================================
+void sendJsonPqEventObj(const pqEvent &ev, const char *type)
+{
+  char jsonBuff[200] = "";
+  char start[14], end[14] = "";
+
+  epochToTimestamp(ev.start, start, sizeof(start));
+  if (ev.end != 0)  epochToTimestamp(ev.end, end, sizeof(end));
+  snprintf(jsonBuff, sizeof(jsonBuff), "%s{\"seq\": %u, \"type\": \"%s\", \"phase\": %d,"
+                          "\"start\": \"%s\", \"end\": \"%s\", \"extreme\": %.3f}"
+                                      , objSprtr, ev.seq, type, ev.phase, start, end, ev.extreme);
+
+  httpServer.sendContent(jsonBuff);
+  sprintf(objSprtr, ",\r\n");
+
+} // sendJsonPqEventObj()
 
 
 //=======================================================================
@@ -83,7 +161,7 @@ void sendNestedJsonObj(const char *cName, const char *cValue)
 
 
 //=======================================================================
-void sendNestedJsonObj(const char *cName, String sValue, const char *cUnit)
+void sendNestedJsonObj(const char *cName, const String &sValue, const char *cUnit)
 {
   char jsonBuff[JSON_BUFF_MAX] = "";
   
@@ -92,15 +170,17 @@ void sendNestedJsonObj(const char *cName, String sValue, const char *cUnit)
     DebugTf("[2] sValue.length() [%d]\r\n", sValue.length());
   }
   
+  //-- cut off a too long value, but keep the JSON valid --
+  int maxLen = JSON_BUFF_MAX - (strlen(cName) + strlen(cUnit) + 40);
   if (strlen(cUnit) == 0)
   {
-    snprintf(jsonBuff, sizeof(jsonBuff), "%s{\"name\": \"%s\", \"value\": \"%s\"}"
-                                      , objSprtr, cName, sValue.c_str());
+    snprintf(jsonBuff, sizeof(jsonBuff), "%s{\"name\": \"%s\", \"value\": \"%.*s\"}"
+                                      , objSprtr, cName, maxLen, sValue.c_str());
   }
   else
   {
-    snprintf(jsonBuff, sizeof(jsonBuff), "%s{\"name\": \"%s\", \"value\": \"%s\", \"unit\": \"%s\"}"
-                                      , objSprtr, cName, sValue.c_str(), cUnit);
+    snprintf(jsonBuff, sizeof(jsonBuff), "%s{\"name\": \"%s\", \"value\": \"%.*s\", \"unit\": \"%s\"}"
+                                      , objSprtr, cName, maxLen, sValue.c_str(), cUnit);
   }
 
   httpServer.sendContent(jsonBuff);
@@ -109,18 +189,11 @@ void sendNestedJsonObj(const char *cName, String sValue, const char *cUnit)
 } // sendNestedJsonObj(*char, String, *char)
 
 //---------------------------------------------------------------
-void sendNestedJsonObj(const char *cName, String sValue)
+void sendNestedJsonObj(const char *cName, const String &sValue)
 {
   char noUnit[] = {'\0'};
 
-  if (sValue.length() > (JSON_BUFF_MAX - 60) )
-  {
-    sendNestedJsonObj(cName, sValue.substring(0,(JSON_BUFF_MAX - (strlen(cName) + 30))), noUnit);
-  }
-  else
-  {
-    sendNestedJsonObj(cName, sValue, noUnit);
-  }
+  sendNestedJsonObj(cName, sValue, noUnit);
   
 } // sendNestedJsonObj(*char, String)
 
@@ -218,6 +291,39 @@ void sendNestedJsonObj(const char *cName, float fValue)
 } // sendNestedJsonObj(*char, float)
 
 
+//=======================================================================
+void sendNestedJsonObj(const char *cName, FixedValue &xValue, const char *cUnit)
+{
+  char jsonBuff[200] = "";
+  char cValue[FIXED_MAX_CHARS];
+
+  fixedToChars(cValue, (int32_t)xValue.int_val());
+  if (strlen(cUnit) == 0)
+  {
+    snprintf(jsonBuff, sizeof(jsonBuff), "%s{\"name\": \"%s\", \"value\": %s}"
+                                      , objSprtr, cName, cValue);
+  }
+  else
+  {
+    snprintf(jsonBuff, sizeof(jsonBuff), "%s{\"name\": \"%s\", \"value\": %s, \"unit\": \"%s\"}"
+                                      , objSprtr, cName, cValue, cUnit);
+  }
+
+  httpServer.sendContent(jsonBuff);
+  sprintf(objSprtr, ",\r\n");
+
+} // sendNestedJsonObj(*char, FixedValue, *char)
+
+//---------------------------------------------------------------
+void sendNestedJsonObj(const char *cName, FixedValue &xValue)
+{
+  char noUnit[] = {'\0'};
+
+  sendNestedJsonObj(cName, xValue, noUnit);
+  
+} // sendNestedJsonObj(*char, FixedValue)
+
+
 //=======================================================================
 //----- v0 api ----------------------------------------------------------
 //=======================================================================
@@ -246,6 +352,21 @@ void sendNestedJsonV0Obj(const char *cName, float fValue)
   
 } // sendNestedJsonV0Obj(*char, float)
 
+//---------------------------------------------------------------
+void sendNestedJsonV0Obj(const char *cName, FixedValue &xValue)
+{
+  char jsonBuff[200] = "";
+  char cValue[FIXED_MAX_CHARS];
+
+  fixedToChars(cValue, (int32_t)xValue.int_val());
+  snprintf(jsonBuff, sizeof(jsonBuff), "%s \"%s\": %s"
+                                      , objSprtr, cName, cValue);
+
+  httpServer.sendContent(jsonBuff);
+  sprintf(objSprtr, ",\r\n");
+  
+} // sendNestedJsonV0Obj(*char, FixedValue)
+
 //---------------------------------------------------------------
 void sendNestedJsonV0Obj(const char *cName, int32_t iValue)
 {
@@ -260,13 +381,13 @@ void sendNestedJsonV0Obj(const char *cName, int32_t iValue)
 } // sendNestedV0Obj(*char, int)
 
 //---------------------------------------------------------------
-void sendNestedJsonV0Obj(const char *cName, String sValue)
+void sendNestedJsonV0Obj(const char *cName, const String &sValue)
 {
   char jsonBuff[200] = "";
   
-  snprintf(jsonBuff, sizeof(jsonBuff), "%s \"%s\": \"%s\""
+  snprintf(jsonBuff, sizeof(jsonBuff), "%s \"%s\": \"%.*s\""
                                       , objSprtr, cName
-                                      , sValue.substring(0,(150 - (strlen(cName)))).c_str());
+                                      , (int)(150 - strlen(cName)), sValue.c_str());
 
   httpServer.sendContent(jsonBuff);
   sprintf(objSprtr, ",\r\n");
@@ -348,6 +469,94 @@ void sendJsonSettingObj(const char *cName, const char *cValue, const char *sType
 } // sendJsonSettingObj(*char, *char, *char, int, int)
 
 
+//=======================================================================
+void sendJsonTaskObj(const schedTask &task)
+{
+  char jsonBuff[250] = "";
+
+  snprintf(jsonBuff, sizeof(jsonBuff), "%s{\"name\": \"%s\", \"prio\": %d, \"interval\": %lu, \"runs\": %lu"
+                                       ", \"avg_us\": %lu, \"max_us\": %lu, \"late_ms\": %lu, \"max_late_ms\": %lu}"
+                                      , objSprtr, task.name, task.prio, (unsigned long)*task.interval
+                                      , (unsigned long)task.runs
+                                      , (unsigned long)(task.runs > 0 ? (task.totalUs / task.runs) : 0)
+                                      , (unsigned long)task.maxUs
+                                      , (unsigned long)task.lastLateMs, (unsigned long)task.maxLateMs);
+
+  httpServer.sendContent(jsonBuff);
+  sprintf(objSprtr, ",\r\n");
+
+} // sendJsonTaskObj()
+
+
+//=======================================================================
+void sendJsonStageObj(const telegramStage &stage)
+{
+  char jsonBuff[250] = "";
+
+  snprintf(jsonBuff, sizeof(jsonBuff), "%s{\"name\": \"%s\", \"budget_ms\": %u, \"runs\": %lu"
+                                       ", \"avg_us\": %lu, \"max_us\": %lu, \"overruns\": %lu, \"deferred\": %lu}"
+                                      , objSprtr, stage.name, stage.budgetMs
+                                      , (unsigned long)stage.runs
+                                      , (unsigned long)(stage.runs > 0 ? (stage.totalUs / stage.runs) : 0)
+                                      , (unsigned long)stage.maxUs
+                                      , (unsigned long)stage.overruns, (unsigned long)stage.deferred);
+
+  httpServer.sendContent(jsonBuff);
+  sprintf(objSprtr, ",\r\n");
+
+} // sendJsonStageObj()
+
+
+//=======================================================================
+void sendJsonLogObj(uint32_t seq, const logRecord &rec)
+{
+  char    logText[200];
+  char    jsonBuff[400] = "";
+  size_t  l;
+
+  _logFormat(rec, logText, sizeof(logText));
+
+  l = snprintf(jsonBuff, sizeof(jsonBuff), "%s{\"seq\": %lu, \"time\": \"%02d:%02d:%02d\", \"level\": %d"
+                                           ", \"module\": \"%.*s\", \"function\": \"%s\", \"line\": %d"
+                                           ", \"truncated\": %s, \"text\": \""
+                                      , objSprtr, (unsigned long)seq
+                                      , hour(rec.time), minute(rec.time), second(rec.time)
+                                      , rec.site->level
+                                      , (rec.module < logNrModules ? logModules[rec.module].len : 1)
+                                      , (rec.module < logNrModules ? logModules[rec.module].name : "?")
+                                      , rec.site->func, rec.site->line
+                                      , (rec.truncated ? "true" : "false"));
+  //-- escape the text, leave out the line endings --
+  for (char *c = logText; *c && l < (sizeof(jsonBuff) -4); c++)
+  {
+    if (*c == '\r' || *c == '\n')         continue;
+    if (*c == '"' || *c == '\\')          jsonBuff[l++] = '\\';
+    jsonBuff[l++] = ((uint8_t)*c < ' ') ? ' ' : *c;
+  }
+  jsonBuff[l++] = '"';
+  jsonBuff[l++] = '}';
+  jsonBuff[l]   = '\0';
+
+  httpServer.sendContent(jsonBuff);
+  sprintf(objSprtr, ",\r\n");
+
+} // sendJsonLogObj()
+
+
+//=======================================================================
+void sendJsonLogLevelObj(const logModule &module)
+{
+  char jsonBuff[100] = "";
+
+  snprintf(jsonBuff, sizeof(jsonBuff), "%s{\"module\": \"%.*s\", \"level\": %d}"
+                                      , objSprtr, module.len, module.name, module.level);
+
+  httpServer.sendContent(jsonBuff);
+  sprintf(objSprtr, ",\r\n");
+
+} // sendJsonLogLevelObj()
+
+
 
 //=========================================================================
 // function to build MQTT Json string ** max message size is 128 bytes!! **
@@ -493,6 +702,35 @@ void createMQTTjsonMessage(char *mqttBuff, const char *cName, float fValue)
 } // createMQTTjsonMessage(char *mqttBuff, *char, float)
 
 
+//=======================================================================
+void createMQTTjsonMessage(char *mqttBuff, const char *cName, FixedValue &xValue, const char *cUnit)
+{
+  char cValue[FIXED_MAX_CHARS];
+
+  fixedToChars(cValue, (int32_t)xValue.int_val());
+  if (strlen(cUnit) == 0)
+  {
+    snprintf(mqttBuff, MQTT_BUFF_MAX, "{\"%s\": {\"value\": %s}}"
+                                      , cName, cValue);
+  }
+  else
+  {
+    snprintf(mqttBuff, MQTT_BUFF_MAX, "{\"%s\": {\"value\": %s, \"unit\": \"%s\"}}"
+                                      , cName, cValue, cUnit);
+  }
+
+} // createMQTTjsonMessage(*char, FixedValue, *char)
+
+//---------------------------------------------------------------
+void createMQTTjsonMessage(char *mqttBuff, const char *cName, FixedValue &xValue)
+{
+  char noUnit[] = {'\0'};
+
+  createMQTTjsonMessage(mqttBuff, cName, xValue, noUnit);
+  
+} // createMQTTjsonMessage(char *mqttBuff, *char, FixedValue)
+
+
 /***************************************************************************
 *
 * Permission is hereby granted, free of charge, to any person obtaining a
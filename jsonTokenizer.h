@@ -0,0 +1,350 @@
+/*
+***************************************************************************
+**  Filename  : jsonTokenizer.h
+**  Version  : v2.3.0-rc5
+**
+**  Copyright (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See bottom of file.
+***************************************************************************
+*/
+
+/*
+ * Small streaming JSON tokenizer. It walks over a (not necessarily
+ * '\0' terminated) buffer and returns one token at a time. Nothing is
+ * allocated: a token only points into the input buffer. Use
+ * jsonTokenCopy() to get an unescaped, '\0' terminated copy of a
+ * string or number token in a buffer of your own.
+ *
+ *   jsonTokenizer jt;
+ *   jsonToken     tok;
+ *   jsonBegin(jt, body, strlen(body));
+ *   while (jsonNext(jt, tok) > JSON_TOK_END) { ... }
+ *
+ * jsonNext() returns JSON_TOK_END when the input is exhausted at depth 0
+ * and JSON_TOK_ERROR on malformed input (which also stops the tokenizer).
+ * tok.depth is the nesting level of the container that holds the token
+ * (the top level is 0, keys of the top level object are at depth 1).
+ */
+
+#ifndef _JSON_TOKENIZER_H
+#define _JSON_TOKENIZER_H
+
+#define JSON_MAX_DEPTH    16
+
+enum { JSON_TOK_ERROR, JSON_TOK_END
+     , JSON_TOK_OBJ_START, JSON_TOK_OBJ_END, JSON_TOK_ARR_START, JSON_TOK_ARR_END
+     , JSON_TOK_KEY, JSON_TOK_STRING, JSON_TOK_NUMBER
+     , JSON_TOK_TRUE, JSON_TOK_FALSE, JSON_TOK_NULL };
+
+typedef struct {
+    uint8_t     type;
+    uint8_t     depth;
+    const char *start;  // not '\0' terminated! (strings without quotes)
+    uint16_t    len;
+} jsonToken;
+
+typedef struct {
+    const char *pos;
+    const char *end;
+    uint8_t     depth;
+    uint16_t    isObject;   // one bit per level: 1 = object, 0 = array
+    bool        expectKey;
+    bool        expectValue;
+    bool        afterValue;   // a ',' or the closing token must come next
+    bool        afterComma;   // a value (or key) must come next
+} jsonTokenizer;
+
+
+//===========================================================================================
+static inline bool jsonInObject(const jsonTokenizer &jt)
+{
+  if (jt.depth == 0) return false;
+  return (jt.isObject >> (jt.depth -1)) & 0x01;
+
+} // jsonInObject()
+
+
+//===========================================================================================
+static inline void jsonBegin(jsonTokenizer &jt, const char *buff, size_t len)
+{
+  jt.pos         = buff;
+  jt.end         = buff + len;
+  jt.depth       = 0;
+  jt.isObject    = 0;
+  jt.expectKey   = false;
+  jt.expectValue = false;
+  jt.afterValue  = false;
+  jt.afterComma  = false;
+
+} // jsonBegin()
+
+
+//===========================================================================================
+static inline uint8_t jsonError(jsonTokenizer &jt, jsonToken &tok)
+{
+  jt.pos    = jt.end;   // stop!
+  tok.type  = JSON_TOK_ERROR;
+  tok.start = jt.end;
+  tok.len   = 0;
+  return JSON_TOK_ERROR;
+
+} // jsonError()
+
+
+//===========================================================================================
+static inline uint8_t jsonNext(jsonTokenizer &jt, jsonToken &tok)
+{
+  //-- skip white space, a ',' is only allowed between two values --
+  while (jt.pos < jt.end && isspace(*jt.pos)) jt.pos++;
+  if (jt.afterValue && jt.pos < jt.end && *jt.pos == ',')
+  {
+    if (jt.depth == 0) return jsonError(jt, tok);
+    jt.pos++;
+    jt.afterComma = true;
+    while (jt.pos < jt.end && isspace(*jt.pos)) jt.pos++;
+  }
+
+  tok.depth = jt.depth;
+  tok.start = jt.pos;
+  tok.len   = 0;
+
+  if (jt.pos >= jt.end || *jt.pos == '\0')
+  {
+    if (jt.depth != 0 || jt.afterComma) return jsonError(jt, tok);
+    tok.type = JSON_TOK_END;
+    return JSON_TOK_END;
+  }
+
+  char c = *jt.pos;
+
+  //-- "[1 2]", "{} {}" (no ',') and "[1,]" (nothing after the ',') --
+  if (jt.afterValue && !jt.afterComma && c != '}' && c != ']') return jsonError(jt, tok);
+  if (jt.afterComma && (c == '}' || c == ']'))                 return jsonError(jt, tok);
+  if (jt.expectKey   && c != '"' && c != '}') return jsonError(jt, tok);
+  if (jt.expectValue && (c == '}' || c == ']')) return jsonError(jt, tok);
+  jt.expectValue = false;
+  jt.afterValue  = false;
+  jt.afterComma  = false;
+
+  switch(c)
+  {
+    case '{':
+    case '[': if (jt.depth >= JSON_MAX_DEPTH) return jsonError(jt, tok);
+              if (c == '{') jt.isObject |=  (1 << jt.depth);
+              else          jt.isObject &= ~(1 << jt.depth);
+              jt.depth++;
+              jt.pos++;
+              jt.expectKey = (c == '{');
+              tok.type     = (c == '{') ? JSON_TOK_OBJ_START : JSON_TOK_ARR_START;
+              return tok.type;
+
+    case '}':
+    case ']': if (jt.depth == 0 || jsonInObject(jt) != (c == '}')) return jsonError(jt, tok);
+              jt.depth--;
+              jt.pos++;
+              jt.expectKey  = jsonInObject(jt);
+              jt.afterValue = true;
+              tok.depth     = jt.depth;
+              tok.type      = (c == '}') ? JSON_TOK_OBJ_END : JSON_TOK_ARR_END;
+              return tok.type;
+
+    case '"': jt.pos++;
+              tok.start = jt.pos;
+              while (jt.pos < jt.end && *jt.pos != '"')
+              {
+                if (*jt.pos == '\\') jt.pos++;  // skip escaped char
+                jt.pos++;
+              }
+              if (jt.pos >= jt.end) return jsonError(jt, tok);
+              tok.len = (jt.pos - tok.start);
+              jt.pos++; // skip closing quote
+              if (jt.expectKey)
+              {
+                while (jt.pos < jt.end && isspace(*jt.pos)) jt.pos++;
+                if (jt.pos >= jt.end || *jt.pos != ':') return jsonError(jt, tok);
+                jt.pos++;
+                jt.expectKey   = false;
+                jt.expectValue = true;
+                tok.type       = JSON_TOK_KEY;
+                return JSON_TOK_KEY;
+              }
+              jt.expectKey  = jsonInObject(jt);
+              jt.afterValue = true;
+              tok.type      = JSON_TOK_STRING;
+              return JSON_TOK_STRING;
+  }
+
+  //-- number or literal ---------------------------
+  if (c == '-' || isdigit(c))
+  {
+    while (jt.pos < jt.end && (isdigit(*jt.pos) || strchr("+-.eE", *jt.pos) != NULL)) jt.pos++;
+    tok.type = JSON_TOK_NUMBER;
+  }
+  else if ((jt.end - jt.pos) >= 4 && strncmp(jt.pos, "true", 4) == 0)
+  {
+    jt.pos  += 4;
+    tok.type = JSON_TOK_TRUE;
+  }
+  else if ((jt.end - jt.pos) >= 5 && strncmp(jt.pos, "false", 5) == 0)
+  {
+    jt.pos  += 5;
+    tok.type = JSON_TOK_FALSE;
+  }
+  else if ((jt.end - jt.pos) >= 4 && strncmp(jt.pos, "null", 4) == 0)
+  {
+    jt.pos  += 4;
+    tok.type = JSON_TOK_NULL;
+  }
+  else return jsonError(jt, tok);
+
+  tok.len       = (jt.pos - tok.start);
+  jt.expectKey  = jsonInObject(jt);
+  jt.afterValue = true;
+  return tok.type;
+
+} // jsonNext()
+
+
+//===========================================================================================
+// skip the value that starts with 'tok' (for an object or array:
+// everything up to and including the matching closing token)
+static inline bool jsonSkip(jsonTokenizer &jt, const jsonToken &tok)
+{
+  jsonToken tmp;
+
+  if (tok.type != JSON_TOK_OBJ_START && tok.type != JSON_TOK_ARR_START) return true;
+
+  while (jt.depth > tok.depth)
+  {
+    if (jsonNext(jt, tmp) <= JSON_TOK_END) return false;
+  }
+  return true;
+
+} // jsonSkip()
+
+
+//===========================================================================================
+// walk the complete buffer once, so a batch is only applied when it is valid
+static inline bool jsonIsValid(const char *buff, size_t len)
+{
+  jsonTokenizer jt;
+  jsonToken     tok;
+  uint8_t       type;
+
+  jsonBegin(jt, buff, len);
+  while ((type = jsonNext(jt, tok)) > JSON_TOK_END) { /* next */ }
+  return (type == JSON_TOK_END);
+
+} // jsonIsValid()
+
+
+//===========================================================================================
+static inline bool jsonTokenIs(const jsonToken &tok, const char *text)
+{
+  return (strlen(text) == tok.len && strncasecmp(tok.start, text, tok.len) == 0);
+
+} // jsonTokenIs()
+
+
+//===========================================================================================
+// copy a (unescaped) value into 'dst'. true/false are copied as "1"/"0",
+// null as an empty string. Returns the number of chars copied.
+static inline size_t jsonTokenCopy(const jsonToken &tok, char *dst, size_t dstLen)
+{
+  size_t d = 0;
+
+  if (dstLen == 0) return 0;
+
+  switch(tok.type)
+  {
+    case JSON_TOK_TRUE:   strlcpy(dst, "1", dstLen); return strlen(dst);
+    case JSON_TOK_FALSE:  strlcpy(dst, "0", dstLen); return strlen(dst);
+    case JSON_TOK_KEY:
+    case JSON_TOK_STRING:
+    case JSON_TOK_NUMBER: break;
+    default:              dst[0] = '\0';             return 0;
+  }
+
+  for (uint16_t s = 0; (s < tok.len && d < (dstLen -1)); s++)
+  {
+    char c = tok.start[s];
+    if (c == '\\' && (s +1) < tok.len)
+    {
+      c = tok.start[++s];
+      switch(c)
+      {
+        case 'n': c = '\n'; break;
+        case 'r': c = '\r'; break;
+        case 't': c = '\t'; break;
+        case 'b': c = '\b'; break;
+        case 'f': c = '\f'; break;
+        case 'u': if ((s +4) < tok.len)
+                  {
+                    char hex[5] = { tok.start[s+1], tok.start[s+2], tok.start[s+3], tok.start[s+4], '\0' };
+                    uint16_t u  = strtoul(hex, NULL, 16);
+                    c  = (u < 0x80) ? (char)u : '?';
+                    s += 4;
+                  }
+                  break;
+        default:  break;  // '"', '\\' and '/' are copied as is
+      }
+    }
+    dst[d++] = c;
+  }
+  dst[d] = '\0';
+  return d;
+
+} // jsonTokenCopy()
+
+
+//===========================================================================================
+static inline float jsonTokenToFloat(const jsonToken &tok)
+{
+  char tmp[20];
+
+  jsonTokenCopy(tok, tmp, sizeof(tmp));
+  return atof(tmp);
+
+} // jsonTokenToFloat()
+
+
+//===========================================================================================
+// a number token in 1/1000 (see fixedDecimal.h), 0 if it is not a number
+//===========================================================================================
+static inline int32_t jsonTokenToFixed(const jsonToken &tok)
+{
+  char    tmp[20];
+  int32_t milli = 0;
+
+  jsonTokenCopy(tok, tmp, sizeof(tmp));
+  if (charsToFixed(tmp, milli) == NULL) return 0;
+  return milli;
+
+} // jsonTokenToFixed()
+
+#endif // _JSON_TOKENIZER_H
+
+
+/***************************************************************************
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit
+* persons to whom the Software is furnished to do so, subject to the
+* following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT
+* OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+* THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+***************************************************************************/
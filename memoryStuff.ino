@@ -0,0 +1,137 @@
+/*
+***************************************************************************
+**  Program  : memoryStuff, part of DSMRlogger-Next
+**  Version  : v2.3.0-rc5
+**
+**  Copyright (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See bottom of file.
+***************************************************************************
+**  Memory pressure. handleMemory() looks at the free heap and the largest
+**  free block and sets memLevel:
+**
+**    MEM_OK        everything runs
+**    MEM_LOW       no history API responses, InfluxDB goes to the spool
+**                  (no HTTP), no Home Assistant discovery
+**    MEM_CRITICAL  also: API requests get a 503, MQTT is queued to flash
+**                  (buffer shrunk), no outbound HTTP jobs
+**
+**  It goes back to a better level by itself (with some hysteresis). Only
+**  if the free heap stays below MEM_HEAP_REBOOT for MEM_REBOOT_AFTER
+**  seconds, the logger reboots (and the reason is kept in DSMRstatus.csv).
+*/
+
+  static uint32_t memLowestHeap   = UINT32_MAX;
+  static uint32_t memLowestBlock  = UINT32_MAX;
+  static uint32_t memLevelChanges = 0;
+  static uint32_t memExhausted    = 0;   // millis() when heap got below MEM_HEAP_REBOOT
+
+
+//===========================================================================================
+// true if what needs this level must be skipped now
+//===========================================================================================
+bool memShed(uint8_t level)
+{
+  return (memLevel >= level);
+
+} // memShed()
+
+
+//===========================================================================================
+// called from the scheduler when memoryTimer is DUE
+//===========================================================================================
+void handleMemory()
+{
+  uint32_t  heap  = ESP.getFreeHeap();
+  uint32_t  block = ESP_GET_FREE_BLOCK();
+  uint8_t   level = MEM_OK;
+  uint16_t  hystCrit = (memLevel >= MEM_CRITICAL) ? MEM_HYSTERESIS : 0;
+  uint16_t  hystLow  = (memLevel >= MEM_LOW)      ? MEM_HYSTERESIS : 0;
+
+  if (heap  < memLowestHeap)  memLowestHeap  = heap;
+  if (block < memLowestBlock) memLowestBlock = block;
+
+  if (heap < (MEM_HEAP_CRITICAL + hystCrit) || block < (MEM_BLOCK_CRITICAL + hystCrit))
+        level = MEM_CRITICAL;
+  else if (heap < (MEM_HEAP_LOW + hystLow) || block < (MEM_BLOCK_LOW + hystLow))
+        level = MEM_LOW;
+
+  if (level != memLevel)
+  {
+    memLevelChanges++;
+    DebugTf("memory level [%d] -> [%d] (heap[%u], block[%u])\r\n", memLevel, level, heap, block);
+    writeToSysLog("memory level [%d] -> [%d] (heap[%u], block[%u])", memLevel, level, heap, block);
+    memLevel = level;
+#ifdef USE_MQTT
+    if (memLevel == MEM_CRITICAL && MQTTclient.getBufferSize() > MEM_MQTT_BUFF_MIN)
+    {
+      MQTTclient.setBufferSize(MEM_MQTT_BUFF_MIN);
+    }
+#endif
+  }
+
+  //-- shedding did not help: last resort --
+  if (heap >= MEM_HEAP_REBOOT)
+  {
+    memExhausted = 0;
+    return;
+  }
+  if (memExhausted == 0)  memExhausted = millis();
+  if ((millis() - memExhausted) >= (MEM_REBOOT_AFTER * 1000UL))
+  {
+    snprintf(cMsg, sizeof(cMsg), "low heap %u/%u", heap, block);
+    rebootWithReason(cMsg);
+  }
+
+} // handleMemory()
+
+
+//===========================================================================================
+// keep why we reboot (see readLastStatus()), then reboot
+//===========================================================================================
+void rebootWithReason(const char *reason)
+{
+  DebugTf("Reboot: %s\r\n", reason);
+  writeToSysLog("Reboot: %s", reason);
+  strlcpy(rebootReason, reason, sizeof(rebootReason));
+  commitSettings();
+  writeLastStatus();
+  esp_reboot();
+
+} // rebootWithReason()
+
+
+//===========================================================================================
+void sendJsonMemoryInfo()
+{
+  sendNestedJsonObj("memlevel",           (int32_t)memLevel);
+  sendNestedJsonObj("memlevelchanges",    memLevelChanges);
+  sendNestedJsonObj("memlowestheap",      memLowestHeap, "bytes");
+  sendNestedJsonObj("memlowestblock",     memLowestBlock, "bytes");
+  sendNestedJsonObj("lastrebootreason",   lastRebootReason);
+
+} // sendJsonMemoryInfo()
+
+
+/***************************************************************************
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit
+* persons to whom the Software is furnished to do so, subject to the
+* following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT
+* OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+* THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+***************************************************************************/
@@ -140,6 +140,8 @@ void displayBoardInfo()
   Debug(F("]\r\n            IP Address ["));  Debug( WiFi.localIP().toString() );
   Debug(F("]\r\n              Hostname ["));  Debug( settingHostname );
   Debug(F("]\r\n     Last reset reason ["));  Debug( getResetReason().c_str() );
+  Debug(F("]\r\n    Last reboot reason ["));  Debug( lastRebootReason );
+  Debug(F("]\r\n          memory level ["));  Debug( memLevel );
   Debug(F("]\r\n                upTime ["));  Debug( upTime() );
   Debugln(F("]\r"));
 
@@ -169,6 +171,25 @@ void displayBoardInfo()
 } // displayBoardInfo()
 
 
+//===========================================================================================
+void showTaskStats() 
+{
+  Debugln(F("\r\n==================================================================\r"));
+  Debugln(F(" Task               prio     runs   avg(us)   max(us)  late(ms)   max(ms)\r"));
+  for (uint8_t t = 0; t < schedNrTasks; t++)
+  {
+    schedTask &task = schedTasks[t];
+    Debugf(" %-18s %4d %8lu %9lu %9lu %9lu %9lu\r\n"
+                          , task.name, task.prio, (unsigned long)task.runs
+                          , (unsigned long)(task.runs > 0 ? (task.totalUs / task.runs) : 0)
+                          , (unsigned long)task.maxUs
+                          , (unsigned long)task.lastLateMs, (unsigned long)task.maxLateMs);
+  }
+  Debugln(F("==================================================================\r\n\r"));
+
+} // showTaskStats()
+
+
 
 //===========================================================================================
 void handleKeyInput() 
@@ -184,8 +205,12 @@ void handleKeyInput()
       case 'b':
       case 'B':     displayBoardInfo();
                     break;
+      case 'k':
+      case 'K':     showTaskStats();
+                    showStageStats();
+                    break;
       case 'l':
-      case 'L':     readSettings(true);
+      case 'L':     showSettings();
                     break;
       case 'd':
       case 'D':     displayDaysHist(true);
@@ -197,6 +222,9 @@ void handleKeyInput()
                     runMode = SInit;
                     break;
 #endif
+      case 'g':
+      case 'G':     benchTelegrams(100);
+                    break;
       case 'h':
       case 'H':     displayHoursHist(true);
                     break;
@@ -236,7 +264,7 @@ void handleKeyInput()
                     delay(3000);
                     DebugTln(F("now Rebooting. \r"));
                     DebugFlush();
-                    esp_reboot();
+                    rebootWithReason("telnet command R");
                     break;
       case 's':
       case 'S':     listFiles();
@@ -247,6 +275,7 @@ void handleKeyInput()
                       Debugln(F("Verbose is OFF\r"));
                       Verbose1 = false;
                       Verbose2 = false;
+                      setLogLevel("all", LOG_INFO);
                     } 
                     else if (Verbose1) 
                     {
@@ -258,6 +287,7 @@ void handleKeyInput()
                       Debugln(F("Verbose Level 1 is ON\r"));
                       Verbose1 = true;
                       Verbose2 = false;
+                      setLogLevel("all", LOG_DEBUG);  // the Verbose output is logged at LOG_DEBUG
                     }
                     break;
 #ifdef USE_SYSLOGGER
@@ -280,8 +310,10 @@ void handleKeyInput()
       default:      Debugln(F("\r\nCommands are:\r\n"));
                     Debugln(F("   B - Board Info\r"));
                     Debugln(F("  *E - erase file from SPIFFS\r"));
+                    Debugln(F("   K - Show task and telegram stage statistics\r"));
                     Debugln(F("   L - list Settings\r"));
                     Debugln(F("   D - Display Day table from SPIFFS\r"));
+                    Debugln(F("   G - Benchmark generating/parsing telegrams\r"));
                     Debugln(F("   H - Display Hour table from SPIFFS\r"));
                     Debugln(F("   M - Display Month table from SPIFFS\r"));
                   #if defined(HAS_NO_SLIMMEMETER)
@@ -111,7 +111,7 @@ void startWiFi(const char* hostname, int timeOut)
   //--- and goes into a blocking loop awaiting configuration
   if (!manageWiFi.autoConnect(thisAP.c_str())) 
   {
-    DebugTln(F("failed to connect and hit timeout"));
+    LogTln(LOG_ERROR, F("failed to connect and hit timeout"));
     if (settingOledType > 0)
     {
       oled_Clear();
@@ -125,7 +125,7 @@ void startWiFi(const char* hostname, int timeOut)
     //delay(3000);
     esp_reboot();
     //delay(2000);
-    DebugTf(" took [%d] seconds ==> ERROR!\r\n", (millis() - lTime) / 1000);
+    LogTf(LOG_ERROR, " took [%d] seconds ==> ERROR!\r\n", (millis() - lTime) / 1000);
     return;
   }
   
@@ -165,7 +165,7 @@ void startMDNS(const char *Hostname)
   } 
   else 
   {
-    DebugTln(F("[3] Error setting up MDNS responder!\r\n"));
+    LogTln(LOG_ERROR, F("[3] Error setting up MDNS responder!\r\n"));
   }
   MDNS.addService("http", "tcp", 80);
   
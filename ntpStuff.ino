@@ -13,7 +13,7 @@
 #include <WiFiUdp.h>            // - part of ESP8266 Core https://github.com/esp8266/Arduino
 WiFiUDP           Udp;
 
-const int         timeZone = 1;       // Central European (Winter) Time
+const int         timeZone = SM_UTC_OFFSET; // Central European (Winter) Time
 unsigned int      localPort = 8888;   // local port to listen for UDP packets
 
 // NTP Servers:
@@ -26,6 +26,21 @@
 SSD1306AsciiWire oled;
 
 void oled_Print_Msg(uint8_t, const char* , uint16_t);
+void oled_Flush(uint8_t);
+void oled_Clear();
+
+//-- the text on the screen: oled_Print_Msg() writes in oledText, oled_Update()
+//-- sends what differs from oledShown to the display (a part at a time) --
+#define OLED_LINES        4
+#define OLED_COLS        18     // X11fixed7x14B: 128 / 7
+#define OLED_BURST_CHARS  6     // at most this many chars per oled_Update()
+
+static char     oledText[OLED_LINES][OLED_COLS +1];
+static char     oledShown[OLED_LINES][OLED_COLS +1];
+static uint8_t  oledDirty    = 0;        // bit per line
+static bool     oledBuffered = false;    // false: oled_Print_Msg() writes right away (setup())
+uint32_t        oledUpdates  = 0;        // I2C bursts
+uint32_t        oledCharsSent = 0;
 
 static bool     buttonState = LOW;
 static uint8_t  msgMode = 0;
@@ -33,6 +48,8 @@ static bool     boolDisplay = true;
 static uint8_t  settingOledType = 1;  // 0=none, 1=SSD1306, 2=SH1106
 static uint16_t settingOledSleep; 
 static uint8_t  settingOledFlip;  
+static uint16_t settingOledInterval  = 0;          // sec, 0 = every telegram
+static uint8_t  settingOledAggregate = AGG_LAST;
 
 uint8_t     lineHeight, charHeight;
 
@@ -47,7 +64,7 @@ void checkFlashButton()
   if ( (settingOledSleep > 0) && boolDisplay && DUE(oledSleepTimer) ) 
   {
     DebugTln("Switching display off..");
-    oled.clear();
+    oled_Clear();
     boolDisplay = false;
   }
 
@@ -68,9 +85,9 @@ void checkFlashButton()
     {
       DebugTln(F("Switching display off.."));
     }
-    oled.clear();
+    oled_Clear();
     oled_Print_Msg(0, "<DSMRlogger-Next>", 0);
-    oled_Print_Msg(2, "Wacht ...", 5);
+    oled_Print_Msg(2, "Wacht ...", 0);
     msgMode = 0; //reset the display loop
     RESTART_TIMER(oledSleepTimer);
   }   
@@ -100,6 +117,7 @@ void oled_Init()
                                                         , charHeight, lineHeight, 4);
     boolDisplay = true;
     if (settingOledFlip)  oled.displayRemap(true);
+    oled_Clear();
     RESTART_TIMER(oledSleepTimer);
     
 }   // oled_Init()
@@ -108,6 +126,14 @@ void oled_Init()
 void oled_Clear() 
 {
     oled.clear(); 
+    memset(oledText,  ' ', sizeof(oledText));
+    memset(oledShown, ' ', sizeof(oledShown));
+    for (uint8_t l = 0; l < OLED_LINES; l++)
+    {
+      oledText[l][OLED_COLS]  = '\0';
+      oledShown[l][OLED_COLS] = '\0';
+    }
+    oledDirty = 0;
     
 }   // oled_Clear
 
@@ -116,13 +142,22 @@ void oled_Clear()
 DECLARE_TIMER_MS(timer, 0);
 void oled_Print_Msg(uint8_t line, const char* message, uint16_t wait) 
 {
+  char    lineMsg[OLED_COLS +1];
+  uint8_t c;
+
+  if (line >= OLED_LINES) return;
+
+  for (c = 0; c < OLED_COLS && message[c] != '\0'; c++)  lineMsg[c] = message[c];
+  for ( ; c < OLED_COLS; c++)                             lineMsg[c] = ' ';
+  lineMsg[OLED_COLS] = '\0';
+
+  if (memcmp(oledText[line], lineMsg, OLED_COLS) != 0)
+  {
+    memcpy(oledText[line], lineMsg, OLED_COLS);
+    oledDirty |= (1 << line);
+  }
   if (!boolDisplay) return;  
-  
-  char lineMsg[20] {0}; 
-  strlcpy(lineMsg, message, sizeof(lineMsg)); 
-  strlcat(lineMsg, "                    ", sizeof(lineMsg)); 
-  oled.setCursor(0, ((line * lineHeight)/8));
-  oled.print(lineMsg); 
+  if (!oledBuffered || wait > 0)  oled_Flush(line);
 
   if (wait>0)
   {
@@ -137,6 +172,61 @@ void oled_Print_Msg(uint8_t line, const char* message, uint16_t wait)
 }   // oled_Print_Msg()
 
 
+//===========================================================================================
+// send the changed part of a line (OLED_BURST_CHARS at most). Returns
+// false if the line is (now) the same as the text on the screen
+//===========================================================================================
+bool oled_SendPart(uint8_t line, uint8_t maxChars)
+{
+  uint8_t first = 0, last = OLED_COLS;
+
+  while (first < OLED_COLS && oledText[line][first] == oledShown[line][first])  first++;
+  if (first == OLED_COLS)
+  {
+    oledDirty &= ~(1 << line);
+    return false;
+  }
+  while (last > first && oledText[line][last -1] == oledShown[line][last -1])   last--;
+  if ((last - first) > maxChars)  last = first + maxChars;
+
+  oled.setCursor(oled.fieldWidth(first), ((line * lineHeight)/8));
+  for (uint8_t c = first; c < last; c++)
+  {
+    oled.write(oledText[line][c]);
+    oledShown[line][c] = oledText[line][c];
+  }
+  oledUpdates++;
+  oledCharsSent += (last - first);
+  return true;
+
+} // oled_SendPart()
+
+
+//===========================================================================================
+// the whole line at once (setup() and messages that wait)
+//===========================================================================================
+void oled_Flush(uint8_t line)
+{
+  while (oled_SendPart(line, OLED_COLS)) ;
+
+} // oled_Flush()
+
+
+//===========================================================================================
+// called every loop: one short I2C burst of what changed, if anything
+//===========================================================================================
+void oled_Update()
+{
+  if (oledDirty == 0 || !boolDisplay) return;
+
+  for (uint8_t l = 0; l < OLED_LINES; l++)
+  {
+    if ((oledDirty & (1 << l)) && oled_SendPart(l, OLED_BURST_CHARS)) return;
+  }
+
+} // oled_Update()
+
+
 /***************************************************************************
 *
 * Permission is hereby granted, free of charge, to any person obtaining a
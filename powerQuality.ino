@@ -0,0 +1,254 @@
+/*
+***************************************************************************
+**  Program  : powerQuality, part of DSMRlogger-Next
+**  Version  : v2.3.0-rc5
+**
+**  Copyright (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See bottom of file.
+***************************************************************************
+**  Every telegram the voltage, current and (net) power of every phase is
+**  added to the statistics (min, max, mean and variance, Welford's
+**  algorithm so nothing but the running values is kept) of the running
+**  hour and day. At the start of a new hour/day the statistics of the
+**  previous one are kept.
+**
+**  Under/over voltage, over current and phase imbalance are events with
+**  a start and end time (and the lowest/highest value during the event).
+**  The last PQ_EVENT_SLOTS events are kept in a ring.
+**
+**  /api/v1/sm/quality    statistics
+**  /api/v1/sm/events     events (newest first)
+**  MQTT <topTopic>/event every event when it starts and when it ends
+*/
+
+  static pqStat   pqStats[PQ_PERIODS][2][3][PQ_QUANTITIES];  // [period][running, previous][phase][quantity]
+  static int8_t   pqPeriodKey[PQ_PERIODS] = { -1, -1 };      // hour and day of the running period
+  static pqEvent  pqEvents[PQ_EVENT_SLOTS];
+  static uint32_t pqEventSeq = 0;
+  static uint32_t pqActive[PQ_EV_TYPES][4];                  // seq of the running event per phase (0 = none)
+
+  const char *pqEventName[]    = { "undervoltage", "overvoltage", "overcurrent", "imbalance" };
+  const char *pqQuantityName[] = { "voltage", "current", "power" };
+  const char *pqQuantityUnit[] = { "V", "A", "W" };
+  const char *pqPeriodName[]   = { "hour", "day" };
+
+
+//===========================================================================================
+static void pqAdd(pqStat &st, float x)
+{
+  float delta;
+
+  st.n++;
+  if (st.n == 1)
+  {
+    st.mean = st.min = st.max = x;
+    st.m2   = 0.0;
+    return;
+  }
+  delta    = x - st.mean;
+  st.mean += delta / st.n;
+  st.m2   += delta * (x - st.mean);
+  if (x < st.min) st.min = x;
+  if (x > st.max) st.max = x;
+
+} // pqAdd()
+
+
+//===========================================================================================
+void pqPublishEvent(const pqEvent &ev)
+{
+#ifdef USE_MQTT
+  char  json[160], start[14], end[14] = "";
+
+  if (memShed(MEM_CRITICAL)) return;
+
+  epochToTimestamp(ev.start, start, sizeof(start));
+  if (ev.end != 0)  epochToTimestamp(ev.end, end, sizeof(end));
+  snprintf(json, sizeof(json), "{\"seq\":%u,\"type\":\"%s\",\"phase\":%d,\"start\":\"%s\",\"end\":\"%s\",\"extreme\":%.2f}"
+                             , ev.seq, pqEventName[ev.type], ev.phase, start, end, ev.extreme);
+  sendMQTTData("event", json);
+#endif
+
+} // pqPublishEvent()
+
+
+//===========================================================================================
+// starts, updates or ends the event of this type on this phase
+//===========================================================================================
+static void pqCheck(uint8_t type, uint8_t phase, bool begins, bool ends, float value)
+{
+  uint32_t seq = pqActive[type][phase];
+
+  if (seq != 0)
+  {
+    pqEvent &ev = pqEvents[seq % PQ_EVENT_SLOTS];
+    if (ev.seq != seq)              // overwritten by newer events
+    {
+      pqActive[type][phase] = 0;
+      return;
+    }
+    if (type == PQ_EV_UNDERVOLT)  { if (value < ev.extreme) ev.extreme = value; }
+    else                          { if (value > ev.extreme) ev.extreme = value; }
+    if (ends)
+    {
+      ev.end = newT;
+      pqActive[type][phase] = 0;
+      DebugTf("power quality: %s on L%d ended (%.2f)\r\n", pqEventName[type], phase, ev.extreme);
+      pqPublishEvent(ev);
+    }
+    return;
+  }
+  if (!begins) return;
+
+  seq = ++pqEventSeq;
+  pqEvent &ev = pqEvents[seq % PQ_EVENT_SLOTS];
+  ev.seq      = seq;
+  ev.start    = newT;
+  ev.end      = 0;
+  ev.type     = type;
+  ev.phase    = phase;
+  ev.extreme  = value;
+  pqActive[type][phase] = seq;
+  DebugTf("power quality: %s on L%d (%.2f)\r\n", pqEventName[type], phase, value);
+  writeToSysLog("power quality: %s on L%d (%.2f)", pqEventName[type], phase, value);
+  pqPublishEvent(ev);
+
+} // pqCheck()
+
+
+//===========================================================================================
+// called for every (parsed) telegram, after newT is set
+//===========================================================================================
+void handlePowerQuality()
+{
+  float   value[3][PQ_QUANTITIES];
+  bool    present[3][PQ_QUANTITIES];
+  int8_t  key[PQ_PERIODS] = { (int8_t)hour(newT), (int8_t)day(newT) };
+
+  value[0][PQ_VOLTAGE]   = DSMRdata.voltage_l1;
+  value[1][PQ_VOLTAGE]   = DSMRdata.voltage_l2;
+  value[2][PQ_VOLTAGE]   = DSMRdata.voltage_l3;
+  present[0][PQ_VOLTAGE] = DSMRdata.voltage_l1_present;
+  present[1][PQ_VOLTAGE] = DSMRdata.voltage_l2_present;
+  present[2][PQ_VOLTAGE] = DSMRdata.voltage_l3_present;
+  value[0][PQ_CURRENT]   = DSMRdata.current_l1;
+  value[1][PQ_CURRENT]   = DSMRdata.current_l2;
+  value[2][PQ_CURRENT]   = DSMRdata.current_l3;
+  present[0][PQ_CURRENT] = DSMRdata.current_l1_present;
+  present[1][PQ_CURRENT] = DSMRdata.current_l2_present;
+  present[2][PQ_CURRENT] = DSMRdata.current_l3_present;
+  value[0][PQ_POWER]     = (DSMRdata.power_delivered_l1 - DSMRdata.power_returned_l1) * 1000.0;
+  value[1][PQ_POWER]     = (DSMRdata.power_delivered_l2 - DSMRdata.power_returned_l2) * 1000.0;
+  value[2][PQ_POWER]     = (DSMRdata.power_delivered_l3 - DSMRdata.power_returned_l3) * 1000.0;
+  present[0][PQ_POWER]   = DSMRdata.power_delivered_l1_present;
+  present[1][PQ_POWER]   = DSMRdata.power_delivered_l2_present;
+  present[2][PQ_POWER]   = DSMRdata.power_delivered_l3_present;
+
+  //-- new hour/day: keep the statistics of the previous one --
+  for (uint8_t per = 0; per < PQ_PERIODS; per++)
+  {
+    if (key[per] == pqPeriodKey[per]) continue;
+    if (pqPeriodKey[per] >= 0)  memcpy(pqStats[per][1], pqStats[per][0], sizeof(pqStats[per][0]));
+    memset(pqStats[per][0], 0, sizeof(pqStats[per][0]));
+    pqPeriodKey[per] = key[per];
+  }
+
+  for (uint8_t p = 0; p < 3; p++)
+  {
+    for (uint8_t q = 0; q < PQ_QUANTITIES; q++)
+    {
+      if (!present[p][q]) continue;
+      for (uint8_t per = 0; per < PQ_PERIODS; per++)  pqAdd(pqStats[per][0][p][q], value[p][q]);
+    }
+    if (present[p][PQ_VOLTAGE])
+    {
+      float v = value[p][PQ_VOLTAGE];
+      pqCheck(PQ_EV_UNDERVOLT,   p +1, (v < PQ_VOLT_LOW),  (v >= (PQ_VOLT_LOW  + PQ_VOLT_HYST)), v);
+      pqCheck(PQ_EV_OVERVOLT,    p +1, (v > PQ_VOLT_HIGH), (v <= (PQ_VOLT_HIGH - PQ_VOLT_HYST)), v);
+    }
+    if (present[p][PQ_CURRENT])
+    {
+      float a = value[p][PQ_CURRENT];
+      pqCheck(PQ_EV_OVERCURRENT, p +1, (a > PQ_CURRENT_MAX), (a <= (PQ_CURRENT_MAX - PQ_CURRENT_HYST)), a);
+    }
+  }
+
+  //-- imbalance: only with three phases --
+  if (present[0][PQ_CURRENT] && present[1][PQ_CURRENT] && present[2][PQ_CURRENT])
+  {
+    float aMin = value[0][PQ_CURRENT], aMax = value[0][PQ_CURRENT];
+    for (uint8_t p = 1; p < 3; p++)
+    {
+      if (value[p][PQ_CURRENT] < aMin) aMin = value[p][PQ_CURRENT];
+      if (value[p][PQ_CURRENT] > aMax) aMax = value[p][PQ_CURRENT];
+    }
+    pqCheck(PQ_EV_IMBALANCE, 0, ((aMax - aMin) > PQ_IMBALANCE_MAX)
+                              , ((aMax - aMin) <= (PQ_IMBALANCE_MAX - PQ_CURRENT_HYST)), (aMax - aMin));
+  }
+
+} // handlePowerQuality()
+
+
+//===========================================================================================
+void sendJsonPowerQuality()
+{
+  sendStartJsonObj("quality");
+  for (uint8_t per = 0; per < PQ_PERIODS; per++)
+  {
+    for (uint8_t r = 0; r < 2; r++)
+    {
+      for (uint8_t p = 0; p < 3; p++)
+      {
+        for (uint8_t q = 0; q < PQ_QUANTITIES; q++)
+        {
+          const pqStat &st = pqStats[per][r][p][q];
+          if (st.n == 0) continue;
+          sendJsonPqStatObj(pqPeriodName[per], (r == 0), p +1, pqQuantityName[q], pqQuantityUnit[q]
+                          , st, (st.n > 1) ? sqrt(st.m2 / (st.n -1)) : 0.0);
+        }
+      }
+    }
+  }
+  sendEndJsonObj();
+
+} // sendJsonPowerQuality()
+
+
+//===========================================================================================
+void sendJsonPqEvents()
+{
+  sendStartJsonObj("events");
+  for (uint32_t seq = pqEventSeq; seq > 0 && (pqEventSeq - seq) < PQ_EVENT_SLOTS; seq--)
+  {
+    const pqEvent &ev = pqEvents[seq % PQ_EVENT_SLOTS];
+    if (ev.seq != seq) break;
+    sendJsonPqEventObj(ev, pqEventName[ev.type]);
+  }
+  sendEndJsonObj();
+
+} // sendJsonPqEvents()
+
+
+/***************************************************************************
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit
+* persons to whom the Software is furnished to do so, subject to the
+* following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT
+* OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+* THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+***************************************************************************/
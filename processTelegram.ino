@@ -7,24 +7,107 @@
 **
 **  TERMS OF USE: MIT License. See bottom of file.                                                            
 ***************************************************************************      
+**  A telegram goes through stages. The cheap ones (parse, process) run
+**  for every telegram, also in continuous mode (settingContinuousRead,
+**  DSMR 5: one every second). The expensive ones run on their own
+**  cadence: the RING-files on a new hour, MQTT, InfluxDB and the OLED
+**  screen on the interval of their sink policy (see sinkPolicy).
+**
+**  Every stage has a time budget (STAGE_xx_MS). Runs over budget are
+**  counted. MQTT and InfluxDB wait for the next telegram if they (going
+**  by their last run) do not fit in what is left of TELEGRAM_BUDGET_MS.
 */
+
+  static telegramStage stages[STAGES] = {
+                            { "parse",   STAGE_PARSE_MS,   false }
+                          , { "process", STAGE_PROCESS_MS, false }
+                          , { "files",   STAGE_FILES_MS,   false }
+                          , { "mqtt",    STAGE_MQTT_MS,    true  }
+                          , { "influx",  STAGE_INFLUX_MS,  true  }
+                        };
+  static uint32_t telegramStartUs   = 0;
+  static uint32_t telegramMaxUs     = 0;
+  static uint32_t telegramOverruns  = 0;
+
+
+//==================================================================================
+void stageDone(uint8_t stage, uint32_t tookUs)
+{
+  telegramStage &st = stages[stage];
+
+  st.runs++;
+  st.totalUs += tookUs;
+  st.lastUs   = tookUs;
+  if (tookUs > st.maxUs)  st.maxUs = tookUs;
+  if (tookUs > (st.budgetMs * 1000UL))
+  {
+    st.overruns++;
+    if (Verbose1) LogTf(LOG_DEBUG, "stage [%s] took [%u]us, budget [%u]ms\r\n", st.name, tookUs, st.budgetMs);
+  }
+
+} // stageDone()
+
+
+//==================================================================================
+// a stage that can wait: does it (going by its last run) still fit in
+// this telegram? Never more than STAGE_MAX_DEFER times in a row
+//==================================================================================
+bool stageMayRun(uint8_t stage)
+{
+  telegramStage &st = stages[stage];
+  uint32_t       used = micros() - telegramStartUs;
+
+  if (!st.deferrable || st.deferRow >= STAGE_MAX_DEFER 
+      || (used + st.lastUs) <= (TELEGRAM_BUDGET_MS * 1000UL))
+  {
+    st.deferRow = 0;
+    return true;
+  }
+  st.deferRow++;
+  st.deferred++;
+  return false;
+
+} // stageMayRun()
+
+
 //==================================================================================
 void processTelegram()
 {
+  static bool firstTelegram = true;
+  uint32_t    stageStart;
+
+  telegramStartUs = micros();
+  stageStart      = telegramStartUs;
+
+  if (firstTelegram)
+  {
+    bootMark("telegram");
+    firstTelegram = false;
+  }
+
+  //-- nothing of the previous telegram (or request) is in use anymore --
+  scratchReset();
+  sinkSample();
+
   DebugTf("Telegram[%d]=>DSMRdata.timestamp[%s]\r\n", telegramCount
                                                     , DSMRdata.timestamp.c_str());
 
 //----- update OLED display ---------
   if (settingOledType > 0)
   {
-    String DT   = buildDateTimeString(DSMRdata.timestamp.c_str(), sizeof(DSMRdata.timestamp));
+    const char *DT = buildDateTimeString(DSMRdata.timestamp.c_str(), sizeof(DSMRdata.timestamp));
 
-    snprintf(cMsg, sizeof(cMsg), "%s - %s", DT.substring(0, 10).c_str(), DT.substring(11, 16).c_str());
+    snprintf(cMsg, sizeof(cMsg), "%.10s - %.5s", DT, (strlen(DT) > 11 ? &DT[11] : ""));
     oled_Print_Msg(0, cMsg, 0);
-    snprintf(cMsg, sizeof(cMsg), "-Power%7d Watt", (int)(DSMRdata.power_delivered *1000));
-    oled_Print_Msg(1, cMsg, 0);
-    snprintf(cMsg, sizeof(cMsg), "+Power%7d Watt", (int)(DSMRdata.power_returned *1000));
-    oled_Print_Msg(2, cMsg, 0);
+    if (sinkDue(SINK_OLED))
+    {
+      sinkBegin(SINK_OLED);
+      snprintf(cMsg, sizeof(cMsg), "-Power%7d Watt", (int)(DSMRdata.power_delivered *1000));
+      oled_Print_Msg(1, cMsg, 0);
+      snprintf(cMsg, sizeof(cMsg), "+Power%7d Watt", (int)(DSMRdata.power_returned *1000));
+      oled_Print_Msg(2, cMsg, 0);
+      sinkEnd(SINK_OLED);
+    }
   }
                                                     
   strlcpy(newTimestamp, DSMRdata.timestamp.c_str(), sizeof(newTimestamp)); 
@@ -45,12 +128,15 @@ void processTelegram()
   newT = epoch(newTimestamp, strlen(newTimestamp), true); // update system time
   //--- actTimestamp is the timestamp from the previous telegram
   actT = epoch(actTimestamp, strlen(actTimestamp), false);
+
+  handlePowerQuality();
   
   //--- Skip first 3 telegrams .. just to settle down a bit ;-)
   if ((int32_t)(telegramCount - telegramErrors) < 3) 
   {
     strlcpy(actTimestamp, newTimestamp, sizeof(actTimestamp));
     actT = epoch(actTimestamp, strlen(actTimestamp), false);   // update system time
+    stageDone(STAGE_PROCESS, micros() - stageStart);
     return;
   }
   
@@ -60,6 +146,7 @@ void processTelegram()
   if (hour(actT) != hour(newT)) {
     writeToSysLog("actHour[%02d] -- newHour[%02d]", hour(actT), hour(newT));
   }
+  stageDone(STAGE_PROCESS, micros() - stageStart);
 
 
 //fix Rob Roos
@@ -71,6 +158,7 @@ void processTelegram()
        ||   (DayFromTimestamp(actTimestamp) != DayFromTimestamp(newTimestamp)   ) 
        || (MonthFromTimestamp(actTimestamp) != MonthFromTimestamp(newTimestamp) ) )
   {
+    stageStart = micros();
     writeToSysLog("Update RING-files");
     writeDataToFiles();
     writeLastStatus();
@@ -85,15 +173,20 @@ void processTelegram()
     else  //--- NO, only the hour has changed
     {
       char      record[DATA_RECLEN + 1] = "";
+      int32_t   readings[5];
       //--- actTimestamp := newTimestamp
       strlcpy(actTimestamp, newTimestamp, sizeof(actTimestamp));
 
       buildDataRecordFromSM(record);
+      readingsFromSM(readings);
       uint16_t recSlot = timestampToHourSlot(actTimestamp, strlen(actTimestamp));
       //--- and update the files with the actTimestamp
       writeDataToFile(HOURS_FILE, record, recSlot, HOURS);
+      updateHistSummary(HOURS, recSlot, readings);
+      writeHistColumns(HOURS, recSlot);
       DebugTf(">%s\r\n", record); // record ends in a \n
     }
+    stageDone(STAGE_FILES, micros() - stageStart);
   } 
 
 //fix
@@ -142,21 +235,82 @@ void processTelegram()
 
 // If the MQTT timer is DUE, also send MQTT message
 #ifdef USE_MQTT
-  if ( DUE(publishMQTTtimer) )
+  if ( TIME_LEFT_MS(publishMQTTtimer) == 0 && stageMayRun(STAGE_MQTT) && DUE(publishMQTTtimer) )
   {
+    stageStart = micros();
+    sinkBegin(SINK_MQTT);
     sendMQTTData();      
+    sinkEnd(SINK_MQTT);
+    stageDone(STAGE_MQTT, micros() - stageStart);
   }  
 #endif
 // And send it using InfluxDB
 #ifdef USE_INFLUXDB
+  if ( sinkDue(SINK_INFLUX) && stageMayRun(STAGE_INFLUX) )
+  {
+    stageStart = micros();
+    sinkBegin(SINK_INFLUX);
     handleInfluxDB();
+    sinkEnd(SINK_INFLUX);
+    stageDone(STAGE_INFLUX, micros() - stageStart);
+  }
 #endif
 
+  uint32_t took = micros() - telegramStartUs;
+  if (took > telegramMaxUs)                     telegramMaxUs = took;
+  if (took > (TELEGRAM_BUDGET_MS * 1000UL))     telegramOverruns++;
+
 
 
 } // processTelegram()
 
 
+//==================================================================================
+void showStageStats()
+{
+  Debugln(F("\r\n==================================================================\r"));
+  Debugf(" Stage     budget(ms)     runs   avg(us)   max(us)  overruns  deferred\r\n");
+  for (uint8_t s = 0; s < STAGES; s++)
+  {
+    telegramStage &st = stages[s];
+    Debugf(" %-10s %9u %8lu %9lu %9lu %9lu %9lu\r\n"
+                          , st.name, st.budgetMs, (unsigned long)st.runs
+                          , (unsigned long)(st.runs > 0 ? (st.totalUs / st.runs) : 0)
+                          , (unsigned long)st.maxUs
+                          , (unsigned long)st.overruns, (unsigned long)st.deferred);
+  }
+  Debugf(" telegram: max [%lu]us, [%lu] over budget of [%d]ms (continuous read [%s])\r\n"
+                          , (unsigned long)telegramMaxUs, (unsigned long)telegramOverruns
+                          , TELEGRAM_BUDGET_MS, (settingContinuousRead ? "on" : "off"));
+  showSinkPolicies();
+  Debugln(F("==================================================================\r\n\r"));
+
+} // showStageStats()
+
+
+//==================================================================================
+void sendDeviceStages()
+{
+  sendStartJsonObj("stages");
+  for (uint8_t s = 0; s < STAGES; s++)
+  {
+    sendJsonStageObj(stages[s]);
+  }
+  sendEndJsonObj();
+
+} // sendDeviceStages()
+
+
+//==================================================================================
+void sendJsonStageInfo()
+{
+  sendNestedJsonObj("telegrambudget",   (int32_t)TELEGRAM_BUDGET_MS, "ms");
+  sendNestedJsonObj("telegrammaxus",    telegramMaxUs, "us");
+  sendNestedJsonObj("telegramoverruns", telegramOverruns);
+
+} // sendJsonStageInfo()
+
+
 /***************************************************************************
 *
 * Permission is hereby granted, free of charge, to any person obtaining a
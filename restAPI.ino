@@ -42,42 +42,41 @@ void processAPI()
   char fName[40] = "";
   char URI[50]   = "";
   char buff[60] = "";
-  String words[10];
+  const char *words[10];
+  IPAddress   from = httpServer.client().remoteIP();
+
+  //-- nothing of the previous request (or telegram) is in use anymore --
+  scratchReset();
 
   strlcpy( URI, httpServer.uri().c_str(), sizeof(URI) );
 
   if (httpServer.method() == HTTP_GET)
-        DebugTf("from[%s] URI[%s] method[GET] \r\n"
-                                  , httpServer.client().remoteIP().toString().c_str()
+        DebugTf("from[%d.%d.%d.%d] URI[%s] method[GET] \r\n"
+                                  , from[0], from[1], from[2], from[3]
                                         , URI); 
-  else  DebugTf("from[%s] URI[%s] method[PUT] \r\n" 
-                                  , httpServer.client().remoteIP().toString().c_str()
+  else  DebugTf("from[%d.%d.%d.%d] URI[%s] method[PUT] \r\n" 
+                                  , from[0], from[1], from[2], from[3]
                                         , URI); 
 
-#ifdef USE_SYSLOGGER
-  if (ESP.getFreeHeap() < 5000) // to prevent firmware from crashing!
-#else
-  if (ESP.getFreeHeap() < 7000) // to prevent firmware from crashing!
-#endif
+  if (memShed(MEM_CRITICAL)) // to prevent firmware from crashing!
   {
-    DebugTf("==> Bailout due to low heap (%d bytes))\r\n", ESP.getFreeHeap() );
-    writeToSysLog("from[%s][%s] Bailout low heap (%d bytes)"
-                                  , httpServer.client().remoteIP().toString().c_str()
+    DebugTf("==> Refused due to low heap (%d bytes))\r\n", ESP.getFreeHeap() );
+    writeToSysLog("from[%d.%d.%d.%d][%s] Refused low heap (%d bytes)"
+                                  , from[0], from[1], from[2], from[3]
                                   , URI
                                   , ESP.getFreeHeap() );
-    httpServer.send(500, "text/plain", "500: internal server error (low heap)\r\n");
-    esp_reboot(); //due to low memory, let's restart.
+    httpServer.send(503, "text/plain", "503: service unavailable (low heap), try again later\r\n");
     return;
   }
 
-  int8_t wc = splitString(URI, '/', words, 10);
+  int8_t wc = scratchSplit(URI, '/', words, 10);
 
   if (Verbose2) 
   {
     DebugT(">>");
     for (int w=0; w<wc; w++)
     {
-      Debugf("word[%d] => [%s], ", w, words[w].c_str());
+      Debugf("word[%d] => [%s], ", w, words[w]);
     }
     Debugln(" ");
   }
@@ -85,9 +84,9 @@ void processAPI()
   // if (words[1] == "api")
   // {
     /* code */
-    if (words[2] == "v0") 
+    if (strcmp(words[2], "v0") == 0) 
     {
-      if (words[3] == "sm" && words[4] == "actual" ) 
+      if (strcmp(words[3], "sm") == 0 && strcmp(words[4], "actual") == 0) 
       {
         //--- depreciated api. left here for backward compatibility
         onlyIfPresent = true;
@@ -95,19 +94,21 @@ void processAPI()
         sendJsonV0Fields();
       }
     } 
-    else if (words[2] == "v1") 
+    else if (strcmp(words[2], "v1") == 0) 
     {
-      if (words[3] == "dev")
+      if (strcmp(words[3], "dev") == 0)
       {
-        handleDevApi(URI, words[4].c_str(), words[5].c_str(), words[6].c_str());
+        handleDevApi(URI, words[4], words[5], words[6]);
       }
-      else if (words[3] == "hist")
+      else if (strcmp(words[3], "hist") == 0)
       {
-        handleHistApi(URI, words[4].c_str(), words[5].c_str(), words[6].c_str());
+        if (memShed(MEM_LOW) && strcmp(words[4], "summary") != 0) 
+              httpServer.send(503, "text/plain", "503: service unavailable (low heap), try again later\r\n");
+        else  handleHistApi(URI, words[4], words[5], words[6]);
       }
-      else if (words[3] == "sm")
+      else if (strcmp(words[3], "sm") == 0)
       {
-        handleSmApi(URI, words[4].c_str(), words[5].c_str(), words[6].c_str());
+        handleSmApi(URI, words[4], words[5], words[6]);
       }
       else sendApiNotFound(URI);
     } 
@@ -140,36 +141,69 @@ void handleDevApi(const char *URI, const char *word4, const char *word5, const c
       // json string: {"name":"settingInterval","value":9}  
       // json string: {"name":"settingTelegramInterval","value":123.45}  
       // json string: {"name":"settingTelegramInterval","value":"abc"}  
+      // or an array of these:
+      //              [{"name":"ed_tariff1","value":0.21},{"name":"ed_tariff2","value":0.19}]  
+      // all settings are applied first and written to flash only once
       //------------------------------------------------------------ 
-      // so, why not use ArduinoJSON library?
-      // I say: try it yourself ;-) It won't be easy
-      String wOut[5];
-      String wPair[5];
-      String jsonIn  = httpServer.arg(0).c_str();
-      char field[25] = "";
-      char newValue[101]="";
-      jsonIn.replace("{", "");
-      jsonIn.replace("}", "");
-      jsonIn.replace("\"", "");
-      int8_t wp = splitString(jsonIn.c_str(), ',',  wPair, 5) ;
-      for (int i=0; i<wp; i++)
+      const String &jsonIn = httpServer.arg(0);
+      jsonTokenizer jt;
+      jsonToken     tok;
+      char    field[25]     = "";
+      char    newValue[101] = "";
+      uint8_t nrChanged     = 0;
+      
+      if (!jsonIsValid(jsonIn.c_str(), jsonIn.length()))
       {
-        //DebugTf("[%d] -> pair[%s]\r\n", i, wPair[i].c_str());
-        int8_t wc = splitString(wPair[i].c_str(), ':',  wOut, 5) ;
-        //DebugTf("==> [%s] -> field[%s]->val[%s]\r\n", wPair[i].c_str(), wOut[0].c_str(), wOut[1].c_str());
-        if (wOut[0].equalsIgnoreCase("name"))  strlcpy(field, wOut[1].c_str(), sizeof(field));
-        if (wOut[0].equalsIgnoreCase("value")) strlcpy(newValue, wOut[1].c_str(), sizeof(newValue));
+        DebugTf("invalid json [%s]\r\n", jsonIn.c_str());
+        httpServer.send(400, "text/plain", "400: invalid JSON\r\n");
+        return;
       }
-      //DebugTf("--> field[%s] => newValue[%s]\r\n", field, newValue);
-      updateSetting(field, newValue);
-      httpServer.send(200, "application/json", httpServer.arg(0));
-      writeToSysLog("DSMReditor: Field[%s] changed to [%s]", field, newValue);
+      jsonBegin(jt, jsonIn.c_str(), jsonIn.length());
+      while (jsonNext(jt, tok) > JSON_TOK_END)
+      {
+        if (tok.type == JSON_TOK_OBJ_START)
+        {
+          field[0]    = '\0';
+          newValue[0] = '\0';
+        }
+        else if (tok.type == JSON_TOK_KEY)
+        {
+          bool isName  = jsonTokenIs(tok, "name");
+          bool isValue = jsonTokenIs(tok, "value");
+          if (jsonNext(jt, tok) <= JSON_TOK_END) break;
+          if      (isName)  jsonTokenCopy(tok, field,    sizeof(field));
+          else if (isValue) jsonTokenCopy(tok, newValue, sizeof(newValue));
+          if (!jsonSkip(jt, tok)) break;
+        }
+        else if (tok.type == JSON_TOK_OBJ_END && strlen(field) > 0)
+        {
+          //DebugTf("--> field[%s] => newValue[%s]\r\n", field, newValue);
+          applySetting(field, newValue);
+          writeToSysLog("DSMReditor: Field[%s] changed to [%s]", field, newValue);
+          field[0] = '\0';
+          nrChanged++;
+        }
+      }
+      if (nrChanged > 0)  markSettingsDirty();
+      httpServer.send(200, "application/json", jsonIn);
     }
     else
     {
       sendDeviceSettings();
     }
   }
+  else if (strcasecmp(word4, "tasks") == 0)
+  {
+    sendDeviceTasks();
+  }
+  else if (strcasecmp(word4, "stages") == 0)
+  {
+    sendDeviceStages();
+  }
+  else if (strcasecmp(word4, "log") == 0)
+  {
+    sendDeviceLog(URI, word5, word6);
+  }
   else if (strcasecmp(word4, "debug") == 0)
   {
     sendDeviceDebug(URI, word5);
@@ -196,6 +230,29 @@ void handleHistApi(const char *URI, const char *word4, const char *word5, const
     fileType = DAYS;
     strlcpy(fileName, DAYS_FILE, sizeof(fileName));
   }
+  else if (strcasecmp(word4, "summary") == 0)
+  {
+    sendJsonHistSummary();
+    return;
+  }
+  else if (strcasecmp(word4, "channels") == 0)
+  {
+    sendJsonHistChannels();
+    return;
+  }
+  else if (histColumnByName(word4) >= 0)
+  {
+    if      (strcasecmp(word5, "hours")  == 0)  fileType = HOURS;
+    else if (strcasecmp(word5, "days")   == 0)  fileType = DAYS;
+    else if (strcasecmp(word5, "months") == 0)  fileType = MONTHS;
+    else
+    {
+      sendApiNotFound(URI);
+      return;
+    }
+    sendJsonHistColumn(fileType, histColumnByName(word4), (strcasecmp(word6, "desc") == 0));
+    return;
+  }
   else if (strcasecmp(word4, "months") == 0)
   {
     fileType = MONTHS;
@@ -206,19 +263,34 @@ void handleHistApi(const char *URI, const char *word4, const char *word5, const
       //               ,"edt1":2601.146,"edt2":"9535.555"
       //               ,"ert1":378.074,"ert2":208.746
       //               ,"gdt":3314.404}
+      // or an array of these: [{"recid":"2901",..},{"recid":"2902",..}]
       //------------------------------------------------------------ 
-      char      record[DATA_RECLEN + 1] = "";
-      uint16_t  recSlot;
-
-      String jsonIn  = httpServer.arg(0).c_str();
-      DebugTln(jsonIn);
-      
-      recSlot = buildDataRecordFromJson(record, jsonIn);
+      const String &jsonIn = httpServer.arg(0);
+      if (Verbose1) LogTln(LOG_DEBUG, jsonIn);
       
       //--- update MONTHS
-      writeDataToFile(MONTHS_FILE, record, recSlot, MONTHS);
+      uint16_t rejected;
+      int16_t  written = writeMonthRecordsFromJson(jsonIn.c_str(), jsonIn.length(), rejected);
+      if (written == -2)
+      {
+        httpServer.send(500, "text/plain", "500: could not open " MONTHS_FILE "\r\n");
+        return;
+      }
+      if (written < 0)
+      {
+        httpServer.send(400, "text/plain", "400: invalid JSON\r\n");
+        return;
+      }
+      if (rejected > 0)
+      {
+        //--- none written: 400, some written: 207 (Multi-Status) --
+        char result[60];
+        snprintf(result, sizeof(result), "{\"written\":%d,\"rejected\":%u}\r\n", written, rejected);
+        httpServer.send((written == 0 ? 400 : 207), "application/json", result);
+        return;
+      }
       //--- send OK response --
-      httpServer.send(200, "application/json", httpServer.arg(0));
+      httpServer.send(200, "application/json", jsonIn);
       
       return;
     }
@@ -275,9 +347,23 @@ void handleSmApi(const char *URI, const char *word4, const char *word5, const ch
     }
     sendJsonFields(word4);
   }
+  else if (strcasecmp(word4, "quality") == 0)
+  {
+    sendJsonPowerQuality();
+  }
+  else if (strcasecmp(word4, "events") == 0)
+  {
+    sendJsonPqEvents();
+  }
   else if (strcasecmp(word4, "telegram") == 0)
   {
-    showRaw = true;
+    if (!claimP1forRaw(500))
+    {
+      showRaw = false;
+      httpServer.send(503, "application/plain", "P1 port is busy, try again");
+      return;
+    }
+    p1Continuous = false;
     slimmeMeter.enable(true);
     SM_SERIAL.setTimeout(5000);  // 5 seconds must be enough ..
     memset(tlgrm, 0, sizeof(tlgrm));
@@ -431,15 +517,32 @@ void sendDeviceInfo()
   sendNestedJsonObj("uptime", upTime());
   sendNestedJsonObj("oled_type",        (int)settingOledType);
   sendNestedJsonObj("oled_flip_screen", (int)settingOledFlip);
+  sendNestedJsonObj("oled_interval",    (int)settingOledInterval);
+  sendNestedJsonObj("oled_aggregate",   sinkAggName[sinkAggregate(SINK_OLED)]);
+  sendNestedJsonObj("oled_updates",     oledUpdates);
+  sendNestedJsonObj("oled_chars_sent",  oledCharsSent);
   sendNestedJsonObj("smhasfaseinfo",    (int)settingSmHasFaseInfo);
   sendNestedJsonObj("telegraminterval", (int)settingTelegramInterval);
+  sendNestedJsonObj("continuousread",   (int)settingContinuousRead);
   sendNestedJsonObj("telegramcount",    (int)telegramCount);
   sendNestedJsonObj("telegramerrors",   (int)telegramErrors);
+#ifdef USE_P1_TASK
+  sendNestedJsonObj("telegramsdropped", p1Dropped);
+#endif
+  sendNestedJsonObj("scratchpeak",      (uint32_t)scratch.peak);
+  sendNestedJsonObj("scratchfailed",    scratch.failed);
+  sendNestedJsonObj("settingscommits",  settingsCommits);
 
 #ifdef USE_MQTT
   snprintf(cMsg, sizeof(cMsg), "%s:%04d", settingMQTTbroker, settingMQTTbrokerPort);
   sendNestedJsonObj("mqttbroker", cMsg);
   sendNestedJsonObj("mqttinterval", settingMQTTinterval);
+  sendNestedJsonObj("mqttmode", (int)settingMQTTmode);
+  sendNestedJsonObj("mqttaggregate", sinkAggName[sinkAggregate(SINK_MQTT)]);
+  sendNestedJsonObj("mqttmsgsent",  mqttMsgSent);
+  sendNestedJsonObj("mqttmsgsaved", mqttMsgSaved);
+  sendNestedJsonObj("mqttqueued",   (uint32_t)mqttQueueCount());
+  sendNestedJsonObj("mqttqueuedropped", mqttQueueDropped);
   if (mqttIsConnected)
         sendNestedJsonObj("mqttbroker_connected", "yes");
   else  sendNestedJsonObj("mqttbroker_connected", "no");
@@ -454,11 +557,21 @@ void sendDeviceInfo()
   sendNestedJsonObj("influxdb_hostname",           settingInfluxDBhostname);
   sendNestedJsonObj("influxdb_port",              (int)settingInfluxDBport);
   sendNestedJsonObj("influxdb_databasename",      settingInfluxDBdatabasename);
+  sendNestedJsonObj("influxdb_interval",          (int)sinkInterval(SINK_INFLUX));
+  sendNestedJsonObj("influxdb_aggregate",         sinkAggName[sinkAggregate(SINK_INFLUX)]);
+  sendNestedJsonObj("influxdb_posts",             influxPosts);
+  sendNestedJsonObj("influxdb_errors",            influxErrors);
+  sendNestedJsonObj("influxdb_dropped",           influxDropped);
+  sendNestedJsonObj("influxdb_spooled",           influxSpooled);
+  sendNestedJsonObj("influxdb_thinned",           influxThinned);
 #endif
 
 
   sendNestedJsonObj("reboots", (int)nrReboots);
   sendNestedJsonObj("lastreset", lastReset);
+  sendJsonMemoryInfo();
+  sendJsonStageInfo();
+  sendJsonBootInfo();
 
   httpServer.sendContent("\r\n]}\r\n");
 
@@ -470,7 +583,7 @@ void sendDeviceTime()
 {
   sendStartJsonObj("devtime");
   sendNestedJsonObj("timestamp", actTimestamp); 
-  sendNestedJsonObj("time", buildDateTimeString(actTimestamp, sizeof(actTimestamp)).c_str()); 
+  sendNestedJsonObj("time", buildDateTimeString(actTimestamp, sizeof(actTimestamp))); 
   sendNestedJsonObj("epoch", (int)now());
 
   sendEndJsonObj();
@@ -478,6 +591,80 @@ void sendDeviceTime()
 } // sendDeviceTime()
 
 
+//=======================================================================
+void sendDeviceTasks() 
+{
+  sendStartJsonObj("tasks");
+
+  for (uint8_t t = 0; t < schedNrTasks; t++)
+  {
+    sendJsonTaskObj(schedTasks[t]);
+  }
+
+  sendEndJsonObj();
+
+} // sendDeviceTasks()
+
+
+//=======================================================================
+// GET     /api/v1/dev/log                  -> the records in the log ring
+// GET     /api/v1/dev/log/levels           -> level of every module
+// GET     /api/v1/dev/log/sinks            -> the sinks (and records lost)
+// PUT|POST /api/v1/dev/log/<module|all>/<n> -> set level (0=none .. 4=debug)
+// PUT|POST /api/v1/dev/log/sinks/<n>        -> 1=serial, 2=telnet, 3=both, 0=none
+//=======================================================================
+void sendDeviceLog(const char *URI, const char *word5, const char *word6) 
+{
+  bool isPut = (httpServer.method() == HTTP_PUT || httpServer.method() == HTTP_POST);
+
+  if (strlen(word6) > 0 && !isPut)  //-- a GET never changes anything --
+  {
+    httpServer.send(405, "text/plain", "405: use PUT or POST to change the log settings\r\n");
+    return;
+  }
+
+  if (strlen(word5) == 0)
+  {
+    sendStartJsonObj("log");
+    uint32_t seq = (logHead > LOG_SLOTS) ? (logHead - LOG_SLOTS) : 0;
+    for ( ; seq != logHead; seq++)
+    {
+      sendJsonLogObj(seq, logRing[seq % LOG_SLOTS]);
+    }
+    sendEndJsonObj();
+    return;
+  }
+
+  if (strcasecmp(word5, "sinks") == 0)
+  {
+    if (strlen(word6) > 0) logSinks = (atoi(word6) & (LOG_SINK_SERIAL | LOG_SINK_TELNET));
+    sendStartJsonObj("logsinks");
+    sendNestedJsonObj("serial", (logSinks & LOG_SINK_SERIAL) ? "on" : "off");
+    sendNestedJsonObj("telnet", (logSinks & LOG_SINK_TELNET) ? "on" : "off");
+    sendNestedJsonObj("lost",   logLost);
+    sendNestedJsonObj("truncated", logTruncated);
+    sendEndJsonObj();
+    return;
+  }
+
+  if (strcasecmp(word5, "levels") != 0)
+  {
+    if (strlen(word6) == 0 || !setLogLevel(word5, atoi(word6)))
+    {
+      sendApiNotFound(URI);
+      return;
+    }
+  }
+  sendStartJsonObj("loglevels");
+  for (uint8_t m = 0; m < logNrModules; m++)
+  {
+    sendJsonLogLevelObj(logModules[m]);
+  }
+  sendEndJsonObj();
+
+} // sendDeviceLog()
+
+
 //=======================================================================
 void sendDeviceSettings() 
 {
@@ -495,9 +682,12 @@ void sendDeviceSettings()
   sendJsonSettingObj("gas_netw_costs",    settingGNBK,            "f", 0, 100, 2);
   sendJsonSettingObj("sm_has_fase_info",  settingSmHasFaseInfo,   "i", 0, 1);
   sendJsonSettingObj("tlgrm_interval",    settingTelegramInterval,"i", 2, 60);
+  sendJsonSettingObj("continuous_read",   settingContinuousRead,  "i", 0, 1);
   sendJsonSettingObj("oled_type",         settingOledType,        "i", 0, 2);
   sendJsonSettingObj("oled_screen_time",  settingOledSleep,       "i", 1, 300);
   sendJsonSettingObj("oled_flip_screen",  settingOledFlip,        "i", 0, 1);
+  sendJsonSettingObj("oled_interval",     settingOledInterval,    "i", 0, SINK_MAX_INTERVAL);
+  sendJsonSettingObj("oled_aggregate",    settingOledAggregate,   "i", 0, AGGS -1);
   sendJsonSettingObj("index_page",        settingIndexPage,       "s", sizeof(settingIndexPage) -1);
   sendJsonSettingObj("mqtt_broker",       settingMQTTbroker,      "s", sizeof(settingMQTTbroker) -1);
   sendJsonSettingObj("mqtt_broker_port",  settingMQTTbrokerPort,  "i", 1, 65535);
@@ -505,6 +695,8 @@ void sendDeviceSettings()
   sendJsonSettingObj("mqtt_passwd",       settingMQTTpasswd,      "s", sizeof(settingMQTTpasswd) -1);
   sendJsonSettingObj("mqtt_toptopic",     settingMQTTtopTopic,    "s", sizeof(settingMQTTtopTopic) -1);
   sendJsonSettingObj("mqtt_interval",     settingMQTTinterval,    "i", 0, 600);
+  sendJsonSettingObj("mqtt_mode",         settingMQTTmode,        "i", 0, 2);
+  sendJsonSettingObj("mqtt_aggregate",    settingMQTTaggregate,   "i", 0, AGGS -1);
 #ifdef USE_MINDERGAS
   sendJsonSettingObj("mindergastoken",  settingMindergasToken,    "s", sizeof(settingMindergasToken) -1);
 #endif
@@ -512,6 +704,8 @@ void sendDeviceSettings()
   sendJsonSettingObj("influxdb_hostname",           settingInfluxDBhostname,       "s", sizeof(settingInfluxDBhostname)-1);
   sendJsonSettingObj("influxdb_port",              (int)settingInfluxDBport,      "i", 1, 65535);
   sendJsonSettingObj("influxdb_databasename",      settingInfluxDBdatabasename,   "s", sizeof(settingInfluxDBdatabasename)-1);
+  sendJsonSettingObj("influxdb_interval",          (int)settingInfluxDBinterval,  "i", 0, SINK_MAX_INTERVAL);
+  sendJsonSettingObj("influxdb_aggregate",         settingInfluxDBaggregate,      "i", 0, AGGS -1);
 #endif
   sendEndJsonObj();
 
@@ -557,12 +751,13 @@ struct buildJsonApiV0SmActual
     template<typename Item>
     void apply(Item &i) {
       skip = false;
-      String Name = Item::name;
+      char Name[35];
+      strlcpy_P(Name, (PGM_P)Item::name, sizeof(Name));
       //-- for dsmr30 -----------------------------------------------
 #if defined( USE_PRE40_PROTOCOL )
-      if (Name.indexOf("gas_delivered2") == 0) Name = "gas_delivered";
+      if (strncmp(Name, "gas_delivered2", 14) == 0) strlcpy(Name, "gas_delivered", sizeof(Name));
 #endif
-      if (!isInFieldsArray(Name.c_str(), fieldsElements))
+      if (!isInFieldsArray(Name, fieldsElements))
       {
         skip = true;
       }
@@ -570,8 +765,7 @@ struct buildJsonApiV0SmActual
       {
         if (i.present()) 
         {
-          //String Unit = Item::unit();
-          sendNestedJsonV0Obj(Name.c_str(), i.val());
+          sendNestedJsonV0Obj(Name, i.val());
         }
       }
   }
@@ -601,12 +795,13 @@ struct buildJsonApi
     template<typename Item>
     void apply(Item &i) {
       skip = false;
-      String Name = Item::name;
+      char Name[35];
+      strlcpy_P(Name, (PGM_P)Item::name, sizeof(Name));
       //-- for dsmr30 -----------------------------------------------
 #if defined( USE_PRE40_PROTOCOL )
-      if (Name.indexOf("gas_delivered2") == 0) Name = "gas_delivered";
+      if (strncmp(Name, "gas_delivered2", 14) == 0) strlcpy(Name, "gas_delivered", sizeof(Name));
 #endif
-      if (!isInFieldsArray(Name.c_str(), fieldsElements))
+      if (!isInFieldsArray(Name, fieldsElements))
       {
         skip = true;
       }
@@ -614,20 +809,20 @@ struct buildJsonApi
       {
         if (i.present()) 
         {
-          String Unit = Item::unit();
+          const char *Unit = Item::unit();
         
-          if (Unit.length() > 0)
+          if (strlen(Unit) > 0)
           {
-            sendNestedJsonObj(Name.c_str(), i.val(), Unit.c_str());
+            sendNestedJsonObj(Name, i.val(), Unit);
           }
           else 
           {
-            sendNestedJsonObj(Name.c_str(), i.val());
+            sendNestedJsonObj(Name, i.val());
           }
         }
         else if (!onlyIfPresent)
         {
-          sendNestedJsonObj(Name.c_str(), "-");
+          sendNestedJsonObj(Name, "-");
         }
       }
   }
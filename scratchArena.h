@@ -0,0 +1,137 @@
+/*
+***************************************************************************
+**  Filename  : scratchArena.h
+**  Version  : v2.3.0-rc5
+**
+**  Copyright (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See bottom of file.
+***************************************************************************
+*/
+
+/*
+ * Scratch memory for the short lived strings of one API request or one
+ * telegram. Instead of String objects (a malloc() and free() for every
+ * substring, which fragments the heap) the memory is taken from one
+ * static buffer by moving a pointer. Nothing is freed on its own: the
+ * whole arena is reset at the start of the next request/telegram.
+ *
+ *   scratchReset();
+ *   const char *words[10];
+ *   int8_t wc = scratchSplit(URI, '/', words, 10);
+ *
+ * So never keep a pointer into the arena after the request or telegram
+ * is done!
+ */
+
+#ifndef _SCRATCH_ARENA_H
+#define _SCRATCH_ARENA_H
+
+#define SCRATCH_SIZE      1024
+
+typedef struct {
+    uint16_t  used;
+    uint16_t  peak;         // max. used since boot
+    uint32_t  failed;       // allocations that did not fit
+    uint8_t   buff[SCRATCH_SIZE] __attribute__((aligned(4)));
+} scratchArena;
+
+static scratchArena scratch;
+
+
+//===========================================================================================
+static inline void scratchReset()
+{
+  scratch.used = 0;
+
+} // scratchReset()
+
+
+//===========================================================================================
+// NULL if it does not fit
+static inline void *scratchAlloc(size_t size)
+{
+  size = (size + 3) & ~3;   // keep everything 4 byte aligned
+  if ((scratch.used + size) > SCRATCH_SIZE)
+  {
+    scratch.failed++;
+    return NULL;
+  }
+  void *p = &scratch.buff[scratch.used];
+  scratch.used += size;
+  if (scratch.used > scratch.peak) scratch.peak = scratch.used;
+  return p;
+
+} // scratchAlloc()
+
+
+//===========================================================================================
+// copy of (max) len chars of s, NULL if it does not fit
+static inline char *scratchStrndup(const char *s, size_t len)
+{
+  char *d = (char*)scratchAlloc(len +1);
+  if (d == NULL) return NULL;
+  memcpy(d, s, len);
+  d[len] = '\0';
+  return d;
+
+} // scratchStrndup()
+
+
+//===========================================================================================
+// split "in" into (trimmed) words. Like splitString() the last word gets
+// the rest of the string, unused words are ""
+static inline int8_t scratchSplit(const char *in, char delimiter, const char *wOut[], uint8_t maxWords)
+{
+  const char  *end;
+  const char  *s;
+  const char  *e;
+  int8_t       wordCount = 0;
+
+  for (uint8_t w = 0; w < maxWords; w++) wOut[w] = "";
+
+  while (isspace(*in)) in++;
+  end = in + strlen(in);
+  while (end > in && isspace(*(end -1))) end--;
+
+  while (in < end && wordCount < maxWords)
+  {
+    if (wordCount == (maxWords -1))   e = end;
+    else if ((e = (const char*)memchr(in, delimiter, (end - in))) == NULL) e = end;
+
+    for (s = in; s < e && isspace(*s); s++) ;
+    for (in = e; in > s && isspace(*(in -1)); in--) ;
+
+    char *word = scratchStrndup(s, (in - s));
+    wOut[wordCount++] = (word == NULL) ? "" : word;
+    in = (e < end) ? e +1 : end;
+  }
+  return wordCount;
+
+} // scratchSplit()
+
+#endif // _SCRATCH_ARENA_H
+
+
+/***************************************************************************
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit
+* persons to whom the Software is furnished to do so, subject to the
+* following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT
+* OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+* THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+***************************************************************************/
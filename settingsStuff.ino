@@ -9,8 +9,17 @@
 ***************************************************************************      
 * 1.0.11 added Mindergas Authtoken setting
 * 2.0.3 added influxdb settings
+* 2.3.0 settings are kept in a binary record (SETTINGS_BIN_FILE) that is
+*       read with one read() at boot. Changes are marked dirty and written
+*       (.bin and .ini) once nothing changed for SETTINGS_QUIET_SEC seconds.
+*       The .ini is still there for humans: it is imported if the .bin is
+*       missing, invalid or of another version, and after it is uploaded.
 */
 
+  static bool     settingsDirty   = false;
+  static uint32_t settingsCommits = 0;
+
+
 //=======================================================================
 void writeSettings() 
 {
@@ -19,7 +28,7 @@ void writeSettings()
   File file = SPIFFS.open(SETTINGS_FILE, "w"); // open for reading and writing
   if (!file) 
   {
-    DebugTf("open(%s, 'w') FAILED!!! --> Bailout\r\n", SETTINGS_FILE);
+    LogTf(LOG_ERROR, "open(%s, 'w') FAILED!!! --> Bailout\r\n", SETTINGS_FILE);
     return;
   }
   yield();
@@ -41,9 +50,12 @@ void writeSettings()
   file.print("OledType = ");          file.println(settingOledType);            Debug(F("."));
   file.print("OledSleep = ");         file.println(settingOledSleep);           Debug(F("."));
   file.print("OledFlip = ");          file.println(settingOledFlip);            Debug(F("."));
+  file.print("OledInterval = ");      file.println(settingOledInterval);        Debug(F("."));
+  file.print("OledAggregate = ");     file.println(settingOledAggregate);       Debug(F("."));
   file.print("SmHasFaseInfo = ");     file.println(settingSmHasFaseInfo);       Debug(F("."));
 
   file.print("TelegramInterval = ");  file.println(settingTelegramInterval);    Debug(F("."));
+  file.print("ContinuousRead = ");    file.println(settingContinuousRead);      Debug(F("."));
   file.print("IndexPage = ");         file.println(settingIndexPage);           Debug(F("."));
 
 #ifdef USE_MQTT
@@ -54,6 +66,8 @@ void writeSettings()
   file.print("MQTTpasswd = ");        file.println(settingMQTTpasswd);          Debug(F("."));
   file.print("MQTTinterval = ");      file.println(settingMQTTinterval);        Debug(F("."));
   file.print("MQTTtopTopic = ");      file.println(settingMQTTtopTopic);        Debug(F("."));
+  file.print("MQTTmode = ");          file.println(settingMQTTmode);            Debug(F("."));
+  file.print("MQTTaggregate = ");     file.println(settingMQTTaggregate);       Debug(F("."));
 #endif
   
 #ifdef USE_MINDERGAS
@@ -64,6 +78,8 @@ void writeSettings()
   file.print("InfluxDBhostname = ");file.println(settingInfluxDBhostname);  Debug(F("."));
   file.print("InfluxDBport = ");file.println(settingInfluxDBport);  Debug(F("."));
   file.print("InfluxDBdatabasename = ");file.println(settingInfluxDBdatabasename);  Debug(F("."));
+  file.print("InfluxDBinterval = ");file.println(settingInfluxDBinterval);  Debug(F("."));
+  file.print("InfluxDBaggregate = ");file.println(settingInfluxDBaggregate);  Debug(F("."));
 #endif
 
 file.close();  
@@ -87,11 +103,14 @@ file.close();
     DebugT(F("OledFlip = "));
     if (settingOledFlip)  Debugln(F("Yes"));
     else                  Debugln(F("No"));
+    DebugT(F("OledInterval = "));      Debugln(settingOledInterval);           
+    DebugT(F("OledAggregate = "));     Debugln(settingOledAggregate);           
 
     DebugT(F("SmHasFaseInfo")); 
     if (settingSmHasFaseInfo == 1)     Debugln("Yes");
     else                               Debugln("No");
     DebugT(F("TelegramInterval = "));  Debugln(settingTelegramInterval);            
+    DebugT(F("ContinuousRead = "));    Debugln(settingContinuousRead);            
     DebugT(F("IndexPage = "));         Debugln(settingIndexPage);             
 
 #ifdef USE_MQTT
@@ -105,6 +124,8 @@ file.close();
   #endif       
     DebugT(F("MQTTinterval = "));      Debugln(settingMQTTinterval);        
     DebugT(F("MQTTtopTopic = "));      Debugln(settingMQTTtopTopic);   
+    DebugT(F("MQTTmode = "));          Debugln(settingMQTTmode);   
+    DebugT(F("MQTTaggregate = "));     Debugln(settingMQTTaggregate);   
 #endif
   
 #ifdef USE_MINDERGAS
@@ -119,6 +140,8 @@ file.close();
     DebugT(F("InfluxDBhostname = "));  Debugln(settingInfluxDBhostname);
     DebugT(F("InfluxDBport = "));  Debugln(settingInfluxDBport);
     DebugT(F("InfluxDBdatabasename = "));  Debugln(settingInfluxDBdatabasename);
+    DebugT(F("InfluxDBinterval = "));  Debugln(settingInfluxDBinterval);
+    DebugT(F("InfluxDBaggregate = "));  Debugln(settingInfluxDBaggregate);
 #endif
   } // Verbose1
   
@@ -126,15 +149,8 @@ file.close();
 
 
 //=======================================================================
-void readSettings(bool show) 
+void settingsDefaults()
 {
-  String sTmp, nColor;
-  String words[10];
-  
-  File file;
-  
-  DebugTf(" %s ..\r\n", SETTINGS_FILE);
-
   snprintf(settingHostname, sizeof(settingHostname), "%s", _DEFAULT_HOSTNAME);
   settingEDT1               = 0.1;
   settingEDT2               = 0.2;
@@ -145,9 +161,12 @@ void readSettings(bool show)
   settingGNBK               = 11.11;
   settingSmHasFaseInfo      =  1; // default: it does
   settingTelegramInterval   = 10; // seconds
+  settingContinuousRead     =  0; // one telegram per settingTelegramInterval
   settingOledType           =  1; // 0=None, 1=SDD1306, 2=SH1106
   settingOledSleep          =  0; // infinite
   settingOledFlip           =  0; // Don't flip
+  settingOledInterval       =  0; // every telegram
+  settingOledAggregate      = AGG_LAST;
   strlcpy(settingIndexPage, "DSMRindex.html", sizeof(settingIndexPage));
   settingMQTTbroker[0]     = '\0';
   settingMQTTbrokerPort    = 1883;
@@ -155,17 +174,38 @@ void readSettings(bool show)
   settingMQTTpasswd[0]     = '\0';
   settingMQTTinterval      =  0;
   snprintf(settingMQTTtopTopic, sizeof(settingMQTTtopTopic), "%s", settingHostname);
+  settingMQTTmode          = MQTT_MODE_TOPICS;
+  settingMQTTaggregate     = AGG_LAST;
 
 #ifdef USE_INFLUXDB
   settingInfluxDBhostname[0]  = '\0';
   settingInfluxDBport         = 8086;
   snprintf(settingInfluxDBdatabasename, sizeof(settingInfluxDBdatabasename), "%s", settingHostname);
+  settingInfluxDBinterval     = 0;  // every telegram
+  settingInfluxDBaggregate    = AGG_LAST;
 #endif
 
 #ifdef USE_MINDERGAS
   settingMindergasToken[0] = '\0';
 #endif
 
+} // settingsDefaults()
+
+
+//=======================================================================
+// import SETTINGS_FILE (.ini)
+//=======================================================================
+void readSettings(bool show) 
+{
+  String sTmp, nColor;
+  String words[10];
+  
+  File file;
+  
+  DebugTf(" %s ..\r\n", SETTINGS_FILE);
+
+  settingsDefaults();
+
   if (!SPIFFS.exists(SETTINGS_FILE)) 
   {
     DebugTln(F(" .. file not found! --> created file!"));
@@ -213,20 +253,15 @@ void readSettings(bool show)
       settingOledType = words[1].toInt();
       if (settingOledType > 2) settingOledType = 1;
     }
-    if (words[0].equalsIgnoreCase("OledSleep"))           
-    {
-      settingOledSleep    = words[1].toInt();    
-      CHANGE_INTERVAL_MIN(oledSleepTimer, settingOledSleep);
-    }
+    if (words[0].equalsIgnoreCase("OledSleep"))           settingOledSleep = words[1].toInt();
     if (words[0].equalsIgnoreCase("OledFlip"))    settingOledFlip = words[1].toInt();
     if (settingOledFlip != 0) settingOledFlip = 1;
     else                      settingOledFlip = 0;
+    if (words[0].equalsIgnoreCase("OledInterval"))        settingOledInterval  = words[1].toInt();
+    if (words[0].equalsIgnoreCase("OledAggregate"))       settingOledAggregate = words[1].toInt();
     
-    if (words[0].equalsIgnoreCase("TelegramInterval"))   
-    {
-      settingTelegramInterval     = words[1].toInt(); 
-      CHANGE_INTERVAL_SEC(nextTelegram, settingTelegramInterval); 
-    }
+    if (words[0].equalsIgnoreCase("TelegramInterval"))    settingTelegramInterval = words[1].toInt();
+    if (words[0].equalsIgnoreCase("ContinuousRead"))      settingContinuousRead   = (words[1].toInt() != 0);
 
     if (words[0].equalsIgnoreCase("IndexPage"))           strlcpy(settingIndexPage, words[1].c_str(), sizeof(settingIndexPage));  
 
@@ -241,29 +276,57 @@ void readSettings(bool show)
     if (words[0].equalsIgnoreCase("MQTTpasswd"))          strlcpy(settingMQTTpasswd  , words[1].c_str(), sizeof(settingMQTTpasswd) );  
     if (words[0].equalsIgnoreCase("MQTTinterval"))        settingMQTTinterval        = words[1].toInt(); 
     if (words[0].equalsIgnoreCase("MQTTtopTopic"))        strlcpy(settingMQTTtopTopic, words[1].c_str(), sizeof(settingMQTTtopTopic));  
-    
-    CHANGE_INTERVAL_SEC(publishMQTTtimer, settingMQTTinterval);
-    CHANGE_INTERVAL_MIN(reconnectMQTTtimer, 1);
+    if (words[0].equalsIgnoreCase("MQTTmode"))
+    {
+      settingMQTTmode = words[1].toInt();
+      if (settingMQTTmode > MQTT_MODE_BOTH) settingMQTTmode = MQTT_MODE_TOPICS;
+    }
+    if (words[0].equalsIgnoreCase("MQTTaggregate"))       settingMQTTaggregate       = words[1].toInt();
 #endif
 
 #ifdef USE_INFLUXDB
-  if (words[0].equalsIgnoreCase("InfluxDBhostname"))    	{ 
-    strlcpy(settingInfluxDBhostname,     words[1].c_str(), sizeof(settingInfluxDBhostname));
-    initInfluxDB();
-  }
-  if (words[0].equalsIgnoreCase("InfluxDBport"))          {
-    settingInfluxDBport                = words[1].toInt();  
-    initInfluxDB();
-  }
-  if (words[0].equalsIgnoreCase("InfluxDBdatabasename"))  {
-    strlcpy(settingInfluxDBdatabasename, words[1].c_str(), sizeof(settingInfluxDBdatabasename));
-    initInfluxDB();
-  }
+    if (words[0].equalsIgnoreCase("InfluxDBhostname"))    strlcpy(settingInfluxDBhostname, words[1].c_str(), sizeof(settingInfluxDBhostname));
+    if (words[0].equalsIgnoreCase("InfluxDBport"))        settingInfluxDBport = words[1].toInt();  
+    if (words[0].equalsIgnoreCase("InfluxDBdatabasename"))strlcpy(settingInfluxDBdatabasename, words[1].c_str(), sizeof(settingInfluxDBdatabasename));
+    if (words[0].equalsIgnoreCase("InfluxDBinterval"))    settingInfluxDBinterval  = words[1].toInt();
+    if (words[0].equalsIgnoreCase("InfluxDBaggregate"))   settingInfluxDBaggregate = words[1].toInt();
 #endif
     
   } // while available()
   
   file.close();  
+ 
+  DebugTln(F(" ... done\r"));
+
+  settingsActivate();
+
+  if (show) showSettings();
+
+} // readSettings()
+
+
+//=======================================================================
+// the settings are (re)loaded: let everything that depends on them know
+//=======================================================================
+void settingsActivate()
+{
+  if (strlen(settingIndexPage) < 7) strlcpy(settingIndexPage, "DSMRindex.html", sizeof(settingIndexPage));
+  if (settingTelegramInterval  < 2) settingTelegramInterval = 10;
+  if (settingMQTTbrokerPort    < 1) settingMQTTbrokerPort   = 1883;
+  if (settingOledInterval      > SINK_MAX_INTERVAL) settingOledInterval     = SINK_MAX_INTERVAL;
+#ifdef USE_INFLUXDB
+  if (settingInfluxDBinterval  > SINK_MAX_INTERVAL) settingInfluxDBinterval = SINK_MAX_INTERVAL;
+#endif
+  sinkReset();
+
+  CHANGE_INTERVAL_MIN(oledSleepTimer,   settingOledSleep);
+  setTelegramIntervals();
+#ifdef USE_MQTT
+  CHANGE_INTERVAL_SEC(publishMQTTtimer, settingMQTTinterval);
+#endif
+#ifdef USE_INFLUXDB
+  initInfluxDB();
+#endif
 
   //--- this will take some time to settle in
   //--- probably need a reboot before that to happen :-(
@@ -272,16 +335,24 @@ void readSettings(bool show)
 #elif defined(ESP32)
 // TODO:**ESP32**
 #endif
- 
-  DebugTln(F(" ... done\r"));
 
+} // settingsActivate()
 
-  if (strlen(settingIndexPage) < 7) strlcpy(settingIndexPage, "DSMRindex.html", sizeof(settingIndexPage));
-  if (settingTelegramInterval  < 2) settingTelegramInterval = 10;
-  if (settingMQTTbrokerPort    < 1) settingMQTTbrokerPort   = 1883;
 
-  if (!show) return;
-  
+//=======================================================================
+// continuous read: the meter sends (and we parse) every telegram, the
+// sinks keep their own interval (see sinkPolicy)
+//=======================================================================
+void setTelegramIntervals()
+{
+  CHANGE_INTERVAL_SEC(nextTelegram,     (settingContinuousRead ? 1 : settingTelegramInterval));
+
+} // setTelegramIntervals()
+
+
+//=======================================================================
+void showSettings()
+{
   Debugln(F("\r\n==== Settings ===================================================\r"));
   Debugf("                    Hostname : %s\r\n",     settingHostname);
   Debugf("   Energy Delivered Tarief 1 : %9.7f\r\n",  settingEDT1);
@@ -293,9 +364,12 @@ void readSettings(bool show)
   Debugf("        Gas Netbeheer Kosten : %9.2f\r\n",  settingGNBK);
   Debugf("  SM Fase Info (0=No, 1=Yes) : %d\r\n",     settingSmHasFaseInfo);
   Debugf("   Telegram Process Interval : %d\r\n",     settingTelegramInterval);
+  Debugf("   Read Every Telegram (0/1) : %d\r\n",     settingContinuousRead);
   Debugf("         OLED Type (0, 1, 2) : %d\r\n",     settingOledType);
   Debugf("OLED Sleep Min. (0=oneindig) : %d\r\n",     settingOledSleep);
   Debugf("     Flip Oled (0=No, 1=Yes) : %d\r\n",     settingOledFlip);
+  Debugf("   OLED Power Interval (sec) : %d\r\n",     settingOledInterval);
+  Debugf("     OLED Power Aggr. (0..3) : %d\r\n",     settingOledAggregate);
   Debugf("                  Index Page : %s\r\n",     settingIndexPage);
 
 #ifdef USE_MQTT
@@ -311,6 +385,8 @@ void readSettings(bool show)
 #endif
   Debugf("          MQTT send Interval : %d\r\n", settingMQTTinterval);
   Debugf("              MQTT top Topic : %s\r\n", settingMQTTtopTopic);
+  Debugf("         MQTT Mode (0, 1, 2) : %d\r\n", settingMQTTmode);
+  Debugf("     MQTT Power Aggr. (0..3) : %d\r\n", settingMQTTaggregate);
 #endif  // USE_MQTT
 #ifdef USE_MINDERGAS
   Debugln(F("\r\n==== Mindergas settings ==============================================\r"));
@@ -320,15 +396,227 @@ void readSettings(bool show)
   Debugln(F("\r\n==== InfluxDB settings ===============================================\r"));
   Debugf("             InfluxDB URL:IP : %s:%d\r\n", settingInfluxDBhostname, settingInfluxDBport);
   Debugf("       InfluxDB Databasename : %s\r\n", settingInfluxDBdatabasename);
+  Debugf("     InfluxDB Interval (sec) : %d\r\n", settingInfluxDBinterval);
+  Debugf(" InfluxDB Power Aggr. (0..3) : %d\r\n", settingInfluxDBaggregate);
 #endif
   
+  if (settingsDirty) Debugln(F("\r\n(changes not yet saved)\r"));
   Debugln(F("-\r"));
 
-} // readSettings()
+} // showSettings()
 
 
 //=======================================================================
-void updateSetting(const char *field, const char *newValue)
+static uint32_t settingsCrc(const uint8_t *data, size_t len)
+{
+  uint32_t crc = 0xFFFFFFFF;
+
+  while (len--)
+  {
+    crc ^= *data++;
+    for (uint8_t b = 0; b < 8; b++)  crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+  }
+  return ~crc;
+
+} // settingsCrc()
+
+
+//=======================================================================
+void writeSettingsBin()
+{
+  settingsRecord rec;
+
+  memset(&rec, 0, sizeof(rec));   // no garbage in the padding (crc!)
+  rec.magic             = SETTINGS_MAGIC;
+  rec.version           = SETTINGS_VERSION;
+  rec.size              = sizeof(rec);
+  rec.EDT1              = settingEDT1;
+  rec.EDT2              = settingEDT2;
+  rec.ERT1              = settingERT1;
+  rec.ERT2              = settingERT2;
+  rec.GDT               = settingGDT;
+  rec.ENBK              = settingENBK;
+  rec.GNBK              = settingGNBK;
+  rec.oledSleep         = settingOledSleep;
+  rec.oledType          = settingOledType;
+  rec.oledFlip          = settingOledFlip;
+  rec.telegramInterval  = settingTelegramInterval;
+  rec.smHasFaseInfo     = settingSmHasFaseInfo;
+  rec.continuousRead    = settingContinuousRead;
+  rec.mqttMode          = settingMQTTmode;
+  rec.mqttAggregate     = settingMQTTaggregate;
+  rec.oledAggregate     = settingOledAggregate;
+  rec.oledInterval      = settingOledInterval;
+  rec.mqttInterval      = settingMQTTinterval;
+  rec.mqttBrokerPort    = settingMQTTbrokerPort;
+  strlcpy(rec.hostname,     settingHostname,      sizeof(rec.hostname));
+  strlcpy(rec.indexPage,    settingIndexPage,     sizeof(rec.indexPage));
+  strlcpy(rec.mqttBroker,   settingMQTTbroker,    sizeof(rec.mqttBroker));
+  strlcpy(rec.mqttUser,     settingMQTTuser,      sizeof(rec.mqttUser));
+  strlcpy(rec.mqttPasswd,   settingMQTTpasswd,    sizeof(rec.mqttPasswd));
+  strlcpy(rec.mqttTopTopic, settingMQTTtopTopic,  sizeof(rec.mqttTopTopic));
+#ifdef USE_MINDERGAS
+  strlcpy(rec.mindergasToken, settingMindergasToken, sizeof(rec.mindergasToken));
+#endif
+#ifdef USE_INFLUXDB
+  rec.influxDBport      = settingInfluxDBport;
+  rec.influxDBinterval  = settingInfluxDBinterval;
+  rec.influxDBaggregate = settingInfluxDBaggregate;
+  strlcpy(rec.influxDBhostname,     settingInfluxDBhostname,     sizeof(rec.influxDBhostname));
+  strlcpy(rec.influxDBdatabasename, settingInfluxDBdatabasename, sizeof(rec.influxDBdatabasename));
+#endif
+  rec.crc = settingsCrc((const uint8_t*)&rec, sizeof(rec));
+
+  File file = SPIFFS.open(SETTINGS_BIN_FILE, "w");
+  if (!file) 
+  {
+    LogTf(LOG_ERROR, "open(%s, 'w') FAILED!!! --> Bailout\r\n", SETTINGS_BIN_FILE);
+    return;
+  }
+  if (file.write((const uint8_t*)&rec, sizeof(rec)) != sizeof(rec))
+  {
+    LogTf(LOG_ERROR, "Error writing [%s] (SPIFFS full?)\r\n", SETTINGS_BIN_FILE);
+  }
+  file.close();
+
+} // writeSettingsBin()
+
+
+//=======================================================================
+// false if there is no valid record (of this version)
+//=======================================================================
+bool readSettingsBin()
+{
+  settingsRecord rec;
+  uint32_t       crc;
+
+  File file = SPIFFS.open(SETTINGS_BIN_FILE, "r");
+  if (!file) return false;
+  size_t got = file.read((uint8_t*)&rec, sizeof(rec));
+  file.close();
+
+  if (got != sizeof(rec) || rec.magic != SETTINGS_MAGIC)
+  {
+    DebugTf("[%s] not valid\r\n", SETTINGS_BIN_FILE);
+    return false;
+  }
+  if (rec.version != SETTINGS_VERSION || rec.size != sizeof(rec))
+  {
+    DebugTf("[%s] is version [%d] (need [%d])\r\n", SETTINGS_BIN_FILE, rec.version, SETTINGS_VERSION);
+    return false;
+  }
+  crc     = rec.crc;
+  rec.crc = 0;
+  if (settingsCrc((const uint8_t*)&rec, sizeof(rec)) != crc)
+  {
+    LogTf(LOG_ERROR, "[%s] CRC error\r\n", SETTINGS_BIN_FILE);
+    return false;
+  }
+
+  settingEDT1             = rec.EDT1;
+  settingEDT2             = rec.EDT2;
+  settingERT1             = rec.ERT1;
+  settingERT2             = rec.ERT2;
+  settingGDT              = rec.GDT;
+  settingENBK             = rec.ENBK;
+  settingGNBK             = rec.GNBK;
+  settingOledSleep        = rec.oledSleep;
+  settingOledType         = rec.oledType;
+  settingOledFlip         = rec.oledFlip;
+  settingTelegramInterval = rec.telegramInterval;
+  settingSmHasFaseInfo    = rec.smHasFaseInfo;
+  settingContinuousRead   = rec.continuousRead;
+  settingMQTTmode         = rec.mqttMode;
+  settingMQTTaggregate    = rec.mqttAggregate;
+  settingOledAggregate    = rec.oledAggregate;
+  settingOledInterval     = rec.oledInterval;
+  settingMQTTinterval     = rec.mqttInterval;
+  settingMQTTbrokerPort   = rec.mqttBrokerPort;
+  strlcpy(settingHostname,      rec.hostname,     sizeof(settingHostname));
+  strlcpy(settingIndexPage,     rec.indexPage,    sizeof(settingIndexPage));
+  strlcpy(settingMQTTbroker,    rec.mqttBroker,   sizeof(settingMQTTbroker));
+  strlcpy(settingMQTTuser,      rec.mqttUser,     sizeof(settingMQTTuser));
+  strlcpy(settingMQTTpasswd,    rec.mqttPasswd,   sizeof(settingMQTTpasswd));
+  strlcpy(settingMQTTtopTopic,  rec.mqttTopTopic, sizeof(settingMQTTtopTopic));
+#ifdef USE_MINDERGAS
+  strlcpy(settingMindergasToken, rec.mindergasToken, sizeof(settingMindergasToken));
+#endif
+#ifdef USE_INFLUXDB
+  settingInfluxDBport     = rec.influxDBport;
+  settingInfluxDBinterval = rec.influxDBinterval;
+  settingInfluxDBaggregate = rec.influxDBaggregate;
+  strlcpy(settingInfluxDBhostname,     rec.influxDBhostname,     sizeof(settingInfluxDBhostname));
+  strlcpy(settingInfluxDBdatabasename, rec.influxDBdatabasename, sizeof(settingInfluxDBdatabasename));
+#endif
+  return true;
+
+} // readSettingsBin()
+
+
+//=======================================================================
+// at boot: the binary record, if that is not there (or not valid) import
+// the .ini and make a binary record of it
+//=======================================================================
+void loadSettings(bool show)
+{
+  if (readSettingsBin())
+  {
+    DebugTf("settings from [%s]\r\n", SETTINGS_BIN_FILE);
+    settingsActivate();
+    if (show) showSettings();
+    return;
+  }
+  readSettings(show);
+  writeSettingsBin();
+
+} // loadSettings()
+
+
+//=======================================================================
+// SETTINGS_FILE is uploaded (edited by a human?)
+//=======================================================================
+void importSettings()
+{
+  DebugTf("import [%s]\r\n", SETTINGS_FILE);
+  writeToSysLog("import [%s]", SETTINGS_FILE);
+  readSettings(false);
+  writeSettingsBin();
+  settingsDirty = false;
+
+} // importSettings()
+
+
+//=======================================================================
+// the settings are changed in memory: write them after a quiet period
+//=======================================================================
+void markSettingsDirty()
+{
+  settingsDirty = true;
+  RESTART_TIMER(settingsCommitTimer);
+
+} // markSettingsDirty()
+
+
+//=======================================================================
+// called from the scheduler SETTINGS_QUIET_SEC after the last change (and
+// before a reboot)
+//=======================================================================
+void commitSettings()
+{
+  if (!settingsDirty) return;
+
+  settingsDirty = false;
+  settingsCommits++;
+  DebugTf("commit settings (#%u)\r\n", settingsCommits);
+  writeSettingsBin();
+  writeSettings();        // keep the .ini for humans
+
+} // commitSettings()
+
+
+//=======================================================================
+// change one setting in memory (without writing the settings file)
+void applySetting(const char *field, const char *newValue)
 {
   DebugTf("-> field[%s], newValue[%s]\r\n", field, newValue);
 
@@ -383,11 +671,26 @@ void updateSetting(const char *field, const char *newValue)
     else                      settingOledFlip = 0;
     oled_Init();
   }
+  if (!strcasecmp(field, "oled_interval"))
+  {
+    settingOledInterval = atoi(newValue);
+    if (settingOledInterval > SINK_MAX_INTERVAL) settingOledInterval = SINK_MAX_INTERVAL;
+  }
+  if (!strcasecmp(field, "oled_aggregate"))
+  {
+    settingOledAggregate = atoi(newValue);
+    sinkReset();
+  }
   
   if (!strcasecmp(field, "tlgrm_interval"))    
   {
     settingTelegramInterval     = atoi(newValue);  
-    CHANGE_INTERVAL_SEC(nextTelegram, settingTelegramInterval)
+    setTelegramIntervals();
+  }
+  if (!strcasecmp(field, "continuous_read"))    
+  {
+    settingContinuousRead       = (atoi(newValue) != 0);  
+    setTelegramIntervals();
   }
 
   if (!strcasecmp(field, "index_page"))        strlcpy(settingIndexPage, newValue, sizeof(settingIndexPage));  
@@ -401,28 +704,36 @@ void updateSetting(const char *field, const char *newValue)
    {
     strlcpy(settingMQTTbroker, newValue, sizeof(settingMQTTbroker));   
     DebugTf("settingMQTTbroker to : [%s]\r\n", settingMQTTbroker);
-    mqttIsConnected = false;
+    connectMQTT();  // restart the state machine
   }
   if (!strcasecmp(field, "mqtt_broker_port")) {
     settingMQTTbrokerPort = atoi(newValue);  
-    mqttIsConnected = false;
-    CHANGE_INTERVAL_MS(reconnectMQTTtimer, 100); // try reconnecting cyclus timer
+    connectMQTT();  // restart the state machine
   }
   if (!strcasecmp(field, "mqtt_user")) {
     strlcpy(settingMQTTuser, newValue, sizeof(settingMQTTuser));   
-    mqttIsConnected = false;
-    CHANGE_INTERVAL_MS(reconnectMQTTtimer, 100); // try reconnecting cyclus timer
+    connectMQTT();  // restart the state machine
   }
   if (!strcasecmp(field, "mqtt_passwd")) {
     strlcpy(settingMQTTpasswd, newValue, sizeof(settingMQTTpasswd)); 
-    mqttIsConnected = false;
-    CHANGE_INTERVAL_MS(reconnectMQTTtimer, 100); // try reconnecting cyclus timer
+    connectMQTT();  // restart the state machine
   }
   if (!strcasecmp(field, "mqtt_interval")) {
     settingMQTTinterval   = atoi(newValue);  
     CHANGE_INTERVAL_SEC(publishMQTTtimer, settingMQTTinterval);
   }
-  if (!strcasecmp(field, "mqtt_toptopic"))  strlcpy(settingMQTTtopTopic, newValue, sizeof(settingMQTTtopTopic));
+  if (!strcasecmp(field, "mqtt_toptopic")) {
+    strlcpy(settingMQTTtopTopic, newValue, sizeof(settingMQTTtopTopic));
+    buildMQTTtopicTable();
+  }
+  if (!strcasecmp(field, "mqtt_mode")) {
+    settingMQTTmode = atoi(newValue);
+    if (settingMQTTmode > MQTT_MODE_BOTH) settingMQTTmode = MQTT_MODE_TOPICS;
+  }
+  if (!strcasecmp(field, "mqtt_aggregate")) {
+    settingMQTTaggregate = atoi(newValue);
+    sinkReset();
+  }
 #endif
 
 #ifdef USE_INFLUXDB
@@ -438,9 +749,24 @@ void updateSetting(const char *field, const char *newValue)
     strlcpy(settingInfluxDBdatabasename, newValue, sizeof(settingInfluxDBdatabasename));
     initInfluxDB();
   }
+  if (!strcasecmp(field, "influxdb_interval")) {
+    settingInfluxDBinterval = atoi(newValue);
+    if (settingInfluxDBinterval > SINK_MAX_INTERVAL) settingInfluxDBinterval = SINK_MAX_INTERVAL;
+  }
+  if (!strcasecmp(field, "influxdb_aggregate")) {
+    settingInfluxDBaggregate = atoi(newValue);
+    sinkReset();
+  }
 #endif
+  
+} // applySetting()
+
 
-  writeSettings();
+//=======================================================================
+void updateSetting(const char *field, const char *newValue)
+{
+  applySetting(field, newValue);
+  markSettingsDirty();
   
 } // updateSetting()
 
@@ -0,0 +1,245 @@
+/*
+***************************************************************************
+**  Program  : sinkPolicy, part of DSMRlogger-Next
+**  Version  : v2.3.0-rc5
+**
+**  Copyright (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See bottom of file.
+***************************************************************************
+**  Every sink (MQTT, InfluxDB and the OLED screen) has its own interval
+**  and its own aggregation for the power fields (kW, V and A):
+**
+**    0 = last    the value of the telegram at the moment the sink sends
+**    1 = mean    of every telegram since the sink last sent
+**    2 = min
+**    3 = max
+**
+**  Meter readings (kWh, m3, GJ) always go out as the last value.
+**
+**  Every parsed telegram is added to the running window of every sink
+**  that aggregates (sinkSample()). When a sink is due, sinkBegin() puts
+**  the aggregated values in DSMRdata, the sink sends what it always sent,
+**  and sinkEnd() puts the values of the telegram back and starts a new
+**  window.
+**
+**  Intervals: MQTT      settingMQTTinterval (publishMQTTtimer)
+**             InfluxDB  settingInfluxDBinterval (0 = every telegram, in
+**                       continuous mode every settingTelegramInterval)
+**             OLED      settingOledInterval (0 = every telegram)
+*/
+
+  static sinkAccum sinkAcc[SINKS][SINK_FIELDS];
+  static uint32_t  sinkSaved[SINK_FIELDS];        // values of the telegram during sinkBegin()/sinkEnd()
+  static uint32_t  sinkLastMs[SINKS];
+
+  const char *sinkName[]      = { "mqtt", "influxdb", "oled" };
+  const char *sinkAggName[]   = { "last", "mean", "min", "max" };
+
+
+//===========================================================================================
+static bool isSinkField(const char *unit)
+{
+  return (!strcmp(unit, "kW") || !strcmp(unit, "V") || !strcmp(unit, "A"));
+
+} // isSinkField()
+
+
+//===========================================================================================
+uint8_t sinkAggregate(uint8_t sink)
+{
+  uint8_t agg = AGG_LAST;
+
+  switch(sink)
+  {
+    case SINK_MQTT:   agg = settingMQTTaggregate;       break;
+#ifdef USE_INFLUXDB
+    case SINK_INFLUX: agg = settingInfluxDBaggregate;   break;
+#endif
+    case SINK_OLED:   agg = settingOledAggregate;       break;
+  }
+  return (agg < AGGS) ? agg : AGG_LAST;
+
+} // sinkAggregate()
+
+
+//===========================================================================================
+uint16_t sinkInterval(uint8_t sink)
+{
+  switch(sink)
+  {
+    case SINK_MQTT:   return settingMQTTinterval;
+#ifdef USE_INFLUXDB
+    case SINK_INFLUX: if (settingInfluxDBinterval == 0 && settingContinuousRead)  return settingTelegramInterval;
+                      return settingInfluxDBinterval;
+#endif
+    case SINK_OLED:   return settingOledInterval;
+  }
+  return 0;
+
+} // sinkInterval()
+
+
+//===========================================================================================
+// telegrams do not come in exactly on time, so a sink is due half a
+// telegram before its interval is over (or it would skip one)
+//===========================================================================================
+bool sinkDue(uint8_t sink)
+{
+  uint32_t intervalMs  = sinkInterval(sink) * 1000UL;
+  uint32_t halfTlgrmMs = (settingContinuousRead ? 1 : settingTelegramInterval) * 500UL;
+
+  if (intervalMs == 0) return true;
+  return ((millis() - sinkLastMs[sink]) + halfTlgrmMs >= intervalMs);
+
+} // sinkDue()
+
+
+//===========================================================================================
+struct sinkVisitor {
+
+    uint8_t   f = 0;
+    uint8_t   sink;
+    uint8_t   action;       // 0 = sample, 1 = begin, 2 = end
+
+    template<typename Item>
+    void apply(Item &i) {
+      if (!isSinkField(Item::unit())) return;
+      if (f >= SINK_FIELDS) return;
+      if (i.present()) handle(f, i.val());
+      f++;
+    }
+
+    void handle(uint8_t fld, FixedValue &v) {
+      if (action == 0)
+      {
+        for (uint8_t s = 0; s < SINKS; s++)
+        {
+          if (sinkAggregate(s) == AGG_LAST) continue;
+          sinkAccum &a = sinkAcc[s][fld];
+          if (a.n >= SINK_MAX_SAMPLES) continue;      // sink is not sending
+          if (a.n == 0)  { a.sum = 0; a.min = a.max = v._value; }
+          a.sum += v._value;
+          if (v._value < a.min) a.min = v._value;
+          if (v._value > a.max) a.max = v._value;
+          a.n++;
+        }
+        return;
+      }
+      sinkAccum &a = sinkAcc[sink][fld];
+      if (action == 1)
+      {
+        sinkSaved[fld] = v._value;
+        if (a.n == 0) return;
+        switch(sinkAggregate(sink))
+        {
+          case AGG_MEAN:  v._value = (a.sum + (a.n / 2)) / a.n; break;
+          case AGG_MIN:   v._value = a.min;                     break;
+          case AGG_MAX:   v._value = a.max;                     break;
+        }
+        return;
+      }
+      v._value = sinkSaved[fld];
+      a.n      = 0;
+    }
+
+    //-- kW, V and A are FixedValue's, nothing else to aggregate --
+    template<typename T>
+    void handle(uint8_t fld, T &v) {}
+
+};  // struct sinkVisitor
+
+
+//===========================================================================================
+// called for every (parsed) telegram
+//===========================================================================================
+void sinkSample()
+{
+  sinkVisitor sv;
+  bool        aggregates = false;
+
+  for (uint8_t s = 0; s < SINKS; s++)
+  {
+    if (sinkAggregate(s) != AGG_LAST) aggregates = true;
+  }
+  if (!aggregates) return;
+
+  sv.action = 0;
+  DSMRdata.applyEach(sv);
+
+} // sinkSample()
+
+
+//===========================================================================================
+// DSMRdata holds the aggregated values until sinkEnd()
+//===========================================================================================
+void sinkBegin(uint8_t sink)
+{
+  sinkVisitor sv;
+
+  if (sinkAggregate(sink) == AGG_LAST) return;
+  sv.sink   = sink;
+  sv.action = 1;
+  DSMRdata.applyEach(sv);
+
+} // sinkBegin()
+
+
+//===========================================================================================
+void sinkEnd(uint8_t sink)
+{
+  sinkVisitor sv;
+
+  sinkLastMs[sink] = millis();
+  if (sinkAggregate(sink) == AGG_LAST) return;
+  sv.sink   = sink;
+  sv.action = 2;
+  DSMRdata.applyEach(sv);
+
+} // sinkEnd()
+
+
+//===========================================================================================
+// a changed policy starts with an empty window
+//===========================================================================================
+void sinkReset()
+{
+  memset(sinkAcc, 0, sizeof(sinkAcc));
+
+} // sinkReset()
+
+
+//===========================================================================================
+void showSinkPolicies()
+{
+  for (uint8_t s = 0; s < SINKS; s++)
+  {
+    Debugf(" sink %-9s every %4d sec, power fields: %s\r\n"
+                            , sinkName[s], sinkInterval(s), sinkAggName[sinkAggregate(s)]);
+  }
+
+} // showSinkPolicies()
+
+
+/***************************************************************************
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit
+* persons to whom the Software is furnished to do so, subject to the
+* following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT
+* OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+* THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+***************************************************************************/
@@ -0,0 +1,101 @@
+/*
+***************************************************************************
+**  Filename  : spscRing.h
+**  Version  : v2.3.0-rc5
+**
+**  Copyright (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See bottom of file.
+***************************************************************************
+*/
+
+/*
+ * Lock-free ring for exactly one producer and one consumer (that may run
+ * on different cores). The producer fills a slot in place and then
+ * publishes it, the consumer reads the slot in place and then frees it:
+ *
+ *   spscRing<p1Telegram, 2> ring;
+ *
+ *   producer:  p1Telegram *t = ring.reserve();   // NULL when full
+ *              if (t) { ...fill *t...; ring.commit(); }
+ *
+ *   consumer:  p1Telegram *t = ring.peek();      // NULL when empty
+ *              if (t) { ...use *t...; ring.pop(); }
+ *
+ * head is only written by the producer, tail only by the consumer. The
+ * release/acquire pair makes sure the contents of a slot are visible
+ * before its index is. Both counters run free, (head - tail) is the
+ * number of filled slots, so all N slots can be used.
+ */
+
+#ifndef _SPSC_RING_H
+#define _SPSC_RING_H
+
+#include <atomic>
+
+template <typename T, uint8_t N>
+struct spscRing
+{
+  T                      slot[N];
+  std::atomic<uint32_t>  head {0};    // slots published by the producer
+  std::atomic<uint32_t>  tail {0};    // slots freed by the consumer
+
+  //-- producer: the slot to fill, NULL if the ring is full --
+  T *reserve()
+  {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if ((h - tail.load(std::memory_order_acquire)) >= N) return NULL;
+    return &slot[h % N];
+  }
+
+  //-- producer: the reserved slot is filled, hand it over --
+  void commit()
+  {
+    head.store(head.load(std::memory_order_relaxed) +1, std::memory_order_release);
+  }
+
+  //-- consumer: the oldest filled slot, NULL if the ring is empty --
+  T *peek()
+  {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if (head.load(std::memory_order_acquire) == t) return NULL;
+    return &slot[t % N];
+  }
+
+  //-- consumer: done with the slot from peek(), give it back --
+  void pop()
+  {
+    tail.store(tail.load(std::memory_order_relaxed) +1, std::memory_order_release);
+  }
+
+  uint8_t count()
+  {
+    return (uint8_t)(head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire));
+  }
+};
+
+#endif // _SPSC_RING_H
+
+
+/***************************************************************************
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit
+* persons to whom the Software is furnished to do so, subject to the
+* following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT
+* OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+* THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+***************************************************************************/
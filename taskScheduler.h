@@ -0,0 +1,137 @@
+/*
+***************************************************************************
+**  Filename  : taskScheduler.h
+**  Version  : v2.3.0-rc5
+**
+**  Copyright (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See bottom of file.
+***************************************************************************
+*/
+
+/*
+ * Small cooperative scheduler on top of the safeTimers. A task is a
+ * function and the timer (DECLARE_TIMER_xx) that tells when it is due:
+ *
+ *   DECLARE_TIMER_SEC(updateDisplay, 5);
+ *   ...
+ *   ADD_TASK(updateDisplay, doUpdateDisplay, PRIO_DISPLAY);
+ *   ...
+ *   loop() { doSystemTasks(); runScheduledTask(); }
+ *
+ * Tasks are kept sorted on priority (a lower value is more important).
+ * runScheduledTask() runs (at most) one task per call: the most
+ * important task that is due. So the system tasks (serial input, web
+ * server) get a turn in between. CHANGE_INTERVAL_xx(), RESTART_TIMER()
+ * and TIME_LEFT_xx() still work on the timer of a task.
+ *
+ * For every task the number of runs, total and max. run time (us) and
+ * the (max.) time it started after it was due (ms) are kept.
+ */
+
+#ifndef _TASK_SCHEDULER_H
+#define _TASK_SCHEDULER_H
+
+#define MAX_TASKS         12
+
+enum { PRIO_TELEGRAM, PRIO_SYSTEM, PRIO_DISPLAY, PRIO_UPLOAD, PRIO_LOW };
+
+typedef struct {
+    const char *name;
+    void      (*func)();
+    uint8_t     prio;
+    uint32_t   *due;
+    uint32_t   *interval;
+    byte       *type;
+    uint32_t    runs;
+    uint64_t    totalUs;
+    uint32_t    maxUs;
+    uint32_t    lastLateMs;
+    uint32_t    maxLateMs;
+} schedTask;
+
+static schedTask  schedTasks[MAX_TASKS];
+static uint8_t    schedNrTasks = 0;
+
+#define ADD_TASK(timerName, func, prio) \
+              __AddTask__(#timerName, func, prio, timerName##_due, timerName##_interval, timerName##_type)
+
+
+//===========================================================================================
+static inline bool __AddTask__(const char *name, void (*func)(), uint8_t prio
+                             , uint32_t &due, uint32_t &interval, byte &type)
+{
+  uint8_t t;
+
+  if (schedNrTasks >= MAX_TASKS) return false;
+
+  //-- insert after all tasks with the same (or a more important) priority --
+  for (t = schedNrTasks; (t > 0 && schedTasks[t-1].prio > prio); t--)
+  {
+    schedTasks[t] = schedTasks[t-1];
+  }
+  memset(&schedTasks[t], 0, sizeof(schedTask));
+  schedTasks[t].name      = name;
+  schedTasks[t].func      = func;
+  schedTasks[t].prio      = prio;
+  schedTasks[t].due       = &due;
+  schedTasks[t].interval  = &interval;
+  schedTasks[t].type      = &type;
+  schedNrTasks++;
+  return true;
+
+} // __AddTask__()
+
+
+//===========================================================================================
+// run the most important task that is due, returns its index (or -1)
+static inline int8_t runScheduledTask()
+{
+  for (uint8_t t = 0; t < schedNrTasks; t++)
+  {
+    schedTask &task = schedTasks[t];
+    int32_t   late  = (int32_t)(millis() - *task.due);
+
+    if (late < 0) continue;
+    if (!__Due__(*task.due, *task.interval, *task.type)) continue;
+
+    uint32_t start = micros();
+    task.func();
+    uint32_t took  = micros() - start;
+
+    task.runs++;
+    task.totalUs   += took;
+    task.lastLateMs = late;
+    if (took > task.maxUs)      task.maxUs     = took;
+    if ((uint32_t)late > task.maxLateMs)  task.maxLateMs = late;
+    return t;
+  }
+  return -1;
+
+} // runScheduledTask()
+
+#endif // _TASK_SCHEDULER_H
+
+
+/***************************************************************************
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit
+* persons to whom the Software is furnished to do so, subject to the
+* following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT
+* OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+* THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+***************************************************************************/
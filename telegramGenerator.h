@@ -0,0 +1,490 @@
+/*
+***************************************************************************
+**  Filename  : telegramGenerator.h
+**  Version  : v2.3.0-rc5
+**
+**  Copyright (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See bottom of file.
+***************************************************************************
+*/
+
+/*
+ * Builds P1 telegrams as a Smart Meter would send them, without a Smart
+ * Meter. The values come from a simple model of a household (base load
+ * with a morning and evening peak, solar panels on L1, gas for heating
+ * and hot water, all depending on time of day and season) driven by a
+ * seeded random generator. So the same seed and the same times give
+ * exactly the same telegrams.
+ *
+ *   tgState gen;
+ *   tgBegin(gen, 1, TG_DSMR50, now());
+ *   ...
+ *   tgNext(gen, now());                           // advance the meter
+ *   len = tgBuild(gen, buff, sizeof(buff));       // into a buffer, or
+ *   tgWrite(gen, Serial);                         // into a Stream/File
+ *
+ * There is no rate limit: tgNext() integrates the energy over the time
+ * since the previous call (in steps of max. TG_MAX_STEP seconds), so it
+ * can be called every second, once an hour or a 1000 times per second
+ * with a faked time.
+ *
+ * Protocols: TG_DSMR22, TG_DSMR30 (no CRC, gas on two lines), TG_DSMR42
+ * (hourly gas), TG_DSMR50 (5 minute gas, voltages) and TG_BELGIUM (e-MUCS,
+ * with the 15 minute peak demand).
+ */
+
+#ifndef _TELEGRAM_GENERATOR_H
+#define _TELEGRAM_GENERATOR_H
+
+#include <math.h>
+
+#define TG_MAX_LINE        100
+#define TG_MAX_TELEGRAM   1500
+#define TG_MAX_STEP        900    // seconds
+#define TG_BASE_LOAD       150    // Watt
+#define TG_SOLAR_PEAK     3500    // Watt
+
+enum { TG_DSMR22, TG_DSMR30, TG_DSMR42, TG_DSMR50, TG_BELGIUM };
+
+#if defined( USE_PRE40_PROTOCOL )
+  #define TG_PROTOCOL   TG_DSMR30
+#elif defined( USE_BELGIUM_PROTOCOL )
+  #define TG_PROTOCOL   TG_BELGIUM
+#else
+  #define TG_PROTOCOL   TG_DSMR50
+#endif
+
+typedef struct {
+    uint32_t  rnd;            // xorshift32, never 0
+    uint8_t   protocol;
+    uint8_t   tariff;         // as in 0-0:96.14.0
+    time_t    time;           // of the telegram to build
+    double    edt[2], ert[2]; // kWh for tariff 1 and 2
+    double    gas;            // m3
+    double    gasReading;     // gas at gasTime (meters send it every 5 min/hour)
+    time_t    gasTime;
+    float     cloud;          // solar yield of today (0.1 .. 1.0)
+    int8_t    cloudDay;
+    int32_t   pd[3], pr[3];   // Watt delivered/returned per phase
+    int16_t   volt[3];        // 0.1 Volt
+    float     avgW;           // Belgium: 15 minute average demand
+    float     peakW;          //          and its highest value this month
+    time_t    peakTime;
+    uint16_t  crc;
+    uint32_t  count;          // telegrams built
+    char      ts[14], gasTs[14], peakTs[14];
+} tgState;
+
+
+//===========================================================================================
+static inline uint32_t tgRandom(tgState &g)
+{
+  g.rnd ^= g.rnd << 13;
+  g.rnd ^= g.rnd >> 17;
+  g.rnd ^= g.rnd << 5;
+  return g.rnd;
+
+} // tgRandom()
+
+// 0.0 .. 1.0
+static inline float tgUniform(tgState &g) { return (tgRandom(g) % 10001) / 10000.0; }
+// -1.0 .. 1.0
+static inline float tgNoise(tgState &g)   { return (tgUniform(g) * 2.0) - 1.0; }
+
+
+//===========================================================================================
+static inline uint16_t tgCrc16(uint16_t crc, const char *buf, size_t len)
+{
+  while (len--)
+  {
+    crc ^= (uint8_t)*buf++;
+    for (uint8_t b = 0; b < 8; b++)  crc = (crc & 1) ? ((crc >> 1) ^ 0xA001) : (crc >> 1);
+  }
+  return crc;
+
+} // tgCrc16()
+
+
+//===========================================================================================
+// YYMMDDhhmmssX (X = S/W, the summer time is only roughly right)
+static inline void tgTimestamp(time_t t, char *ts)
+{
+  tmElements_t tm;
+
+  breakTime(t, tm);
+  snprintf(ts, 14, "%02d%02d%02d%02d%02d%02d%c", (tm.Year + 1970) % 100, tm.Month, tm.Day
+                                             , tm.Hour, tm.Minute, tm.Second
+                                             , (tm.Month > 3 && tm.Month < 11) ? 'S' : 'W');
+
+} // tgTimestamp()
+
+
+//===========================================================================================
+// what the household does at time t, for dt seconds
+static inline void tgModel(tgState &g, time_t t, uint32_t dt)
+{
+  tmElements_t tm;
+  float h, winter, load, solar = 0, net, gasRate, rise, set, phase[3];
+  bool  low;
+
+  breakTime(t, tm);
+  h      = tm.Hour + (tm.Minute / 60.0);
+  winter = 0.5 + 0.5 * cos(2 * M_PI * (tm.Month - 1) / 12.0);   // 1 in januari, 0 in juli
+
+  //-- base load, morning and evening peak, now and then a kettle or the oven --
+  load = TG_BASE_LOAD + (50 * winter);
+  if (h >= 7  && h < 9)   load +=  500 * sin(M_PI * (h - 7)  / 2);
+  if (h >= 17 && h < 23)  load += 1200 * sin(M_PI * (h - 17) / 6);
+  if (tgUniform(g) < 0.03)  load += 2000;
+  load *= 1.0 + (0.15 * tgNoise(g));
+
+  //-- solar: sine from sunrise to sunset, less and shorter in winter --
+  if (tm.Day != g.cloudDay)
+  {
+    g.cloudDay = tm.Day;
+    g.cloud    = 0.1 + (0.9 * tgUniform(g));
+  }
+  rise = 5.0  + (3.5 * winter);
+  set  = 22.0 - (5.0 * winter);
+  if (h > rise && h < set)
+  {
+    solar = TG_SOLAR_PEAK * (1.0 - (0.7 * winter)) * g.cloud
+                          * sin(M_PI * (h - rise) / (set - rise)) * (1.0 + (0.1 * tgNoise(g)));
+  }
+
+  //-- the inverter is on L1 --
+  phase[0] = (load * 0.5) - solar;
+  phase[1] =  load * 0.3;
+  phase[2] =  load * 0.2;
+  for (uint8_t p = 0; p < 3; p++)
+  {
+    g.pd[p]   = (phase[p] > 0) ?  phase[p] : 0;
+    g.pr[p]   = (phase[p] < 0) ? -phase[p] : 0;
+    g.volt[p] = 2300 + (30 * tgNoise(g)) - (phase[p] / 100);
+  }
+
+  //-- low tariff at night and in the weekend (Belgium: 1 = day, 2 = night) --
+  low = (h < 7 || h >= 23 || tm.Wday == 1 || tm.Wday == 7);
+  if (g.protocol == TG_BELGIUM) g.tariff = low ? 2 : 1;
+  else                          g.tariff = low ? 1 : 2;
+
+  net = load - solar;
+  if (net > 0)  g.edt[g.tariff -1] +=  net * dt / 3600000.0;
+  else          g.ert[g.tariff -1] += -net * dt / 3600000.0;
+
+  //-- gas: heating (mostly daytime, mostly winter) and a shower now and then --
+  gasRate = 0.03 + (0.9 * winter * ((h >= 6 && h < 23) ? 1.0 : 0.3));
+  if (tgUniform(g) < 0.02)  gasRate += 1.2;
+  g.gas += gasRate * dt / 3600.0;
+
+  //-- Belgium: (running) 15 minute average and its monthly peak --
+  float w = (dt >= 900) ? 1.0 : (dt / 900.0);
+  g.avgW += ((net > 0 ? net : 0) - g.avgW) * w;
+
+} // tgModel()
+
+
+//===========================================================================================
+// advance the meter to time t
+static inline void tgNext(tgState &g, time_t t)
+{
+  uint32_t interval = (g.protocol >= TG_DSMR50) ? 300 : 3600;
+  uint32_t step;
+
+  if (t <= g.time)  tgModel(g, t, 0);   // (first telegram) only the actual values
+  while (g.time < t)
+  {
+    step    = ((t - g.time) > TG_MAX_STEP) ? TG_MAX_STEP : (t - g.time);
+    g.time += step;
+    tgModel(g, g.time, step);
+  }
+  g.time = t;
+
+  if (month(g.peakTime) != month(t))  g.peakW = 0;
+  if (g.avgW > g.peakW)
+  {
+    g.peakW    = g.avgW;
+    g.peakTime = t;
+  }
+  if ((t / interval) != (g.gasTime / interval) || g.gasTime == 0)
+  {
+    g.gasTime    = t - (t % interval);
+    g.gasReading = g.gas;
+  }
+  tgTimestamp(t,          g.ts);
+  tgTimestamp(g.gasTime,  g.gasTs);
+  tgTimestamp(g.peakTime, g.peakTs);
+
+} // tgNext()
+
+
+//===========================================================================================
+static inline void tgBegin(tgState &g, uint32_t seed, uint8_t protocol, time_t start)
+{
+  memset(&g, 0, sizeof(g));
+  g.rnd       = (seed == 0) ? 0x2545F491 : seed;
+  tgRandom(g);  tgRandom(g);    // seeds close together give other streams
+  g.protocol  = protocol;
+  g.cloudDay  = -1;
+  g.edt[0]    = 1000 + (tgRandom(g) % 9000) + (tgUniform(g) / 10.0);
+  g.edt[1]    = 1000 + (tgRandom(g) % 9000) + (tgUniform(g) / 10.0);
+  g.ert[0]    =         tgRandom(g) % 3000;
+  g.ert[1]    =         tgRandom(g) % 3000;
+  g.gas       =  500 + (tgRandom(g) % 4000);
+  g.time      = start;
+  g.peakTime  = start;
+  tgNext(g, start);
+
+} // tgBegin()
+
+
+//===========================================================================================
+// formats a line and appends "\r\n", returns its length
+static inline int16_t tgFmt(char *line, size_t size, const char *fmt, ...)
+{
+  va_list args;
+  int     len;
+
+  va_start(args, fmt);
+  len = vsnprintf(line, size -2, fmt, args);
+  va_end(args);
+  if (len < 0)                   len = 0;
+  if (len > (int)(size -3))      len = size -3;
+  line[len++] = '\r';
+  line[len++] = '\n';
+  line[len]   = '\0';
+  return len;
+
+} // tgFmt()
+
+
+//===========================================================================================
+static inline int16_t tgLine30(tgState &g, uint8_t n, char *line, size_t size)
+{
+  switch(n)
+  {
+    case  0:  if (g.protocol == TG_DSMR22)
+                    return tgFmt(line, size, "/ISk5\\2ME382-1003");
+              return tgFmt(line, size, "/KMP5 KA6U001585575011");
+    case  1:  return tgFmt(line, size, "");
+    case  2:  return tgFmt(line, size, "0-0:96.1.1(4B384547303034303436333935353037)");
+    case  3:  return tgFmt(line, size, "1-0:1.8.1(%09.3f*kWh)", g.edt[0]);
+    case  4:  return tgFmt(line, size, "1-0:1.8.2(%09.3f*kWh)", g.edt[1]);
+    case  5:  return tgFmt(line, size, "1-0:2.8.1(%09.3f*kWh)", g.ert[0]);
+    case  6:  return tgFmt(line, size, "1-0:2.8.2(%09.3f*kWh)", g.ert[1]);
+    case  7:  return tgFmt(line, size, "0-0:96.14.0(%04d)", g.tariff);
+    case  8:  return tgFmt(line, size, "1-0:1.7.0(%07.2f*kW)", (g.pd[0] + g.pd[1] + g.pd[2]) / 1000.0);
+    case  9:  return tgFmt(line, size, "1-0:2.7.0(%07.2f*kW)", (g.pr[0] + g.pr[1] + g.pr[2]) / 1000.0);
+    case 10:  return tgFmt(line, size, "0-0:17.0.0(999*A)");
+    case 11:  return tgFmt(line, size, "0-0:96.3.10(1)");
+    case 12:  return tgFmt(line, size, "0-0:96.13.1()");
+    case 13:  return tgFmt(line, size, "0-0:96.13.0()");
+    case 14:  return tgFmt(line, size, "0-1:24.1.0(3)");
+    case 15:  return tgFmt(line, size, "0-1:96.1.0(3238313031353431303031333733353131)");
+    case 16:  return tgFmt(line, size, "0-1:24.3.0(%12.12s)(08)(60)(1)(0-1:24.2.1)(m3)", g.gasTs);
+    case 17:  return tgFmt(line, size, "(%09.3f)", g.gasReading);
+    case 18:  return tgFmt(line, size, "0-1:24.4.0(1)");
+    case 19:  return tgFmt(line, size, "!");
+  }
+  return -1;
+
+} // tgLine30()
+
+
+//===========================================================================================
+static inline int16_t tgLine40(tgState &g, uint8_t n, char *line, size_t size)
+{
+  bool v50 = (g.protocol == TG_DSMR50);
+
+  switch(n)
+  {
+    case  0:  if (v50)  return tgFmt(line, size, "/XMX5LGBBLB2410065887");
+              return tgFmt(line, size, "/KFM5KAIFA-METER");
+    case  1:  return tgFmt(line, size, "");
+    case  2:  return tgFmt(line, size, "1-3:0.2.8(%d)", v50 ? 50 : 42);
+    case  3:  return tgFmt(line, size, "0-0:1.0.0(%s)", g.ts);
+    case  4:  return tgFmt(line, size, "0-0:96.1.1(4530303336303000000000000000000040)");
+    case  5:  return tgFmt(line, size, "1-0:1.8.1(%010.3f*kWh)", g.edt[0]);
+    case  6:  return tgFmt(line, size, "1-0:1.8.2(%010.3f*kWh)", g.edt[1]);
+    case  7:  return tgFmt(line, size, "1-0:2.8.1(%010.3f*kWh)", g.ert[0]);
+    case  8:  return tgFmt(line, size, "1-0:2.8.2(%010.3f*kWh)", g.ert[1]);
+    case  9:  return tgFmt(line, size, "0-0:96.14.0(%04d)", g.tariff);
+    case 10:  return tgFmt(line, size, "1-0:1.7.0(%06.3f*kW)", (g.pd[0] + g.pd[1] + g.pd[2]) / 1000.0);
+    case 11:  return tgFmt(line, size, "1-0:2.7.0(%06.3f*kW)", (g.pr[0] + g.pr[1] + g.pr[2]) / 1000.0);
+    case 12:  return tgFmt(line, size, "0-0:96.7.21(00010)");
+    case 13:  return tgFmt(line, size, "0-0:96.7.9(00002)");
+    case 14:  return tgFmt(line, size, "1-0:99.97.0(0)(0-0:96.7.19)");
+    case 15:  return tgFmt(line, size, "1-0:32.32.0(00002)");
+    case 16:  return tgFmt(line, size, "1-0:52.32.0(00003)");
+    case 17:  return tgFmt(line, size, "1-0:72.32.0(00003)");
+    case 18:  return tgFmt(line, size, "1-0:32.36.0(00000)");
+    case 19:  return tgFmt(line, size, "1-0:52.36.0(00000)");
+    case 20:  return tgFmt(line, size, "1-0:72.36.0(00000)");
+    case 21:  return tgFmt(line, size, "0-0:96.13.0()");
+    case 22:
+    case 23:
+    case 24:  if (!v50) return 0;   // no voltages before DSMR 5
+              return tgFmt(line, size, "1-0:%d2.7.0(%05.1f*V)", (n - 22) * 2 + 3, g.volt[n - 22] / 10.0);
+    case 25:
+    case 26:
+    case 27:  return tgFmt(line, size, "1-0:%d1.7.0(%03d*A)", (n - 25) * 2 + 3
+                                     , (int)((g.pd[n - 25] + g.pr[n - 25]) * 10 / g.volt[n - 25]));
+    case 28:
+    case 29:
+    case 30:  return tgFmt(line, size, "1-0:%d1.7.0(%06.3f*kW)", (n - 28) * 2 + 2, g.pd[n - 28] / 1000.0);
+    case 31:
+    case 32:
+    case 33:  return tgFmt(line, size, "1-0:%d2.7.0(%06.3f*kW)", (n - 31) * 2 + 2, g.pr[n - 31] / 1000.0);
+    case 34:  return tgFmt(line, size, "0-1:24.1.0(003)");
+    case 35:  return tgFmt(line, size, "0-1:96.1.0(4730303339303031363532303530323136)");
+    case 36:  return tgFmt(line, size, "0-1:24.2.1(%s)(%09.3f*m3)", g.gasTs, g.gasReading);
+    case 37:  return tgFmt(line, size, "!");
+  }
+  return -1;
+
+} // tgLine40()
+
+
+//===========================================================================================
+static inline int16_t tgLineBelgium(tgState &g, uint8_t n, char *line, size_t size)
+{
+  switch(n)
+  {
+    case  0:  return tgFmt(line, size, "/FLU5\\253769484_A");
+    case  1:  return tgFmt(line, size, "");
+    case  2:  return tgFmt(line, size, "0-0:96.1.4(50217)");
+    case  3:  return tgFmt(line, size, "0-0:96.1.1(3153414733313031303231363035)");
+    case  4:  return tgFmt(line, size, "0-0:1.0.0(%s)", g.ts);
+    case  5:  return tgFmt(line, size, "1-0:1.8.1(%010.3f*kWh)", g.edt[0]);
+    case  6:  return tgFmt(line, size, "1-0:1.8.2(%010.3f*kWh)", g.edt[1]);
+    case  7:  return tgFmt(line, size, "1-0:2.8.1(%010.3f*kWh)", g.ert[0]);
+    case  8:  return tgFmt(line, size, "1-0:2.8.2(%010.3f*kWh)", g.ert[1]);
+    case  9:  return tgFmt(line, size, "0-0:96.14.0(%04d)", g.tariff);
+    case 10:  return tgFmt(line, size, "1-0:1.4.0(%06.3f*kW)", g.avgW / 1000.0);
+    case 11:  return tgFmt(line, size, "1-0:1.6.0(%s)(%06.3f*kW)", g.peakTs, g.peakW / 1000.0);
+    case 12:  return tgFmt(line, size, "1-0:1.7.0(%06.3f*kW)", (g.pd[0] + g.pd[1] + g.pd[2]) / 1000.0);
+    case 13:  return tgFmt(line, size, "1-0:2.7.0(%06.3f*kW)", (g.pr[0] + g.pr[1] + g.pr[2]) / 1000.0);
+    case 14:
+    case 15:
+    case 16:  return tgFmt(line, size, "1-0:%d1.7.0(%06.3f*kW)", (n - 14) * 2 + 2, g.pd[n - 14] / 1000.0);
+    case 17:
+    case 18:
+    case 19:  return tgFmt(line, size, "1-0:%d2.7.0(%06.3f*kW)", (n - 17) * 2 + 2, g.pr[n - 17] / 1000.0);
+    case 20:
+    case 21:
+    case 22:  return tgFmt(line, size, "1-0:%d2.7.0(%05.1f*V)", (n - 20) * 2 + 3, g.volt[n - 20] / 10.0);
+    case 23:
+    case 24:
+    case 25:  return tgFmt(line, size, "1-0:%d1.7.0(%03d*A)", (n - 23) * 2 + 3
+                                     , (int)((g.pd[n - 23] + g.pr[n - 23]) * 10 / g.volt[n - 23]));
+    case 26:  return tgFmt(line, size, "0-0:96.3.10(1)");
+    case 27:  return tgFmt(line, size, "0-0:17.0.0(999.9*kW)");
+    case 28:  return tgFmt(line, size, "1-0:31.4.0(999*A)");
+    case 29:  return tgFmt(line, size, "0-0:96.13.0()");
+    case 30:  return tgFmt(line, size, "0-1:24.1.0(003)");
+    case 31:  return tgFmt(line, size, "0-1:96.1.1(37464C4F32313139303333373333)");
+    case 32:  return tgFmt(line, size, "0-1:24.4.0(1)");
+    case 33:  return tgFmt(line, size, "0-1:24.2.3(%s)(%09.3f*m3)", g.gasTs, g.gasReading);
+    case 34:  return tgFmt(line, size, "!");
+  }
+  return -1;
+
+} // tgLineBelgium()
+
+
+//===========================================================================================
+// line n (with "\r\n") of the telegram: its length, 0 if this protocol has
+// no line n, -1 after the last line. The "!" line gets the CRC (DSMR 4+)
+//===========================================================================================
+static inline int16_t tgLine(tgState &g, uint8_t n, char *line, size_t size)
+{
+  int16_t len;
+
+  switch(g.protocol)
+  {
+    case TG_DSMR22:
+    case TG_DSMR30:   len = tgLine30(g, n, line, size);       break;
+    case TG_BELGIUM:  len = tgLineBelgium(g, n, line, size);  break;
+    default:          len = tgLine40(g, n, line, size);
+  }
+  if (len <= 0) return len;
+
+  if (n == 0)  g.crc = 0;
+  if (line[0] == '!')
+  {
+    if (g.protocol <= TG_DSMR30)  return len;
+    g.crc = tgCrc16(g.crc, "!", 1);
+    return snprintf(line, size, "!%04X\r\n", g.crc);
+  }
+  g.crc = tgCrc16(g.crc, line, len);
+  return len;
+
+} // tgLine()
+
+
+//===========================================================================================
+// the whole telegram in buff, returns its length (0 if it does not fit)
+//===========================================================================================
+static inline size_t tgBuild(tgState &g, char *buff, size_t size)
+{
+  size_t  len = 0;
+  int16_t l;
+
+  for (uint8_t n = 0; ; n++)
+  {
+    if ((size - len) < TG_MAX_LINE)  return 0;   // does not fit
+    if ((l = tgLine(g, n, &buff[len], size - len)) < 0)  break;
+    len += l;
+  }
+  buff[len] = '\0';
+  g.count++;
+  return len;
+
+} // tgBuild()
+
+
+//===========================================================================================
+// the whole telegram to a Stream (Serial as stand-in for the P1 port) or a
+// File, returns the number of bytes written
+//===========================================================================================
+static inline size_t tgWrite(tgState &g, Print &out)
+{
+  char    line[TG_MAX_LINE];
+  size_t  len = 0;
+  int16_t l;
+
+  for (uint8_t n = 0; (l = tgLine(g, n, line, sizeof(line))) >= 0; n++)
+  {
+    if (l > 0)  len += out.write((const uint8_t*)line, l);
+  }
+  g.count++;
+  return len;
+
+} // tgWrite()
+
+#endif // _TELEGRAM_GENERATOR_H
+
+
+/***************************************************************************
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit
+* persons to whom the Software is furnished to do so, subject to the
+* following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT
+* OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR
+* THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+***************************************************************************/
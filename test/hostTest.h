@@ -0,0 +1,118 @@
+/*
+***************************************************************************
+**  Filename  : hostTest.h, part of the DSMRlogger-Next host tests
+**
+**  Copyright (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See LICENSE.
+***************************************************************************
+*/
+
+/*
+ * Just enough to write a test without a framework:
+ *
+ *   TEST(tokenizer_rejects_trailing_comma)
+ *   {
+ *     CHECK(!jsonIsValid("[1,]", 4));
+ *     CHECK_EQ(42, answer());
+ *   }
+ *
+ *   int main() { return runTests(); }
+ */
+
+#ifndef _HOST_TEST_H
+#define _HOST_TEST_H
+
+#include <cstdio>
+#include <cstdint>
+#include <chrono>
+
+typedef void (*testFunc)();
+
+struct testCase {
+    const char *name;
+    testFunc    func;
+    testCase   *next;
+};
+
+static testCase *testList    = nullptr;
+static testCase *testLast    = nullptr;
+static int       testFailed  = 0;
+static int       testChecks  = 0;
+static bool      testCurFail = false;
+
+struct testRegister {
+    testRegister(testCase *t) {
+      if (testLast) testLast->next = t; else testList = t;
+      testLast = t;
+    }
+};
+
+#define TEST(name)                                                      \
+  static void test_##name();                                            \
+  static testCase     testCase_##name = { #name, test_##name, nullptr }; \
+  static testRegister testReg_##name(&testCase_##name);                 \
+  static void test_##name()
+
+#define CHECK(cond)                                                     \
+  do {                                                                  \
+    testChecks++;                                                       \
+    if (!(cond)) {                                                      \
+      printf("  %s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+      testCurFail = true;                                               \
+    }                                                                   \
+  } while (0)
+
+#define CHECK_EQ(expected, actual)                                      \
+  do {                                                                  \
+    testChecks++;                                                       \
+    long long e_ = (long long)(expected), a_ = (long long)(actual);     \
+    if (e_ != a_) {                                                     \
+      printf("  %s:%d: %s == %lld, expected %lld\n"                     \
+                           , __FILE__, __LINE__, #actual, a_, e_);     \
+      testCurFail = true;                                               \
+    }                                                                   \
+  } while (0)
+
+#define CHECK_STR(expected, actual)                                     \
+  do {                                                                  \
+    testChecks++;                                                       \
+    if (strcmp((expected), (actual)) != 0) {                            \
+      printf("  %s:%d: %s == \"%s\", expected \"%s\"\n"                 \
+                    , __FILE__, __LINE__, #actual, (actual), (expected)); \
+      testCurFail = true;                                               \
+    }                                                                   \
+  } while (0)
+
+
+//===========================================================================================
+// wall clock time of the host (for the benchmarks), in micro seconds
+static inline uint64_t hostMicros()
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::steady_clock::now().time_since_epoch()).count();
+
+} // hostMicros()
+
+
+//===========================================================================================
+static inline int runTests()
+{
+  int nrTests = 0;
+
+  for (testCase *t = testList; t; t = t->next)
+  {
+    testCurFail = false;
+    printf("%-50s ", t->name);
+    fflush(stdout);
+    t->func();
+    printf("%s\n", testCurFail ? "FAILED" : "ok");
+    if (testCurFail) testFailed++;
+    nrTests++;
+  }
+  printf("%d tests, %d checks, %d failed\n", nrTests, testChecks, testFailed);
+  return (testFailed == 0) ? 0 : 1;
+
+} // runTests()
+
+#endif // _HOST_TEST_H
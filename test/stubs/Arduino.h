@@ -0,0 +1,90 @@
+/*
+***************************************************************************
+**  Filename  : Arduino.h, stand-in for the host tests
+**
+**  Copyright (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See LICENSE.
+***************************************************************************
+*/
+
+/*
+ * The few parts of the Arduino core that the sketch headers use. Time
+ * does not run on its own: a test sets hostMillis (or calls delay()).
+ */
+
+#ifndef _HOST_ARDUINO_H
+#define _HOST_ARDUINO_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <cstdarg>
+#include <strings.h>
+#include "WString.h"
+
+typedef uint8_t byte;
+typedef bool    boolean;
+
+#define PGM_P               const char *
+#define PROGMEM
+#define F(s)                (s)
+#define strlcpy_P(d, s, n)  strlcpy((d), (s), (n))
+
+static uint32_t hostMillis = 0;
+
+static inline uint32_t millis()            { return hostMillis; }
+static inline uint32_t micros()            { return hostMillis * 1000UL; }
+static inline void     delay(uint32_t ms)  { hostMillis += ms; }
+static inline void     yield()             { }
+static inline long     random(long max)    { return (max > 0) ? (rand() % max) : 0; }
+
+class Print
+{
+  public:
+    virtual ~Print()                                      { }
+    virtual size_t write(uint8_t c)                       = 0;
+    virtual size_t write(const uint8_t *buf, size_t len)
+    {
+      size_t n = 0;
+      while (n < len && write(buf[n]) == 1) n++;
+      return n;
+    }
+};
+
+class Stream : public Print
+{
+  public:
+    virtual int available()                               = 0;
+    virtual int read()                                    = 0;
+    virtual int peek()                                    = 0;
+};
+
+#if !defined(__GLIBC__) || !defined(__GLIBC_PREREQ) || !__GLIBC_PREREQ(2, 38)
+//===========================================================================================
+static inline size_t strlcpy(char *dst, const char *src, size_t size)
+{
+  size_t len = strlen(src);
+  if (size > 0)
+  {
+    size_t n = (len < size) ? len : size -1;
+    memcpy(dst, src, n);
+    dst[n] = '\0';
+  }
+  return len;
+
+} // strlcpy()
+
+//===========================================================================================
+static inline size_t strlcat(char *dst, const char *src, size_t size)
+{
+  size_t dLen = strnlen(dst, size);
+  if (dLen == size) return size + strlen(src);
+  return dLen + strlcpy(dst + dLen, src, size - dLen);
+
+} // strlcat()
+#endif
+
+#endif // _HOST_ARDUINO_H
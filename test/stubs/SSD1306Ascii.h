@@ -0,0 +1,118 @@
+/*
+***************************************************************************
+**  Filename  : SSD1306Ascii.h, mock display driver for the host tests
+**
+**  Copyright (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See LICENSE.
+***************************************************************************
+*/
+
+/*
+ * Behaves like SSD1306Ascii 1.2.x with a fixed font of 7x14 pixels (two
+ * pages high, 18 chars on a line as oledStuff.h has it) and counts what
+ * goes to the display controller:
+ *
+ *   setCursor()   3 command bytes (column low/high nibble, page)
+ *   write()       7 RAM bytes per page, and a setCursor() for the second
+ *                 page. Columns past the display width are not sent
+ *
+ * The I2C address and control bytes are not counted. screen[][] keeps
+ * the char in every cell, so a test can read the display back.
+ */
+
+#ifndef _HOST_SSD1306ASCII_H
+#define _HOST_SSD1306ASCII_H
+
+#include "Arduino.h"
+
+#define MOCK_OLED_WIDTH     128
+#define MOCK_OLED_HEIGHT     64
+#define MOCK_OLED_PAGES     (MOCK_OLED_HEIGHT / 8)
+#define MOCK_FONT_WIDTH       7
+#define MOCK_FONT_HEIGHT     14
+#define MOCK_FONT_PAGES       2
+#define MOCK_CELL_WIDTH     MOCK_FONT_WIDTH
+#define MOCK_CELLS          (MOCK_OLED_WIDTH / MOCK_CELL_WIDTH)
+
+struct DevType { uint8_t id; };
+static const DevType  Adafruit128x64  = { 1 };
+static const DevType  SH1106_128x64   = { 2 };
+static const uint8_t  X11fixed7x14B[] = { MOCK_FONT_WIDTH, MOCK_FONT_HEIGHT };
+
+class SSD1306Ascii
+{
+  public:
+    uint32_t  bytes       = 0;      // commands + RAM data
+    uint32_t  cursorMoves = 0;
+    uint32_t  glyphs      = 0;      // chars written (also the ones off screen)
+    char      screen[MOCK_OLED_PAGES][MOCK_CELLS +1];
+
+    SSD1306Ascii()                                { wipe(); }
+    void      begin(const DevType *dev, uint8_t i2cAddr)  { }
+    void      setFont(const uint8_t *font)        { }
+    uint8_t   fontHeight()      const             { return MOCK_FONT_HEIGHT; }
+    uint8_t   displayWidth()    const             { return MOCK_OLED_WIDTH; }
+    uint8_t   displayHeight()   const             { return MOCK_OLED_HEIGHT; }
+    void      displayRemap(bool mode)             { bytes += 2; }
+    uint16_t  fieldWidth(uint8_t n)               { return n * MOCK_CELL_WIDTH; }
+    void      resetCounters()                     { bytes = cursorMoves = glyphs = 0; }
+
+    void clear()
+    {
+      for (uint8_t p = 0; p < MOCK_OLED_PAGES; p++)
+      {
+        setCursor(0, p);
+        bytes += MOCK_OLED_WIDTH;
+      }
+      wipe();
+      setCursor(0, 0);
+    }
+
+    void setCursor(uint8_t col, uint8_t row)
+    {
+      m_col = col;
+      m_row = row;
+      bytes += 3;
+      cursorMoves++;
+    }
+
+    size_t write(uint8_t c)
+    {
+      uint8_t col = m_col, row = m_row;
+      glyphs++;
+      if (col < MOCK_OLED_WIDTH && row < MOCK_OLED_PAGES) screen[row][col / MOCK_CELL_WIDTH] = c;
+      for (uint8_t p = 0; p < MOCK_FONT_PAGES; p++)
+      {
+        if (p > 0) setCursor(col, row + p);
+        for (uint8_t x = col; x < col + MOCK_CELL_WIDTH; x++)
+        {
+          if (x < MOCK_OLED_WIDTH) bytes++;
+        }
+      }
+      m_row = row;
+      m_col = col + MOCK_CELL_WIDTH;
+      return 1;
+    }
+
+    size_t print(const char *s)
+    {
+      size_t n = 0;
+      while (*s) n += write(*s++);
+      return n;
+    }
+
+    // the text of a text line (two pages), as it is on the display
+    const char *line(uint8_t l)     { return screen[l * MOCK_FONT_PAGES]; }
+
+  private:
+    uint8_t   m_col = 0, m_row = 0;
+
+    void wipe()
+    {
+      memset(screen, ' ', sizeof(screen));
+      for (uint8_t p = 0; p < MOCK_OLED_PAGES; p++) screen[p][MOCK_CELLS] = '\0';
+    }
+};
+
+#endif // _HOST_SSD1306ASCII_H
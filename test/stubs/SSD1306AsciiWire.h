@@ -0,0 +1,26 @@
+/*
+***************************************************************************
+**  Filename  : SSD1306AsciiWire.h, mock display driver for the host tests
+**
+**  Copyright (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See LICENSE.
+***************************************************************************
+*/
+
+#ifndef _HOST_SSD1306ASCIIWIRE_H
+#define _HOST_SSD1306ASCIIWIRE_H
+
+#include "SSD1306Ascii.h"
+
+class TwoWire
+{
+  public:
+    void begin()                    { }
+    void begin(int sda, int scl)    { }
+};
+static TwoWire Wire;
+
+class SSD1306AsciiWire : public SSD1306Ascii { };
+
+#endif // _HOST_SSD1306ASCIIWIRE_H
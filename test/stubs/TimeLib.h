@@ -0,0 +1,75 @@
+/*
+***************************************************************************
+**  Filename  : TimeLib.h, stand-in for the host tests
+**
+**  Copyright (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See LICENSE.
+***************************************************************************
+*/
+
+/*
+ * The parts of the TimeLib (Paul Stoffregen) the sketch uses, on top of
+ * timegm()/gmtime_r(). Like the real one, now() moves with millis().
+ */
+
+#ifndef _HOST_TIMELIB_H
+#define _HOST_TIMELIB_H
+
+#include <ctime>
+#include "Arduino.h"
+
+#define SECS_PER_MIN    (60UL)
+#define SECS_PER_HOUR   (3600UL)
+#define SECS_PER_DAY    (SECS_PER_HOUR * 24UL)
+
+typedef struct {
+    uint8_t Second, Minute, Hour, Wday, Day, Month, Year;   // Year: offset from 1970
+} tmElements_t;
+
+static time_t   hostSysTime = 0;
+static uint32_t hostSysMs   = 0;
+
+static inline time_t now()          { return hostSysTime + (millis() - hostSysMs) / 1000; }
+static inline void   setTime(time_t t)
+{
+  hostSysTime = t;
+  hostSysMs   = millis();
+}
+
+static inline void breakTime(time_t t, tmElements_t &tm)
+{
+  struct tm g;
+  gmtime_r(&t, &g);
+  tm.Second = g.tm_sec;   tm.Minute = g.tm_min;       tm.Hour = g.tm_hour;
+  tm.Wday   = g.tm_wday +1;   tm.Day = g.tm_mday;     tm.Month = g.tm_mon +1;
+  tm.Year   = g.tm_year + 1900 - 1970;
+}
+
+static inline time_t makeTime(const tmElements_t &tm)
+{
+  struct tm g = {};
+  g.tm_sec  = tm.Second;  g.tm_min = tm.Minute;       g.tm_hour = tm.Hour;
+  g.tm_mday = tm.Day;     g.tm_mon = tm.Month -1;     g.tm_year = tm.Year + 1970 - 1900;
+  return timegm(&g);
+}
+
+// a year of 2 digits is 20yy, as in the TimeLib
+static inline void setTime(int hr, int min, int sec, int dy, int mnth, int yr)
+{
+  tmElements_t tm;
+  if (yr > 99)  yr -= 1970;
+  else          yr += 30;
+  tm.Year = yr; tm.Month = mnth; tm.Day = dy; tm.Hour = hr; tm.Minute = min; tm.Second = sec;
+  setTime(makeTime(tm));
+}
+
+static inline int second(time_t t)  { tmElements_t tm; breakTime(t, tm); return tm.Second; }
+static inline int minute(time_t t)  { tmElements_t tm; breakTime(t, tm); return tm.Minute; }
+static inline int hour(time_t t)    { tmElements_t tm; breakTime(t, tm); return tm.Hour; }
+static inline int day(time_t t)     { tmElements_t tm; breakTime(t, tm); return tm.Day; }
+static inline int month(time_t t)   { tmElements_t tm; breakTime(t, tm); return tm.Month; }
+static inline int year(time_t t)    { tmElements_t tm; breakTime(t, tm); return tm.Year + 1970; }
+static inline int hour()            { return hour(now()); }
+
+#endif // _HOST_TIMELIB_H
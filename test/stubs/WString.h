@@ -0,0 +1,85 @@
+/*
+***************************************************************************
+**  Filename  : WString.h, stand-in for the host tests
+**
+**  Copyright (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See LICENSE.
+***************************************************************************
+*/
+
+/*
+ * The part of the Arduino String class the sketch uses, on std::string.
+ */
+
+#ifndef _HOST_WSTRING_H
+#define _HOST_WSTRING_H
+
+#include <string>
+#include <cstdlib>
+
+class String
+{
+  public:
+    String()                        { }
+    String(const char *s)           : str(s ? s : "") { }
+    String(const std::string &s)    : str(s) { }
+    String(char c)                  : str(1, c) { }
+    String(int v)                   : str(std::to_string(v)) { }
+    String(unsigned int v)          : str(std::to_string(v)) { }
+    String(long v)                  : str(std::to_string(v)) { }
+    String(unsigned long v)         : str(std::to_string(v)) { }
+    String(double v, int dec = 2)   { char b[40]; snprintf(b, sizeof(b), "%.*f", dec, v); str = b; }
+
+    const char   *c_str()  const    { return str.c_str(); }
+    unsigned int  length() const    { return str.length(); }
+    long          toInt()  const    { return atol(str.c_str()); }
+    float         toFloat() const   { return atof(str.c_str()); }
+    char          operator[](unsigned int i) const { return (i < str.length()) ? str[i] : 0; }
+    char         &operator[](unsigned int i)       { static char dummy; return (i < str.length()) ? str[i] : (dummy = 0); }
+    void          reserve(unsigned int size)       { str.reserve(size); }
+    std::string::iterator begin()                  { return str.begin(); }
+    std::string::iterator end()                    { return str.end(); }
+
+    bool  equals(const String &s) const             { return str == s.str; }
+    bool  equalsIgnoreCase(const String &s) const   { return strcasecmp(str.c_str(), s.c_str()) == 0; }
+    bool  startsWith(const String &s) const         { return str.compare(0, s.str.size(), s.str) == 0; }
+    bool  endsWith(const String &s) const
+    {
+      return str.size() >= s.str.size() && str.compare(str.size() - s.str.size(), s.str.size(), s.str) == 0;
+    }
+    int     indexOf(const String &s, unsigned int from = 0) const
+    {
+      size_t p = str.find(s.str, from); return (p == std::string::npos) ? -1 : (int)p;
+    }
+    int     indexOf(char c, unsigned int from = 0) const
+    {
+      size_t p = str.find(c, from); return (p == std::string::npos) ? -1 : (int)p;
+    }
+    String  substring(unsigned int from) const      { return (from < str.size()) ? String(str.substr(from)) : String(); }
+    String  substring(unsigned int from, unsigned int to) const
+    {
+      if (from >= str.size() || to <= from) return String();
+      return String(str.substr(from, to - from));
+    }
+    void    trim()
+    {
+      size_t b = str.find_first_not_of(" \t\r\n");
+      size_t e = str.find_last_not_of(" \t\r\n");
+      str = (b == std::string::npos) ? "" : str.substr(b, e - b + 1);
+    }
+
+    String &operator+=(const String &s)   { str += s.str; return *this; }
+    friend String operator+(const String &a, const String &b)   { return String(a.str + b.str); }
+    friend String operator+(const String &a, const char *b)     { return String(a.str + b); }
+    friend String operator+(const char *a, const String &b)     { return String(a + b.str); }
+    bool operator==(const String &s) const  { return str == s.str; }
+    bool operator==(const char *s)   const  { return str == s; }
+    bool operator!=(const String &s) const  { return str != s.str; }
+    bool operator!=(const char *s)   const  { return str != s; }
+
+  private:
+    std::string str;
+};
+
+#endif // _HOST_WSTRING_H
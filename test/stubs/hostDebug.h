@@ -0,0 +1,34 @@
+/*
+***************************************************************************
+**  Filename  : hostDebug.h, stand-in for Debug.h in the host tests
+**
+**  Copyright (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See LICENSE.
+***************************************************************************
+*/
+
+/*
+ * The Debug macro's (LogTxx() like DebugTxx()) and writeToSysLog() print
+ * to stdout, but only when a test sets hostVerbose (most tests want a
+ * quiet run).
+ */
+
+#ifndef _HOST_DEBUG_H
+#define _HOST_DEBUG_H
+
+#include <cstdio>
+
+static bool hostVerbose = false;
+
+#define Debug(...)          ({ if (hostVerbose) printf("%s", String(__VA_ARGS__).c_str()); })
+#define Debugln(...)        ({ if (hostVerbose) printf("%s\n", String(__VA_ARGS__).c_str()); })
+#define Debugf(...)         ({ if (hostVerbose) printf(__VA_ARGS__); })
+#define DebugT(...)         Debug(__VA_ARGS__)
+#define DebugTln(...)       Debugln(__VA_ARGS__)
+#define DebugTf(...)        ({ if (hostVerbose) { printf("%s: ", __FUNCTION__); printf(__VA_ARGS__); } })
+#define LogTln(lvl, ...)    DebugTln(__VA_ARGS__)
+#define LogTf(lvl, ...)     DebugTf(__VA_ARGS__)
+#define writeToSysLog(...)  ({ if (hostVerbose) { printf("syslog: "); printf(__VA_ARGS__); printf("\n"); } })
+
+#endif // _HOST_DEBUG_H
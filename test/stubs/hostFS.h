@@ -0,0 +1,160 @@
+/*
+***************************************************************************
+**  Filename  : hostFS.h, stand-in for SPIFFS in the host tests
+**
+**  Copyright (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See LICENSE.
+***************************************************************************
+*/
+
+/*
+ * SPIFFS in memory. Every file keeps count of the writes to it, so a
+ * test can see how much a piece of code wears the flash. capacity
+ * limits the total size of all files (a write that does not fit writes
+ * what does fit, like SPIFFS).
+ */
+
+#ifndef _HOST_FS_H
+#define _HOST_FS_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+enum SeekMode { SeekSet, SeekCur, SeekEnd };
+
+struct hostFile {
+    std::vector<uint8_t>  data;
+    uint32_t              writes = 0;     // write() calls
+    uint32_t              opens  = 0;
+};
+
+class hostFileSystem;
+
+class File
+{
+  public:
+    File() { }
+    File(std::shared_ptr<hostFile> f, hostFileSystem *fs, bool canWrite, size_t pos)
+                            : file(f), owner(fs), writable(canWrite), at(pos) { }
+
+    operator bool() const   { return (bool)file; }
+    size_t  size() const    { return file ? file->data.size() : 0; }
+    size_t  position() const { return at; }
+    int     available() const { return file ? (int)(file->data.size() - at) : 0; }
+
+    bool seek(size_t pos, SeekMode mode = SeekSet)
+    {
+      if (!file) return false;
+      if (mode == SeekCur) pos += at;
+      if (mode == SeekEnd) pos  = file->data.size() - pos;
+      if (pos > file->data.size()) return false;
+      at = pos;
+      return true;
+    }
+    size_t read(uint8_t *buf, size_t len)
+    {
+      if (!file) return 0;
+      size_t n = (at + len <= file->data.size()) ? len : file->data.size() - at;
+      memcpy(buf, file->data.data() + at, n);
+      at += n;
+      return n;
+    }
+    int read()
+    {
+      uint8_t c;
+      return (read(&c, 1) == 1) ? c : -1;
+    }
+    size_t write(const uint8_t *buf, size_t len);
+    size_t write(uint8_t c)                 { return write(&c, 1); }
+    size_t print(const char *s)             { return write((const uint8_t*)s, strlen(s)); }
+    size_t print(const String &s)           { return print(s.c_str()); }
+    size_t printf(const char *fmt, ...)
+    {
+      char    buf[256];
+      va_list args;
+      va_start(args, fmt);
+      int len = vsnprintf(buf, sizeof(buf), fmt, args);
+      va_end(args);
+      return (len > 0) ? write((const uint8_t*)buf, strlen(buf)) : 0;
+    }
+    size_t readBytes(char *buf, size_t len) { return read((uint8_t*)buf, len); }
+    void   flush()                          { }
+    void   close()                          { file.reset(); }
+
+  private:
+    std::shared_ptr<hostFile> file;
+    hostFileSystem           *owner    = nullptr;
+    bool                      writable = false;
+    size_t                    at       = 0;
+};
+
+class hostFileSystem
+{
+  public:
+    size_t  capacity = 1024 * 1024;
+
+    bool begin()                            { return true; }
+    bool exists(const char *name)           { return files.count(name) > 0; }
+    bool exists(const String &name)         { return exists(name.c_str()); }
+    bool remove(const char *name)           { return files.erase(name) > 0; }
+    bool remove(const String &name)         { return remove(name.c_str()); }
+    bool rename(const char *from, const char *to)
+    {
+      auto f = files.find(from);
+      if (f == files.end()) return false;
+      files[to] = f->second;
+      files.erase(f);
+      return true;
+    }
+    File open(const String &name, const char *mode) { return open(name.c_str(), mode); }
+    File open(const char *name, const char *mode)
+    {
+      bool canWrite = (mode[0] != 'r' || mode[1] == '+');
+      auto f = files.find(name);
+      if (f == files.end())
+      {
+        if (mode[0] == 'r') return File();
+        files[name] = std::make_shared<hostFile>();
+        f = files.find(name);
+      }
+      if (mode[0] == 'w') f->second->data.clear();
+      f->second->opens++;
+      return File(f->second, this, canWrite, (mode[0] == 'a') ? f->second->data.size() : 0);
+    }
+    size_t usedBytes() const
+    {
+      size_t used = 0;
+      for (auto &f : files) used += f.second->data.size();
+      return used;
+    }
+    size_t totalBytes() const               { return capacity; }
+
+    //-- for the tests --
+    hostFile *file(const char *name)        { auto f = files.find(name); return (f == files.end()) ? nullptr : f->second.get(); }
+    void      format()                      { files.clear(); }
+
+  private:
+    std::map<std::string, std::shared_ptr<hostFile>> files;
+};
+
+static hostFileSystem SPIFFS;
+
+//===========================================================================================
+inline size_t File::write(const uint8_t *buf, size_t len)
+{
+  if (!file || !writable) return 0;
+  size_t grow = (at + len > file->data.size()) ? (at + len - file->data.size()) : 0;
+  size_t room = owner->capacity - owner->usedBytes();
+  if (grow > room)  len -= (grow - room);
+  if (at + len > file->data.size()) file->data.resize(at + len);
+  memcpy(file->data.data() + at, buf, len);
+  at += len;
+  file->writes++;
+  return len;
+
+} // File::write()
+
+#endif // _HOST_FS_H
@@ -0,0 +1,92 @@
+/*
+***************************************************************************
+**  Filename  : hostHTTP.h, stand-in for HTTPClient in the host tests
+**
+**  Copyright (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See LICENSE.
+***************************************************************************
+*/
+
+/*
+ * HTTPClient talks to hostServer, an HTTP endpoint in memory. A test
+ * takes it down (every request fails like a refused connection) and
+ * looks at what it received. A request costs hostServer.latencyMs of
+ * (host) time, so a test can see how long the sketch is kept busy.
+ */
+
+#ifndef _HOST_HTTP_H
+#define _HOST_HTTP_H
+
+#include <string>
+#include <vector>
+#include "hostFS.h"
+#include "hostNet.h"
+
+#define HTTPC_ERROR_CONNECTION_REFUSED  (-1)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)    // the stream did not have Content-Length bytes
+
+struct hostRequest {
+    std::string method;
+    std::string url;
+    std::string body;
+};
+
+struct hostHTTPServer {
+    bool                      up        = true;
+    int                       code      = 204;    // the answer to a POST
+    uint32_t                  latencyMs = 0;
+    uint32_t                  connects  = 0;
+    std::vector<hostRequest>  received;
+
+    int request(const char *method, const std::string &url, const std::string &body)
+    {
+      hostMillis += latencyMs;
+      if (!up) return HTTPC_ERROR_CONNECTION_REFUSED;
+      received.push_back({ method, url, body });
+      if (url.size() >= 5 && url.compare(url.size() - 5, 5, "/ping") == 0) return 204;
+      return code;
+    }
+};
+
+static hostHTTPServer hostServer;
+
+class HTTPClient
+{
+  public:
+    void  setReuse(bool reuse)              { }
+    void  setTimeout(uint16_t ms)           { }
+    bool  begin(WiFiClient &client, const char *url)
+    {
+      this->url = url;
+      hostServer.connects++;
+      return true;
+    }
+    void  end()                             { url.clear(); }
+    int   GET()                             { return hostServer.request("GET", url, ""); }
+    int   POST(const uint8_t *body, size_t len)
+    {
+      return hostServer.request("POST", url, std::string((const char*)body, len));
+    }
+    int   sendRequest(const char *method, File *stream, size_t len)
+    {
+      std::string body(len, '\0');
+      len = stream->read((uint8_t*)&body[0], len);
+      body.resize(len);
+      return hostServer.request(method, url, body);
+    }
+    int   sendRequest(const char *method, Stream *stream, size_t len)
+    {
+      std::string body;
+      int         c;
+      while (body.size() < len && (c = stream->read()) >= 0) body += (char)c;
+      if (body.size() != len || stream->available() > 0) return HTTPC_ERROR_SEND_PAYLOAD_FAILED;
+      return hostServer.request(method, url, body);
+    }
+    String errorToString(int code)          { return String("refused"); }
+
+  private:
+    std::string url;
+};
+
+#endif // _HOST_HTTP_H
@@ -0,0 +1,145 @@
+/*
+***************************************************************************
+**  Filename  : hostNet.h, stand-in for the network in the host tests
+**
+**  Copyright (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See LICENSE.
+***************************************************************************
+*/
+
+/*
+ * IPAddress, the lwIP DNS call and a WiFiClient that talks to hostPeer,
+ * a TCP server in memory.
+ *
+ * dns_gethostbyname() answers from hostDns.names. In async mode it
+ * returns ERR_INPROGRESS, and the answer only comes when the test calls
+ * hostDns.answer(). In this way the test plays the part of lwIP.
+ * hostPeer takes what the client writes and, once the whole request is
+ * in (an empty line), gives back hostPeer.response.
+ */
+
+#ifndef _HOST_NET_H
+#define _HOST_NET_H
+
+#include <map>
+#include <string>
+
+//-- lwIP DNS ------------------------------------------------------------------------------
+typedef int8_t    err_t;
+typedef struct { uint32_t addr; } ip_addr_t;
+typedef void (*dns_found_callback)(const char *name, const ip_addr_t *ipaddr, void *arg);
+
+#define ERR_OK                    0
+#define ERR_INPROGRESS          (-5)
+#define ERR_ARG                (-16)
+#define ip_2_ip4(ipaddr)        (ipaddr)
+#define ip4_addr_get_u32(ipaddr) ((ipaddr)->addr)
+
+struct hostResolver {
+    std::map<std::string, uint32_t> names;
+    bool                async    = true;
+    uint32_t            lookups  = 0;
+    dns_found_callback  pending  = nullptr;
+    std::string         pendingName;
+    void               *pendingArg = nullptr;
+
+    //-- the answer to the outstanding lookup (if any) --
+    void answer()
+    {
+      if (!pending) return;
+      dns_found_callback cb = pending;
+      pending = nullptr;
+      auto n = names.find(pendingName);
+      if (n == names.end()) { cb(pendingName.c_str(), nullptr, pendingArg); return; }
+      ip_addr_t a = { n->second };
+      cb(pendingName.c_str(), &a, pendingArg);
+    }
+};
+
+static hostResolver hostDns;
+
+static err_t dns_gethostbyname(const char *name, ip_addr_t *addr, dns_found_callback found, void *arg)
+{
+  hostDns.lookups++;
+  if (hostDns.async)
+  {
+    hostDns.pending     = found;
+    hostDns.pendingName = name;
+    hostDns.pendingArg  = arg;
+    return ERR_INPROGRESS;
+  }
+  auto n = hostDns.names.find(name);
+  if (n == hostDns.names.end()) return ERR_ARG;
+  addr->addr = n->second;
+  return ERR_OK;
+
+} // dns_gethostbyname()
+
+//-- IPAddress (kept in network order, like the core does) ------------------------------------
+class IPAddress
+{
+  public:
+    IPAddress(uint32_t a = 0) : addr(a) { }
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : addr(a | (b << 8) | (c << 16) | ((uint32_t)d << 24)) { }
+    operator uint32_t() const     { return addr; }
+    uint8_t operator[](int i) const { return (addr >> (8 * i)) & 0xFF; }
+    String  toString() const
+    {
+      char s[16];
+      snprintf(s, sizeof(s), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+      return String(s);
+    }
+
+  private:
+    uint32_t addr;
+};
+
+//-- a TCP server in memory ------------------------------------------------------------------
+struct hostPeer {
+    IPAddress   ip        = IPAddress(192, 168, 1, 10);
+    uint16_t    port      = 80;
+    bool        listening = true;
+    bool        dropAfterConnect = false;   // connection is lost right away
+    std::string response  = "HTTP/1.1 201 Created\r\nContent-Length: 0\r\n\r\n";
+    std::string received;                   // what was written to it
+    uint32_t    connects  = 0;
+    uint32_t    writes    = 0;
+};
+
+static hostPeer hostTcp;
+
+class WiFiClient
+{
+  public:
+    int connect(IPAddress ip, uint16_t port)
+    {
+      hostTcp.connects++;
+      if (!hostTcp.listening || ip != hostTcp.ip || port != hostTcp.port) return 0;
+      hostTcp.received.clear();
+      open = true;
+      at   = 0;
+      return 1;
+    }
+    uint8_t connected()           { return open && !hostTcp.dropAfterConnect; }
+    size_t  write(const uint8_t *buf, size_t len)
+    {
+      if (!connected()) return 0;
+      hostTcp.received.append((const char *)buf, len);
+      hostTcp.writes++;
+      return len;
+    }
+    int available()
+    {
+      if (!open || hostTcp.received.find("\r\n\r\n") == std::string::npos) return 0;
+      return hostTcp.response.size() - at;
+    }
+    int read()                    { return (available() > 0) ? (uint8_t)hostTcp.response[at++] : -1; }
+    void stop()                   { open = false; }
+
+  private:
+    bool    open = false;
+    size_t  at   = 0;
+};
+
+#endif // _HOST_NET_H
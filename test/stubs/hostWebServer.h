@@ -0,0 +1,60 @@
+/*
+***************************************************************************
+**  Filename  : hostWebServer.h, stand-in for the ESP web server in the host tests
+**
+**  Copyright (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See LICENSE.
+***************************************************************************
+*/
+
+/*
+ * httpServer answers the request the test put in it (uri, method and the
+ * body as arg(0)). Of the answer only the code and the number of bytes
+ * are kept: the stand-in itself never takes heap, so a test that counts
+ * malloc() only counts the sketch.
+ */
+
+#ifndef _HOST_WEB_SERVER_H
+#define _HOST_WEB_SERVER_H
+
+#include "hostNet.h"
+
+enum HTTPMethod { HTTP_ANY, HTTP_GET, HTTP_POST, HTTP_PUT, HTTP_PATCH, HTTP_DELETE };
+
+#define CONTENT_LENGTH_UNKNOWN  ((size_t) -1)
+
+class hostWebClient
+{
+  public:
+    IPAddress remoteIP()                          { return IPAddress(192, 168, 1, 2); }
+};
+
+class hostWebServer
+{
+  public:
+    String        requestUri;
+    String        requestBody;
+    HTTPMethod    requestMethod = HTTP_GET;
+    int           code          = 0;      // of the last answer
+    uint32_t      bytes         = 0;      // sent since the test reset it
+
+    const String &uri()                           { return requestUri; }
+    HTTPMethod    method()                        { return requestMethod; }
+    const String &arg(int i)                      { return requestBody; }
+    hostWebClient client()                        { return hostWebClient(); }
+    void  sendHeader(const char *n, const char *v)  { }
+    void  setContentLength(size_t len)            { }
+    void  send(int c, const char *type, const char *content)
+    {
+      code   = c;
+      bytes += strlen(content);
+    }
+    void  send(int c, const char *type, const String &content)   { send(c, type, content.c_str()); }
+    void  sendContent(const char *content)        { bytes += strlen(content); }
+    void  sendContent(const String &content)      { sendContent(content.c_str()); }
+};
+
+static hostWebServer httpServer;
+
+#endif // _HOST_WEB_SERVER_H
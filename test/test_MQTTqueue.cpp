@@ -0,0 +1,297 @@
+/*
+***************************************************************************
+**  Program  : test_MQTTqueue, host test for MQTTqueue.ino
+**
+**  Copyright (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See LICENSE.
+***************************************************************************
+**  MQTTqueue.ino is compiled against an in-memory SPIFFS and a stand-in
+**  broker that can go down, come back and refuse a publish.
+*/
+
+#define USE_MQTT
+
+#include "Arduino.h"
+#include "hostTest.h"
+#include "hostDebug.h"
+#include "hostFS.h"
+#include "safeTimers.h"
+#include "MQTTqueue.h"
+
+#include <vector>
+
+//-- stand-in broker ------------------------------------------------------------------------
+struct hostMessage {
+    std::string topic;
+    std::string payload;
+};
+
+class hostBroker
+{
+  public:
+    bool                      up        = false;
+    uint16_t                  failNext  = 0;      // refuse this many publishes
+    uint16_t                  bufferSize = 256;
+    std::vector<hostMessage>  received;
+
+    bool      connected()                   { return up; }
+    uint16_t  getBufferSize()               { return bufferSize; }
+    bool      setBufferSize(uint16_t size)  { bufferSize = size; return true; }
+    bool      publish(const char *topic, const char *payload, bool retained)
+    {
+      if (!up) return false;
+      if (failNext > 0) { failNext--; return false; }
+      if (strlen(topic) + strlen(payload) + 7 > bufferSize) return false;
+      received.push_back({ topic, payload });
+      return true;
+    }
+};
+
+//-- what MQTTqueue.ino needs of the rest of the sketch ---------------------------------------
+enum    { MEM_OK, MEM_LOW, MEM_CRITICAL };
+
+struct hostValue {
+    int32_t v = 0;
+    int32_t int_val() const { return v; }
+};
+
+struct {
+    hostValue energy_delivered_tariff1, energy_delivered_tariff2;
+    hostValue energy_returned_tariff1,  energy_returned_tariff2;
+    hostValue power_delivered, power_returned, gas_delivered;
+} DSMRdata;
+
+static hostBroker MQTTclient;
+static bool       mqttIsConnected = false;
+static bool       Verbose1        = false;
+static char       actTimestamp[20];
+static char       settingMQTTtopTopic[21] = "DSMR-API/";
+static uint8_t    hostMemLevel    = MEM_OK;
+static uint32_t   hostEpoch       = 1700000000;
+
+static bool   memShed(uint8_t level)              { return hostMemLevel >= level; }
+static time_t utcEpoch(const char *timeStamp)     { return hostEpoch; }
+
+#include "MQTTqueue.ino"
+
+
+//===========================================================================================
+static void brokerUp(bool up)
+{
+  MQTTclient.up   = up;
+  mqttIsConnected = up;
+
+} // brokerUp()
+
+//===========================================================================================
+// a clean device: empty SPIFFS, nothing in memory
+static void reset()
+{
+  SPIFFS.format();
+  MQTTclient.received.clear();
+  MQTTclient.failNext = 0;
+  brokerUp(false);
+  memset(&mqttQueue, 0, sizeof(mqttQueue));
+  mqttQueueOpen    = false;
+  mqttQueueChecked = false;
+  mqttQueueDropped = 0;
+  mqttQueueUnsaved = 0;
+  hostMemLevel     = MEM_OK;
+  hostEpoch        = 1700000000;
+
+} // reset()
+
+//===========================================================================================
+// the reboot: SPIFFS stays, the rest is gone
+static void reboot()
+{
+  memset(&mqttQueue, 0, sizeof(mqttQueue));
+  mqttQueueOpen    = false;
+  mqttQueueChecked = false;
+  mqttQueueUnsaved = 0;
+
+} // reboot()
+
+//===========================================================================================
+// telegram 'n' (every 10 seconds)
+static void telegram(uint32_t n)
+{
+  snprintf(actTimestamp, sizeof(actTimestamp), "2401%02u%02u%02u00W", 1 + (n / 8640), (n / 360) % 24, (n / 6) % 60);
+  DSMRdata.energy_delivered_tariff1.v = 1000000 + n;
+  DSMRdata.energy_delivered_tariff2.v = 2000000 + n;
+  DSMRdata.energy_returned_tariff1.v  = 3000;
+  DSMRdata.energy_returned_tariff2.v  = 4000;
+  DSMRdata.power_delivered.v          = 1234;
+  DSMRdata.power_returned.v           = 0;
+  DSMRdata.gas_delivered.v            = 5000000 + n;
+  hostEpoch   = 1700000000 + (n * 10);
+  hostMillis += 10000;
+
+} // telegram()
+
+//===========================================================================================
+// the main loop while the broker is down: handleMQTTqueue() every 250ms
+static void outage(uint32_t first, uint32_t nrTelegrams)
+{
+  for (uint32_t n = first; n < (first + nrTelegrams); n++)
+  {
+    telegram(n);
+    hostMillis -= 10000;
+    queueMQTTsnapshot();
+    for (uint8_t t = 0; t < 40; t++)
+    {
+      hostMillis += 250;
+      handleMQTTqueue();
+    }
+  }
+
+} // outage()
+
+//===========================================================================================
+static uint32_t drain()
+{
+  for (uint32_t guard = 0; mqttQueueCount() > 0 && guard < 10000; guard++)
+  {
+    hostMillis += 250;
+    handleMQTTqueue();
+  }
+  return MQTTclient.received.size();
+
+} // drain()
+
+//===========================================================================================
+// telegram 'n' as handleMQTTqueue() publishes it
+static bool isTelegram(const hostMessage &m, uint32_t n)
+{
+  char expected[60];
+
+  snprintf(expected, sizeof(expected), "\"epoch\":%u,", 1700000000 + (n * 10));
+  if (m.payload.find(expected) == std::string::npos) return false;
+  snprintf(expected, sizeof(expected), "\"energy_delivered_tariff1\":1000.%03u,", n);
+  return (m.payload.find(expected) != std::string::npos);
+
+} // isTelegram()
+
+
+//===========================================================================================
+TEST(outage_is_published_in_order_after_reconnect)
+{
+  reset();
+  outage(0, 30);
+  CHECK_EQ(30, mqttQueueCount());
+  CHECK_EQ(0, MQTTclient.received.size());
+
+  brokerUp(true);
+  CHECK_EQ(30, drain());
+  for (uint32_t n = 0; n < 30; n++)
+  {
+    CHECK(MQTTclient.received[n].topic == "DSMR-API/history");
+    CHECK(isTelegram(MQTTclient.received[n], n));
+  }
+  CHECK_EQ(0, mqttQueueCount());
+}
+
+//===========================================================================================
+TEST(queue_file_grows_with_the_queue)
+{
+  reset();
+  outage(0, 5);
+  CHECK_EQ(sizeof(mqttQueueHeader) + (5 * sizeof(mqttSnapshot)), SPIFFS.file(MQTT_QUEUE_FILE)->data.size());
+}
+
+//===========================================================================================
+TEST(header_is_not_written_for_every_snapshot)
+{
+  const uint32_t nrTelegrams = 360;     // one hour
+
+  reset();
+  outage(0, nrTelegrams);
+  hostFile *qFile = SPIFFS.file(MQTT_QUEUE_FILE);
+  uint32_t  headerWrites = qFile->writes - nrTelegrams;
+  printf("[%u writes for %u snapshots] ", qFile->writes, nrTelegrams);
+  CHECK(headerWrites <= (nrTelegrams / MQTT_QUEUE_SAVE_EVERY) + 2);
+
+  //-- draining saves the header in batches too --
+  uint32_t before = qFile->writes;
+  brokerUp(true);
+  CHECK_EQ(nrTelegrams, drain());
+  CHECK((qFile->writes - before) <= (nrTelegrams / MQTT_QUEUE_SAVE_EVERY) + 2);
+}
+
+//===========================================================================================
+TEST(full_queue_drops_the_oldest)
+{
+  reset();
+  outage(0, MQTT_QUEUE_SLOTS + 5);
+  CHECK_EQ(MQTT_QUEUE_SLOTS, mqttQueueCount());
+  CHECK_EQ(5, mqttQueueDropped);
+  CHECK_EQ(sizeof(mqttQueueHeader) + (MQTT_QUEUE_SLOTS * sizeof(mqttSnapshot)), SPIFFS.file(MQTT_QUEUE_FILE)->data.size());
+
+  brokerUp(true);
+  CHECK_EQ(MQTT_QUEUE_SLOTS, drain());
+  CHECK(isTelegram(MQTTclient.received.front(), 5));
+  CHECK(isTelegram(MQTTclient.received.back(),  MQTT_QUEUE_SLOTS + 4));
+}
+
+//===========================================================================================
+TEST(reboot_keeps_what_was_saved)
+{
+  reset();
+  outage(0, 25);                      // header saved at 10 and 20 (and by the timer)
+  reboot();
+  handleMQTTqueue();                  // picks up the file
+  CHECK(mqttQueueCount() >= 25 - MQTT_QUEUE_SAVE_EVERY);
+  CHECK(mqttQueueCount() <= 25);
+  uint16_t kept = mqttQueueCount();
+
+  outage(100, 5);
+  brokerUp(true);
+  CHECK_EQ(kept + 5, drain());
+  CHECK(isTelegram(MQTTclient.received[0], 0));
+  CHECK(isTelegram(MQTTclient.received[kept], 100));
+  CHECK(isTelegram(MQTTclient.received[kept + 4], 104));
+}
+
+//===========================================================================================
+TEST(refused_publish_is_retried)
+{
+  reset();
+  outage(0, 3);
+  brokerUp(true);
+  MQTTclient.failNext = 2;
+  CHECK_EQ(3, drain());
+  for (uint32_t n = 0; n < 3; n++)  CHECK(isTelegram(MQTTclient.received[n], n));
+}
+
+//===========================================================================================
+TEST(broker_goes_down_while_draining)
+{
+  reset();
+  outage(0, 20);
+  brokerUp(true);
+  for (uint8_t t = 0; t < 8; t++)  handleMQTTqueue();
+  brokerUp(false);
+  outage(20, 5);
+  brokerUp(true);
+  CHECK_EQ(25, drain());
+  for (uint32_t n = 0; n < 25; n++)  CHECK(isTelegram(MQTTclient.received[n], n));
+}
+
+//===========================================================================================
+TEST(not_valid_queue_file_is_replaced)
+{
+  reset();
+  File f = SPIFFS.open(MQTT_QUEUE_FILE, "w");
+  f.print("garbage that is not a queue header");
+  f.close();
+  outage(0, 2);
+  CHECK_EQ(2, mqttQueueCount());
+  CHECK_EQ(sizeof(mqttQueueHeader) + (2 * sizeof(mqttSnapshot)), SPIFFS.file(MQTT_QUEUE_FILE)->data.size());
+}
+
+//===========================================================================================
+int main()
+{
+  return runTests();
+}
@@ -0,0 +1,194 @@
+/*
+***************************************************************************
+**  Program  : test_debugLog, host test for the log ring of Debug.h
+**
+**  Copyright (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See LICENSE.
+***************************************************************************
+**  The real Debug.h: LogTf()/DebugTxx() store a record in logRing[],
+**  _logFormat() builds its text later on. The text must be the same as
+**  what printf() makes of the format and the arguments, also for the
+**  levels, widths, 64 bit values and cut strings.
+*/
+
+#include "Arduino.h"
+#include "hostTest.h"
+#include "TimeLib.h"
+
+#include <string>
+
+//-- what Debug.h needs of the core and of DSMRlogger-Next.h -----------------------------------
+class __FlashStringHelper;
+#define strncpy_P(d, s, n)    strncpy((d), (s), (n))
+#define pgm_read_byte(p)      (*(const uint8_t *)(p))
+
+struct hostPrinter {
+    std::string out;
+    void  print(const char *s)              { out += s; }
+    void  print(const String &s)            { out += s.c_str(); }
+    void  println(const char *s)            { out += s; out += "\r\n"; }
+    void  printf(const char *fmt, ...)      { }
+    void  flush()                           { }
+};
+static hostPrinter Serial, TelnetStream;
+
+struct hostESP {
+    uint32_t getFreeHeap()                  { return 30000; }
+};
+static hostESP ESP;
+static uint32_t esp_get_free_block()        { return 20000; }
+
+#define LOG_ARGS_SIZE      104
+#define LOG_STR_MAX         80
+#define LOG_MODULES         32
+#define LOG_DRAIN_MAX       4
+
+#include "Debug.h"
+
+//-- the text of the last record --
+static const char *lastText()
+{
+  static char text[200];
+  _logFormat(logRing[(logHead -1) % LOG_SLOTS], text, sizeof(text));
+  return text;
+}
+
+//-- what printf() makes of it --
+static const char *printed(const char *fmt, ...)
+{
+  static char text[200];
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf(text, sizeof(text), fmt, args);
+  va_end(args);
+  return text;
+}
+
+
+//===========================================================================================
+TEST(format_is_like_printf)
+{
+  LogTf(LOG_ERROR, "[%5d] %-4s|%u|%x|%04X %% %c\r\n", -12, "ab", 42u, 255, 0xBEEF, 'z');
+  CHECK_STR(printed("[%5d] %-4s|%u|%x|%04X %% %c\r\n", -12, "ab", 42u, 255, 0xBEEF, 'z'), lastText());
+
+  LogTf(LOG_WARN, "[%.3f] [%8.2f] [%g]", 3.14159, -2.5f, 0.25);
+  CHECK_STR(printed("[%.3f] [%8.2f] [%g]", 3.14159, -2.5, 0.25), lastText());
+
+  LogTf(LOG_INFO, "[%*d] [%-*s] [%.*s]", 6, 42, 5, "ab", 3, "abcdef");
+  CHECK_STR("[    42] [ab   ] [abc]", lastText());
+
+  String s("a String");
+  DebugTf("[%s] [%ld] [%lu]", s, -7L, 7UL);
+  CHECK_STR("[a String] [-7] [7]", lastText());
+}
+
+//===========================================================================================
+TEST(wide_values_are_kept)
+{
+  int64_t   big  = -12345678901234LL;
+  uint64_t  ubig = 12345678901234ULL;
+  time_t    t    = 1585432800;
+
+  LogTf(LOG_INFO, "[%lld] [%llu] [%lld] [%d]", big, ubig, (int64_t)-5, t);
+  CHECK_STR("[-12345678901234] [12345678901234] [-5] [1585432800]", lastText());
+}
+
+//===========================================================================================
+TEST(args_without_a_format)
+{
+  DebugTln("telegram ", 42, ' ', 1.5);
+  CHECK_STR("telegram 42 1.50\r\n", lastText());
+
+  DebugT(F("no newline"));
+  CHECK_STR("no newline", lastText());
+}
+
+//===========================================================================================
+TEST(missing_and_wrong_args)
+{
+  LogTf(LOG_INFO, "[%d] [%s]", 1);
+  CHECK_STR("[1] [?]", lastText());
+
+  LogTf(LOG_INFO, "[%s] [%d]", 5, "five");
+  CHECK_STR("[?] [five]", lastText());
+
+  LogTf(LOG_INFO, "100%");
+  CHECK_STR("100", lastText());
+}
+
+//===========================================================================================
+TEST(long_strings_are_cut)
+{
+  char  longStr[LOG_STR_MAX + 20];
+  memset(longStr, 'x', sizeof(longStr) -1);
+  longStr[sizeof(longStr) -1] = '\0';
+
+  uint32_t truncated = logTruncated;
+  LogTf(LOG_ERROR, "[%s]\r\n", longStr);
+  const logRecord &r = logRing[(logHead -1) % LOG_SLOTS];
+  CHECK(r.truncated & LOG_TRUNC_STR);
+  CHECK_EQ(truncated +1, logTruncated);
+
+  std::string expect = "[" + std::string(LOG_STR_MAX, 'x') + "] [truncated]\r\n";
+  CHECK_STR(expect.c_str(), lastText());
+
+  //-- more arguments than fit: the ones that do not fit are left out --
+  LogTf(LOG_ERROR, "%s %s %s", longStr, longStr, longStr);
+  CHECK(logRing[(logHead -1) % LOG_SLOTS].truncated & LOG_TRUNC_ARGS);
+  CHECK(strstr(lastText(), "? [truncated]") != NULL);
+}
+
+//===========================================================================================
+TEST(text_fits_the_buffer)
+{
+  char small[12];
+
+  LogTf(LOG_INFO, "%s and %d more", "a long text", 12345);
+  size_t n = _logFormat(logRing[(logHead -1) % LOG_SLOTS], small, sizeof(small));
+  CHECK_EQ(sizeof(small) -1, n);
+  CHECK_STR("a long text", small);
+}
+
+//===========================================================================================
+TEST(levels_per_module)
+{
+  setLogLevel("all", LOG_INFO);
+  uint32_t head = logHead;
+
+  LogTf(LOG_DEBUG, "not stored %d", 1);
+  CHECK_EQ(head, logHead);
+  LogTf(LOG_ERROR, "stored %d", 2);
+  CHECK_EQ(head +1, logHead);
+
+  CHECK(setLogLevel("test_debugLog", LOG_DEBUG));
+  LogTf(LOG_DEBUG, "stored %d", 3);
+  CHECK_EQ(head +2, logHead);
+  CHECK_STR("stored 3", lastText());
+  CHECK_EQ(LOG_DEBUG, logRing[(logHead -1) % LOG_SLOTS].site->level);
+
+  CHECK(setLogLevel("test_debugLog", LOG_ERROR));
+  LogTf(LOG_WARN, "not stored %d", 4);
+  DebugTln("not stored");
+  CHECK_EQ(head +2, logHead);
+  CHECK(!setLogLevel("noSuchModule", LOG_DEBUG));
+  setLogLevel("all", LOG_INFO);
+}
+
+//===========================================================================================
+TEST(drained_to_the_sinks)
+{
+  Serial.out.clear();
+  handleDebugLog();
+  while (logSinkTail != logHead) handleDebugLog();
+  CHECK(Serial.out.find("stored 3") != std::string::npos);
+  CHECK(Serial.out.find("not stored") == std::string::npos);
+  CHECK(Serial.out.find("[  30000| 20000]") != std::string::npos);  // heap and block
+  CHECK(Serial.out == TelnetStream.out.substr(TelnetStream.out.size() - Serial.out.size()));
+}
+
+//===========================================================================================
+int main()
+{
+  return runTests();
+}
@@ -0,0 +1,137 @@
+/*
+***************************************************************************
+**  Program  : test_fixedDecimal, host test for fixedDecimal.h
+**
+**  Copyright (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See LICENSE.
+***************************************************************************
+**  Exactness of fixedToChars()/charsToFixed() (also against the float
+**  they replaced) and a benchmark against snprintf("%.3f").
+*/
+
+#include "Arduino.h"
+#include "hostTest.h"
+#include "fixedDecimal.h"
+
+#include <random>
+
+static std::string toChars(int32_t milli, uint8_t decimals = 3, uint8_t width = 0)
+{
+  char buff[FIXED_MAX_CHARS];
+  fixedToChars(buff, milli, decimals, width);
+  return buff;
+}
+
+static bool parses(const char *s, int32_t expected, char endsAt = '\0')
+{
+  int32_t     milli = 12345;
+  const char *e     = charsToFixed(s, milli);
+  return (e != NULL && *e == endsAt && milli == expected);
+}
+
+static bool rejects(const char *s)
+{
+  int32_t milli = 12345;
+  return (charsToFixed(s, milli) == NULL && milli == 12345);
+}
+
+//===========================================================================================
+TEST(formats_exact)
+{
+  CHECK_STR("12345.678",    toChars(12345678).c_str());
+  CHECK_STR("12345.68",     toChars(12345678, 2).c_str());
+  CHECK_STR("12345.7",      toChars(12345678, 1).c_str());
+  CHECK_STR("12346",        toChars(12345678, 0).c_str());
+  CHECK_STR(" 12345.678",   toChars(12345678, 3, 10).c_str());
+  CHECK_STR("0.001",        toChars(1).c_str());
+  CHECK_STR("-0.001",       toChars(-1).c_str());
+  CHECK_STR("0.00",         toChars(-4, 2).c_str());      // no "-0.00"
+  CHECK_STR("-0.01",        toChars(-5, 2).c_str());      // half away from zero
+  CHECK_STR("2147483.647",  toChars(INT32_MAX).c_str());
+  CHECK_STR("-2147483.648", toChars(INT32_MIN).c_str());
+}
+
+//===========================================================================================
+TEST(parses_exact)
+{
+  CHECK(parses(" 12345.678;", 12345678, ';'));
+  CHECK(parses("12345.6785", 12345679));          // rounds on the 4th decimal
+  CHECK(parses("12345.67849", 12345678));
+  CHECK(parses("-1.5", -1500));
+  CHECK(parses("+7", 7000));
+  CHECK(parses("000000000000012.5", 12500));      // leading zero's do not count
+  CHECK(parses("2147483.647", INT32_MAX));
+  CHECK(parses("-2147483.648", INT32_MIN));
+  CHECK(rejects(""));
+  CHECK(rejects(" -.;"));
+  CHECK(rejects("abc"));
+}
+
+//===========================================================================================
+TEST(rejects_what_does_not_fit)
+{
+  CHECK(rejects("99999999999"));                  // used to give 276446232
+  CHECK(rejects("9999999999"));
+  CHECK(rejects("12345678901234567890.5"));
+  CHECK(rejects("2147483.648"));
+  CHECK(rejects("-2147483.649"));
+  CHECK(rejects("2147483.6475"));                 // rounds past INT32_MAX
+  CHECK(rejects("4294967.296"));                  // would wrap to 0 in 32 bits
+}
+
+//===========================================================================================
+// every value survives fixedToChars() -> charsToFixed(), a float does not
+TEST(round_trip_is_exact)
+{
+  std::mt19937                            rng(2020);
+  std::uniform_int_distribution<int32_t>  all(INT32_MIN, INT32_MAX);
+  std::uniform_int_distribution<int32_t>  meter(0, 99999999);   // up to 99999.999 kWh
+  uint32_t  wrong = 0, floatWrong = 0;
+
+  for (uint32_t i = 0; i < 1000000; i++)
+  {
+    int32_t v = (i & 1) ? all(rng) : meter(rng);
+    int32_t back;
+    if (!parses(toChars(v).c_str(), v)) wrong++;
+
+    char  fbuff[20];
+    snprintf(fbuff, sizeof(fbuff), "%.3f", (float)v / 1000.0);
+    if (charsToFixed(fbuff, back) == NULL || back != v) floatWrong++;
+  }
+  CHECK_EQ(0, wrong);
+  CHECK(floatWrong > 0);
+  printf("  1M values: %u wrong, through a float %u wrong\n", wrong, floatWrong);
+}
+
+//===========================================================================================
+TEST(benchmark)
+{
+  const uint32_t  N = 1000000;
+  char            buff[FIXED_MAX_CHARS];
+  uint32_t        sum = 0;
+
+  uint64_t start = hostMicros();
+  for (uint32_t i = 0; i < N; i++) sum += fixedToChars(buff, (int32_t)(i * 7919));
+  uint64_t fixedUs = hostMicros() - start;
+
+  start = hostMicros();
+  for (uint32_t i = 0; i < N; i++) sum += snprintf(buff, sizeof(buff), "%.3f", (float)(int32_t)(i * 7919) / 1000.0);
+  uint64_t printfUs = hostMicros() - start;
+
+  int32_t milli = 0;
+  start = hostMicros();
+  for (uint32_t i = 0; i < N; i++) { charsToFixed("12345.678", milli); sum += milli; }
+  uint64_t parseUs = hostMicros() - start;
+
+  CHECK(sum != 0);
+  CHECK(fixedUs < printfUs);
+  printf("  fixedToChars() %.0f ns, snprintf(\"%%.3f\") %.0f ns, charsToFixed() %.0f ns\n"
+                              , fixedUs * 1000.0 / N, printfUs * 1000.0 / N, parseUs * 1000.0 / N);
+}
+
+//===========================================================================================
+int main()
+{
+  return runTests();
+}
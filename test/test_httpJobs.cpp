@@ -0,0 +1,295 @@
+/*
+***************************************************************************
+**  Program  : test_httpJobs, host test for httpJobs.ino
+**
+**  Copyright (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See LICENSE.
+***************************************************************************
+**  httpJobs.ino is compiled against a stand-in DNS, a stand-in TCP server
+**  and an in-memory SPIFFS. The test plays lwIP: it decides when (and if)
+**  the DNS answer comes.
+*/
+
+#define USE_MINDERGAS
+
+#include "Arduino.h"
+#include "hostTest.h"
+#include "hostDebug.h"
+#include "hostFS.h"
+#include "hostNet.h"
+#include "httpJobs.h"
+
+#include <vector>
+
+//-- what httpJobs.ino needs of the rest of the sketch ----------------------------------------
+enum    { MEM_OK, MEM_LOW, MEM_CRITICAL };
+
+#define MG_FILENAME     "/Mindergas.post"
+
+static uint8_t              hostMemLevel = MEM_OK;
+static std::vector<int16_t> jobsDone;       // what mindergasJobDone() was told
+
+static bool memShed(uint8_t level)              { return hostMemLevel >= level; }
+static void mindergasJobDone(int16_t httpCode)  { jobsDone.push_back(httpCode); }
+
+#include "httpJobs.ino"
+
+static const char *request = "POST /api/gas_meter_readings HTTP/1.1\r\n"
+                             "Host: www.mindergas.nl\r\n"
+                             "Content-Length: 2\r\n\r\n{}";
+
+
+//===========================================================================================
+// a clean device with a mindergas request in its file
+static void reset(const char *req = request)
+{
+  SPIFFS.format();
+  File f = SPIFFS.open(MG_FILENAME, "w");
+  f.print(req);
+  f.close();
+
+  hostDns = hostResolver();
+  hostDns.names["www.mindergas.nl"] = IPAddress(192, 168, 1, 10);
+  hostTcp = hostPeer();
+  jobsDone.clear();
+  hostMemLevel = MEM_OK;
+  hostMillis   = 1000;
+
+  httpJobClient.stop();
+  httpJobActive = -1;
+  httpJobsRead  = false;
+
+} // reset()
+
+//===========================================================================================
+// loop() 'n' times, 10 ms apart
+static void loops(uint32_t n)
+{
+  for (uint32_t l = 0; l < n; l++)
+  {
+    handleHttpJobs();
+    hostMillis += 10;
+  }
+
+} // loops()
+
+//===========================================================================================
+static uint8_t activeState()
+{
+  return (httpJobActive < 0) ? HTTP_JOB_QUEUED : httpJobs[httpJobActive].state;
+
+} // activeState()
+
+
+//===========================================================================================
+TEST(job_is_sent_and_answered)
+{
+  reset();
+  CHECK(queueHttpJob(HTTP_JOB_MINDERGAS));
+  loops(1);
+  CHECK_EQ(HTTP_JOB_RESOLVE, activeState());
+  hostDns.answer();
+  loops(20);
+  CHECK_EQ(1, hostTcp.connects);
+  CHECK(hostTcp.received == request);
+  CHECK_EQ(1, jobsDone.size());
+  CHECK_EQ(201, jobsDone[0]);
+  CHECK_EQ(-1, httpJobActive);
+  CHECK_EQ(HTTP_JOB_NONE, httpJobs[0].kind);
+}
+
+//===========================================================================================
+TEST(loop_goes_on_while_the_lookup_is_busy)
+{
+  reset();
+  queueHttpJob(HTTP_JOB_MINDERGAS);
+  uint32_t start = hostMillis;
+  loops(100);                                  // one second of loop()'s
+  CHECK_EQ(HTTP_JOB_RESOLVE, activeState());
+  CHECK_EQ(1, hostDns.lookups);                // asked once ..
+  CHECK_EQ(0, hostTcp.connects);               // .. and no connect without the answer
+  CHECK_EQ(100 * 10, hostMillis - start);      // no step took any time
+  hostDns.answer();
+  loops(20);
+  CHECK_EQ(1, jobsDone.size());
+}
+
+//===========================================================================================
+TEST(cached_address_needs_no_answer)
+{
+  reset();
+  hostDns.async = false;
+  queueHttpJob(HTTP_JOB_MINDERGAS);
+  loops(20);
+  CHECK_EQ(1, jobsDone.size());
+  CHECK_EQ(201, jobsDone[0]);
+}
+
+//===========================================================================================
+TEST(lookup_without_answer_times_out_and_backs_off)
+{
+  reset();
+  queueHttpJob(HTTP_JOB_MINDERGAS);
+  loops(HTTP_JOB_CONNECT_MS / 10 + 2);
+  CHECK_EQ(-1, httpJobActive);
+  CHECK_EQ(1, httpJobs[0].attempts);
+  CHECK((int32_t)(httpJobs[0].nextTry - hostMillis) > (HTTP_JOB_BACKOFF / 2));
+  CHECK_EQ(0, jobsDone.size());
+
+  //-- an answer that comes too late is not used for the next attempt --
+  dns_found_callback late    = hostDns.pending;
+  void              *lateArg = hostDns.pendingArg;
+  hostMillis = httpJobs[0].nextTry;
+  loops(1);
+  CHECK_EQ(HTTP_JOB_RESOLVE, activeState());
+  ip_addr_t wrong = { IPAddress(10, 0, 0, 1) };
+  late("www.mindergas.nl", &wrong, lateArg);
+  loops(5);
+  CHECK_EQ(HTTP_JOB_RESOLVE, activeState());
+  CHECK_EQ(0, hostTcp.connects);
+  hostDns.answer();
+  loops(20);
+  CHECK_EQ(1, hostTcp.connects);
+  CHECK_EQ(1, jobsDone.size());
+  CHECK_EQ(201, jobsDone[0]);
+}
+
+//===========================================================================================
+TEST(unknown_host_fails)
+{
+  reset();
+  hostDns.names.clear();
+  queueHttpJob(HTTP_JOB_MINDERGAS);
+  loops(1);
+  hostDns.answer();
+  loops(2);
+  CHECK_EQ(-1, httpJobActive);
+  CHECK_EQ(1, httpJobs[0].attempts);
+  CHECK_EQ(0, hostTcp.connects);
+}
+
+//===========================================================================================
+TEST(refused_connection_is_given_up_after_all_tries)
+{
+  reset();
+  hostDns.async     = false;
+  hostTcp.listening = false;
+  queueHttpJob(HTTP_JOB_MINDERGAS);
+  for (uint8_t t = 0; t < HTTP_JOB_TRIES; t++)
+  {
+    loops(5);
+    if (httpJobs[0].kind != HTTP_JOB_NONE) hostMillis = httpJobs[0].nextTry;
+  }
+  CHECK_EQ(HTTP_JOB_TRIES, hostTcp.connects);
+  CHECK_EQ(1, jobsDone.size());
+  CHECK_EQ(-1, jobsDone[0]);
+  CHECK_EQ(HTTP_JOB_NONE, httpJobs[0].kind);
+}
+
+//===========================================================================================
+TEST(server_errors_are_tried_again)
+{
+  reset();
+  hostDns.async    = false;
+  hostTcp.response = "HTTP/1.1 503 Service Unavailable\r\n\r\n";
+  queueHttpJob(HTTP_JOB_MINDERGAS);
+  loops(20);
+  CHECK_EQ(0, jobsDone.size());
+  CHECK_EQ(1, httpJobs[0].attempts);
+  CHECK((int32_t)(httpJobs[0].nextTry - hostMillis) > (HTTP_JOB_BACKOFF / 2));
+
+  hostTcp.response = "HTTP/1.1 429 Too Many Requests\r\n\r\n";
+  hostMillis = httpJobs[0].nextTry;
+  loops(20);
+  CHECK_EQ(0, jobsDone.size());
+  CHECK_EQ(2, httpJobs[0].attempts);
+
+  hostTcp.response = "HTTP/1.1 201 Created\r\n\r\n";
+  hostMillis = httpJobs[0].nextTry;
+  loops(20);
+  CHECK_EQ(1, jobsDone.size());
+  CHECK_EQ(201, jobsDone[0]);
+  CHECK_EQ(3, hostTcp.connects);
+}
+
+//===========================================================================================
+TEST(client_errors_are_final)
+{
+  reset();
+  hostDns.async    = false;
+  hostTcp.response = "HTTP/1.1 422 Unprocessable Entity\r\n\r\n";
+  queueHttpJob(HTTP_JOB_MINDERGAS);
+  loops(20);
+  CHECK_EQ(1, jobsDone.size());
+  CHECK_EQ(422, jobsDone[0]);
+  CHECK_EQ(HTTP_JOB_NONE, httpJobs[0].kind);
+}
+
+//===========================================================================================
+TEST(server_error_is_given_up_with_its_code)
+{
+  reset();
+  hostDns.async    = false;
+  hostTcp.response = "HTTP/1.1 500 Internal Server Error\r\n\r\n";
+  queueHttpJob(HTTP_JOB_MINDERGAS);
+  for (uint8_t t = 0; t < HTTP_JOB_TRIES; t++)
+  {
+    loops(20);
+    if (httpJobs[0].kind != HTTP_JOB_NONE) hostMillis = httpJobs[0].nextTry;
+  }
+  CHECK_EQ(HTTP_JOB_TRIES, hostTcp.connects);
+  CHECK_EQ(1, jobsDone.size());
+  CHECK_EQ(500, jobsDone[0]);
+}
+
+//===========================================================================================
+TEST(no_response_times_out)
+{
+  reset();
+  hostDns.async    = false;
+  hostTcp.response = "";
+  queueHttpJob(HTTP_JOB_MINDERGAS);
+  loops(HTTP_JOB_RESPONSE_MS / 10 + 20);
+  CHECK_EQ(-1, httpJobActive);
+  CHECK_EQ(1, httpJobs[0].attempts);
+  CHECK_EQ(0, jobsDone.size());
+}
+
+//===========================================================================================
+TEST(request_is_sent_in_chunks)
+{
+  std::string big = "POST /big HTTP/1.1\r\nContent-Length: 1000\r\n\r\n" + std::string(1000, 'x');
+
+  reset(big.c_str());
+  hostDns.async = false;
+  queueHttpJob(HTTP_JOB_MINDERGAS);
+  loops(30);
+  CHECK(hostTcp.received == big);
+  CHECK_EQ((big.size() + HTTP_JOB_CHUNK - 1) / HTTP_JOB_CHUNK, hostTcp.writes);
+  CHECK_EQ(1, jobsDone.size());
+}
+
+//===========================================================================================
+TEST(queue_survives_a_reboot)
+{
+  reset();
+  hostDns.async = false;
+  hostMemLevel  = MEM_CRITICAL;                // nothing is started ..
+  queueHttpJob(HTTP_JOB_MINDERGAS);
+  loops(5);
+  CHECK_EQ(0, hostTcp.connects);
+
+  httpJobsRead = false;                        // .. the reboot
+  memset(httpJobs, 0, sizeof(httpJobs));
+  hostMemLevel = MEM_OK;
+  loops(20);
+  CHECK_EQ(1, jobsDone.size());
+  CHECK_EQ(201, jobsDone[0]);
+}
+
+//===========================================================================================
+int main()
+{
+  return runTests();
+}
@@ -0,0 +1,393 @@
+/*
+***************************************************************************
+**  Program  : test_influxDB, host test for handleInfluxDB.ino
+**
+**  Copyright (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See LICENSE.
+***************************************************************************
+**  handleInfluxDB.ino is compiled against a stand-in HTTP endpoint and an
+**  in-memory SPIFFS. Time only moves when a test moves it.
+*/
+
+#define USE_INFLUXDB
+
+#include "Arduino.h"
+#include "hostTest.h"
+#include "hostDebug.h"
+#include "hostFS.h"
+#include "hostHTTP.h"
+#include "fixedDecimal.h"
+
+#include <algorithm>
+#include <string>
+#include <tuple>
+
+//-- what handleInfluxDB.ino needs of the rest of the sketch ----------------------------------
+enum    { MEM_OK, MEM_LOW, MEM_CRITICAL };
+
+struct FixedValue {
+    int32_t v = 0;
+    int32_t int_val() const { return v; }
+};
+
+//-- a telegram with HOST_FIELDS measurements (a line of about 700 bytes, a 3-phase DSMR 5 meter) --
+#define HOST_FIELDS   20
+
+static const char *hostNames[HOST_FIELDS] = {
+    "energy_delivered_tariff1", "energy_delivered_tariff2", "energy_returned_tariff1"
+  , "energy_returned_tariff2",  "power_delivered",          "power_returned"
+  , "voltage_l1",               "voltage_l2",               "voltage_l3"
+  , "current_l1",               "current_l2",               "current_l3"
+  , "power_delivered_l1",       "power_delivered_l2",       "power_delivered_l3"
+  , "power_returned_l1",        "power_returned_l2",        "power_returned_l3"
+  , "gas_delivered",            "water_delivered" };
+
+template<int N>
+struct hostItem {
+    static const char  *name;
+    static const char  *unit()          { return "kWh"; }
+    FixedValue          value;
+    bool                present() const { return true; }
+    FixedValue         &val()           { return value; }
+};
+template<int N> const char *hostItem<N>::name = hostNames[N];
+
+template<typename Seq> struct hostTelegram;
+template<int... N>
+struct hostTelegram<std::integer_sequence<int, N...>> {
+    std::tuple<hostItem<N>...> items;
+
+    template<typename F>
+    void applyEach(F f)                 { std::apply([&](auto &... i) { (f.apply(i), ...); }, items); }
+    void setAll(int32_t milli)          { std::apply([&](auto &... i) { ((i.value.v = milli), ...); }, items); }
+};
+
+static hostTelegram<std::make_integer_sequence<int, HOST_FIELDS>> DSMRdata;
+
+static char       settingHostname[30]             = "DSMR-API";
+static char       settingInfluxDBhostname[101]    = "influx";
+static uint16_t   settingInfluxDBport             = 8086;
+static char       settingInfluxDBdatabasename[30] = "dsmr";
+static uint32_t   telegramCount   = 0;
+static char       actTimestamp[20];
+static bool       Verbose1        = false;
+static uint8_t    hostMemLevel    = MEM_OK;
+static uint32_t   hostEpoch       = 1700000000;
+
+static bool   memShed(uint8_t level)              { return hostMemLevel >= level; }
+static time_t utcEpoch(const char *timeStamp)     { return hostEpoch; }
+
+//-- the meter readings: energy_returned_tariff2 is 0 (not in the telegram) --
+static void readingsFromSM(int32_t v[5])
+{
+  for (uint8_t i = 0; i < 5; i++)  v[i] = std::get<0>(DSMRdata.items).value.v;
+  v[3] = 0;
+}
+
+#include "handleInfluxDB.ino"
+
+
+//===========================================================================================
+// a clean device: empty SPIFFS, nothing buffered, server up
+static void reset()
+{
+  SPIFFS.format();
+  hostServer = hostHTTPServer();
+  influxBuffLen     = 0;
+  influxLines       = 0;
+  influxSpoolRead   = false;
+  influxThinNext    = 0;
+  influxPosts = influxErrors = influxDropped = influxSpooled = influxThinned = 0;
+  hostMemLevel      = MEM_OK;
+  hostMillis        = 0;
+  initInfluxDB();
+
+} // reset()
+
+//===========================================================================================
+// telegram 'n' (every 10 seconds), the way processTelegram() hands it to handleInfluxDB()
+static void telegram(uint32_t n)
+{
+  DSMRdata.setAll(1000000 + n);
+  hostEpoch = 1700000000 + (n * 10);
+  telegramCount++;
+  handleInfluxDB();
+
+} // telegram()
+
+//===========================================================================================
+// the scheduler: influxBatchTimer every 5s, influxSpoolTimer every 2s (here: 1s steps)
+static void runFor(uint32_t seconds)
+{
+  for (uint32_t s = 0; s < seconds; s++)
+  {
+    hostMillis += 1000;
+    if ((hostMillis / 1000) % 5 == 0)  handleInfluxBatch();
+    if ((hostMillis / 1000) % 2 == 0)  handleInfluxSpool();
+  }
+
+} // runFor()
+
+//===========================================================================================
+// telegrams first .. first + nrTelegrams with the scheduled tasks in between
+static void telegrams(uint32_t first, uint32_t nrTelegrams)
+{
+  for (uint32_t n = first; n < (first + nrTelegrams); n++)
+  {
+    telegram(n);
+    runFor(10);
+  }
+
+} // telegrams()
+
+//===========================================================================================
+// all lines the server received (in the order they came in)
+static std::vector<std::string> receivedLines()
+{
+  std::vector<std::string> lines;
+
+  for (auto &r : hostServer.received)
+  {
+    if (r.method != "POST") continue;
+    size_t from = 0, to;
+    while ((to = r.body.find('\n', from)) != std::string::npos)
+    {
+      lines.push_back(r.body.substr(from, to - from));
+      from = to + 1;
+    }
+  }
+  return lines;
+
+} // receivedLines()
+
+//===========================================================================================
+static bool isTelegram(const std::string &line, uint32_t n)
+{
+  char expected[60];
+
+  snprintf(expected, sizeof(expected), " %u", 1700000000 + (n * 10));
+  if (line.size() < strlen(expected) || line.compare(line.size() - strlen(expected), strlen(expected), expected) != 0) return false;
+  snprintf(expected, sizeof(expected), " energy_delivered_tariff1=%u.%03u,", (1000000 + n) / 1000, (1000000 + n) % 1000);
+  return (line.find(expected) != std::string::npos);
+
+} // isTelegram()
+
+
+//===========================================================================================
+// a line of a thinned telegram: only the meter readings
+static bool isThinned(const std::string &line)
+{
+  return (line.find("power_delivered=") == std::string::npos);
+
+} // isThinned()
+
+
+//===========================================================================================
+// every 'step'th telegram of first .. first + nrTelegrams was received, exactly once 
+// (the order does not matter, every line has its own timestamp)
+static bool receivedAll(uint32_t first, uint32_t nrTelegrams, uint32_t step)
+{
+  auto lines = receivedLines();
+
+  if (lines.size() != (nrTelegrams + step - 1) / step) return false;
+  for (uint32_t n = first; n < (first + nrTelegrams); n += step)
+  {
+    uint16_t found = 0;
+    for (auto &l : lines)  if (isTelegram(l, n)) found++;
+    if (found != 1) return false;
+  }
+  return true;
+
+} // receivedAll()
+
+
+//===========================================================================================
+TEST(line_protocol_and_url)
+{
+  reset();
+  telegram(0);
+  hostMillis += 60000;
+  handleInfluxBatch();
+  CHECK_EQ(1, hostServer.received.size());
+  CHECK(hostServer.received[0].url == "http://influx:8086/write?db=dsmr&precision=s");
+  auto lines = receivedLines();
+  CHECK_EQ(1, lines.size());
+  CHECK(lines[0].compare(0, 18, "dsmr,host=DSMR-API") == 0);
+  CHECK(isTelegram(lines[0], 0));
+}
+
+//===========================================================================================
+TEST(batch_is_posted_when_full)
+{
+  reset();
+  for (uint32_t n = 0; n < INFLUX_BATCH_TELEGRAMS; n++)  telegram(n);
+  CHECK_EQ(1, hostServer.received.size());
+  CHECK_EQ(INFLUX_BATCH_TELEGRAMS, receivedLines().size());
+}
+
+//===========================================================================================
+TEST(old_batch_is_posted_without_a_next_telegram)
+{
+  reset();
+  telegram(0);
+  runFor(INFLUX_BATCH_SEC - 5);
+  CHECK_EQ(0, hostServer.received.size());    // not too early ..
+  runFor(5);
+  CHECK_EQ(1, hostServer.received.size());    // .. but on time, with no telegram after it
+  CHECK(isTelegram(receivedLines()[0], 0));
+  runFor(600);
+  CHECK_EQ(1, hostServer.received.size());
+}
+
+//===========================================================================================
+TEST(failed_batch_is_retried_by_the_timer)
+{
+  reset();
+  hostServer.up = false;
+  telegram(0);
+  runFor(INFLUX_BATCH_SEC);
+  CHECK_EQ(0, hostServer.received.size());
+  CHECK_EQ(1, influxErrors);
+  CHECK_EQ(1, influxLines);                   // still in influxBuff
+
+  hostServer.up = true;
+  runFor(INFLUX_RETRY_SEC + 5);
+  auto lines = receivedLines();
+  CHECK_EQ(1, lines.size());
+  CHECK(isTelegram(lines[0], 0));
+}
+
+//===========================================================================================
+TEST(outage_is_spooled_and_replayed)
+{
+  const uint32_t nrTelegrams = 90;            // a quarter of an hour, nothing is thinned
+
+  reset();
+  hostServer.up = false;
+  telegrams(0, nrTelegrams);
+  CHECK(influxSpooled > 0);
+  CHECK_EQ(0, influxDropped);
+
+  hostServer.up = true;
+  runFor(600);
+  CHECK(influxSpoolEmpty);
+  CHECK(receivedAll(0, nrTelegrams, 1));
+}
+
+//===========================================================================================
+TEST(long_outage_is_thinned)
+{
+  const uint32_t nrTelegrams = 6 * 360;       // six hours
+
+  reset();
+  hostServer.up = false;
+  telegrams(0, nrTelegrams);
+  CHECK(influxThinned > 0);
+  CHECK_EQ(0, influxDropped);
+  CHECK((influxSpoolHead - influxSpoolTail) < INFLUX_SPOOL_SEGMENTS);
+
+  hostServer.up = true;
+  runFor(600);
+  CHECK(influxSpoolEmpty && influxThinEmpty);
+  CHECK(receivedAll(0, nrTelegrams, 1));      // every telegram ..
+
+  //-- .. at first as a whole line, later one every INFLUX_SPOOL_THIN_SEC --
+  auto      lines = receivedLines();
+  uint32_t  thinLines = 0, thinGaps = 0;
+  std::vector<uint32_t> epochs;
+  for (auto &l : lines)
+  {
+    if (isThinned(l))
+    {
+      thinLines++;
+      CHECK(l.find(" energy_delivered_tariff1=") != std::string::npos);
+      CHECK(l.find(",gas_delivered=") != std::string::npos);
+      CHECK(l.find("energy_returned_tariff2") == std::string::npos);
+      continue;
+    }
+    epochs.push_back(strtoul(l.substr(l.rfind(' ') + 1).c_str(), NULL, 10));
+  }
+  CHECK_EQ(influxThinned, thinLines);
+  std::sort(epochs.begin(), epochs.end());
+  CHECK_EQ(1700000000, epochs.front());
+  CHECK(epochs.back() > 1700000000 + (nrTelegrams * 10) - INFLUX_SPOOL_THIN_SEC);
+  for (size_t e = 1; e < epochs.size(); e++)
+  {
+    uint32_t gap = epochs[e] - epochs[e -1];
+    if (gap == INFLUX_SPOOL_THIN_SEC) thinGaps++;
+    else CHECK_EQ(10, gap);
+  }
+  CHECK(thinGaps > 50);
+}
+
+//===========================================================================================
+// The benchmark: InfluxDB is down for a day (a telegram every 10 seconds), how much
+// of it is there after the recovery and how long does the replay take?
+// A 32KB POST is taken to take 400ms on the ESP. Of most telegrams only the meter
+// readings are left.
+//===========================================================================================
+TEST(recovery_after_a_day)
+{
+  const uint32_t nrTelegrams = 24 * 360;
+  uint64_t       hostStart   = hostMicros();
+
+  reset();
+  hostServer.up = false;
+  telegrams(0, nrTelegrams);
+  size_t  spoolBytes = SPIFFS.usedBytes();
+
+  hostServer.up        = true;
+  hostServer.latencyMs = 400;
+  uint32_t recoverStart = hostMillis;
+  uint32_t busyMs = 0;
+  while (!(influxSpoolEmpty && influxThinEmpty) && (hostMillis - recoverStart) < 3600000)
+  {
+    uint32_t before = hostMillis;
+    runFor(1);
+    busyMs += (hostMillis - before) - 1000;
+  }
+  uint32_t recoverMs = hostMillis - recoverStart;
+  runFor(60);
+
+  auto      lines = receivedLines();
+  uint32_t  thinLines = std::count_if(lines.begin(), lines.end(), isThinned);
+  std::vector<bool> hour(24, false);
+  for (auto &l : lines)
+  {
+    if (isThinned(l)) continue;
+    uint32_t epoch = strtoul(l.substr(l.rfind(' ') + 1).c_str(), NULL, 10);
+    hour[((epoch - 1700000000) / 3600) % 24] = true;
+  }
+  printf("\n    spool [%u] bytes, [%u] of [%u] telegrams kept, [%u] of them only the readings, [%u] dropped"
+         "\n    replay [%u] POSTs in [%u] s, busy [%u] ms"
+         "\n    (host run [%u] ms) "
+        , (unsigned)spoolBytes, (unsigned)lines.size(), nrTelegrams, thinLines, influxDropped
+        , (unsigned)hostServer.received.size(), recoverMs / 1000, busyMs
+        , (unsigned)((hostMicros() - hostStart) / 1000));
+
+  CHECK_EQ(0, influxDropped);                 // nothing is lost ..
+  CHECK(receivedAll(0, nrTelegrams, 1));      // .. every telegram is there ..
+  CHECK(std::all_of(hour.begin(), hour.end(), [](bool h) { return h; }));   // .. every hour as a whole line
+  CHECK(spoolBytes <= (INFLUX_SPOOL_SEGMENTS * INFLUX_SPOOL_SEG_MAX) + (INFLUX_THIN_MAX * sizeof(influxThinRec)) + 100);
+  CHECK(recoverMs < 180000);
+}
+
+//===========================================================================================
+TEST(no_posts_when_memory_is_low)
+{
+  reset();
+  hostMemLevel = MEM_LOW;
+  telegram(0);
+  runFor(INFLUX_BATCH_SEC + 10);
+  CHECK_EQ(0, hostServer.received.size());
+  hostMemLevel = MEM_OK;
+  runFor(5);
+  CHECK_EQ(1, receivedLines().size());
+}
+
+//===========================================================================================
+int main()
+{
+  return runTests();
+}
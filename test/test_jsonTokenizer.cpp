@@ -0,0 +1,102 @@
+/*
+***************************************************************************
+**  Program  : test_jsonTokenizer, host test for jsonTokenizer.h
+**
+**  Copyright (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See LICENSE.
+***************************************************************************
+*/
+
+#include "Arduino.h"
+#include "hostTest.h"
+#include "fixedDecimal.h"
+#include "jsonTokenizer.h"
+
+static bool valid(const char *json)
+{
+  return jsonIsValid(json, strlen(json));
+}
+
+//===========================================================================================
+TEST(accepts_valid_json)
+{
+  CHECK(valid("{}"));
+  CHECK(valid("[]"));
+  CHECK(valid(" { \"a\" : 1 , \"b\" : [ 1 , 2 , { } ] } "));
+  CHECK(valid("[{\"recid\":\"2901\",\"edt1\":2601.146},{\"recid\":\"2902\"}]"));
+  CHECK(valid("{\"name\":\"mqttBroker\",\"value\":\"a,b\"}"));
+  CHECK(valid("[true,false,null,-1.5e3]"));
+}
+
+//===========================================================================================
+TEST(rejects_misplaced_commas)
+{
+  CHECK(!valid("{\"a\":,1}"));
+  CHECK(!valid("{\"a\":1,}"));
+  CHECK(!valid("[1,]"));
+  CHECK(!valid("[,1]"));
+  CHECK(!valid("[1,,2]"));
+  CHECK(!valid("{,\"a\":1}"));
+  CHECK(!valid("{},"));
+  CHECK(!valid(",{}"));
+}
+
+//===========================================================================================
+TEST(rejects_missing_commas)
+{
+  CHECK(!valid("[1 2]"));
+  CHECK(!valid("{\"a\":1 \"b\":2}"));
+  CHECK(!valid("{} {}"));
+  CHECK(!valid("[{}{}]"));
+}
+
+//===========================================================================================
+TEST(rejects_unbalanced)
+{
+  CHECK(!valid("{"));
+  CHECK(!valid("[1,2"));
+  CHECK(!valid("{\"a\":1]"));
+  CHECK(!valid("{\"a\"}"));
+  CHECK(!valid("{\"a\":}"));
+}
+
+//===========================================================================================
+TEST(tokens_and_depth)
+{
+  const char    *json = "{\"a\":[1,\"x\"],\"b\":true}";
+  const uint8_t  types[]  = { JSON_TOK_OBJ_START, JSON_TOK_KEY, JSON_TOK_ARR_START, JSON_TOK_NUMBER
+                            , JSON_TOK_STRING, JSON_TOK_ARR_END, JSON_TOK_KEY, JSON_TOK_TRUE
+                            , JSON_TOK_OBJ_END, JSON_TOK_END };
+  const uint8_t  depths[] = { 0, 1, 1, 2, 2, 1, 1, 1, 0, 0 };
+  jsonTokenizer  jt;
+  jsonToken      tok;
+
+  jsonBegin(jt, json, strlen(json));
+  for (size_t t = 0; t < sizeof(types); t++)
+  {
+    CHECK_EQ(types[t], jsonNext(jt, tok));
+    CHECK_EQ(depths[t], tok.depth);
+  }
+}
+
+//===========================================================================================
+TEST(token_copy_unescapes)
+{
+  const char    *json = "[\"a\\\"b\\n\\u0041\"]";
+  char           buff[20];
+  jsonTokenizer  jt;
+  jsonToken      tok;
+
+  jsonBegin(jt, json, strlen(json));
+  jsonNext(jt, tok);
+  CHECK_EQ(JSON_TOK_STRING, jsonNext(jt, tok));
+  jsonTokenCopy(tok, buff, sizeof(buff));
+  CHECK_STR("a\"b\nA", buff);
+}
+
+//===========================================================================================
+int main()
+{
+  return runTests();
+}
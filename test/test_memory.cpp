@@ -0,0 +1,243 @@
+/*
+***************************************************************************
+**  Program  : test_memory, host test for memoryStuff.ino
+**
+**  Copyright (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See LICENSE.
+***************************************************************************
+**  ESP.getFreeHeap() and ESP_GET_FREE_BLOCK() return what the test says.
+**  The test shrinks (and grows) the heap while handleMemory() runs every
+**  2 seconds, like the memoryTimer does.
+*/
+
+#include "Arduino.h"
+#include "hostTest.h"
+#include "hostDebug.h"
+
+#include <string>
+
+//-- what memoryStuff.ino needs of the rest of the sketch (as in DSMRlogger-Next.h) -----------
+#define MEM_HEAP_LOW        12000
+#define MEM_BLOCK_LOW        6000
+#define MEM_HEAP_CRITICAL    7000
+#define MEM_BLOCK_CRITICAL   3000
+#define MEM_HYSTERESIS       2000
+#define MEM_HEAP_REBOOT      4000
+#define MEM_REBOOT_AFTER      120
+
+enum    { MEM_OK, MEM_LOW, MEM_CRITICAL };
+
+static uint32_t hostHeap  = 40000;
+static uint32_t hostBlock = 20000;
+
+struct hostESP {
+    uint32_t getFreeHeap()  { return hostHeap; }
+};
+static hostESP ESP;
+#define ESP_GET_FREE_BLOCK()  (hostBlock)
+
+static uint8_t      memLevel              = MEM_OK;
+static char         cMsg[150];
+static char         lastRebootReason[41]  = "";
+static char         rebootReason[41]      = "";
+static int          reboots               = 0;
+static int          statusWrites          = 0;
+static std::string  json;
+
+static void commitSettings()      { }
+static void writeLastStatus()     { statusWrites++; }
+static void esp_reboot()          { reboots++; }
+
+static void sendNestedJsonObj(const char *n, int32_t v)                 { json += std::string(n) + "=" + std::to_string(v) + ";"; }
+static void sendNestedJsonObj(const char *n, uint32_t v, const char *u) { json += std::string(n) + "=" + std::to_string(v) + ";"; }
+static void sendNestedJsonObj(const char *n, const char *v)             { json += std::string(n) + "=" + v + ";"; }
+
+void rebootWithReason(const char *reason);     // the Arduino IDE makes this prototype
+
+#include "memoryStuff.ino"
+
+
+//===========================================================================================
+static void reset()
+{
+  hostHeap  = 40000;
+  hostBlock = 20000;
+  hostMillis = 1000;
+  memLevel  = MEM_OK;
+  memLowestHeap   = UINT32_MAX;
+  memLowestBlock  = UINT32_MAX;
+  memLevelChanges = 0;
+  memExhausted    = 0;
+  reboots = statusWrites = 0;
+  rebootReason[0] = '\0';
+}
+
+// one memoryTimer period
+static void tick(uint32_t heap, uint32_t block)
+{
+  hostHeap  = heap;
+  hostBlock = block;
+  handleMemory();
+  hostMillis += 2000;
+}
+
+// what memLevel must be after handleMemory() saw heap/block at level "was"
+static uint8_t expected(uint8_t was, uint32_t heap, uint32_t block)
+{
+  uint32_t hC = (was >= MEM_CRITICAL) ? MEM_HYSTERESIS : 0;
+  uint32_t hL = (was >= MEM_LOW)      ? MEM_HYSTERESIS : 0;
+  if (heap < MEM_HEAP_CRITICAL + hC || block < MEM_BLOCK_CRITICAL + hC) return MEM_CRITICAL;
+  if (heap < MEM_HEAP_LOW + hL      || block < MEM_BLOCK_LOW + hL)      return MEM_LOW;
+  return MEM_OK;
+}
+
+
+//===========================================================================================
+TEST(shrinking_heap_steps_down)
+{
+  reset();
+  uint8_t lastLevel = MEM_OK;
+  bool    upward    = false;
+
+  for (uint32_t heap = 40000; heap >= 5000; heap -= 250)
+  {
+    tick(heap, heap / 2);
+    if (memLevel < lastLevel) upward = true;
+    lastLevel = memLevel;
+    if (heap == 12000) CHECK_EQ(MEM_OK,  memLevel);     // block is 6000: just not LOW
+    if (heap == 11750) CHECK_EQ(MEM_LOW, memLevel);
+  }
+  CHECK(!upward);
+  CHECK_EQ(MEM_CRITICAL, memLevel);
+  CHECK_EQ(2, memLevelChanges);
+  CHECK_EQ(5000, memLowestHeap);
+  CHECK_EQ(2500, memLowestBlock);
+  CHECK_EQ(0, reboots);
+  CHECK(memShed(MEM_LOW) && memShed(MEM_CRITICAL));
+}
+
+//===========================================================================================
+TEST(no_flapping_around_a_threshold)
+{
+  reset();
+  tick(MEM_HEAP_LOW - 100, 20000);
+  CHECK_EQ(MEM_LOW, memLevel);
+
+  //-- +/- 1500 bytes around MEM_HEAP_LOW: inside the hysteresis --
+  for (int i = 0; i < 1000; i++)
+    tick((i & 1) ? MEM_HEAP_LOW + 1500 : MEM_HEAP_LOW - 1500, 20000);
+  CHECK_EQ(MEM_LOW, memLevel);
+  CHECK_EQ(1, memLevelChanges);
+
+  //-- the same around MEM_HEAP_CRITICAL --
+  tick(MEM_HEAP_CRITICAL - 100, 20000);
+  for (int i = 0; i < 1000; i++)
+    tick((i & 1) ? MEM_HEAP_CRITICAL + 1500 : MEM_HEAP_CRITICAL - 1500, 20000);
+  CHECK_EQ(MEM_CRITICAL, memLevel);
+  CHECK_EQ(2, memLevelChanges);
+}
+
+//===========================================================================================
+TEST(recovers_only_past_the_hysteresis)
+{
+  reset();
+  tick(5000, 2000);
+  CHECK_EQ(MEM_CRITICAL, memLevel);
+
+  tick(MEM_HEAP_CRITICAL + MEM_HYSTERESIS - 1, 20000);
+  CHECK_EQ(MEM_CRITICAL, memLevel);
+  tick(MEM_HEAP_CRITICAL + MEM_HYSTERESIS, 20000);
+  CHECK_EQ(MEM_LOW, memLevel);
+  tick(MEM_HEAP_LOW + MEM_HYSTERESIS - 1, 20000);
+  CHECK_EQ(MEM_LOW, memLevel);
+  tick(MEM_HEAP_LOW + MEM_HYSTERESIS, 20000);
+  CHECK_EQ(MEM_OK, memLevel);
+  CHECK(!memShed(MEM_LOW));
+}
+
+//===========================================================================================
+TEST(fragmented_heap_is_critical)
+{
+  reset();
+  tick(30000, MEM_BLOCK_CRITICAL - 1);
+  CHECK_EQ(MEM_CRITICAL, memLevel);
+  tick(30000, MEM_BLOCK_LOW);
+  CHECK_EQ(MEM_LOW, memLevel);
+  tick(30000, MEM_BLOCK_LOW + MEM_HYSTERESIS);
+  CHECK_EQ(MEM_OK, memLevel);
+  CHECK_EQ(0, reboots);   // free heap is fine, no reboot for fragmentation
+}
+
+//===========================================================================================
+TEST(reboots_only_when_exhausted_long_enough)
+{
+  reset();
+  //-- just short of MEM_REBOOT_AFTER, then a bit of heap comes back --
+  for (uint32_t t = 0; t < MEM_REBOOT_AFTER - 2; t += 2) tick(MEM_HEAP_REBOOT - 1, 1000);
+  CHECK_EQ(0, reboots);
+  tick(MEM_HEAP_REBOOT, 1000);
+  CHECK_EQ(0, reboots);
+
+  //-- and again, now long enough --
+  for (uint32_t t = 0; t < MEM_REBOOT_AFTER; t += 2) tick(MEM_HEAP_REBOOT - 1, 1000);
+  CHECK_EQ(0, reboots);
+  tick(MEM_HEAP_REBOOT - 1, 1000);
+  CHECK_EQ(1, reboots);
+  CHECK_EQ(1, statusWrites);
+  CHECK_STR("low heap 3999/1000", rebootReason);
+}
+
+//===========================================================================================
+// a random walk of heap and block, 24 hours of memoryTimer ticks
+TEST(random_walk_stress)
+{
+  reset();
+  srandom(2020);
+  int32_t  heap  = 30000;
+  int32_t  block = 15000;
+  uint32_t lowest = UINT32_MAX;
+  uint32_t wrong  = 0;
+  uint32_t below  = 0;              // seconds below MEM_HEAP_REBOOT, as it should be counted
+  int      rebootsExpected = 0;
+
+  for (uint32_t t = 0; t < 24 * 3600; t += 2)
+  {
+    heap  += (random() % 2001) - 1000;
+    heap   = std::max<int32_t>(2000, std::min<int32_t>(45000, heap));
+    block  = std::min<int32_t>(heap, std::max<int32_t>(500, block + (random() % 1001) - 500));
+    if ((uint32_t)heap < lowest) lowest = heap;
+
+    uint8_t want = expected(memLevel, heap, block);
+    if ((uint32_t)heap < MEM_HEAP_REBOOT)
+    {
+      below += 2;
+      if (below > MEM_REBOOT_AFTER) { rebootsExpected++; below = 0; }
+    }
+    else below = 0;
+
+    int bootsBefore = reboots;
+    tick(heap, block);
+    if (memLevel != want) wrong++;
+    if (reboots != bootsBefore)       // and the logger starts over
+    {
+      memExhausted = 0;
+      memLevel     = MEM_OK;
+    }
+  }
+  CHECK_EQ(0, wrong);
+  CHECK_EQ(lowest, memLowestHeap);
+  CHECK_EQ(rebootsExpected, reboots);
+  CHECK(memLevelChanges > 0);
+  printf("  %u level changes, %d reboots in 24h of random heap\n", memLevelChanges, reboots);
+
+  json.clear();
+  sendJsonMemoryInfo();
+  CHECK(json.find("memlowestheap=" + std::to_string(lowest) + ";") != std::string::npos);
+}
+
+//===========================================================================================
+int main()
+{
+  return runTests();
+}
@@ -0,0 +1,193 @@
+/*
+***************************************************************************
+**  Program  : test_oled, host test for oledStuff.h
+**
+**  Copyright (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See LICENSE.
+***************************************************************************
+**  oledStuff.h drives the mock SSD1306Ascii in stubs/, that counts the
+**  bytes that go to the display and keeps what is on it. The telegram
+**  screen of processTelegram() is compared with how it was written
+**  before the dirty regions: every line as a whole, every telegram.
+*/
+
+#include "Arduino.h"
+#include "hostTest.h"
+#include "hostDebug.h"
+#include "safeTimers.h"
+
+//-- what oledStuff.h needs of the rest of the sketch ------------------------------------------
+#define LOW           0
+#define HIGH          1
+#define FLASH_BUTTON  0
+enum    { AGG_LAST, AGG_MEAN, AGG_MIN, AGG_MAX, AGGS };
+
+static int digitalRead(uint8_t pin)   { return HIGH; }
+
+#include "oledStuff.h"
+
+// the telegram screen, as processTelegram() prints it
+static void printTelegram(uint32_t t, int watt, int wattRet)
+{
+  char msg[30];
+  snprintf(msg, sizeof(msg), "2020-03-28 - %02u:%02u", (t / 3600) % 24, (t / 60) % 60);
+  oled_Print_Msg(0, msg, 0);
+  snprintf(msg, sizeof(msg), "-Power%7d Watt", watt);
+  oled_Print_Msg(1, msg, 0);
+  snprintf(msg, sizeof(msg), "+Power%7d Watt", wattRet);
+  oled_Print_Msg(2, msg, 0);
+}
+
+// loop() passes until the screen is up to date, returns the number of passes
+static uint16_t updateAll()
+{
+  uint16_t passes = 0;
+  while (oledDirty != 0 && passes < 100)
+  {
+    oled_Update();
+    passes++;
+  }
+  return passes;
+}
+
+static bool screenIsText()
+{
+  for (uint8_t l = 0; l < OLED_LINES; l++)
+  {
+    if (strncmp(oled.line(l), oledText[l], OLED_COLS) != 0) return false;
+  }
+  return true;
+}
+
+static void reset()
+{
+  oledBuffered = false;
+  boolDisplay  = true;
+  oled_Init();
+  oled.resetCounters();
+  oledUpdates = oledCharsSent = 0;
+}
+
+
+//===========================================================================================
+TEST(setup_messages_go_right_away)
+{
+  reset();
+  oled_Print_Msg(0, " <DSMRlogger-Next>", 0);
+  oled_Print_Msg(1, "Verbinden met WiFi", 0);
+  CHECK_EQ(0, oledDirty);
+  CHECK_STR(" <DSMRlogger-Next>", oled.line(0));
+  CHECK_STR("Verbinden met WiFi", oled.line(1));
+  CHECK(screenIsText());
+}
+
+//===========================================================================================
+TEST(buffered_text_comes_in_bursts)
+{
+  reset();
+  oledBuffered = true;
+  printTelegram(3600, 1234, 0);
+  CHECK(oledDirty != 0);
+  CHECK_STR("                  ", oled.line(1));    // nothing sent yet
+
+  uint32_t before = oled.bytes;
+  oled_Update();
+  uint32_t burst = oled.bytes - before;
+  CHECK(burst <= 3 + OLED_BURST_CHARS * (2 * MOCK_FONT_WIDTH + 3));
+
+  updateAll();
+  CHECK_EQ(0, oledDirty);
+  CHECK(screenIsText());
+  CHECK_STR("-Power   1234 Watt", oled.line(1));
+}
+
+//===========================================================================================
+TEST(unchanged_text_sends_nothing)
+{
+  reset();
+  oledBuffered = true;
+  printTelegram(3600, 500, 20);
+  updateAll();
+
+  oled.resetCounters();
+  for (int i = 0; i < 100; i++)
+  {
+    printTelegram(3600, 500, 20);
+    oled_Update();
+  }
+  CHECK_EQ(0, oled.bytes);
+  CHECK_EQ(0, oledDirty);
+}
+
+//===========================================================================================
+TEST(display_off_sends_nothing)
+{
+  reset();
+  oledBuffered = true;
+  boolDisplay  = false;
+  printTelegram(7200, 800, 0);
+  updateAll();
+  CHECK_EQ(0, oled.bytes);
+  CHECK(oledDirty != 0);          // kept for when it is switched on
+
+  boolDisplay = true;             // the flash button
+  updateAll();
+  CHECK(screenIsText());
+  CHECK_STR("-Power    800 Watt", oled.line(1));
+}
+
+//===========================================================================================
+// an hour of telegrams at 1 Hz: bytes to the display per telegram, now
+// and the way it was done before (every line, whole, every telegram)
+TEST(bytes_per_update)
+{
+  SSD1306AsciiWire  before;
+  uint32_t          maxBurst = 0, maxPasses = 0;
+  int               watt = 450, wattRet = 0;
+
+  reset();
+  oledBuffered = true;
+  srand(2020);
+  for (uint32_t t = 0; t < 3600; t++)
+  {
+    watt    = std::max(0, watt    + (rand() % 201) - 100);
+    wattRet = std::max(0, wattRet + (rand() % 101) - 50);
+    printTelegram(36000 + t, watt, wattRet);
+
+    uint16_t passes = 0;
+    while (oledDirty != 0)
+    {
+      uint32_t b = oled.bytes;
+      oled_Update();
+      passes++;
+      if (oled.bytes - b > maxBurst) maxBurst = oled.bytes - b;
+    }
+    if (passes > maxPasses) maxPasses = passes;
+    if (!screenIsText()) { CHECK(screenIsText()); break; }
+
+    //-- before: setCursor() and the line padded to 19 chars --
+    for (uint8_t l = 0; l < 3; l++)
+    {
+      char lineMsg[20] {0};
+      strlcpy(lineMsg, oledText[l], sizeof(lineMsg));
+      strlcat(lineMsg, "                    ", sizeof(lineMsg));
+      before.setCursor(0, ((l * lineHeight) / 8));
+      before.print(lineMsg);
+    }
+  }
+  double nowPer    = oled.bytes   / 3600.0;
+  double beforePer = before.bytes / 3600.0;
+
+  CHECK(nowPer * 4 < beforePer);
+  CHECK(maxBurst <= 3 + OLED_BURST_CHARS * (2 * MOCK_FONT_WIDTH + 3));
+  CHECK(maxPasses <= (3 * OLED_COLS + OLED_BURST_CHARS - 1) / OLED_BURST_CHARS);
+  printf("  %.0f bytes/telegram (before %.0f), %.1f chars, max burst %u bytes, max %u loop passes\n"
+                , nowPer, beforePer, oledCharsSent / 3600.0, maxBurst, maxPasses);
+}
+
+//===========================================================================================
+int main()
+{
+  return runTests();
+}
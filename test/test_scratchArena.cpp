@@ -0,0 +1,489 @@
+/*
+***************************************************************************
+**  Program  : test_scratchArena, host test for scratchArena.h
+**
+**  Copyright (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See LICENSE.
+***************************************************************************
+**  malloc() is replaced by a counting one, so the test can show that
+**  splitting an API URI in the arena takes no heap at all, where the
+**  String based splitString() it replaced takes several blocks.
+**  The glibc std::string keeps up to 15 chars without malloc() (the ESP
+**  String does the same up to 10), so the String numbers are a lower bound.
+**
+**  processTelegram() and processAPI() (with timeStuff, sinkPolicy and
+**  jsonStuff) run under the counter as well: the mallocs of one telegram
+**  and of one request may not grow past what is recorded in the
+**  baselines below.
+*/
+
+#include "Arduino.h"
+#include "hostTest.h"
+#include "hostDebug.h"
+#include "hostNet.h"
+#include "hostWebServer.h"
+#include "TimeLib.h"
+#include "safeTimers.h"
+#include "scratchArena.h"
+#include "fixedDecimal.h"
+#include "jsonTokenizer.h"
+#include "taskScheduler.h"
+
+#include <tuple>
+
+//-- count every malloc() while mallocCounting is set ------------------------------------------
+static bool     mallocCounting = false;
+static uint32_t mallocCount    = 0;
+
+#if !defined(__SANITIZE_ADDRESS__) && !defined(__SANITIZE_THREAD__)
+#define HOST_COUNTS_MALLOC
+extern "C" {
+  void *__libc_malloc(size_t size);
+  void *__libc_calloc(size_t n, size_t size);
+  void *__libc_realloc(void *p, size_t size);
+
+  void *malloc(size_t size)             { if (mallocCounting) mallocCount++; return __libc_malloc(size); }
+  void *calloc(size_t n, size_t size)   { if (mallocCounting) mallocCount++; return __libc_calloc(n, size); }
+  void *realloc(void *p, size_t size)   { if (mallocCounting) mallocCount++; return __libc_realloc(p, size); }
+}
+#endif
+
+static void     countMallocs()  { mallocCount = 0; mallocCounting = true; }
+static uint32_t countedMallocs(){ mallocCounting = false; return mallocCount; }
+
+//-- what the sketch files need of the rest of the sketch (as in DSMRlogger-Next.h) ----------
+#define _FW_VERSION           "v2.3.0-rc5 (host)"
+#define JSON_BUFF_MAX         255
+#define MQTT_BUFF_MAX         200
+#define SINK_FIELDS           16
+#define SINK_MAX_SAMPLES    3600
+#define SINK_MAX_INTERVAL   3600
+#define SM_UTC_OFFSET          1
+#define DATA_RECLEN           75
+#define HOURS_FILE            "/RINGhours.csv"
+#define _NO_HOUR_SLOTS_       (48 +1)
+#define DAYS_FILE             "/RINGdays.csv"
+#define _NO_DAY_SLOTS_        (14 +1)
+#define MONTHS_FILE           "/RINGmonths.csv"
+#define _NO_MONTH_SLOTS_      (24 +1)
+#define TELEGRAM_BUDGET_MS   800
+#define STAGE_PARSE_MS       150
+#define STAGE_PROCESS_MS      50
+#define STAGE_FILES_MS       300
+#define STAGE_MQTT_MS        150
+#define STAGE_INFLUX_MS      150
+#define STAGE_MAX_DEFER        5
+
+enum    { STAGE_PARSE, STAGE_PROCESS, STAGE_FILES, STAGE_MQTT, STAGE_INFLUX, STAGES };
+enum    { SINK_MQTT, SINK_INFLUX, SINK_OLED, SINKS };
+enum    { AGG_LAST, AGG_MEAN, AGG_MIN, AGG_MAX, AGGS };
+enum    { PERIOD_UNKNOWN, HOURS, DAYS, MONTHS, YEARS };
+enum    { MEM_OK, MEM_LOW, MEM_CRITICAL };
+
+typedef struct {
+    const char *name;
+    uint16_t  budgetMs;
+    bool      deferrable;
+    uint8_t   deferRow;
+    uint32_t  runs;
+    uint32_t  overruns;
+    uint32_t  deferred;
+    uint32_t  lastUs, maxUs;
+    uint64_t  totalUs;
+} telegramStage;
+
+typedef struct {
+    uint32_t  sum;
+    uint32_t  min, max;
+    uint16_t  n;
+} sinkAccum;
+
+typedef struct {
+    uint32_t  n;
+    float     mean, m2;
+    float     min, max;
+} pqStat;
+
+typedef struct {
+    uint32_t  seq;
+    time_t    start, end;
+    uint8_t   type, phase;
+    float     extreme;
+} pqEvent;
+
+//-- the log ring of Debug.h, empty --
+#define LOG_SLOTS             32
+#define LOG_SINK_SERIAL     0x01
+#define LOG_SINK_TELNET     0x02
+typedef struct { const char *func; uint16_t line; uint8_t level; } logSite;
+typedef struct { const logSite *site; time_t time; int8_t module; uint8_t truncated; } logRecord;
+typedef struct { const char *name; uint8_t len; uint8_t level; } logModule;
+static logRecord  logRing[LOG_SLOTS];
+static uint32_t   logHead = 0, logLost = 0, logTruncated = 0;
+static uint8_t    logSinks = LOG_SINK_SERIAL, logNrModules = 0;
+static logModule  logModules[1];
+static void _logFormat(const logRecord &r, char *buff, size_t size)   { buff[0] = '\0'; }
+static bool setLogLevel(const char *module, int level)                { return false; }
+
+//-- FixedValue of the dsmr library: the value in 1/1000 --
+struct FixedValue {
+    uint32_t _value = 0;
+    int32_t  int_val() const          { return _value; }
+    operator float() const            { return _value / 1000.0; }
+};
+
+//-- DSMRdata: a few fields, the way the dsmr library hands them to applyEach() --
+#define HOST_FIELDS   6
+static const char *hostNames[HOST_FIELDS] = { "power_delivered", "power_returned", "voltage_l1"
+                                            , "current_l1", "power_delivered_l1", "gas_delivered" };
+static const char *hostUnits[HOST_FIELDS] = { "kW", "kW", "V", "A", "kW", "m3" };
+
+template<int N>
+struct hostItem {
+    static const char  *name;
+    static const char  *unit()          { return hostUnits[N]; }
+    FixedValue          value;
+    bool                present() const { return true; }
+    FixedValue         &val()           { return value; }
+};
+template<int N> const char *hostItem<N>::name = hostNames[N];
+
+template<typename Seq> struct hostTelegram;
+template<int... N>
+struct hostTelegram<std::integer_sequence<int, N...>> {
+    String                      timestamp;
+    FixedValue                 &power_delivered = std::get<0>(items).value;
+    FixedValue                 &power_returned  = std::get<1>(items).value;
+    std::tuple<hostItem<N>...>  items;
+
+    template<typename F>
+    void applyEach(F &&f)               { std::apply([&](auto &... i) { (f.apply(i), ...); }, items); }
+};
+
+static hostTelegram<std::make_integer_sequence<int, HOST_FIELDS>> DSMRdata;
+
+struct hostESP {
+    uint32_t    getFreeHeap()           { return 30000; }
+    uint32_t    getMaxFreeBlockSize()   { return 20000; }
+    uint32_t    getChipId()             { return 0x00C0FFEE; }
+    const char *getSdkVersion()         { return "2.2.2-dev"; }
+    uint8_t     getCpuFreqMHz()         { return 80; }
+    uint32_t    getSketchSize()         { return 500000; }
+    uint32_t    getFreeSketchSpace()    { return 1500000; }
+    uint32_t    getFlashChipSize()      { return 4194304; }
+    uint32_t    getFlashChipSpeed()     { return 40000000; }
+    uint8_t     getFlashChipMode()      { return 2; }
+};
+static hostESP ESP;
+typedef uint8_t FlashMode_t;
+#define ESP_GET_FREE_BLOCK()    ESP.getMaxFreeBlockSize()
+#define ESP_GET_CHIPID()        ESP.getChipId()
+#define HEX                     16
+const char *flashMode[]         { "QIO", "QOUT", "DIO", "DOUT", "Unknown" };
+
+struct hostWiFi {
+    IPAddress   localIP()               { return IPAddress(192, 168, 1, 20); }
+    String      macAddress()            { return String("5C:CF:7F:00:11:22"); }
+    String      SSID()                  { return String("home"); }
+    int32_t     RSSI()                  { return -60; }
+};
+static hostWiFi WiFi;
+
+struct hostSerial {
+    void    setTimeout(uint32_t ms)                         { }
+    size_t  readBytesUntil(char c, char *buff, size_t len)  { return 0; }
+    int     read()                                          { return -1; }
+};
+static hostSerial SM_SERIAL;
+
+struct hostP1 {
+    void    enable(bool on)             { }
+};
+static hostP1 slimmeMeter;
+
+static bool       Verbose1 = false, Verbose2 = false;
+static char       cMsg[150];
+static char       newTimestamp[20]  = "";
+static char       actTimestamp[20]  = "";
+static bool       isDST             = false;
+static time_t     newT = 0, actT    = 0;
+static uint32_t   telegramCount     = 0;
+static uint32_t   telegramErrors    = 0;
+static uint8_t    memLevel          = MEM_OK;
+static uint32_t   upTimeSeconds     = 0;
+static int        nrReboots         = 0;
+static String     lastReset         = "";
+static bool       showRaw           = false;
+static bool       p1Continuous      = true;
+static uint32_t   settingsCommits   = 0;
+static uint32_t   oledUpdates = 0, oledCharsSent = 0;
+static char       settingHostname[30]   = "DSMR-API";
+static char       settingIndexPage[50]  = "DSMRindex.html";
+static char       settingMQTTbroker[101] = "broker", settingMQTTuser[40] = "", settingMQTTpasswd[30] = "";
+static char       settingMQTTtopTopic[21] = "DSMR-API";
+static int32_t    settingMQTTinterval = 60, settingMQTTbrokerPort = 1883;
+static uint8_t    settingMQTTmode = 0, settingMQTTaggregate = AGG_LAST;
+static float      settingEDT1, settingEDT2, settingERT1, settingERT2, settingGDT, settingENBK, settingGNBK;
+static uint8_t    settingSmHasFaseInfo = 1, settingTelegramInterval = 10, settingContinuousRead = 1;
+static uint8_t    settingOledType = 1, settingOledFlip = 0, settingOledAggregate = AGG_LAST;
+static uint16_t   settingOledSleep = 0, settingOledInterval = 0;
+static uint32_t   filesWritten = 0, slotsRead = 0;
+
+DECLARE_TIMER_SEC(antiWearTimer, 61);
+
+static bool memShed(uint8_t level)                              { return memLevel >= level; }
+static void bootMark(const char *stage)                         { }
+static void oled_Print_Msg(uint8_t l, const char *m, uint16_t w){ }
+static void handlePowerQuality()                                { }
+static void writeDataToFiles()                                  { filesWritten++; }
+static void writeLastStatus()                                   { }
+static bool buildDataRecordFromSM(char *rec)                    { strlcpy(rec, "", DATA_RECLEN); return true; }
+static void readingsFromSM(int32_t r[5])                        { memset(r, 0, 5 * sizeof(int32_t)); }
+static uint16_t timestampToHourSlot(const char *ts, int8_t len)  { return 1; }
+static uint16_t timestampToDaySlot(const char *ts, int8_t len)   { return 1; }
+static uint16_t timestampToMonthSlot(const char *ts, int8_t len) { return 1; }
+static void writeDataToFile(const char *f, const char *r, uint16_t s, uint8_t p){ }
+static void updateHistSummary(uint8_t p, uint16_t s, const int32_t r[5])        { }
+static void writeHistColumns(uint8_t p, uint16_t s)                             { }
+static void readOneSlot(int8_t t, const char *f, uint8_t r, uint8_t s, bool j, const char *n)  { slotsRead++; }
+static void sendJsonHistSummary()                               { }
+static void sendJsonHistChannels()                              { }
+static int8_t histColumnByName(const char *name)                { return -1; }
+static void sendJsonHistColumn(int8_t t, int8_t c, bool desc)   { }
+static int16_t writeMonthRecordsFromJson(const char *j, size_t l, uint16_t &rejected) { rejected = 0; return 0; }
+static void sendJsonPowerQuality()                              { }
+static void sendJsonPqEvents()                                  { }
+static bool claimP1forRaw(uint32_t ms)                          { return false; }
+static void applySetting(const char *field, const char *value)  { }
+static void markSettingsDirty()                                 { }
+static void sendJsonMemoryInfo()                                { }
+static void sendJsonBootInfo()                                  { }
+
+time_t epoch(const char *timeStamp, int8_t len, bool syncTime);   // the Arduino IDE makes these prototypes
+void   showSinkPolicies();
+void   sendJsonHist(int8_t fileType, const char *fileName, const char *timeStamp, bool desc);
+bool   isInFieldsArray(const char* lookUp, int elemts);
+void   copyToFieldsArray(const char inArray[][35], int elemts);
+void   sendJsonV0Fields();
+void   sendJsonFields(const char *Name);
+void   sendApiNotFound(const char *URI);
+void   handleDevApi(const char *URI, const char *word4, const char *word5, const char *word6);
+void   handleHistApi(const char *URI, const char *word4, const char *word5, const char *word6);
+void   handleSmApi(const char *URI, const char *word4, const char *word5, const char *word6);
+void   sendDeviceInfo();
+void   sendDeviceTime();
+void   sendDeviceTasks();
+void   sendDeviceLog(const char *URI, const char *word5, const char *word6);
+void   sendDeviceSettings();
+void   sendDeviceDebug(const char *URI, String tail);
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat"                     // time_t is 64 bits on the host
+#pragma GCC diagnostic ignored "-Wsizeof-pointer-memaccess"
+#pragma GCC diagnostic ignored "-Wreturn-type"
+#include "helperStuff.ino"
+#include "timeStuff.ino"
+#include "sinkPolicy.ino"
+#include "jsonStuff.ino"
+#include "processTelegram.ino"
+#include "restAPI.ino"
+#pragma GCC diagnostic pop
+
+static const char *URIs[] = {
+    "/api/v2/hist/months/asc"
+  , "/api/v2/dev/settings"
+  , "/api/v2/sm/fields/power_delivered_l1"
+  , "  /api/v2/hist/hours/desc  "
+  , "/api/v2/sm/telegram"
+};
+#define NR_URIS   (sizeof(URIs) / sizeof(URIs[0]))
+#define REQUESTS  1000
+
+//-- mallocs of one processAPI() call, as recorded on the host --
+struct apiBaseline {
+    const char *uri;
+    uint32_t    mallocs;
+};
+static const apiBaseline apiBaselines[] = {
+    { "/api/v0/sm/actual",                      0 }
+  , { "/api/v1/sm/actual",                      0 }
+  , { "/api/v1/sm/fields/power_delivered_l1",   0 }
+  , { "/api/v1/dev/time",                       0 }
+  , { "/api/v1/dev/settings",                   0 }
+  , { "/api/v1/dev/tasks",                      0 }
+  , { "/api/v1/dev/log/levels",                 0 }
+  , { "/api/v1/hist/hours/desc",                0 }
+  , { "/api/v1/hist/months/asc",                0 }
+  , { "/api/v1/dev/info",                       2 }   // String's of the WiFi and ESP calls
+  , { "/api/v1/does/not/exist",                 0 }
+};
+#define NR_API_BASELINES  (sizeof(apiBaselines) / sizeof(apiBaselines[0]))
+
+//-- mallocs of one processTelegram() (a new hour included) --
+#define TELEGRAM_BASELINE   0
+
+
+//===========================================================================================
+TEST(split_is_like_splitString)
+{
+  for (uint8_t u = 0; u < NR_URIS; u++)
+  {
+    const char *words[10];
+    String      wOut[10];
+    scratchReset();
+    int8_t wc   = scratchSplit(URIs[u], '/', words, 10);
+    int8_t wcS  = splitString(URIs[u], '/', wOut, 10);
+    CHECK_EQ(wcS, wc);
+    for (int8_t w = 0; w < wc; w++)
+      CHECK_STR(wOut[w].c_str(), words[w]);
+  }
+  scratchReset();
+  const char *words[3];
+  CHECK_EQ(3, scratchSplit("a/b/c/d", '/', words, 3));
+  CHECK_STR("c/d", words[2]);
+}
+
+//===========================================================================================
+TEST(split_takes_no_heap)
+{
+  const char *words[10];
+  uint8_t     bad = 0;
+
+  countMallocs();
+  for (uint16_t r = 0; r < REQUESTS; r++)
+  {
+    scratchReset();
+    int8_t wc = scratchSplit(URIs[r % NR_URIS], '/', words, 10);
+    if (wc < 4 || strcmp(words[1], "api") != 0 || strcmp(words[2], "v2") != 0) bad++;
+  }
+  uint32_t n = countedMallocs();
+
+  CHECK_EQ(0, bad);
+#ifdef HOST_COUNTS_MALLOC
+  CHECK_EQ(0, n);
+#endif
+  CHECK(scratch.peak < SCRATCH_SIZE);
+  printf("  scratchSplit(): %u mallocs for %d requests, peak %u of %d bytes\n"
+                              , n, REQUESTS, scratch.peak, SCRATCH_SIZE);
+}
+
+//===========================================================================================
+TEST(splitString_takes_heap)
+{
+  String   wOut[10];
+
+  countMallocs();
+  for (uint16_t r = 0; r < REQUESTS; r++)
+  {
+    splitString(URIs[r % NR_URIS], '/', wOut, 10);
+  }
+  uint32_t n = countedMallocs();
+
+#ifdef HOST_COUNTS_MALLOC
+  CHECK(n >= REQUESTS);
+#endif
+  printf("  splitString() : %u mallocs for %d requests\n", n, REQUESTS);
+}
+
+//===========================================================================================
+TEST(full_arena_gives_empty_words)
+{
+  const char *words[10];
+
+  scratchReset();
+  uint32_t failed = scratch.failed;
+  CHECK(scratchAlloc(SCRATCH_SIZE - 8) != NULL);
+
+  countMallocs();
+  int8_t wc = scratchSplit("/api/v2/hist/months", '/', words, 10);
+  uint32_t n = countedMallocs();
+
+#ifdef HOST_COUNTS_MALLOC
+  CHECK_EQ(0, n);
+#endif
+  CHECK_EQ(5, wc);
+  CHECK_STR("",    words[0]);     // takes 4 bytes, just like "api"
+  CHECK_STR("api", words[1]);     // after that it is full
+  CHECK_STR("",    words[2]);
+  CHECK_STR("",    words[3]);
+  CHECK_STR("",    words[4]);
+  CHECK_EQ(failed + 3, scratch.failed);
+  CHECK(scratchAlloc(1) == NULL);
+
+  scratchReset();
+  CHECK(scratchAlloc(SCRATCH_SIZE) != NULL);
+}
+
+//===========================================================================================
+// two hours of telegrams (every 10 seconds): not one malloc in processTelegram()
+TEST(telegram_mallocs_stay_at_baseline)
+{
+  char      ts[14];
+  uint32_t  maxMallocs = 0, total = 0;
+  uint32_t  telegrams  = 2 * 360;
+
+  filesWritten = 0;
+  epoch("200328000000W", 13, false);                // glibc reads its time zone data on the first timegm()
+  for (uint32_t t = 0; t < telegrams; t++)
+  {
+    uint32_t s = 22 * 3600 + 50 * 60 + (t * 10);    // over 23:00 and midnight
+    snprintf(ts, sizeof(ts), "2003%02u%02u%02u%02uW", 28 + (s / 86400), (s / 3600) % 24, (s / 60) % 60, s % 60);
+    DSMRdata.timestamp = ts;                        // the parser, outside the count
+    std::get<0>(DSMRdata.items).value._value = 1000 + (t % 500);
+    telegramCount++;
+    hostMillis += 10000;
+
+    countMallocs();
+    processTelegram();
+    uint32_t n = countedMallocs();
+    total += n;
+    if (n > maxMallocs) maxMallocs = n;
+  }
+
+  CHECK(filesWritten >= 2);                         // the new hours (and day) are in it
+#ifdef HOST_COUNTS_MALLOC
+  CHECK(maxMallocs <= TELEGRAM_BASELINE);
+#endif
+  printf("  processTelegram(): %u mallocs in %u telegrams (max %u, baseline %u)\n"
+                              , total, telegrams, maxMallocs, TELEGRAM_BASELINE);
+}
+
+//===========================================================================================
+// every request of the baseline (GET) a few times: no more mallocs than recorded
+TEST(api_mallocs_stay_at_baseline)
+{
+  strlcpy(actTimestamp, "200329013000S", sizeof(actTimestamp));
+  scratch.peak = 0;
+  for (uint8_t b = 0; b < NR_API_BASELINES; b++)
+  {
+    uint32_t  maxMallocs = 0;
+
+    httpServer.requestUri    = apiBaselines[b].uri;
+    httpServer.requestMethod = HTTP_GET;
+    for (uint8_t r = 0; r < 5; r++)
+    {
+      httpServer.bytes = 0;
+      countMallocs();
+      processAPI();
+      uint32_t n = countedMallocs();
+      if (n > maxMallocs) maxMallocs = n;
+    }
+    CHECK(httpServer.bytes > 0);
+#ifdef HOST_COUNTS_MALLOC
+    if (maxMallocs > apiBaselines[b].mallocs)
+    {
+      printf("  [%s] %u mallocs, baseline %u\n", apiBaselines[b].uri, maxMallocs, apiBaselines[b].mallocs);
+      CHECK(maxMallocs <= apiBaselines[b].mallocs);
+    }
+#endif
+    printf("  %-40s %u mallocs, %u bytes\n", apiBaselines[b].uri, maxMallocs, httpServer.bytes);
+  }
+  CHECK(scratch.peak < SCRATCH_SIZE);
+}
+
+//===========================================================================================
+int main()
+{
+  return runTests();
+}
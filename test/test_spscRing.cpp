@@ -0,0 +1,182 @@
+/*
+***************************************************************************
+**  Program  : test_spscRing, host test for spscRing.h
+**
+**  Copyright (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See LICENSE.
+***************************************************************************
+**  The producer and the consumer run in their own std::thread, like the
+**  P1 reader task and loop() on the two cores of the ESP32. Every slot
+**  carries a sequence number and a payload derived from it, so a slot
+**  that is read before it is completely written shows up.
+*/
+
+#include "Arduino.h"
+#include "hostTest.h"
+#include "spscRing.h"
+
+#include <thread>
+
+#define PAYLOAD_WORDS   32
+
+struct hostSlot {
+    uint32_t  seq;
+    uint32_t  payload[PAYLOAD_WORDS];
+};
+
+//===========================================================================================
+static void fill(hostSlot *s, uint32_t seq)
+{
+  s->seq = seq;
+  for (uint8_t w = 0; w < PAYLOAD_WORDS; w++)  s->payload[w] = (uint32_t)(seq * 2654435761UL + w);
+
+} // fill()
+
+//===========================================================================================
+static bool isComplete(const hostSlot *s)
+{
+  for (uint8_t w = 0; w < PAYLOAD_WORDS; w++)
+  {
+    if (s->payload[w] != (uint32_t)(s->seq * 2654435761UL + w)) return false;
+  }
+  return true;
+
+} // isComplete()
+
+
+//===========================================================================================
+TEST(all_slots_can_be_used)
+{
+  spscRing<hostSlot, 2> ring;
+
+  CHECK(ring.peek() == NULL);
+  for (uint32_t n = 0; n < 2; n++)
+  {
+    hostSlot *s = ring.reserve();
+    CHECK(s != NULL);
+    fill(s, n);
+    ring.commit();
+  }
+  CHECK(ring.reserve() == NULL);      // full
+  CHECK_EQ(2, ring.count());
+  for (uint32_t n = 0; n < 2; n++)
+  {
+    hostSlot *s = ring.peek();
+    CHECK(s != NULL);
+    CHECK_EQ(n, s->seq);
+    ring.pop();
+  }
+  CHECK(ring.peek() == NULL);
+  CHECK_EQ(0, ring.count());
+}
+
+//===========================================================================================
+TEST(counters_run_over)
+{
+  spscRing<hostSlot, 3> ring;
+
+  ring.head = ring.tail = 0xFFFFFFFE;
+  for (uint32_t n = 0; n < 10; n++)
+  {
+    fill(ring.reserve(), n);
+    ring.commit();
+    CHECK_EQ(1, ring.count());
+    CHECK_EQ(n, ring.peek()->seq);
+    ring.pop();
+  }
+  CHECK_EQ(8, ring.head.load());
+}
+
+//===========================================================================================
+// both sides wait for each other: nothing may be lost, torn or out of order
+//===========================================================================================
+TEST(threads_hand_over_every_slot)
+{
+  const uint32_t          nrSlots = 1000000;
+  spscRing<hostSlot, 2>   ring;
+  uint32_t                torn = 0, outOfOrder = 0, received = 0;
+
+  std::thread producer([&]() {
+    for (uint32_t n = 0; n < nrSlots; )
+    {
+      hostSlot *s = ring.reserve();
+      if (s == NULL) { std::this_thread::yield(); continue; }
+      fill(s, n++);
+      ring.commit();
+    }
+  });
+
+  for (uint32_t expected = 0; expected < nrSlots; )
+  {
+    hostSlot *s = ring.peek();
+    if (s == NULL) { std::this_thread::yield(); continue; }
+    if (!isComplete(s))      torn++;
+    if (s->seq != expected)  outOfOrder++;
+    expected = s->seq + 1;
+    received++;
+    ring.pop();
+  }
+  producer.join();
+
+  CHECK_EQ(nrSlots, received);
+  CHECK_EQ(0, torn);
+  CHECK_EQ(0, outOfOrder);
+  CHECK_EQ(0, ring.count());
+}
+
+//===========================================================================================
+// the P1 reader never waits: when the ring is full the telegram is dropped
+// (p1Dropped). What does come through must still be complete and in order.
+//===========================================================================================
+TEST(threads_with_a_producer_that_drops)
+{
+  const uint32_t          nrSlots = 1000000;
+  spscRing<hostSlot, 2>   ring;
+  std::atomic<bool>       done {false};
+  uint32_t                dropped = 0, torn = 0, outOfOrder = 0, received = 0;
+  int64_t                 last = -1;
+
+  std::thread producer([&]() {
+    for (uint32_t n = 0; n < nrSlots; n++)
+    {
+      hostSlot *s = ring.reserve();
+      if (s == NULL) { dropped++; continue; }
+      fill(s, n);
+      ring.commit();
+      std::this_thread::yield();          // (a telegram does not come every us)
+    }
+    done = true;
+  });
+
+  for (;;)
+  {
+    hostSlot *s = ring.peek();
+    if (s == NULL)
+    {
+      if (done && ring.peek() == NULL) break;
+      std::this_thread::yield();
+      continue;
+    }
+    if (!isComplete(s))           torn++;
+    if ((int64_t)s->seq <= last)  outOfOrder++;
+    last = s->seq;
+    received++;
+    ring.pop();
+    if ((received % 64) == 0) std::this_thread::sleep_for(std::chrono::microseconds(50));  // loop() is busy
+  }
+  producer.join();
+
+  printf("[%u received, %u dropped] ", received, dropped);
+  CHECK_EQ(nrSlots, received + dropped);
+  CHECK(received > 0);
+  CHECK(dropped > 0);
+  CHECK_EQ(0, torn);
+  CHECK_EQ(0, outOfOrder);
+}
+
+//===========================================================================================
+int main()
+{
+  return runTests();
+}
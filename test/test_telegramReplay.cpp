@@ -0,0 +1,310 @@
+/*
+***************************************************************************
+**  Program  : test_telegramReplay, host replay of the 1 Hz telegram pipeline
+**
+**  Copyright (c) 2020 Willem Aandewiel
+**
+**  TERMS OF USE: MIT License. See LICENSE.
+***************************************************************************
+**  telegramGenerator.h sends a DSMR 5 telegram every second (continuous
+**  read) into processTelegram.ino, sinkPolicy.ino and timeStuff.ino. The
+**  sinks and the RING-files are stand-ins that take a given time (in
+**  faked millis()), so the stage budgets and the deferral decide if the
+**  logger keeps up.
+**
+**  A telegram arrives every 1000ms. The serial RX buffer holds one, so a
+**  telegram is lost if the previous one is not done within a second of
+**  its own arrival.
+*/
+
+#define USE_MQTT
+#define USE_INFLUXDB
+
+#include "Arduino.h"
+#include "hostTest.h"
+#include "hostDebug.h"
+#include "TimeLib.h"
+#include "safeTimers.h"
+#include "scratchArena.h"
+#include "fixedDecimal.h"
+#include "telegramGenerator.h"
+
+//-- what the pipeline needs of the rest of the sketch (as in DSMRlogger-Next.h) --------------
+#define TELEGRAM_BUDGET_MS   800
+#define STAGE_PARSE_MS       150
+#define STAGE_PROCESS_MS      50
+#define STAGE_FILES_MS       300
+#define STAGE_MQTT_MS        150
+#define STAGE_INFLUX_MS      150
+#define STAGE_MAX_DEFER        5
+
+enum    { STAGE_PARSE, STAGE_PROCESS, STAGE_FILES, STAGE_MQTT, STAGE_INFLUX, STAGES };
+
+#define SINK_FIELDS           16
+#define SINK_MAX_SAMPLES    3600
+
+enum    { SINK_MQTT, SINK_INFLUX, SINK_OLED, SINKS };
+enum    { AGG_LAST, AGG_MEAN, AGG_MIN, AGG_MAX, AGGS };
+
+#define SM_UTC_OFFSET          1
+#define DATA_RECLEN           75
+#define HOURS_FILE            "/RINGhours.csv"
+enum    { PERIOD_UNKNOWN, HOURS, DAYS, MONTHS, YEARS };
+
+typedef struct {
+    const char *name;
+    uint16_t  budgetMs;
+    bool      deferrable;
+    uint8_t   deferRow;
+    uint32_t  runs;
+    uint32_t  overruns;
+    uint32_t  deferred;
+    uint32_t  lastUs, maxUs;
+    uint64_t  totalUs;
+} telegramStage;
+
+typedef struct {
+    uint32_t  sum;
+    uint32_t  min, max;
+    uint16_t  n;
+} sinkAccum;
+
+struct FixedValue {
+    uint32_t _value = 0;
+};
+
+//-- DSMRdata: what the stand-in parser takes from a telegram --
+struct hostData {
+    String    timestamp;
+    float     power_delivered = 0;
+    float     power_returned  = 0;
+    template<typename V>
+    void applyEach(V &v)    { }     // no aggregation: every sink sends the last value
+};
+static hostData DSMRdata;
+
+static bool       Verbose1 = false, Verbose2 = false;
+static char       cMsg[150];
+static char       newTimestamp[20]  = "";
+static char       actTimestamp[20]  = "";
+static bool       isDST             = false;
+static time_t     newT = 0, actT    = 0;
+static uint32_t   telegramCount     = 0;
+static uint32_t   telegramErrors    = 0;
+static uint8_t    settingOledType   = 0;
+static uint8_t    settingTelegramInterval   = 10;
+static uint8_t    settingContinuousRead     = 1;
+static uint16_t   settingMQTTinterval       = 60;
+static uint16_t   settingInfluxDBinterval   = 0;    // every settingTelegramInterval
+static uint16_t   settingOledInterval       = 0;
+static uint8_t    settingMQTTaggregate      = AGG_LAST;
+static uint8_t    settingInfluxDBaggregate  = AGG_LAST;
+static uint8_t    settingOledAggregate      = AGG_LAST;
+
+DECLARE_TIMER_SEC(publishMQTTtimer, 60, CATCH_UP_MISSED_TICKS);
+
+//-- what a stage costs on the board (ms of faked time) --
+struct hostCosts {
+    uint32_t  parse, process, files, mqtt, influx;
+};
+static hostCosts  cost;
+static uint32_t   filesWritten, mqttSent, influxSent;
+
+static void spend(uint32_t ms)                  { hostMillis += ms; }
+static void bootMark(const char *stage)         { }
+static void oled_Print_Msg(uint8_t l, const char *m, uint16_t w) { }
+static void handlePowerQuality()                { spend(cost.process); }
+static void writeDataToFiles()                  { spend(cost.files); filesWritten++; }
+static void writeLastStatus()                   { }
+static bool buildDataRecordFromSM(char *rec)    { return true; }
+static void readingsFromSM(int32_t r[5])        { }
+static uint16_t timestampToHourSlot(const char *ts, int8_t len)                 { return 0; }
+static void writeDataToFile(const char *f, const char *r, uint16_t s, uint8_t p){ }
+static void updateHistSummary(uint8_t p, uint16_t s, const int32_t r[5])        { }
+static void writeHistColumns(uint8_t p, uint16_t s)                             { }
+static void sendMQTTData()                      { spend(cost.mqtt);   mqttSent++; }
+static void handleInfluxDB()                    { spend(cost.influx); influxSent++; }
+static void sendStartJsonObj(const char *n)     { }
+static void sendEndJsonObj()                    { }
+static void sendJsonStageObj(telegramStage &s)  { }
+static void sendNestedJsonObj(const char *n, int32_t v, const char *u)  { }
+static void sendNestedJsonObj(const char *n, uint32_t v, const char *u) { }
+static void sendNestedJsonObj(const char *n, uint32_t v)                { }
+
+time_t epoch(const char *timeStamp, int8_t len, bool syncTime);   // the Arduino IDE makes these prototypes
+void   showSinkPolicies();
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat"                     // time_t is 64 bits on the host
+#pragma GCC diagnostic ignored "-Wsizeof-pointer-memaccess"
+#include "timeStuff.ino"
+#include "sinkPolicy.ino"
+#include "processTelegram.ino"
+#pragma GCC diagnostic pop
+
+
+//===========================================================================================
+// stand-in for P1Parser::parse(): only what processTelegram() uses
+static bool hostParse(const char *telegram)
+{
+  const char *p = strstr(telegram, "0-0:1.0.0(");
+  int32_t     milli;
+
+  if (p == NULL) return false;
+  DSMRdata.timestamp = std::string(p + 10, 13);
+  if ((p = strstr(telegram, "1-0:1.7.0(")) && charsToFixed(p + 10, milli)) DSMRdata.power_delivered = milli / 1000.0;
+  if ((p = strstr(telegram, "1-0:2.7.0(")) && charsToFixed(p + 10, milli)) DSMRdata.power_returned  = milli / 1000.0;
+  return true;
+}
+
+struct replayResult {
+    uint32_t  telegrams, lost;
+    uint32_t  maxBusyMs;      // parse + processTelegram() of one telegram
+    uint32_t  maxLateMs;      // waited in the RX buffer
+    uint64_t  busyMs;
+};
+
+//===========================================================================================
+// "seconds" telegrams at 1 Hz, starting at (meter) time "start"
+static replayResult replay(time_t start, uint32_t seconds)
+{
+  static char   telegram[TG_MAX_TELEGRAM];
+  tgState       gen;
+  replayResult  r = {};
+  uint32_t      t0 = hostMillis;
+
+  tgBegin(gen, 1, TG_DSMR50, start);
+  for (uint32_t k = 0; k < seconds; k++)
+  {
+    tgNext(gen, start + k);
+    tgBuild(gen, telegram, sizeof(telegram));
+
+    uint32_t arrival = t0 + (k * 1000);
+    if ((int32_t)(hostMillis - arrival) < 0) hostMillis = arrival;     // idle
+    uint32_t late = hostMillis - arrival;
+    if (late > r.maxLateMs) r.maxLateMs = late;
+    if (late >= 1000)       r.lost++;               // the next one came in on top of it
+
+    uint32_t begin = hostMillis;
+    spend(cost.parse);
+    bool ok = hostParse(telegram);
+    stageDone(STAGE_PARSE, cost.parse * 1000);
+    telegramCount++;
+    if (!ok) { telegramErrors++; continue; }
+    processTelegram();
+
+    uint32_t busy = hostMillis - begin;
+    if (busy > r.maxBusyMs) r.maxBusyMs = busy;
+    r.busyMs += busy;
+    r.telegrams++;
+  }
+  return r;
+}
+
+//===========================================================================================
+static void reset(const hostCosts &c)
+{
+  cost = c;
+  for (uint8_t s = 0; s < STAGES; s++)
+  {
+    telegramStage &st = stages[s];
+    st.deferRow = 0;
+    st.runs = st.overruns = st.deferred = st.lastUs = st.maxUs = 0;
+    st.totalUs = 0;
+  }
+  telegramMaxUs = telegramOverruns = 0;
+  telegramCount = telegramErrors = 0;
+  filesWritten  = mqttSent = influxSent = 0;
+  actTimestamp[0] = '\0';
+  hostMillis += 3600 * 1000;
+  RESTART_TIMER(publishMQTTtimer);
+}
+
+static void report(const char *what, const replayResult &r)
+{
+  printf("  %s: %u telegrams, %u lost, max %u ms (headroom %u ms), late max %u ms, load %.1f%%\n"
+                  , what, r.telegrams, r.lost, r.maxBusyMs, 1000 - std::min<uint32_t>(1000, r.maxBusyMs)
+                  , r.maxLateMs, (r.busyMs * 100.0) / (r.telegrams * 1000.0));
+  printf("  %*s  files %u, mqtt %u (deferred %u), influx %u (deferred %u), over budget %u\n"
+                  , (int)strlen(what), "", filesWritten, mqttSent, stages[STAGE_MQTT].deferred
+                  , influxSent, stages[STAGE_INFLUX].deferred, telegramOverruns);
+}
+
+// 2020-03-28 22:00:00 UTC: midnight (a new day and a new month, almost) is in the replay
+static const time_t replayStart = 1585432800;
+#define REPLAY_SECONDS  (4 * 3600)
+
+
+//===========================================================================================
+// every stage takes its whole budget: still 1 Hz, with headroom
+TEST(sustains_1Hz_at_full_budget)
+{
+  reset({ STAGE_PARSE_MS, STAGE_PROCESS_MS, STAGE_FILES_MS, STAGE_MQTT_MS, STAGE_INFLUX_MS });
+  replayResult r = replay(replayStart, REPLAY_SECONDS);
+  report("full budget", r);
+
+  CHECK_EQ(REPLAY_SECONDS, r.telegrams);
+  CHECK_EQ(0, r.lost);
+  CHECK(r.maxBusyMs <= STAGE_PARSE_MS + TELEGRAM_BUDGET_MS);
+  CHECK(r.maxLateMs < 1000);
+  CHECK_EQ(0, telegramOverruns);
+  CHECK_EQ(REPLAY_SECONDS, stages[STAGE_PROCESS].runs);
+  CHECK_EQ(REPLAY_SECONDS, stages[STAGE_PARSE].runs);
+
+  //-- the expensive stages on their own cadence --
+  CHECK(filesWritten >= 4 && filesWritten <= 5);              // every hour, twice at midnight
+  CHECK(mqttSent   >= (REPLAY_SECONDS / 60) - 1);
+  CHECK(mqttSent   <= (REPLAY_SECONDS / 60) + 1);
+  CHECK(influxSent >= (REPLAY_SECONDS / 10) * 95 / 100);
+  CHECK(influxSent <= (REPLAY_SECONDS / 10) + 1);
+  CHECK(stages[STAGE_INFLUX].deferred <= filesWritten + mqttSent);
+}
+
+//===========================================================================================
+// InfluxDB every second and MQTT every 10 seconds do not fit in one second
+// together: InfluxDB waits for the next telegram, no telegram is lost
+TEST(slow_sinks_are_deferred)
+{
+  reset({ STAGE_PARSE_MS, STAGE_PROCESS_MS, STAGE_FILES_MS, 450, 400 });
+  settingInfluxDBinterval = 1;
+  settingMQTTinterval     = 10;
+  CHANGE_INTERVAL_SEC(publishMQTTtimer, 10);
+  CHECK(cost.parse + cost.process + cost.mqtt + cost.influx > 1000);
+
+  replayResult r = replay(replayStart, REPLAY_SECONDS);
+  report("slow sinks ", r);
+
+  CHECK_EQ(0, r.lost);
+  CHECK(r.maxBusyMs < 1000);
+  CHECK_EQ(0, telegramOverruns);
+  CHECK(stages[STAGE_INFLUX].deferred >= mqttSent - 1);    // every time MQTT ran
+  CHECK(mqttSent   >= (REPLAY_SECONDS / 10) - 1);
+  CHECK(influxSent >= REPLAY_SECONDS * 85 / 100);
+  for (uint8_t s = 0; s < STAGES; s++) CHECK(stages[s].deferRow <= STAGE_MAX_DEFER);
+
+  settingInfluxDBinterval = 0;
+  settingMQTTinterval     = 60;
+  CHANGE_INTERVAL_SEC(publishMQTTtimer, 60);
+}
+
+//===========================================================================================
+// a sink that never fits runs anyway after STAGE_MAX_DEFER telegrams. It
+// is counted over budget, the pipeline catches up within a telegram
+TEST(hopeless_sink_runs_anyway)
+{
+  reset({ STAGE_PARSE_MS, STAGE_PROCESS_MS, STAGE_FILES_MS, STAGE_MQTT_MS, 900 });
+  replayResult r = replay(replayStart, 600);
+  report("influx 900ms", r);
+
+  CHECK_EQ(0, r.lost);
+  CHECK(influxSent >= 600 / (10 + STAGE_MAX_DEFER +1));
+  CHECK(stages[STAGE_INFLUX].overruns > 0);
+  CHECK(telegramOverruns > 0);
+  CHECK(r.maxLateMs < 1000);
+}
+
+//===========================================================================================
+int main()
+{
+  return runTests();
+}
@@ -11,17 +11,17 @@
 
 
 //===========================================================================================
-String buildDateTimeString(const char* timeStamp, int len) 
+const char *buildDateTimeString(const char* timeStamp, int len) 
 {
-  String tmpTS = String(timeStamp);
-  String DateTime = "";
-  if (len < 12) return String(timeStamp);
-  DateTime   = "20" + tmpTS.substring(0, 2);    // YY
-  DateTime  += "-"  + tmpTS.substring(2, 4);    // MM
-  DateTime  += "-"  + tmpTS.substring(4, 6);    // DD
-  DateTime  += " "  + tmpTS.substring(6, 8);    // HH
-  DateTime  += ":"  + tmpTS.substring(8, 10);   // MM
-  DateTime  += ":"  + tmpTS.substring(10, 12);  // SS
+  static char fallBack[20];
+
+  if (len < 12 || strlen(timeStamp) < 12) return timeStamp;
+  //-- "YYMMDDhhmmss" -> "20YY-MM-DD hh:mm:ss" (in the scratch arena) --
+  char *DateTime = (char*)scratchAlloc(20);
+  if (DateTime == NULL) DateTime = fallBack;
+  snprintf(DateTime, 20, "20%.2s-%.2s-%.2s %.2s:%.2s:%.2s"
+                                , &timeStamp[0], &timeStamp[2], &timeStamp[4]
+                                , &timeStamp[6], &timeStamp[8], &timeStamp[10]);
   return DateTime;
     
 } // buildDateTimeString()
@@ -37,7 +37,7 @@ void epochToTimestamp(time_t t, char *ts, int8_t len)
   sprintf(ts, "%02d%02d%02d%02d%02d%02d", year(t)-2000, month(t), day(t)
                                         , hour(t), minute(t), second(t));
                                                
-  if (Verbose2) DebugTf("epochToTimestamp() => [%s]\r\n", ts);
+  if (Verbose2) LogTf(LOG_DEBUG, "epochToTimestamp() => [%s]\r\n", ts);
   
 } // epochToTimestamp()
 
@@ -154,6 +154,18 @@ bool isdsmrDST(const char *timeStamp) {
   }
   else return false; //then defaults to "wintertijd"
 }
+//===========================================================================================
+// the UTC epoch of a meter timestamp. The meter (and the clock, that is
+// set from its timestamps) runs on local time: SM_UTC_OFFSET plus an
+// hour when the S/W flag says it is summer time
+time_t utcEpoch(const char *timeStamp)
+{
+  int8_t offset = SM_UTC_OFFSET + (isdsmrDST(timeStamp) ? 1 : 0);
+
+  return epoch(timeStamp, strlen(timeStamp), false) - (offset * SECS_PER_HOUR);
+
+} // utcEpoch()
+
 //===========================================================================================
 // calculate epoch from timeStamp
 // if syncTime is true, set system time to calculated epoch-time
@@ -162,7 +174,7 @@ time_t epoch(const char *timeStamp, int8_t len, bool syncTime)
   char fullTimeStamp[16] = "";
 
   strlcat(fullTimeStamp, timeStamp, sizeof(fullTimeStamp));
-  if (Verbose2) DebugTf("epoch(%s) strlen([%d])\r\n", fullTimeStamp, strlen(fullTimeStamp));  
+  if (Verbose2) LogTf(LOG_DEBUG, "epoch(%s) strlen([%d])\r\n", fullTimeStamp, strlen(fullTimeStamp));  
   switch(strlen(fullTimeStamp)) {
     case  4:  //--- timeStamp is YYMM
               strlcat(fullTimeStamp, "01010101X", sizeof(fullTimeStamp));
@@ -184,7 +196,7 @@ time_t epoch(const char *timeStamp, int8_t len, bool syncTime)
   
   if (strlen(fullTimeStamp) < 13) return now();
   
-  if (Verbose2) DebugTf("DateTime: [%02d]-[%02d]-[%02d] [%02d]:[%02d]:[%02d]\r\n"
+  if (Verbose2) LogTf(LOG_DEBUG, "DateTime: [%02d]-[%02d]-[%02d] [%02d]:[%02d]:[%02d]\r\n"
                                                                  ,DayFromTimestamp(timeStamp)
                                                                  ,MonthFromTimestamp(timeStamp)
                                                                  ,YearFromTimestamp(timeStamp)